@@ -1,6 +1,6 @@
 ﻿
 #include "AppController.h"
-#include "Logger.h"
+#include "LogFormat.h"
 #include "FontManager.h"
 
 #define WIN32_LEAN_AND_MEAN
@@ -50,14 +50,33 @@ AppController::AppController(HWND mainWindow)
     : mainWindow_(mainWindow),
     resourceTracker("AppController") {
 
+    // Sự kiện cho UI: có cửa sổ → giao qua hàng đợi message của cửa sổ (WM_APP_EVENTS)
+    if (mainWindow_) AttachWin32Delivery(events_, mainWindow_);
+
     //== Khởi tạo các components chính ==
     printerModel_ = std::make_unique<PrinterModel>();   // Model lưu trạng thái máy in
     rciClient_ = std::make_unique<RciClient>();      // Client RCI Linx 8900
 
+    // Pipeline: coroutine gửi lệnh không chặn thread executor trong lúc chờ reply
+    rciClient_->SetPipelineWindow(4);
+    executor_ = std::make_unique<RciExecutor>(1);
+    rciAsync_ = std::make_unique<RciAsyncClient>(*rciClient_, *executor_);
+
+    // Lệnh dừng khẩn đang xếp hàng → lệnh ưu tiên thấp hơn không chờ reply nữa
+    rciClient_->SetPreemptCheck([this] { return PreemptRequested(); });
+
+    // Đặt biến môi trường LINX_RCI_CAPTURE=<file> để ghi lưu lượng RCI (replay bằng tools/RciReplay)
+    wchar_t capturePath[MAX_PATH];
+    DWORD capturePathLen = GetEnvironmentVariableW(L"LINX_RCI_CAPTURE", capturePath, MAX_PATH);
+    if (capturePathLen > 0 && capturePathLen < MAX_PATH) {
+        EnableWireCapture(capturePath);
+    }
+
     //== ĐĂNG KÝ CALLBACK LOG TỪ RCI CLIENT ==
     // Giả định RciClient cũ có SetMessageCallback giống bản mới
-    rciClient_->SetMessageCallback([this](const std::wstring& msg, int level) {
-        this->SendLogMessage(L"[Máy in] " + msg, level);
+    // msg trỏ vào buffer LogFormat của thread gọi → nối tay, không format lại
+    rciClient_->SetMessageCallback([this](std::wstring_view msg, int level) {
+        this->SendLogMessage(std::wstring(L"[Máy in] ").append(msg), level);
         });
 
     // ========== ĐĂNG KÝ CLEANUP TASKS ==========
@@ -65,57 +84,69 @@ AppController::AppController(HWND mainWindow)
     // 1. RCI Client cleanup
     resourceTracker.addCleanup("RciClient_Disconnect", [this]() {
         if (rciClient_) {
-            Logger::GetInstance().Write(L"Disconnecting RCI client...");
+            LogInfo(LogModule::App, L"Disconnecting RCI client...");
             rciClient_->Disconnect();
-            Logger::GetInstance().Write(L"RCI client disconnected");
+            LogInfo(LogModule::App, L"RCI client disconnected");
         }
         });
 
-    // 2. Worker thread cleanup
+    // 2. Executor cleanup (chạy trước RciClient_Disconnect)
+    resourceTracker.addCleanup("Executor_Stop", [this]() {
+        LogInfo(LogModule::App, L"Stopping coroutine executor...");
+        StopExecutor();
+        LogInfo(LogModule::App, L"Coroutine executor stopped");
+        });
+
+    // 3. Worker thread cleanup
     resourceTracker.addCleanup("WorkerThread_Stop", [this]() {
-        Logger::GetInstance().Write(L"Stopping worker thread...");
+        LogInfo(LogModule::App, L"Stopping worker thread...");
         StopWorkerThread(3000);
-        Logger::GetInstance().Write(L"Worker thread stopped");
+        LogInfo(LogModule::App, L"Worker thread stopped");
         });
 
-    // 3. Request queue cleanup
+    // 4. Request queue cleanup
     resourceTracker.addCleanup("RequestQueue_Clear", [this]() {
-        Logger::GetInstance().Write(L"Clearing request queue...");
-        // Có thể thêm logic clear queue nếu cần
-        Logger::GetInstance().Write(L"Request queue cleared");
+        LogInfo(LogModule::App, L"Clearing request queue...");
+        // worker đã dừng ở bước 3 → lấy hết 1 lần rồi bỏ, không thực hiện lệnh còn sót
+        std::vector<Request> pending;
+        size_t n = requestQueue_.DrainAll(pending);
+        LogInfo(LogModule::App, L"Request queue cleared ({} pending dropped)", n);
+
+        static const wchar_t* laneNames[kRequestPriorityCount] = { L"emergency", L"control", L"status" };
+        for (size_t i = 0; i < kRequestPriorityCount; ++i) {
+            auto s = requestQueue_.GetStats((RequestPriority)i);
+            LogInfo(LogModule::App, L"Queue {}: popped={} coalesced={} dropped={} expired={} rejected={}",
+                laneNames[i], s.popped, s.coalesced, s.dropped, s.expired, s.rejected);
+        }
         });
 
-    // 4. Model cleanup
+    // 5. Model cleanup
     resourceTracker.addCleanup("PrinterModel_Cleanup", [this]() {
         if (printerModel_) {
-            Logger::GetInstance().Write(L"Cleaning printer model...");
+            LogInfo(LogModule::App, L"Cleaning printer model...");
             printerModel_.reset();
-            Logger::GetInstance().Write(L"Printer model cleaned");
+            LogInfo(LogModule::App, L"Printer model cleaned");
         }
         });
 
-    // 5. Message callback cleanup
+    // 6. Message callback cleanup
     resourceTracker.addCleanup("MessageCallback_Clear", [this]() {
         if (rciClient_) {
-            Logger::GetInstance().Write(L"Clearing message callbacks...");
+            LogInfo(LogModule::App, L"Clearing message callbacks...");
             rciClient_->SetMessageCallback(nullptr);
-            Logger::GetInstance().Write(L"Message callbacks cleared");
+            LogInfo(LogModule::App, L"Message callbacks cleared");
         }
         });
 
-    Logger::GetInstance().Write(
-        L"AppController initialized with " +
-        std::to_wstring(resourceTracker.getPendingCleanupCount()) +
-        L" cleanup tasks"
-    );
+    LogInfo(LogModule::App, L"AppController initialized with {} cleanup tasks",
+        resourceTracker.getPendingCleanupCount());
 }
 
 AppController::~AppController() {
-    Logger::GetInstance().Write(L"AppController destructor called");
+    LogInfo(LogModule::App, L"AppController destructor called");
 
-    static std::atomic<bool> destructorCalled{ false };
-    if (destructorCalled.exchange(true)) {
-        Logger::GetInstance().Write(L"AppController destructor already called - skipping");
+    if (destroyed_.exchange(true)) {
+        LogInfo(LogModule::App, L"AppController destructor already called - skipping");
         return;
     }
 
@@ -124,10 +155,7 @@ AppController::~AppController() {
         resourceTracker.cleanupAll();
     }
     catch (const std::exception& e) {
-        Logger::GetInstance().Write(
-            L"Exception in destructor: " +
-            std::wstring(e.what(), e.what() + strlen(e.what())), 2
-        );
+        LogError(LogModule::App, L"Exception in destructor: {}", e.what());
     }
 }
 
@@ -138,33 +166,33 @@ void AppController::StartWorkerThread() {
 
     running_ = true;
     workerThread_ = std::thread(&AppController::WorkerLoop, this);
-    Logger::GetInstance().Write(L"Worker thread started");
+    LogInfo(LogModule::App, L"Worker thread started");
 }
 
 bool AppController::StopWorkerThread(int timeoutMs) {
     running_ = false;
+    requestQueue_.Wake();   // worker có thể đang chờ không hạn định
     bool success = true;
 
-    static std::atomic<bool> stopInProgress{ false };
-    if (stopInProgress.exchange(true)) {
-        Logger::GetInstance().Write(L"StopWorkerThread already in progress - skipping");
+    if (stopInProgress_.exchange(true)) {
+        LogInfo(LogModule::App, L"StopWorkerThread already in progress - skipping");
         return false;
     }
 
     struct ScopeGuard {
         std::atomic<bool>& flag;
         ~ScopeGuard() { flag.store(false, std::memory_order_release); }
-    } guard{ stopInProgress };
+    } guard{ stopInProgress_ };
 
     try {
         if (!workerThread_.joinable()) {
-            Logger::GetInstance().Write(L"Worker thread already stopped");
+            LogInfo(LogModule::App, L"Worker thread already stopped");
             return true;
         }
 
         if (timeoutMs <= 0) {
             workerThread_.join();
-            Logger::GetInstance().Write(L"Worker thread stopped gracefully");
+            LogInfo(LogModule::App, L"Worker thread stopped gracefully");
         }
         else {
             std::future<void> future;
@@ -176,65 +204,50 @@ bool AppController::StopWorkerThread(int timeoutMs) {
                         }
                     }
                     catch (const std::exception& e) {
-                        Logger::GetInstance().Write(
-                            L"Join failed in async: " +
-                            std::wstring(e.what(), e.what() + strlen(e.what())), 2
-                        );
+                        LogError(LogModule::App, L"Join failed in async: {}", e.what());
                     }
                     });
             }
             catch (const std::exception& e) {
-                Logger::GetInstance().Write(
-                    L"Failed to create async task: " +
-                    std::wstring(e.what(), e.what() + strlen(e.what())), 2
-                );
+                LogError(LogModule::App, L"Failed to create async task: {}", e.what());
                 return false;
             }
 
             auto status = future.wait_for(std::chrono::milliseconds(timeoutMs));
             if (status == std::future_status::timeout) {
-                Logger::GetInstance().Write(L"Worker thread stop timeout - emergency detach", 2);
+                LogError(LogModule::App, L"Worker thread stop timeout - emergency detach");
                 success = false;
 
                 try {
                     if (workerThread_.joinable()) {
                         workerThread_.detach();
-                        Logger::GetInstance().Write(L"Worker thread emergency detached");
+                        LogInfo(LogModule::App, L"Worker thread emergency detached");
                     }
                 }
                 catch (const std::exception& e) {
-                    Logger::GetInstance().Write(
-                        L"Emergency detach failed: " +
-                        std::wstring(e.what(), e.what() + strlen(e.what())), 2
-                    );
+                    LogError(LogModule::App, L"Emergency detach failed: {}", e.what());
                 }
             }
             else if (status == std::future_status::ready) {
-                Logger::GetInstance().Write(L"Worker thread stopped with timeout");
+                LogInfo(LogModule::App, L"Worker thread stopped with timeout");
             }
         }
     }
     catch (const std::system_error& e) {
-        Logger::GetInstance().Write(
-            L"System error in StopWorkerThread: " +
-            std::wstring(e.what(), e.what() + strlen(e.what())), 2
-        );
+        LogError(LogModule::App, L"System error in StopWorkerThread: {}", e.what());
         success = false;
         try {
             if (workerThread_.joinable()) {
                 workerThread_.detach();
-                Logger::GetInstance().Write(L"Worker thread detached after join failure");
+                LogInfo(LogModule::App, L"Worker thread detached after join failure");
             }
         }
         catch (...) {
-            Logger::GetInstance().Write(L"Final detach also failed", 2);
+            LogError(LogModule::App, L"Final detach also failed");
         }
     }
     catch (const std::exception& e) {
-        Logger::GetInstance().Write(
-            L"General error in StopWorkerThread: " +
-            std::wstring(e.what(), e.what() + strlen(e.what())), 2
-        );
+        LogError(LogModule::App, L"General error in StopWorkerThread: {}", e.what());
         success = false;
     }
 
@@ -244,27 +257,25 @@ bool AppController::StopWorkerThread(int timeoutMs) {
 // ================== Emergency / Comprehensive Cleanup ==================
 
 void AppController::EmergencyCleanup() {
-    Logger::GetInstance().Write(L"⚠️ EMERGENCY CLEANUP INITIATED");
+    LogInfo(LogModule::App, L"⚠️ EMERGENCY CLEANUP INITIATED");
 
     static std::atomic<bool> emergencyCleanupInProgress{ false };
     if (emergencyCleanupInProgress.exchange(true)) {
-        Logger::GetInstance().Write(L"EmergencyCleanup already in progress");
+        LogInfo(LogModule::App, L"EmergencyCleanup already in progress");
         return;
     }
 
     running_ = false;
+    CancelPendingOps();
 
     try {
         if (workerThread_.joinable()) {
             workerThread_.detach();
-            Logger::GetInstance().Write(L"Worker thread emergency detached");
+            LogInfo(LogModule::App, L"Worker thread emergency detached");
         }
     }
     catch (const std::exception& e) {
-        Logger::GetInstance().Write(
-            L"Emergency detach failed: " +
-            std::wstring(e.what(), e.what() + strlen(e.what())), 2
-        );
+        LogError(LogModule::App, L"Emergency detach failed: {}", e.what());
     }
 
     if (rciClient_) {
@@ -272,15 +283,15 @@ void AppController::EmergencyCleanup() {
     }
 
     resourceTracker.clearWithoutCleanup();
-    Logger::GetInstance().Write(L"⚠️ EMERGENCY CLEANUP COMPLETED");
+    LogInfo(LogModule::App, L"⚠️ EMERGENCY CLEANUP COMPLETED");
 }
 
 void AppController::ComprehensiveCleanup() {
-    Logger::GetInstance().Write(L"=== STARTING COMPREHENSIVE CLEANUP ===");
+    LogInfo(LogModule::App, L"=== STARTING COMPREHENSIVE CLEANUP ===");
 
     static std::atomic<bool> comprehensiveCleanupInProgress{ false };
     if (comprehensiveCleanupInProgress.exchange(true)) {
-        Logger::GetInstance().Write(L"ComprehensiveCleanup already in progress");
+        LogInfo(LogModule::App, L"ComprehensiveCleanup already in progress");
         return;
     }
 
@@ -289,22 +300,25 @@ void AppController::ComprehensiveCleanup() {
         ~ScopeGuard() { flag = false; }
     } guard{ comprehensiveCleanupInProgress };
 
-    Logger::GetInstance().Write(L"1. Stopping worker threads...");
+    LogInfo(LogModule::App, L"1. Stopping worker threads...");
     if (!StopWorkerThread(5000)) {
-        Logger::GetInstance().Write(L"⚠️ Worker thread stop timeout - emergency mode", 1);
+        LogWarning(LogModule::App, L"⚠️ Worker thread stop timeout - emergency mode");
     }
 
-    Logger::GetInstance().Write(L"2. Closing network connections...");
+    StopExecutor();
+
+    LogInfo(LogModule::App, L"2. Closing network connections...");
     if (rciClient_) {
         rciClient_->Disconnect();
     }
+    statusHistory_.Close();     // ghi nốt khối lịch sử trạng thái đang dở
 
-    Logger::GetInstance().Write(L"3. Releasing GDI resources...");
+    LogInfo(LogModule::App, L"3. Releasing GDI resources...");
     FontManager::GetInstance().Cleanup();
 
-    Logger::GetInstance().Write(L"4. Clearing containers...");
+    LogInfo(LogModule::App, L"4. Clearing containers...");
 
-    Logger::GetInstance().Write(L"5. Additional resource cleanup...");
+    LogInfo(LogModule::App, L"5. Additional resource cleanup...");
 
     printerModel_.reset();
     rciClient_.reset();
@@ -312,21 +326,22 @@ void AppController::ComprehensiveCleanup() {
 
     resourceTracker.cleanupAll();
 
-    Logger::GetInstance().Write(L"=== COMPREHENSIVE CLEANUP COMPLETED ===");
+    LogInfo(LogModule::App, L"=== COMPREHENSIVE CLEANUP COMPLETED ===");
 }
 
 // ================== UI Public API ==================
 
-void AppController::Connect(const std::wstring& ipAddress) {
+void AppController::Connect(const std::wstring& ipAddress, int port) {
 
     Request req{ RequestType::RequestConnect };
     req.data = ipAddress;
-    requestQueue_.Push(req);
+    req.port = port;
+    PushRequest(std::move(req));
 }
 
 void AppController::Disconnect() {
     Request req{ RequestType::RequestDisconnect };
-    requestQueue_.Push(req);
+    PushRequest(std::move(req));
 }
 
 void AppController::StartPrinting(const std::wstring& content, int count) {
@@ -343,28 +358,49 @@ void AppController::StartPrinting(const std::wstring& content, int count) {
     Request req{ RequestType::RequestStartPrint };
     req.data = content;
     req.count = count;
-    requestQueue_.Push(req);
+    PushRequest(std::move(req));
 }
 
 void AppController::StopPrinting() {
     Request req{ RequestType::RequestStopPrint };
-    requestQueue_.Push(req);
+    PushRequest(std::move(req));
 }
 
 void AppController::SetCount(int count) {
     Request req{ RequestType::RequestSetCount };
     req.count = count;
-    requestQueue_.Push(req);
+    PushRequest(std::move(req));
 }
 
 void AppController::StartJet() {
     Request req{ RequestType::RequestStartJet };
-    requestQueue_.Push(req);
+    PushRequest(std::move(req));
 }
 
 void AppController::StopJet() {
     Request req{ RequestType::RequestStopJet };
-    requestQueue_.Push(req);
+    PushRequest(std::move(req));
+}
+
+void AppController::PushRequest(Request request) {
+    RequestPriority priority = PriorityOf(request.type);
+    // lệnh dừng Push sau StartPrint hủy cả chuỗi lệnh của nó, kể cả khi worker đã lấy StartPrint
+    // ra nhưng executor chưa chạy tới StartPrintSequence
+    if (request.type == RequestType::RequestStartPrint)
+        request.opsGeneration = CurrentOpsGeneration();
+    if (!requestQueue_.Push(std::move(request)))
+        LogInfo(LogModule::App, L"Request queue full, request rejected");
+
+    if (priority == RequestPriority::Emergency) {
+        CancelPendingOps();     // chuỗi bật jet / load / in trên executor dừng ngay
+        if (currentPriority_ != RequestPriority::Emergency && rciClient_)
+            rciClient_->CancelWaits();  // worker thôi chờ reply → lấy lệnh dừng ra ngay
+    }
+}
+
+bool AppController::PreemptRequested() const {
+    return currentPriority_ != RequestPriority::Emergency &&
+        requestQueue_.HasPending(RequestPriority::Emergency);
 }
 
 bool AppController::ValidatePrintContent(const std::wstring& content) {
@@ -378,89 +414,87 @@ bool AppController::ValidatePrintCount(int count) {
 // ================== WORKER THREAD LOOP ==================
 
 void AppController::WorkerLoop() {
+    using Clock = std::chrono::steady_clock;
     const auto POLL_INTERVAL = std::chrono::milliseconds(500);
     const auto RECONNECT_INTERVAL = std::chrono::seconds(2);
 
+    // Lịch của worker: không ngủ cố định, chỉ chờ tới mốc gần nhất.
+    // Request từ UI đánh thức ngay; poll STATUS và reconnect là các mốc thời gian.
+    Clock::time_point nextPoll = Clock::now();
+    Clock::time_point nextReconnect = Clock::now();
+    bool wasConnected = false;
+
     try {
         while (running_) {
             try {
+                bool connected = (rciClient_ && rciClient_->IsConnected());
+
+                // vừa kết nối → poll ngay; vừa mất kết nối → reconnect ngay
+                if (connected != wasConnected) {
+                    // ngắt do người dùng đã log ở HandleDisconnectRequest (autoReconnect_ đã tắt)
+                    if (wasConnected && autoReconnect_)
+                        LogWarning(LogModule::App, L"Disconnected from printer (connection lost, error: {})", rciClient_->LastError());
+                    nextPoll = nextReconnect = Clock::now();
+                    wasConnected = connected;
+                }
+
+                Clock::time_point due;
+                if (connected) {
+                    due = nextPoll;
+                }
+                else if (printerModel_->GetSnapshot()->status == PrinterStateType::Connecting) {
+                    // đang kết nối ở nơi khác → xem lại sau 1 chu kỳ
+                    due = Clock::now() + POLL_INTERVAL;
+                }
+                else if (CanReconnect()) {
+                    due = nextReconnect;
+                }
+                else {
+                    // không còn gì để làm tới khi có request / Wake()
+                    if (!autoReconnect_) reconnectAttempts_ = 0;
+                    due = Clock::time_point::max();
+                }
 
                 //---------------------------------------------------------
                 // 0) ƯU TIÊN TUYỆT ĐỐI: XỬ LÝ REQUEST TỪ UI TRƯỚC
                 //---------------------------------------------------------
                 Request req;
-                if (requestQueue_.Pop(req, 50)) {
+                if (requestQueue_.PopUntil(req, due)) {
+                    currentPriority_ = PriorityOf(req.type);
                     HandleRequest(req);
-                    std::this_thread::sleep_for(POLL_INTERVAL);
-                    continue;      
+                    currentPriority_ = RequestPriority::Status;
+                    continue;
                 }
+                if (!running_) break;
+
+                auto now = Clock::now();
+                if (now < due) continue;    // bị Wake() → tính lại lịch
 
                 //---------------------------------------------------------
-                // 1) KIỂM TRA KẾT NỐI
+                // 1) ĐÃ KẾT NỐI → POLL ĐỊNH KỲ
                 //---------------------------------------------------------
-                bool connected = (rciClient_ && rciClient_->IsConnected());
-                PrinterState currentState = printerModel_->GetState();
-
-                if (!connected) {
-
-                    //-----------------------------------------------------
-                    // 1.1) Nếu đang CONNECTING → KHÔNG reconnect
-                    //-----------------------------------------------------
-                    if (currentState.status == PrinterStateType::Connecting) {
-                        std::this_thread::sleep_for(POLL_INTERVAL);
-                        continue;
-                    }
-
-                    //-----------------------------------------------------
-                    // 1.2) Nếu autoReconnect TẮT → không reconnect
-                    //-----------------------------------------------------
-                    if (!autoReconnect_) {
-                        reconnectAttempts_ = 0;
-                        std::this_thread::sleep_for(POLL_INTERVAL);
-                        continue;
-                    }
-
-                    //-----------------------------------------------------
-                    // 1.3) Không có IP → không reconnect
-                    //-----------------------------------------------------
-                    auto lastIp = printerModel_->GetIpAddress();
-                    if (lastIp.empty()) {
-                        static int logCounter = 0;
-                        if (logCounter++ % 20 == 0)
-
-                        std::this_thread::sleep_for(POLL_INTERVAL);
-                        continue;
-                    }
-
-                    //-----------------------------------------------------
-                    // 1.4) Giới hạn số lần reconnect
-                    //-----------------------------------------------------
-                    if (reconnectAttempts_ >= MAX_RECONNECT_ATTEMPTS) {
-                        std::this_thread::sleep_for(POLL_INTERVAL);
-                        continue;
-                    }
-
-                    //-----------------------------------------------------
-                    // 1.5) Thực hiện reconnect
-                    //-----------------------------------------------------
-                    TryReconnect();
-                    std::this_thread::sleep_for(RECONNECT_INTERVAL);
+                if (connected) {
+                    DoPeriodicPoll();
+                    // giữ nhịp 500 ms; bị trễ quá 1 chu kỳ thì tính lại từ bây giờ
+                    nextPoll += POLL_INTERVAL;
+                    if (nextPoll < now) nextPoll = now + POLL_INTERVAL;
                     continue;
                 }
 
                 //---------------------------------------------------------
-                // 2) Nếu đã kết nối → poll hoặc idle
+                // 2) MẤT KẾT NỐI → RECONNECT (request Connect đi qua queue)
                 //---------------------------------------------------------
-                DoPeriodicPoll();
-                std::this_thread::sleep_for(POLL_INTERVAL);
+                if (CanReconnect()) {
+                    TryReconnect();
+                    nextReconnect = now + RECONNECT_INTERVAL;
+                }
             }
 
             //-------------------------------------------------------------
             // Catch lỗi trong vòng lặp nội bộ
             //-------------------------------------------------------------
             catch (const std::exception& e) {
-                SendLogMessage(L"Lỗi trong WorkerLoop: " +
-                    std::wstring(e.what(), e.what() + strlen(e.what())), 2);
+                SendLogFormatted(2, L"Lỗi trong WorkerLoop: {}", e.what());
                 std::this_thread::sleep_for(POLL_INTERVAL);
             }
             catch (...) {
@@ -474,10 +508,10 @@ void AppController::WorkerLoop() {
     // Catch lỗi crash toàn bộ loop
     //-------------------------------------------------------------
     catch (...) {
-        Logger::GetInstance().Write(L"CRITICAL: WorkerLoop bị crash", 2);
+        LogError(LogModule::App, L"CRITICAL: WorkerLoop bị crash");
     }
 
-    Logger::GetInstance().Write(L"WorkerLoop exited normally");
+    LogInfo(LogModule::App, L"WorkerLoop exited normally");
 }
 
 void AppController::HandleRequest(const Request& request) {
@@ -504,6 +538,10 @@ void AppController::HandleRequest(const Request& request) {
         case RequestType::RequestStopJet:
             HandleStopJetRequest();
             break;
+        case RequestType::RequestPrintJetStarting:
+        case RequestType::RequestPrintStarted:
+            HandlePrintProgress(request);
+            break;
         default:
             break;
         }
@@ -511,9 +549,7 @@ void AppController::HandleRequest(const Request& request) {
         SendStateUpdate();
     }
     catch (const std::exception& e) {
-        std::string errorMsg = e.what();
-        SendLogMessage(L"Lỗi xử lý request: " +
-            std::wstring(errorMsg.begin(), errorMsg.end()), 2);
+        SendLogFormatted(2, L"Lỗi xử lý request: {}", e.what());
     }
 }
 
@@ -521,8 +557,11 @@ void AppController::HandleRequest(const Request& request) {
 
 void AppController::HandleDisconnectRequest() {
     DisableAutoReconnect();
+    CancelPendingOps();
     if (rciClient_) {
+        bool wasConnected = rciClient_->IsConnected();
         rciClient_->Disconnect();
+        if (wasConnected) LogInfo(LogModule::App, L"Disconnected from printer (user request)");
     }
 
     PrinterState disconnectedState;
@@ -561,7 +600,8 @@ void AppController::HandleStatusRequest() {
     if (!rciClient_ || !rciClient_->IsConnected())
         return;
 
-    PrinterStatus raw = rciClient_->RequestStatusEx();
+    PrinterStatus raw;
+    bool valid = rciClient_->RequestStatusEx(raw);
     if (!rciClient_->IsConnected()) {
         return; // socket chết, dừng poll
     }
@@ -572,8 +612,21 @@ void AppController::HandleStatusRequest() {
         L" Print=" + std::to_wstring(raw.printState) +
         L" ErrMask=0x" + std::to_wstring(raw.errorMask);
 
+    LogDebug(LogModule::App, L"Poll status: jet={} print={} errMask=0x{} printing={}",
+        raw.jetState, raw.printState, LogHex{ raw.errorMask, 8 }, raw.printing);
+
     printerModel_->SetStatusText(text);
 
+    StatusSample sample;
+    sample.timeMs = StatusHistory::NowMs();
+    sample.errorMask = raw.errorMask;
+    sample.count = printerModel_->GetCurrentCount();
+    sample.jetState = raw.jetState;
+    sample.printState = raw.printState;
+    sample.flags = (raw.jetOn ? StatusFlagJetOn : 0) | (raw.printing ? StatusFlagPrinting : 0) | (raw.paused ? StatusFlagPaused : 0);
+    // poll lỗi (timeout / NAK) trả trạng thái toàn 0: không ghi, tránh mask lỗi giả 0 / jet tắt giả
+    if (valid) statusHistory_.Record(sample);
+
     PrinterState st = printerModel_->GetState(); // lấy state cũ
 
     // ----- Mapping FLAGS -----
@@ -619,10 +672,6 @@ void AppController::HandleStartPrintRequest(const Request& req) {
         return;
     }
 
-    // auto bật jet
-    if (!HandleStartJetRequest())
-        return;
-
     // chuẩn hóa tên message 8 ký tự
     std::wstring wname = req.data;
     if (wname.size() > 8) wname = wname.substr(0, 8);
@@ -632,19 +681,77 @@ void AppController::HandleStartPrintRequest(const Request& req) {
     name.resize(len);
     WideCharToMultiByte(CP_ACP, 0, wname.c_str(), -1, &name[0], len, NULL, NULL);
 
-    if (!rciClient_->LoadMessage(name, (uint16_t)req.count)) {
-        SendLogMessage(L"Lỗi LoadMessage", 2);
-        return;
+    // Chạy chuỗi lệnh trên executor → worker thread quay lại xử lý request / poll ngay
+    RciSpawn(*executor_, StartPrintSequence(req.data, name, req.count, req.opsGeneration),
+        [this](std::exception_ptr error) {
+            if (!error) return;
+            try { std::rethrow_exception(error); }
+            catch (const std::exception& e) {
+                SendLogFormatted(2, L"Lỗi chuỗi lệnh in: {}", e.what());
+            }
+            catch (...) {
+                SendLogMessage(L"Lỗi không xác định trong chuỗi lệnh in", 2);
+            }
+        });
+}
+
+// bật jet → LoadMessage → StartPrint, mỗi bước chờ reply mà không giữ thread.
+// Chạy trên thread executor: không đụng PrinterModel, gửi kết quả về worker (HandlePrintProgress)
+RciTask<void> AppController::StartPrintSequence(std::wstring job, std::string name, int count, uint64_t generation) {
+    // StopPrint / StopJet / ngắt kết nối sau lúc bấm in → không gửi lệnh nào
+    RciCancelToken cancel;
+    if (!CancelTokenFor(generation, cancel))
+        co_return;
+
+    // auto bật jet: CHỈ gửi lệnh, không check jetOn ngay lập tức (giống HandleStartJetRequest)
+    RciResult jet = co_await rciAsync_->StartJet(3000, cancel);
+    if (jet.status == RciResult::Status::Cancelled || !rciClient_->IsConnected())
+        co_return;
+
+    Request jetStarting;
+    jetStarting.type = RequestType::RequestPrintJetStarting;
+    jetStarting.opsGeneration = generation;
+    PushRequest(std::move(jetStarting));
+    SendLogMessage(L"Khởi động Jet - đang chờ phản hồi...");
+
+    RciResult load = co_await rciAsync_->LoadMessage(name, (uint16_t)count, 3000, cancel);
+    if (!load.Ok()) {
+        if (load.status != RciResult::Status::Cancelled)
+            SendLogMessage(L"Lỗi LoadMessage", 2);
+        co_return;
     }
 
-    if (!rciClient_->StartPrint()) {
-        SendLogMessage(L"Lỗi StartPrint", 2);
-        return;
+    RciResult start = co_await rciAsync_->StartPrint(3000, cancel);
+    if (!start.Ok()) {
+        if (start.status != RciResult::Status::Cancelled)
+            SendLogMessage(L"Lỗi StartPrint", 2);
+        co_return;
     }
 
-    printerModel_->SetCurrentJob(req.data, req.count);
+    Request started;
+    started.type = RequestType::RequestPrintStarted;
+    started.data = std::move(job);
+    started.count = count;
+    started.opsGeneration = generation;
+    PushRequest(std::move(started));
+}
+
+// Worker thread: cập nhật model theo kết quả StartPrintSequence
+void AppController::HandlePrintProgress(const Request& req) {
+    // dừng in / ngắt kết nối sau khi máy in trả lời → trạng thái mới hơn, bỏ kết quả cũ
+    if (!IsCurrentOps(req.opsGeneration))
+        return;
 
     PrinterState st = printerModel_->GetState();
+    if (req.type == RequestType::RequestPrintJetStarting) {
+        st.status = PrinterStateType::StartingJet;
+        st.statusText = L"Đang khởi động Jet...";
+        printerModel_->SetState(st);
+        return;
+    }
+
+    printerModel_->SetCurrentJob(req.data, req.count);
+    st = printerModel_->GetState();
     st.printing = true;
     st.jetOn = true;
     st.status = PrinterStateType::Printing;
@@ -652,7 +759,42 @@ void AppController::HandleStartPrintRequest(const Request& req) {
     printerModel_->SetState(st);
 }
 
+uint64_t AppController::CurrentOpsGeneration() {
+    std::lock_guard<std::mutex> lock(cancelMtx_);
+    return opsGeneration_;
+}
+
+// Kiểm tra lượt và lấy token trong cùng 1 lần khóa: CancelPendingOps chạy sau đó sẽ hủy token này
+bool AppController::CancelTokenFor(uint64_t generation, RciCancelToken& token) {
+    std::lock_guard<std::mutex> lock(cancelMtx_);
+    if (generation != opsGeneration_) return false;
+    token = opsCancel_.Token();
+    return true;
+}
+
+bool AppController::IsCurrentOps(uint64_t generation) {
+    std::lock_guard<std::mutex> lock(cancelMtx_);
+    return generation == opsGeneration_;
+}
+
+void AppController::CancelPendingOps() {
+    RciCancelSource old;
+    {
+        std::lock_guard<std::mutex> lock(cancelMtx_);
+        old = opsCancel_;
+        opsCancel_ = RciCancelSource();     // chuỗi lệnh mới dùng nguồn hủy mới
+        ++opsGeneration_;
+    }
+    old.Cancel();
+}
+
+void AppController::StopExecutor() {
+    CancelPendingOps();
+    if (executor_) executor_->Stop();
+}
+
 void AppController::HandleStopPrintRequest() {
+    CancelPendingOps();     // bỏ chuỗi bật jet / load / in còn dang dở
     if (rciClient_->IsConnected())
         rciClient_->StopPrint();
 
@@ -716,13 +858,24 @@ void AppController::HandleConnectRequest(const Request& req)
     printerModel_->SetState(s);
     SendStateUpdate();
 
-    // Lưu IP
-    printerModel_->SetConnectionInfo(req.data, 9100);
+    // Lưu IP + cổng (reconnect dùng lại)
+    printerModel_->SetConnectionInfo(req.data, req.port);
 
-    bool ok = rciClient_->Connect(req.data, 9100, 3000);
+    bool ok = rciClient_->Connect(req.data, (unsigned short)req.port, 3000);
 
     PrinterState st = printerModel_->GetState();
 
+    // Dòng cố định cho tools/LogAnalyzer (uptime / reconnect / mã lỗi): không đổi câu chữ
+    if (ok) LogInfo(LogModule::App, L"Connected to printer {}:{}", req.data, req.port);
+    else LogError(LogModule::App, L"Connection failed to {}:{}, error: {}", req.data, req.port, rciClient_->LastError());
+
+    // lịch sử trạng thái theo từng máy in (đổi IP → mở file của máy kia)
+    if (ok && (!statusHistory_.IsOpen() || historyPrinter_ != req.data)) {
+        historyPrinter_ = req.data;
+        if (!statusHistory_.Open(req.data))
+            LogWarning(LogModule::App, L"Cannot open status history for {}", req.data);
+    }
+
     if (!ok)
     {
         //-------------------------------------------------------
@@ -771,7 +924,13 @@ void AppController::HandleConnectRequest(const Request& req)
 
 void AppController::HandleSetCountRequest(const Request& request) {
     printerModel_->SetCurrentJob(L"", request.count);
-    SendLogMessage(L"Đã đặt số lượng in: " + std::to_wstring(request.count));
+    SendLogFormatted(0, L"Đã đặt số lượng in: {}", request.count);
+}
+
+bool AppController::CanReconnect() const {
+    return autoReconnect_ &&
+        reconnectAttempts_ < MAX_RECONNECT_ATTEMPTS &&
+        !printerModel_->GetIpAddress().empty();
 }
 
 void AppController::TryReconnect() {
@@ -786,13 +945,14 @@ void AppController::TryReconnect() {
 
     reconnectAttempts_++;
 
-    SendLogMessage(
-        L"Tự động reconnect lần " + std::to_wstring(reconnectAttempts_) +
-        L" tới " + lastIp + L"...", 1);
+    SendLogFormatted(1, L"Tự động reconnect lần {} tới {}...", reconnectAttempts_.load(), lastIp);
 
     Request req{ RequestType::RequestConnect };
     req.data = lastIp;
-    requestQueue_.Push(req);
+    req.port = printerModel_->GetPort();
+    // chưa tới lượt trong 2s thì bỏ: vòng reconnect sau sẽ tạo request mới
+    req.expiresAt = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    requestQueue_.Push(std::move(req));
 }
 
 // ================== STATE MACHINE LOGIC ==================
@@ -802,27 +962,25 @@ bool AppController::ShouldPollStatus() const {
 }
 
 bool AppController::ShouldGetPrintCount() const {
-    auto state = printerModel_->GetState();
-    return state.status == PrinterStateType::Printing;
+    return printerModel_->GetSnapshot()->status == PrinterStateType::Printing;
 }
 
 bool AppController::ShouldAutoStartJet() const {
-    auto state = printerModel_->GetState();
-    return (state.status == PrinterStateType::Connected ||
-        state.status == PrinterStateType::Idle) &&
+    auto state = printerModel_->GetSnapshot();
+    return (state->status == PrinterStateType::Connected ||
+        state->status == PrinterStateType::Idle) &&
         printerModel_->HasPendingPrintJob();
 }
 
 void AppController::UpdatePrinterState()
 {
-    auto currentState = printerModel_->GetState();
-
     if (!rciClient_ || !rciClient_->IsConnected())
     {
+        auto currentState = printerModel_->GetSnapshot();
 
         // 🟡 Đang auto-reconnect và còn lượt thử → ép trạng thái về Connecting (màu vàng)
         if (autoReconnect_ && reconnectAttempts_ < MAX_RECONNECT_ATTEMPTS) {
-            PrinterState st = currentState;
+            PrinterState st = *currentState;
             st.status = PrinterStateType::Reconnecting;
             st.statusText = L"Đang kết nối lại...";
             printerModel_->SetState(st);
@@ -831,9 +989,9 @@ void AppController::UpdatePrinterState()
         }
 
         // 🔴 Không autoReconnect hoặc đã hết lượt → chuyển sang Disconnected/mất kết nối
-        if (currentState.status != PrinterStateType::Disconnected &&
-            currentState.status != PrinterStateType::Connecting &&
-            currentState.status != PrinterStateType::Reconnecting)
+        if (currentState->status != PrinterStateType::Disconnected &&
+            currentState->status != PrinterStateType::Connecting &&
+            currentState->status != PrinterStateType::Reconnecting)
         {
 
             SendLogMessage(L"🔌 Mất kết nối với máy in", 2);
@@ -854,35 +1012,36 @@ void AppController::UpdatePrinterState()
 // ================== THREAD-SAFE UI UPDATES ==================
 
 void AppController::SendStateUpdate() {
-    if (!mainWindow_) return;
-
-    auto state = printerModel_->GetState();
+    auto state = printerModel_->GetSnapshot();
     auto statusText = printerModel_->GetStatusText();
-    auto* msg = new PrinterStateMessage{ state, statusText, L"" };
 
-    if (!PostMessage(mainWindow_, WM_APP_PRINTER_UPDATE, (WPARAM)msg, 0)) {
-        delete msg;
-        Logger::GetInstance().Write(L"PostMessage failed for state update", 2);
+    // So với lần gửi trước từng trường; không có trường UI quan tâm nào đổi → không gửi
+    std::lock_guard<std::mutex> lock(publishMtx_);
+    uint32_t changed = StateFieldAll;
+    if (lastPublished_) {
+        if (lastPublished_->version == state->version && lastPublishedText_ == statusText) return;
+        changed = state->DiffFields(*lastPublished_);
+        if (lastPublishedText_ != statusText) changed |= StateFieldStatusText;
     }
-}
-
-void AppController::SendLogMessage(const std::wstring& text, int level) {
-    if (!mainWindow_) return;
+    changed &= statePublishMask_.load(std::memory_order_relaxed);
+    if (changed == 0) return;
 
-    auto* msg = new LogMessage{ text, level };
-    if (!PostMessage(mainWindow_, WM_APP_LOG, (WPARAM)msg, 0)) {
-        delete msg;
+    // chưa ai nghe → lần sau gửi đủ cho người nghe đầu tiên
+    if (!events_.Publish<PrinterStateMessage>(PrinterStateMessage{ *state, statusText, L"", changed })) {
+        lastPublished_.reset();
+        return;
     }
+    lastPublished_ = std::move(state);
+    lastPublishedText_ = std::move(statusText);
 }
 
-void AppController::SendConnectionUpdate(bool connected) {
-    if (!mainWindow_) return;
+void AppController::SendLogMessage(std::wstring text, int level) {
+    events_.Publish<LogMessage>(LogMessage{ std::move(text), level });
+}
 
-    auto ip = printerModel_->GetIpAddress();
-    auto* msg = new ConnectionMessage{ connected, ip, 9100 };
-    if (!PostMessage(mainWindow_, WM_APP_CONNECTION_UPDATE, (WPARAM)msg, 0)) {
-        delete msg;
-    }
+void AppController::SendConnectionUpdate(bool connected) {
+    events_.Publish<ConnectionMessage>(
+        ConnectionMessage{ connected, printerModel_->GetIpAddress(), printerModel_->GetPort() });
 }
 
 PrinterState AppController::GetCurrentState() const {
@@ -895,6 +1054,23 @@ bool AppController::IsConnected() const {
 void AppController::SetLastIp(const std::wstring& ip) {
     if (printerModel_) {
         printerModel_->SetConnectionInfo(ip, 9100);
+        requestQueue_.Wake();   // có IP → worker có thể lên lịch reconnect
+    }
+}
+
+void AppController::SetCommandObserver(RciClient::CommandObserver observer) {
+    if (rciClient_) rciClient_->SetCommandObserver(std::move(observer));
+}
+
+bool AppController::EnableWireCapture(const std::wstring& path) {
+    auto capture = std::make_shared<RciCapture>();
+    if (!capture->Open(path)) {
+        LogError(LogModule::App, L"Không mở được file capture: {}", path);
+        return false;
     }
+    capture_ = capture;
+    rciClient_->SetCapture(capture);
+    LogInfo(LogModule::App, L"Ghi lưu lượng RCI vào {}", path);
+    return true;
 }
 
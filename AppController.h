@@ -8,16 +8,24 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <functional>
 #include <string>
 
 #include "RciClient.h"       
+#include "RciAsync.h"
+#include "RciExecutor.h"
+#include "RciTask.h"
 #include "PrinterModel.h"
 #include "MessageDef.h"
+#include "EventBus.h"
+#include "EventBusWin32.h"
 #include "ThreadSafeQueue.h"
 #include "CommonTypes.h"
 #include "RequestQueue.h"
 #include "ResourceTracker.h"
+#include "LogFormat.h"
+#include "StatusHistory.h"
 
 // Forward declarations
 class RciClient;
@@ -35,7 +43,7 @@ public:
 	void ComprehensiveCleanup();
 
 	//===== Public API for UI - chỉ push request vào queue =====
-	void Connect(const std::wstring& ipAddress);
+	void Connect(const std::wstring& ipAddress, int port = 9100);
 	void Disconnect();
 	void StartPrinting(const std::wstring& content, int count);
 	void StopPrinting();
@@ -47,11 +55,27 @@ public:
 	bool ValidatePrintContent(const std::wstring& content);
 	bool ValidatePrintCount(int count);
 	void DisableAutoReconnect() { autoReconnect_ = false; }
-	void EnableAutoReconnect() { autoReconnect_ = true; }
+	void EnableAutoReconnect() { autoReconnect_ = true; requestQueue_.Wake(); }
 	//======= Getter methods =====
 	PrinterState GetCurrentState() const; //Lấy trạng thái đang lưu trong PrinterModel
 	bool IsConnected() const;            //Kiểm tra trạng thái kết nối từ RciClient
 	void SetLastIp(const std::wstring& ip);
+	// Quan sát thời gian round trip từng lệnh RCI (benchmark); gọi trước Connect
+	void SetCommandObserver(RciClient::CommandObserver observer);
+	// Ghi lưu lượng RCI ra file nhị phân (xem RciCapture); gọi trước StartWorkerThread
+	bool EnableWireCapture(const std::wstring& path);
+	// Trường PrinterState mà UI hiển thị: chỉ các trường này đổi mới gửi WM_APP_PRINTER_UPDATE.
+	// Bộ đếm / jobId đổi mỗi lần poll khi đang in nhưng UI không dùng → mặc định bỏ qua.
+	static constexpr uint32_t kUiStateFields =
+		StateFieldStatus | StateFieldJetOn | StateFieldPrinting | StateFieldErrorMessage | StateFieldStatusText;
+	void SetStatePublishMask(uint32_t fields) { statePublishMask_ = fields; }
+	// Sự kiện gửi UI (LogMessage, PrinterStateMessage, ConnectionMessage): Subscribe từ thread UI,
+	// Dispatch khi nhận WM_APP_EVENTS (hoặc tự gọi định kỳ nếu không có cửa sổ)
+	EventBus& Events() { return events_; }
+	// Thời gian request chờ trong queue theo lớp ưu tiên
+	RequestQueue::LaneStats GetQueueStats(RequestPriority priority) const { return requestQueue_.GetStats(priority); }
+	// Lịch sử trạng thái poll của máy in đang / vừa kết nối (truy vấn được từ thread bất kỳ)
+	const StatusHistory& GetStatusHistory() const { return statusHistory_; }
 	//================= WORKER THREAD MANAGEMENT =================
 	void StartWorkerThread();               //khởi động worker thread
 	bool StopWorkerThread(int timeoutMs);   //dừng worker thread với timeout
@@ -59,13 +83,32 @@ public:
 private:
 	ResourceTracker resourceTracker;               // Quản lý cleanup resources
 	HWND mainWindow_;                              // Handle của cửa sổ chính
+	EventBus events_;                              // sự kiện gửi UI (hủy sau mọi thành phần có thể Publish)
 	std::unique_ptr<RciClient> rciClient_;         // Client RCI Linx 8900
 	std::unique_ptr<PrinterModel> printerModel_;   // Model lưu trạng thái máy in
+	std::shared_ptr<RciCapture> capture_;          // capture lưu lượng RCI (nullptr = tắt)
+	StatusHistory statusHistory_;                  // mẫu STATUS mỗi lần poll (status_history/*.sts)
+	std::wstring historyPrinter_;                  // máy in của statusHistory_ (worker thread)
+
+	//=== Coroutine cho chuỗi lệnh nhiều bước ====
+	std::unique_ptr<RciExecutor> executor_;        // thread chạy coroutine (không chặn worker khi chờ máy in)
+	std::unique_ptr<RciAsyncClient> rciAsync_;     // awaitable trên rciClient_
+	std::mutex cancelMtx_;
+	RciCancelSource opsCancel_;                    // hủy chuỗi lệnh đang chạy (ngắt kết nối / dừng in)
+	uint64_t opsGeneration_ = 0;                   // tăng mỗi lần CancelPendingOps (cancelMtx_)
 
 	//=== Worker thread and request queue ====
 	std::thread workerThread_;            // Thread xử lý nền
 	std::atomic<bool> running_{ false };  // Biến điều khiển vòng lặp worker thread
+	std::atomic<bool> stopInProgress_{ false };   // StopWorkerThread đang chạy (theo từng instance)
+	std::atomic<bool> destroyed_{ false };        // destructor đã chạy cleanup
 	RequestQueue requestQueue_;           // Queue chứa các request từ UI
+	std::atomic<RequestPriority> currentPriority_{ RequestPriority::Status };  // lớp của việc worker đang làm
+	// lần gửi trạng thái gần nhất cho UI (SendStateUpdate so sánh để chỉ gửi phần đổi)
+	std::mutex publishMtx_;
+	PrinterModel::Snapshot lastPublished_;
+	std::wstring lastPublishedText_;
+	std::atomic<uint32_t> statePublishMask_{ kUiStateFields };
 
 	//== Reconnect management ==
 	std::atomic<bool> autoReconnect_{ true };   // Tự động reconnect khi mất kết nối
@@ -77,12 +120,16 @@ private:
 	void HandleRequest(const Request& request); // Xử lý từng request cụ thể
 	void DoPeriodicPoll();                    // Poll trạng thái định kỳ
 	void TryReconnect();                      // Thử reconnect nếu mất kết nối
+	void PushRequest(Request request);        // đưa vào queue; lệnh dừng khẩn ngắt lệnh đang chờ
+	bool PreemptRequested() const;            // có lệnh dừng khẩn chờ sau việc ưu tiên thấp hơn
+	bool CanReconnect() const;                // còn điều kiện để tự reconnect không
 
 	//==== Request Handlers =====
 	void HandleStatusRequest();                     // RCI STATUS 0x14
 	void HandlePrintCountRequest();                 // Hiện vẫn mô phỏng bằng model
 	void HandleStartPrintRequest(const Request& request);   // bắt đầu in
 	void HandleStopPrintRequest();                  // dừng in
+	void HandlePrintProgress(const Request& request);   // kết quả chuỗi lệnh in (executor → worker)
 
 	void HandleSetCountRequest(const Request& request);     // đặt số lượng in
 	bool HandleStartJetRequest();                           // bật jet
@@ -90,6 +137,14 @@ private:
 	void HandleConnectRequest(const Request& request);      // kết nối
 	void HandleDisconnectRequest();                         // ngắt kết nối
 
+	//== Coroutine ==
+	RciTask<void> StartPrintSequence(std::wstring job, std::string name, int count, uint64_t generation); // bật jet → load → in
+	uint64_t CurrentOpsGeneration();          // lượt chuỗi lệnh hiện tại (gán cho StartPrint lúc Push)
+	bool CancelTokenFor(uint64_t generation, RciCancelToken& token);  // false = lượt đã bị hủy
+	void CancelPendingOps();                  // hủy mọi chuỗi lệnh đang chờ máy in
+	bool IsCurrentOps(uint64_t generation);   // chuỗi lệnh của lượt này chưa bị hủy
+	void StopExecutor();                      // hủy + dừng executor trước khi giải phóng client/model
+
 	//== State machine logic ==
 	void UpdatePrinterState();        // Cập nhật trạng thái máy in theo state machine
 	bool ShouldPollStatus() const;    // có nên poll trạng thái không
@@ -98,6 +153,11 @@ private:
 
 	//=================== Messaging to UI ==================
 	void SendStateUpdate();                         // Gửi cập nhật trạng thái máy in tới UI
-	void SendLogMessage(const std::wstring& text, int level = 0); // Gửi thông điệp log tới UI
+	void SendLogMessage(std::wstring text, int level = 0);        // Gửi thông điệp log tới UI
+	// Format như LogInfo (LogFormat.h) rồi gửi tới UI; tham số không được là kết quả LogFormat khác
+	template<typename... Args>
+	void SendLogFormatted(int level, std::wstring_view fmt, const Args&... args) {
+		SendLogMessage(std::wstring(LogFormat(fmt, args...)), level);
+	}
 	void SendConnectionUpdate(bool connected);      // Gửi cập nhật trạng thái kết nối tới UI
 };
@@ -19,6 +19,7 @@
 #define WM_APP_CONNECTION_UPDATE (WM_APP + 3)
 #define WM_APP_PRINT_PROGRESS  (WM_APP + 4)
 #define WM_APP_BUTTON_STATE    (WM_APP + 5)
+#define WM_APP_EVENTS          (WM_APP + 6)   // EventBus có sự kiện chờ Dispatch (EventBusWin32.h)
 
 // Forward declarations
 struct PrinterState;
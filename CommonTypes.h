@@ -1,6 +1,8 @@
 ﻿#pragma once
 #include <string>
 #include <vector>
+#include <chrono>
+#include <cstdint>
 
 enum class PrinterStateType {
     Disconnected,
@@ -28,7 +30,49 @@ enum class RequestType {
     RequestStartJet,
     RequestStopJet,
     RequestConnect,
-    RequestDisconnect
+    RequestDisconnect,
+    // nội bộ: chuỗi lệnh in trên executor báo kết quả về worker (chỉ worker sửa PrinterModel)
+    RequestPrintJetStarting,
+    RequestPrintStarted
+};
+
+//
+// Lớp ưu tiên của request: worker luôn lấy lớp cao nhất trước (số nhỏ = ưu tiên cao)
+//
+enum class RequestPriority {
+    Emergency = 0,  // dừng in / dừng jet: được ngắt lệnh đang chờ reply
+    Control = 1,    // kết nối, bắt đầu in, bật jet, đặt số lượng
+    Status = 2,     // poll trạng thái / bộ đếm
+};
+
+constexpr size_t kRequestPriorityCount = 3;
+
+inline RequestPriority PriorityOf(RequestType type) {
+    switch (type) {
+    case RequestType::RequestStopPrint:
+    case RequestType::RequestStopJet:
+        return RequestPriority::Emergency;
+    case RequestType::RequestStatus:
+    case RequestType::RequestPrintCount:
+        return RequestPriority::Status;
+    default:
+        return RequestPriority::Control;
+    }
+}
+
+//
+// Bit của từng trường PrinterState (PrinterState::DiffFields, PrinterStateMessage::changed)
+//
+enum PrinterStateField : uint32_t {
+    StateFieldStatus = 1u << 0,
+    StateFieldJetOn = 1u << 1,
+    StateFieldPrinting = 1u << 2,
+    StateFieldPrintedCount = 1u << 3,
+    StateFieldTargetCount = 1u << 4,
+    StateFieldJobId = 1u << 5,
+    StateFieldErrorMessage = 1u << 6,
+    StateFieldStatusText = 1u << 7,
+    StateFieldAll = (1u << 8) - 1,
 };
 
 //
@@ -47,6 +91,8 @@ struct PrinterState {
     std::wstring errorMessage;
     std::wstring statusText;
 
+    uint64_t version = 0;   // PrinterModel gán khi công bố snapshot
+
     // Helper methods
     bool IsConnected() const {
         return status == PrinterStateType::Connected ||
@@ -57,6 +103,24 @@ struct PrinterState {
     bool CanPrint() const {
         return IsConnected() && status != PrinterStateType::Error;
     }
+
+    // Các trường khác với other (mask PrinterStateField), bỏ qua version
+    uint32_t DiffFields(const PrinterState& other) const {
+        uint32_t changed = 0;
+        if (status != other.status) changed |= StateFieldStatus;
+        if (jetOn != other.jetOn) changed |= StateFieldJetOn;
+        if (printing != other.printing) changed |= StateFieldPrinting;
+        if (printedCount != other.printedCount) changed |= StateFieldPrintedCount;
+        if (targetCount != other.targetCount) changed |= StateFieldTargetCount;
+        if (jobId != other.jobId) changed |= StateFieldJobId;
+        if (errorMessage != other.errorMessage) changed |= StateFieldErrorMessage;
+        if (statusText != other.statusText) changed |= StateFieldStatusText;
+        return changed;
+    }
+
+    bool SameAs(const PrinterState& other) const {
+        return DiffFields(other) == 0;
+    }
 };
 
 //
@@ -67,5 +131,12 @@ struct Request {
     std::vector<uint8_t> payload;
     std::wstring data;      // message text
     int count = 0;
+    int port = 9100;        // cổng RCI (RequestConnect)
     std::wstring ipAddress; // not used but kept for compatibility
+    std::chrono::steady_clock::time_point enqueuedAt;  // RequestQueue::Push gán (đo thời gian chờ)
+    // quá hạn này thì RequestQueue bỏ, không thực hiện (max() = theo maxAge của lớp ưu tiên)
+    std::chrono::steady_clock::time_point expiresAt = std::chrono::steady_clock::time_point::max();
+    uint64_t queueSeq = 0;      // RequestQueue::Push gán: thứ tự Push trong cả queue (gộp / hủy request)
+    // StartPrint / RequestPrint*: lượt chuỗi lệnh lúc Push (xem AppController::CancelPendingOps)
+    uint64_t opsGeneration = 0;
 };
@@ -0,0 +1,325 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "MpscQueue.h"
+
+//
+// Pool đối tượng cố định cho payload sự kiện: Acquire / Release từ nhiều thread không khóa
+// (free list Treiber đánh số slot + tag như MpscQueue). Pool cạn → cấp phát heap (đếm Overflows),
+// Release tự nhận ra đối tượng nào thuộc pool.
+//
+template<typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(uint32_t capacity)
+        : slots_(new Slot[capacity ? capacity : 1]), capacity_(capacity ? capacity : 1) {
+        for (uint32_t i = 0; i < capacity_; ++i)
+            slots_[i].freeNext.store(i + 1 < capacity_ ? i + 1 : kNil, std::memory_order_relaxed);
+        free_.store(Pack(0, 0), std::memory_order_relaxed);
+    }
+
+    // Mọi đối tượng phải đã được Release
+    ~ObjectPool() { delete[] slots_; }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    template<typename... Args>
+    T* Acquire(Args&&... args) {
+        Slot* slot = PopFree();
+        if (!slot) {
+            overflows_.fetch_add(1, std::memory_order_relaxed);
+            return new T(std::forward<Args>(args)...);
+        }
+        try {
+            return new (slot->storage) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            PushFree(slot);
+            throw;
+        }
+    }
+
+    void Release(T* object) {
+        if (!object) return;
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        if (slot < slots_ || slot >= slots_ + capacity_) {
+            delete object;      // cấp từ heap lúc pool cạn
+            return;
+        }
+        object->~T();
+        PushFree(slot);
+    }
+
+    uint32_t Capacity() const { return capacity_; }
+    // Số lần pool cạn phải cấp phát heap
+    uint64_t Overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFFu;
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];    // đầu struct: T* ↔ Slot*
+        std::atomic<uint32_t> freeNext{ kNil };
+    };
+
+    static uint64_t Pack(uint64_t tag, uint32_t index) { return (tag << 32) | index; }
+
+    Slot* PopFree() {
+        uint64_t head = free_.load(std::memory_order_acquire);
+        while ((uint32_t)head != kNil) {
+            Slot* slot = &slots_[(uint32_t)head];
+            uint32_t next = slot->freeNext.load(std::memory_order_relaxed);
+            if (free_.compare_exchange_weak(head, Pack((head >> 32) + 1, next),
+                std::memory_order_acquire, std::memory_order_acquire))
+                return slot;
+        }
+        return nullptr;
+    }
+
+    void PushFree(Slot* slot) {
+        uint32_t index = (uint32_t)(slot - slots_);
+        uint64_t head = free_.load(std::memory_order_relaxed);
+        do {
+            slot->freeNext.store((uint32_t)head, std::memory_order_relaxed);
+        } while (!free_.compare_exchange_weak(head, Pack((head >> 32) + 1, index),
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    Slot* slots_;
+    uint32_t capacity_;
+    alignas(64) std::atomic<uint64_t> free_{ kNil };    // tag << 32 | index
+    std::atomic<uint64_t> overflows_{ 0 };
+};
+
+//
+// Bus sự kiện trong process, không phụ thuộc Win32:
+//   - Subscribe<T>(handler): đăng ký nhận sự kiện kiểu T (gọi được từ mọi thread, mọi lúc)
+//   - Publish<T>(args...): dựng T trong pool của kiểu đó rồi xếp hàng (nhiều producer, không khóa).
+//     Không ai nghe → bỏ luôn, không cấp phát.
+//   - Dispatch(): chỉ 1 thread (thread UI); gọi handler theo đúng thứ tự Publish của mọi kiểu,
+//     xong trả đối tượng về pool
+//   - SetWakeup(fn): gọi khi queue từ rỗng sang có sự kiện, để thread Dispatch thức dậy
+//     (Win32: PostMessage 1 message, xem EventBusWin32.h). fn trả false → lần Publish sau gọi lại.
+// Sự kiện chưa Dispatch khi bus bị hủy được trả về pool, không rò rỉ dù cửa sổ đã đóng.
+//
+class EventBus {
+public:
+    using SubscriptionId = uint64_t;
+
+    struct Stats {
+        uint64_t published = 0;
+        uint64_t delivered = 0;
+        uint64_t unheard = 0;       // Publish khi chưa ai Subscribe
+        uint64_t wakeups = 0;       // số lần gọi hàm wakeup
+    };
+
+    // poolSize: số đối tượng sẵn cho mỗi kiểu sự kiện
+    explicit EventBus(uint32_t poolSize = 256) : poolSize_(poolSize) {}
+
+    ~EventBus() {
+        Envelope e;
+        while (queue_.TryPop(e)) e.channel->Discard(e.event);
+    }
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    // Gọi trước khi có thread nào Publish
+    void SetWakeup(std::function<bool()> wakeup) { wakeup_ = std::move(wakeup); }
+
+    template<typename T>
+    SubscriptionId Subscribe(std::function<void(const T&)> handler) {
+        Channel<T>& channel = ChannelFor<T>();
+        SubscriptionId id = nextSubscription_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto list = std::make_shared<typename Channel<T>::List>(*channel.subscribers.load());
+        list->push_back({ id, std::move(handler) });
+        channel.Replace(std::move(list));
+        return id;
+    }
+
+    void Unsubscribe(SubscriptionId id) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& channel : owned_) channel->Unsubscribe(id);
+    }
+
+    // false = không ai nghe hoặc hết node queue (sự kiện bị bỏ)
+    template<typename T, typename... Args>
+    bool Publish(Args&&... args) {
+        Channel<T>* channel = static_cast<Channel<T>*>(
+            channels_[TypeIndex<T>()].load(std::memory_order_acquire));
+        if (!channel || channel->subscriberCount.load(std::memory_order_relaxed) == 0) {
+            unheard_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        T* event = channel->pool.Acquire(std::forward<Args>(args)...);
+        if (!queue_.Push(Envelope{ channel, event })) {
+            channel->pool.Release(event);
+            return false;
+        }
+        published_.fetch_add(1, std::memory_order_relaxed);
+
+        // chỉ lần đầu sau mỗi Dispatch mới phải đánh thức
+        if (!wakePending_.exchange(true, std::memory_order_acq_rel) && wakeup_) {
+            wakeups_.fetch_add(1, std::memory_order_relaxed);
+            if (!wakeup_()) wakePending_.store(false, std::memory_order_release);
+        }
+        return true;
+    }
+
+    // Chỉ 1 thread. Giao tối đa maxEvents sự kiện; trả về số sự kiện đã giao.
+    size_t Dispatch(size_t maxEvents = SIZE_MAX) {
+        // acq_rel: thấy mọi sự kiện đã Push trước lần đặt cờ mà ta vừa xóa
+        wakePending_.exchange(false, std::memory_order_acq_rel);
+
+        size_t n = 0;
+        Envelope e;
+        while (n < maxEvents && queue_.TryPop(e)) {
+            e.channel->Deliver(e.event);
+            ++n;
+        }
+        delivered_.fetch_add(n, std::memory_order_relaxed);
+
+        // còn sự kiện (dừng vì maxEvents) → xin thêm 1 lượt
+        if (n == maxEvents && !queue_.Empty() && wakeup_ &&
+            !wakePending_.exchange(true, std::memory_order_acq_rel) && !wakeup_())
+            wakePending_.store(false, std::memory_order_release);
+        return n;
+    }
+
+    bool Empty() const { return queue_.Empty(); }
+
+    Stats GetStats() const {
+        Stats s;
+        s.published = published_.load(std::memory_order_relaxed);
+        s.delivered = delivered_.load(std::memory_order_relaxed);
+        s.unheard = unheard_.load(std::memory_order_relaxed);
+        s.wakeups = wakeups_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Số lần pool của kiểu T cạn (0 nếu chưa ai Subscribe T)
+    template<typename T>
+    uint64_t PoolOverflows() const {
+        auto* channel = static_cast<Channel<T>*>(channels_[TypeIndex<T>()].load(std::memory_order_acquire));
+        return channel ? channel->pool.Overflows() : 0;
+    }
+
+private:
+    static constexpr size_t kMaxEventTypes = 32;
+
+    struct ChannelBase {
+        virtual ~ChannelBase() = default;
+        virtual void Deliver(void* event) = 0;
+        virtual void Discard(void* event) = 0;
+        virtual void Unsubscribe(SubscriptionId id) = 0;
+    };
+
+    template<typename T>
+    struct Channel final : ChannelBase {
+        struct Subscriber {
+            SubscriptionId id;
+            std::function<void(const T&)> handler;
+        };
+        using List = std::vector<Subscriber>;
+
+        explicit Channel(uint32_t poolSize) : pool(poolSize) {
+            subscribers.store(std::make_shared<const List>());
+        }
+
+        void Deliver(void* event) override {
+            T* e = static_cast<T*>(event);
+            // chỉ thread Dispatch chạm cached: lấy lại danh sách khi Subscribe / Unsubscribe đã đổi nó
+            uint64_t version = listVersion.load(std::memory_order_acquire);
+            if (version != cachedVersion) {
+                cached = subscribers.load();
+                cachedVersion = version;
+            }
+            for (const auto& s : *cached) s.handler(*e);
+            pool.Release(e);
+        }
+
+        // gọi khi đang giữ EventBus::mtx_
+        void Replace(std::shared_ptr<const List> list) {
+            subscriberCount.store(list->size(), std::memory_order_relaxed);
+            subscribers.store(std::move(list));
+            listVersion.fetch_add(1, std::memory_order_release);
+        }
+
+        void Discard(void* event) override { pool.Release(static_cast<T*>(event)); }
+
+        // gọi khi đang giữ EventBus::mtx_
+        void Unsubscribe(SubscriptionId id) override {
+            auto current = subscribers.load();
+            auto list = std::make_shared<List>();
+            for (const auto& s : *current)
+                if (s.id != id) list->push_back(s);
+            if (list->size() != current->size()) Replace(std::move(list));
+        }
+
+        ObjectPool<T> pool;
+        std::atomic<std::shared_ptr<const List>> subscribers;
+        std::atomic<size_t> subscriberCount{ 0 };
+        std::atomic<uint64_t> listVersion{ 0 };
+        std::shared_ptr<const List> cached;     // bản danh sách thread Dispatch đang dùng
+        uint64_t cachedVersion = ~0ull;
+    };
+
+    struct Envelope {
+        ChannelBase* channel = nullptr;
+        void* event = nullptr;
+    };
+
+    // Số thứ tự của từng kiểu sự kiện, cấp lần đầu dùng (chung cho mọi EventBus)
+    static size_t NextTypeIndex() {
+        static std::atomic<size_t> next{ 0 };
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template<typename T>
+    static size_t TypeIndex() {
+        static const size_t index = NextTypeIndex();
+        return index;
+    }
+
+    template<typename T>
+    Channel<T>& ChannelFor() {
+        size_t index = TypeIndex<T>();
+        if (index >= kMaxEventTypes) throw std::length_error("EventBus: too many event types");
+        if (auto* channel = channels_[index].load(std::memory_order_acquire))
+            return *static_cast<Channel<T>*>(channel);
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (auto* channel = channels_[index].load(std::memory_order_relaxed))
+            return *static_cast<Channel<T>*>(channel);
+        auto channel = std::make_unique<Channel<T>>(poolSize_);
+        Channel<T>* raw = channel.get();
+        owned_.push_back(std::move(channel));
+        channels_[index].store(raw, std::memory_order_release);
+        return *raw;
+    }
+
+    uint32_t poolSize_;
+    std::mutex mtx_;                                    // tạo channel / sửa danh sách subscriber
+    std::vector<std::unique_ptr<ChannelBase>> owned_;
+    std::atomic<ChannelBase*> channels_[kMaxEventTypes] = {};
+    MpscQueue<Envelope> queue_;
+    std::function<bool()> wakeup_;
+    std::atomic<bool> wakePending_{ false };
+    std::atomic<SubscriptionId> nextSubscription_{ 0 };
+    std::atomic<uint64_t> published_{ 0 };
+    std::atomic<uint64_t> delivered_{ 0 };
+    std::atomic<uint64_t> unheard_{ 0 };
+    std::atomic<uint64_t> wakeups_{ 0 };
+};
@@ -0,0 +1,16 @@
+﻿#pragma once
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "EventBus.h"
+#include "CommonDefs.h"
+
+//
+// Giao sự kiện của EventBus qua hàng đợi message Win32: khi bus có sự kiện mới, PostMessage
+// 1 message WM_APP_EVENTS (không kèm dữ liệu) tới hwnd; WndProc gọi bus.Dispatch().
+// Cửa sổ đã đóng → PostMessage thất bại, sự kiện nằm lại trong bus và được trả về pool khi bus hủy.
+//
+inline void AttachWin32Delivery(EventBus& bus, HWND hwnd, UINT message = WM_APP_EVENTS) {
+    bus.SetWakeup([hwnd, message] {
+        return PostMessage(hwnd, message, 0, 0) != 0;
+    });
+}
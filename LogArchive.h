@@ -0,0 +1,472 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <system_error>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <share.h>
+#endif
+#include "LogCodec.h"
+#include "ThreadSafeQueue.h"
+
+//
+// Segment log:
+//   linx_controller.log                        segment đang ghi (text UTF-8)
+//   linx_controller.20261017-051802-513.log      segment đã đóng, chờ nén (tên = giờ bắt đầu)
+//   linx_controller.20261017-051802-513.log.lz   segment đã nén: các khối LogCodec độc lập
+//   linx_controller.20261017-051802-513.idx      index: (thời điểm dòng đầu khối, offset) mỗi khối
+//
+// Tool tìm theo khoảng thời gian: đọc .idx, chỉ giải nén các khối có thời điểm nằm trong khoảng.
+// Thời điểm trong index = giờ địa phương ghi trên dòng log ("YYYY-MM-DD HH:MM:SS.mmm"),
+// đổi ra micro giây như thể là UTC (LogCivilMicros) → không phụ thuộc múi giờ / DST; 0 = không rõ
+// (dòng log cũ chưa có ngày).
+//
+
+// Đổi segment đang ghi (writer thread của AsyncLogBackend)
+struct LogRotationPolicy {
+    uint64_t maxBytes = 8 * 1024 * 1024;    // 0 = không giới hạn kích thước
+    std::chrono::hours maxAge{ 24 };        // 0 = không giới hạn thời gian
+    bool splitDaily = true;                 // qua nửa đêm → segment mới
+};
+
+// Giữ lại bao nhiêu segment đã đóng (xóa cũ nhất trước)
+struct LogRetentionPolicy {
+    uint64_t maxBytes = 256ull * 1024 * 1024;   // tổng .log.lz + .idx + .log chờ nén
+    size_t maxSegments = 400;
+};
+
+#pragma pack(push, 1)
+struct LogIndexHeader {
+    char magic[4];              // "LXIX"
+    uint32_t version;           // 1
+    uint32_t entryCount;
+    uint32_t compressed;        // 1: offset trỏ vào .log.lz, 0: vào .log
+    int64_t firstTimeUs;
+    int64_t lastTimeUs;
+    uint64_t rawBytes;          // kích thước text gốc
+};
+
+struct LogIndexEntry {
+    int64_t timeUs;             // thời điểm dòng đầu tiên của khối
+    uint64_t rawOffset;         // offset trong text gốc
+    uint64_t fileOffset;        // offset dữ liệu khối trong file (.log.lz: sau header khối)
+    uint32_t rawSize;
+    uint32_t packedSize;        // == rawSize: khối lưu nguyên (nén không nhỏ đi)
+};
+#pragma pack(pop)
+
+// Ngày giờ địa phương → micro giây (tính như UTC, thuật toán days-from-civil)
+inline int64_t LogCivilMicros(int y, int mon, int d, int h, int mi, int s, int ms) {
+    y -= mon <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = era * 146097 + doe - 719468;
+    return (((days * 24 + h) * 60 + mi) * 60 + s) * 1000000ll + ms * 1000ll;
+}
+
+// Đọc "YYYY-MM-DD HH:MM:SS.mmm" ở đầu dòng; false nếu dòng không có ngày
+inline bool LogParseLineTime(const char* p, size_t n, int64_t& timeUs) {
+    static const char kPattern[] = "dddd-dd-dd dd:dd:dd.ddd";
+    if (n < sizeof(kPattern) - 1) return false;
+    for (size_t i = 0; i < sizeof(kPattern) - 1; ++i) {
+        if (kPattern[i] == 'd' ? (p[i] < '0' || p[i] > '9') : p[i] != kPattern[i]) return false;
+    }
+    auto num = [p](size_t at, size_t len) {
+        int v = 0;
+        for (size_t i = 0; i < len; ++i) v = v * 10 + (p[at + i] - '0');
+        return v;
+    };
+    timeUs = LogCivilMicros(num(0, 4), num(5, 2), num(8, 2), num(11, 2), num(14, 2), num(17, 2), num(20, 3));
+    return true;
+}
+
+// wchar_t (UTF-16 trên Windows, UTF-32 nơi khác) → UTF-8
+inline void LogAppendUtf8(std::string& out, const wchar_t* text, size_t chars) {
+    for (size_t i = 0; i < chars; ++i) {
+        uint32_t c = (uint32_t)text[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < chars) {
+            uint32_t low = (uint32_t)text[i + 1];
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+        if (c < 0x80) out.push_back((char)c);
+        else if (c < 0x800) {
+            out.push_back((char)(0xC0 | (c >> 6)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else if (c < 0x10000) {
+            out.push_back((char)(0xE0 | (c >> 12)));
+            out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else {
+            out.push_back((char)(0xF0 | (c >> 18)));
+            out.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+    }
+}
+
+// Đường dẫn từ wstring của app (POSIX: qua UTF-8, không phụ thuộc locale)
+inline std::filesystem::path LogPath(const std::wstring& path) {
+#ifdef _WIN32
+    return std::filesystem::path(path);
+#else
+    std::string narrow;
+    LogAppendUtf8(narrow, path.data(), path.size());
+    return std::filesystem::path(narrow);
+#endif
+}
+
+// fopen cho path; Windows: cho phép process khác đọc cùng lúc (tool xem log khi app đang chạy)
+inline std::FILE* LogOpenFile(const std::filesystem::path& path, const char* mode) {
+#ifdef _WIN32
+    wchar_t wmode[8] = {};
+    for (size_t i = 0; i < 7 && mode[i]; ++i) wmode[i] = (wchar_t)mode[i];
+    return _wfsopen(path.c_str(), wmode, _SH_DENYNO);
+#else
+    return std::fopen(path.c_str(), mode);
+#endif
+}
+
+inline bool LogReadWholeFile(const std::filesystem::path& path, std::string& out) {
+    std::FILE* f = LogOpenFile(path, "rb");
+    if (!f) return false;
+    out.clear();
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+    bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
+
+inline bool LogReadIndex(const std::filesystem::path& path, LogIndexHeader& header, std::vector<LogIndexEntry>& entries) {
+    std::FILE* f = LogOpenFile(path, "rb");
+    if (!f) return false;
+    bool ok = std::fread(&header, sizeof(header), 1, f) == 1 &&
+        std::memcmp(header.magic, "LXIX", 4) == 0 && header.version == 1;
+    if (ok) {
+        entries.resize(header.entryCount);
+        ok = header.entryCount == 0 ||
+            std::fread(entries.data(), sizeof(LogIndexEntry), entries.size(), f) == entries.size();
+    }
+    std::fclose(f);
+    return ok;
+}
+
+inline int LogSeek(std::FILE* f, int64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET);
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+// Đọc 1 khối theo entry index (file = .log.lz nếu header.compressed, không thì .log)
+inline bool LogReadBlock(std::FILE* f, const LogIndexEntry& entry, std::string& out, std::vector<uint8_t>& scratch) {
+    out.resize(entry.rawSize);
+    if (LogSeek(f, (int64_t)entry.fileOffset) != 0) return false;
+    if (entry.packedSize == entry.rawSize)
+        return entry.rawSize == 0 || std::fread(out.data(), 1, entry.rawSize, f) == entry.rawSize;
+    scratch.resize(entry.packedSize);
+    if (std::fread(scratch.data(), 1, entry.packedSize, f) != entry.packedSize) return false;
+    return LogCodec::Decompress(scratch.data(), scratch.size(), (uint8_t*)out.data(), out.size());
+}
+
+// Các file của 1 segment đã đóng; key = giờ bắt đầu "YYYYMMDD-HHMMSS-mmm[_nnn]" (độ dài cố định →
+// sắp xếp chuỗi = thứ tự thời gian)
+struct LogSegmentFiles {
+    std::filesystem::path::string_type key;
+    std::filesystem::path plain;        // .log chưa nén (rỗng nếu không có)
+    std::filesystem::path packed;       // .log.lz
+    std::filesystem::path index;        // .idx
+    uint64_t bytes = 0;                 // tổng kích thước trên đĩa
+};
+
+// Segment đã đóng cạnh file đang ghi base, cũ → mới (không gồm base)
+inline std::vector<LogSegmentFiles> LogListSegments(const std::filesystem::path& base) {
+    namespace fs = std::filesystem;
+    using String = fs::path::string_type;
+    std::vector<LogSegmentFiles> segments;
+    fs::path dir = base.parent_path().empty() ? fs::path(".") : base.parent_path();
+    String prefix = base.stem().native() + fs::path::value_type('.');
+    const String ext = base.extension().native();
+
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        String name = it->path().filename().native();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+        String rest = name.substr(prefix.size());
+
+        auto endsWith = [&rest](const String& suffix) {
+            return rest.size() > suffix.size() && rest.compare(rest.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        String packedExt = ext + fs::path(".lz").native();
+        String indexExt = fs::path(".idx").native();
+        String key;
+        int kind;
+        if (endsWith(packedExt)) { key = rest.substr(0, rest.size() - packedExt.size()); kind = 1; }
+        else if (endsWith(indexExt)) { key = rest.substr(0, rest.size() - indexExt.size()); kind = 2; }
+        else if (endsWith(ext)) { key = rest.substr(0, rest.size() - ext.size()); kind = 0; }
+        else continue;
+
+        auto found = std::find_if(segments.begin(), segments.end(), [&key](const LogSegmentFiles& s) { return s.key == key; });
+        if (found == segments.end()) {
+            LogSegmentFiles segment;
+            segment.key = key;
+            segments.push_back(std::move(segment));
+            found = segments.end() - 1;
+        }
+        (kind == 0 ? found->plain : kind == 1 ? found->packed : found->index) = it->path();
+        found->bytes += (uint64_t)it->file_size(ec);
+    }
+    std::sort(segments.begin(), segments.end(),
+        [](const LogSegmentFiles& a, const LogSegmentFiles& b) { return a.key < b.key; });
+    return segments;
+}
+
+// Tên cho segment bắt đầu lúc timeUs (system_clock): base.YYYYMMDD-HHMMSS-mmm.log, trùng → thêm _nnn
+inline std::filesystem::path LogSegmentPath(const std::filesystem::path& base, int64_t timeUs) {
+    std::time_t seconds = (std::time_t)(timeUs / 1000000);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char key[32];
+    std::snprintf(key, sizeof(key), "%04d%02d%02d-%02d%02d%02d-%03d",
+        local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec,
+        (int)(timeUs / 1000 % 1000));
+
+    std::filesystem::path dir = base.parent_path();
+    std::string stem = std::string(".") + key;
+    for (int n = 0; ; ++n) {
+        char suffix[8];
+        std::snprintf(suffix, sizeof(suffix), "_%03d", n);
+        std::string name = n == 0 ? stem : stem + suffix;
+        std::filesystem::path plain = dir / base.stem();
+        plain += name;
+        plain += base.extension();
+        std::filesystem::path packed = plain;
+        packed += ".lz";
+        std::error_code ec;
+        if (!std::filesystem::exists(plain, ec) && !std::filesystem::exists(packed, ec)) return plain;
+    }
+}
+
+//
+// Nén 1 segment đã đóng: X.log → X.log.lz + X.idx rồi xóa X.log.
+// Chia text thành khối ~blockBytes, cắt ở cuối dòng; mỗi khối nén độc lập.
+// Ghi ra file tạm rồi đổi tên → dừng giữa chừng thì X.log vẫn còn, lần sau nén lại.
+//
+inline bool LogCompressSegment(const std::filesystem::path& plain, size_t blockBytes = 64 * 1024) {
+    namespace fs = std::filesystem;
+    std::string text;
+    if (!LogReadWholeFile(plain, text)) return false;
+
+    fs::path packed = plain;
+    packed += ".lz";
+    fs::path index = plain;
+    index.replace_extension(".idx");
+    fs::path packedTmp = packed;
+    packedTmp += ".tmp";
+    fs::path indexTmp = index;
+    indexTmp += ".tmp";
+
+    std::FILE* out = LogOpenFile(packedTmp, "wb");
+    if (!out) return false;
+    const char fileHeader[8] = { 'L', 'X', 'L', 'Z', 1, 0, 0, 0 };
+    bool ok = std::fwrite(fileHeader, 1, sizeof(fileHeader), out) == sizeof(fileHeader);
+
+    LogIndexHeader header{ { 'L', 'X', 'I', 'X' }, 1, 0, 1, 0, 0, (uint64_t)text.size() };
+    std::vector<LogIndexEntry> entries;
+    std::vector<uint8_t> packedBuf;
+    std::vector<uint32_t> table;
+    uint64_t fileOffset = sizeof(fileHeader);
+    int64_t lastTime = 0;
+
+    for (size_t off = 0; ok && off < text.size(); ) {
+        size_t end = std::min(off + blockBytes, text.size());
+        if (end < text.size()) {
+            size_t nl = text.find('\n', end - 1);
+            end = nl == std::string::npos ? text.size() : nl + 1;
+        }
+
+        // thời điểm dòng đầu có ngày trong khối; cập nhật thời điểm cuối
+        int64_t blockTime = 0;
+        for (size_t line = off; line < end; ) {
+            size_t nl = text.find('\n', line);
+            size_t lineEnd = (nl == std::string::npos || nl >= end) ? end : nl;
+            int64_t t;
+            if (LogParseLineTime(text.data() + line, lineEnd - line, t)) {
+                if (!blockTime) blockTime = t;
+                if (!header.firstTimeUs) header.firstTimeUs = t;
+                lastTime = t;
+            }
+            line = lineEnd + 1;
+        }
+        if (!blockTime) blockTime = lastTime;
+
+        const uint8_t* raw = (const uint8_t*)text.data() + off;
+        uint32_t rawSize = (uint32_t)(end - off);
+        packedBuf.resize(LogCodec::Bound(rawSize));
+        size_t packedSize = LogCodec::Compress(raw, rawSize, packedBuf.data(), table);
+        const uint8_t* data = packedBuf.data();
+        if (packedSize >= rawSize) {
+            packedSize = rawSize;       // không nhỏ đi → lưu nguyên
+            data = raw;
+        }
+
+        uint32_t blockHeader[2] = { rawSize, (uint32_t)packedSize };
+        ok = std::fwrite(blockHeader, sizeof(blockHeader), 1, out) == 1 &&
+            std::fwrite(data, 1, packedSize, out) == packedSize;
+        entries.push_back(LogIndexEntry{ blockTime, off, fileOffset + sizeof(blockHeader), rawSize, (uint32_t)packedSize });
+        fileOffset += sizeof(blockHeader) + packedSize;
+        off = end;
+    }
+    ok = std::fclose(out) == 0 && ok;
+
+    header.entryCount = (uint32_t)entries.size();
+    header.lastTimeUs = lastTime;
+    if (ok) {
+        std::FILE* idx = LogOpenFile(indexTmp, "wb");
+        ok = idx && std::fwrite(&header, sizeof(header), 1, idx) == 1 &&
+            (entries.empty() || std::fwrite(entries.data(), sizeof(LogIndexEntry), entries.size(), idx) == entries.size());
+        if (idx) ok = std::fclose(idx) == 0 && ok;
+    }
+
+    std::error_code ec;
+    if (ok) {
+        fs::rename(indexTmp, index, ec);
+        if (!ec) fs::rename(packedTmp, packed, ec);
+        if (!ec) fs::remove(plain, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        fs::remove(packedTmp, ec);
+        fs::remove(indexTmp, ec);
+    }
+    return ok;
+}
+
+//
+// Thread nén nền: nhận segment vừa đóng (Enqueue), nén + ghi index, rồi xóa segment cũ theo
+// LogRetentionPolicy. Chạy ở mức ưu tiên thấp (Windows: background mode, giảm cả ưu tiên I/O)
+// để không tranh CPU / đĩa với thread điều khiển máy in.
+//
+class LogArchiver {
+public:
+    LogArchiver() = default;
+    ~LogArchiver() { Stop(); }
+
+    LogArchiver(const LogArchiver&) = delete;
+    LogArchiver& operator=(const LogArchiver&) = delete;
+
+    void SetRetention(const LogRetentionPolicy& policy) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        retention_ = policy;
+    }
+
+    // base = file đang ghi. Segment chưa nén còn sót từ lần chạy trước được nén lại.
+    void Start(const std::filesystem::path& base) {
+        Stop();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            base_ = base;
+        }
+        stop_.store(false, std::memory_order_relaxed);
+        for (const auto& segment : LogListSegments(base)) {
+            if (!segment.plain.empty()) queue_.Push(segment.plain);
+        }
+        worker_ = std::thread([this] { Run(); });
+    }
+
+    void Enqueue(const std::filesystem::path& segment) {
+        queue_.Push(segment);
+    }
+
+    // Nén nốt segment đang làm rồi dừng; segment còn trong queue được nén ở lần Start sau
+    void Stop() {
+        if (!worker_.joinable()) return;
+        stop_.store(true, std::memory_order_relaxed);
+        worker_.join();
+    }
+
+    uint64_t Compressed() const { return compressed_.load(std::memory_order_relaxed); }
+    uint64_t Failed() const { return failed_.load(std::memory_order_relaxed); }
+    uint64_t Removed() const { return removed_.load(std::memory_order_relaxed); }
+
+private:
+    void Run() {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+        ApplyRetention();
+        std::filesystem::path segment;
+        while (!stop_.load(std::memory_order_relaxed)) {
+            if (!queue_.WaitPop(segment, 200)) continue;
+            std::error_code ec;
+            if (!std::filesystem::exists(segment, ec)) continue;     // đã bị retention xóa
+            if (LogCompressSegment(segment)) compressed_.fetch_add(1, std::memory_order_relaxed);
+            else failed_.fetch_add(1, std::memory_order_relaxed);
+            ApplyRetention();
+        }
+    }
+
+    void ApplyRetention() {
+        std::filesystem::path base;
+        LogRetentionPolicy policy;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            base = base_;
+            policy = retention_;
+        }
+
+        auto segments = LogListSegments(base);
+        uint64_t total = 0;
+        for (const auto& s : segments) total += s.bytes;
+
+        size_t count = segments.size();
+        for (const auto& s : segments) {
+            bool overBytes = policy.maxBytes && total > policy.maxBytes;
+            bool overCount = policy.maxSegments && count > policy.maxSegments;
+            if (!overBytes && !overCount) break;
+            std::error_code ec;
+            for (const auto* path : { &s.plain, &s.packed, &s.index })
+                if (!path->empty()) std::filesystem::remove(*path, ec);
+            total -= s.bytes;
+            --count;
+            removed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::mutex mtx_;
+    std::filesystem::path base_;
+    LogRetentionPolicy retention_;
+    ThreadSafeQueue<std::filesystem::path, QueueConsumers::Single> queue_;     // chỉ worker_ lấy ra
+    std::thread worker_;
+    std::atomic<bool> stop_{ false };
+    std::atomic<uint64_t> compressed_{ 0 };
+    std::atomic<uint64_t> failed_{ 0 };
+    std::atomic<uint64_t> removed_{ 0 };
+};
@@ -0,0 +1,495 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+#include "LogArchive.h"
+
+//
+// Ring byte 1 producer / 1 consumer cho bản ghi log của 1 thread.
+// Bản ghi = LogRecordHeader + text (wchar_t), căn 8 byte, luôn nằm liền trong buffer:
+// không đủ chỗ tới cuối buffer → đệm (header Pad, hoặc bỏ trống nếu không đủ chỗ cho header) rồi quay về 0.
+//
+struct LogRecordHeader {
+    uint32_t size;      // tổng số byte của bản ghi (gồm header, đã căn)
+    uint32_t chars;     // số wchar_t của text
+    uint64_t seq;       // thứ tự toàn cục (ghép các ring theo đúng thứ tự Write)
+    int64_t timeUs;     // system_clock, micro giây từ epoch
+    int32_t level;
+    uint32_t kind;      // kRecord / kPad
+};
+
+class LogRing {
+public:
+    static constexpr uint32_t kRecord = 0;
+    static constexpr uint32_t kPad = 1;
+
+    explicit LogRing(size_t capacityBytes)
+        : capacity_(std::max<size_t>(capacityBytes & ~size_t(7), 1024)),
+        buffer_(new unsigned char[capacity_]) {}
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // Producer. false = ring đầy (bản ghi bị bỏ). Text dài hơn 1/4 ring bị cắt.
+    bool Push(uint64_t seq, int64_t timeUs, int level, const wchar_t* text, size_t chars) {
+        size_t maxChars = (capacity_ / 4 - sizeof(LogRecordHeader)) / sizeof(wchar_t);
+        if (chars > maxChars) chars = maxChars;
+        size_t need = Align8(sizeof(LogRecordHeader) + chars * sizeof(wchar_t));
+
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        size_t index = (size_t)(head % capacity_);
+        size_t toEnd = capacity_ - index;
+        size_t total = toEnd < need ? toEnd + need : need;
+        if (head + total - tail > capacity_) return false;
+
+        if (toEnd < need) {
+            if (toEnd >= sizeof(LogRecordHeader)) {
+                LogRecordHeader pad{ (uint32_t)toEnd, 0, 0, 0, 0, kPad };
+                std::memcpy(buffer_.get() + index, &pad, sizeof(pad));
+            }
+            head += toEnd;
+            index = 0;
+        }
+
+        LogRecordHeader h{ (uint32_t)need, (uint32_t)chars, seq, timeUs, level, kRecord };
+        std::memcpy(buffer_.get() + index, &h, sizeof(h));
+        std::memcpy(buffer_.get() + index + sizeof(h), text, chars * sizeof(wchar_t));
+        head_.store(head + need, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: gọi onRecord(header, text) cho mọi bản ghi đang có; trả về số bản ghi
+    template<typename F>
+    size_t Drain(F&& onRecord) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        size_t n = 0;
+        while (tail != head) {
+            size_t index = (size_t)(tail % capacity_);
+            size_t toEnd = capacity_ - index;
+            if (toEnd < sizeof(LogRecordHeader)) {
+                tail += toEnd;
+                continue;
+            }
+            LogRecordHeader h;
+            std::memcpy(&h, buffer_.get() + index, sizeof(h));
+            if (h.kind == kRecord) {
+                onRecord(h, reinterpret_cast<const wchar_t*>(buffer_.get() + index + sizeof(h)));
+                ++n;
+            }
+            tail += h.size;
+        }
+        tail_.store(tail, std::memory_order_release);
+        return n;
+    }
+
+    // Số byte đang dùng (xấp xỉ, gọi từ mọi thread)
+    size_t Used() const {
+        return (size_t)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    // Thread chủ đã kết thúc: writer đọc nốt rồi bỏ ring
+    void Close() { closed_.store(true, std::memory_order_release); }
+    bool Closed() const { return closed_.load(std::memory_order_acquire); }
+
+    bool halfWakeSent = false;  // chỉ producer: đã đánh thức writer vì ring quá nửa
+
+private:
+    static size_t Align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+    size_t capacity_;
+    std::unique_ptr<unsigned char[]> buffer_;
+    alignas(64) std::atomic<uint64_t> head_{ 0 };   // producer
+    alignas(64) std::atomic<uint64_t> tail_{ 0 };   // consumer
+    std::atomic<bool> closed_{ false };
+};
+
+//
+// Backend ghi log bất đồng bộ:
+//   - Append (thread bất kỳ): chép bản ghi vào ring riêng của thread đó. Không khóa, không cấp phát
+//     (trừ lần đầu thread ghi log: tạo ring), không chạm file → không bao giờ chờ I/O đĩa.
+//     Ring đầy → bỏ bản ghi, đếm Dropped (writer ghi 1 dòng báo số bản ghi bị bỏ).
+//   - writer thread: mỗi flushInterval (hoặc khi được đánh thức) gom mọi ring, xếp theo seq,
+//     định dạng "YYYY-MM-DD HH:MM:SS.mmm [LEVEL] text", ghi 1 lần vào file (UTF-8) rồi fflush
+//   - file đầy / quá tuổi / qua nửa đêm (LogRotationPolicy) → writer đổi tên thành segment và mở
+//     file mới; LogArchiver nén segment + ghi index trên thread nền (LogArchive.h)
+//   - ERROR hoặc ring quá nửa → đánh thức writer ngay (thread ghi log không chờ)
+//   - Flush(): chờ tới khi mọi bản ghi trước đó đã xuống file. Stop(): Flush + dừng writer;
+//     sau Stop, Append ghi thẳng (đồng bộ) để log lúc thoát chương trình không mất.
+//
+class AsyncLogBackend {
+public:
+    AsyncLogBackend() = default;
+    ~AsyncLogBackend() {
+        Stop();
+        if (file_) std::fclose(file_);
+        archiver_.Stop();
+    }
+
+    AsyncLogBackend(const AsyncLogBackend&) = delete;
+    AsyncLogBackend& operator=(const AsyncLogBackend&) = delete;
+
+    // Kích thước ring của mỗi thread; gọi trước khi thread đó ghi log lần đầu
+    void SetRingBytes(size_t bytes) { ringBytes_ = bytes; }
+    void SetFlushInterval(std::chrono::milliseconds interval) { flushIntervalMs_ = (int64_t)interval.count(); }
+    void SetConsoleOutput(bool enable) { consoleOutput_ = enable; }
+    void SetDebuggerOutput(bool enable) { debuggerOutput_ = enable; }
+
+    void SetRotation(const LogRotationPolicy& policy) {
+        std::lock_guard<std::mutex> lock(fileMtx_);
+        rotation_ = policy;
+    }
+
+    void SetRetention(const LogRetentionPolicy& policy) {
+        archiver_.SetRetention(policy);
+    }
+
+    // Mở file log (append); file cũ được flush và đóng.
+    // File còn dữ liệu của lần chạy trước → tách thành segment để nén, phiên này bắt đầu file mới.
+    bool OpenFile(const std::wstring& path) {
+        std::lock_guard<std::mutex> lock(fileMtx_);
+        if (file_) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+        basePath_ = LogPath(path);
+        activeBytes_ = 0;
+        segmentStartUs_ = 0;
+
+        std::error_code ec;
+        uint64_t existing = std::filesystem::exists(basePath_, ec) ? (uint64_t)std::filesystem::file_size(basePath_, ec) : 0;
+        if (existing > 0 && RotationEnabledLocked()) RenameActiveLocked(NowUs());
+        archiver_.Start(basePath_);
+
+        file_ = LogOpenFile(basePath_, "ab");
+        if (file_) {
+            std::setvbuf(file_, nullptr, _IOFBF, 64 * 1024);
+            activeBytes_ = (uint64_t)std::filesystem::file_size(basePath_, ec);
+            if (activeBytes_ > 0) segmentStartUs_ = NowUs();   // không tách được file cũ → tính tuổi từ giờ
+        }
+        return file_ != nullptr;
+    }
+
+    void Start() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (running_.load(std::memory_order_relaxed)) return;
+        stop_ = false;
+        running_.store(true, std::memory_order_release);
+        writer_ = std::thread([this] { Run(); });
+    }
+
+    void Append(int level, const wchar_t* text, size_t chars) {
+        int64_t timeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        uint64_t seq = nextSeq_.fetch_add(1, std::memory_order_relaxed);
+
+        if (!running_.load(std::memory_order_acquire)) {
+            WriteDirect(timeUs, level, text, chars);
+            return;
+        }
+
+        LogRing& ring = ThreadRing();
+        if (!ring.Push(seq, timeUs, level, text, chars)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            Wake();
+            return;
+        }
+        // ERROR → ghi xuống đĩa ngay; ring vượt nửa → đánh thức 1 lần cho tới khi writer đọc bớt
+        bool pastHalf = ring.Used() > ring.Capacity() / 2;
+        bool wake = level == 2 || (pastHalf && !ring.halfWakeSent);
+        ring.halfWakeSent = pastHalf;
+        if (wake) Wake();
+    }
+
+    // Chờ mọi bản ghi Append trước lời gọi này xuống file
+    void Flush() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (!running_.load(std::memory_order_relaxed)) return;
+        uint64_t ticket = ++flushRequested_;
+        wake_ = true;
+        cv_.notify_one();
+        flushedCv_.wait(lock, [&] { return flushedTicket_ >= ticket || !running_.load(std::memory_order_relaxed); });
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!running_.load(std::memory_order_relaxed)) return;
+            stop_ = true;
+            running_.store(false, std::memory_order_release);     // Append từ giờ ghi thẳng
+            cv_.notify_one();
+            flushedCv_.notify_all();
+        }
+        writer_.join();
+    }
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Rotations() const { return rotations_.load(std::memory_order_relaxed); }
+    const LogArchiver& Archiver() const { return archiver_; }
+
+    // Định dạng 1 dòng log (không có '\n') thành UTF-8, nối vào out
+    static void FormatLine(std::string& out, int64_t timeUs, int level, const wchar_t* text, size_t chars) {
+        std::time_t seconds = (std::time_t)(timeUs / 1000000);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        char prefix[64];
+        int n = std::snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%03d %s",
+            local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+            local.tm_hour, local.tm_min, local.tm_sec, (int)(timeUs / 1000 % 1000), LevelTag(level));
+        out.append(prefix, (size_t)n);
+        AppendUtf8(out, text, chars);
+    }
+
+    static const char* LevelTag(int level) {
+        switch (level) {
+        case 1: return "[WARNING] ";
+        case 2: return "[ERROR] ";
+        case 3: return "[DEBUG] ";
+        default: return "[INFO] ";
+        }
+    }
+
+    // wchar_t (UTF-16 trên Windows, UTF-32 nơi khác) → UTF-8
+    static void AppendUtf8(std::string& out, const wchar_t* text, size_t chars) {
+        LogAppendUtf8(out, text, chars);
+    }
+
+private:
+    struct Pending {
+        uint64_t seq;
+        int64_t timeUs;
+        int level;
+        std::wstring text;
+    };
+
+    // Ring của thread hiện tại; tạo + đăng ký lần đầu. Thread kết thúc → ring được đóng.
+    LogRing& ThreadRing() {
+        struct Holder {
+            std::shared_ptr<LogRing> ring;
+            const AsyncLogBackend* owner = nullptr;
+            ~Holder() { if (ring) ring->Close(); }
+        };
+        thread_local Holder holder;
+        if (!holder.ring || holder.owner != this) {
+            if (holder.ring) holder.ring->Close();
+            holder.ring = std::make_shared<LogRing>(ringBytes_);
+            holder.owner = this;
+            std::lock_guard<std::mutex> lock(ringsMtx_);
+            rings_.push_back(holder.ring);
+        }
+        return *holder.ring;
+    }
+
+    void Wake() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        wake_ = true;
+        cv_.notify_one();
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            cv_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_.load(std::memory_order_relaxed)),
+                [this] { return stop_ || wake_; });
+            bool stopping = stop_;
+            uint64_t ticket = flushRequested_;
+            wake_ = false;
+            lock.unlock();
+
+            WriteBatch();
+
+            lock.lock();
+            flushedTicket_ = ticket;
+            flushedCv_.notify_all();
+            if (stopping) return;
+        }
+    }
+
+    // Gom mọi ring (theo đúng thứ tự seq), ghi 1 lần, fflush
+    void WriteBatch() {
+        std::vector<std::shared_ptr<LogRing>> rings;
+        {
+            std::lock_guard<std::mutex> lock(ringsMtx_);
+            rings = rings_;
+        }
+
+        batch_.clear();
+        for (auto& ring : rings) {
+            ring->Drain([this](const LogRecordHeader& h, const wchar_t* text) {
+                batch_.push_back({ h.seq, h.timeUs, h.level, std::wstring(text, h.chars) });
+                });
+        }
+        std::sort(batch_.begin(), batch_.end(), [](const Pending& a, const Pending& b) { return a.seq < b.seq; });
+
+        // ring của thread đã kết thúc và đã đọc hết → bỏ
+        {
+            std::lock_guard<std::mutex> lock(ringsMtx_);
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                [](const std::shared_ptr<LogRing>& r) { return r->Closed() && r->Used() == 0; }), rings_.end());
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (batch_.empty() && dropped == reportedDropped_) return;
+
+        std::lock_guard<std::mutex> lock(fileMtx_);
+        text_.clear();
+        int64_t firstTimeUs = batch_.empty() ? NowUs() : batch_.front().timeUs;
+        if (dropped != reportedDropped_) {
+            std::wstring note = L"Log ring full: " + std::to_wstring(dropped - reportedDropped_) + L" records dropped";
+            EmitLocked(NowUs(), 1, note.data(), note.size());
+            reportedDropped_ = dropped;
+        }
+        for (const auto& p : batch_) EmitLocked(p.timeUs, p.level, p.text.data(), p.text.size());
+        WriteOutLocked(firstTimeUs);
+    }
+
+    // Ghi text_ (trọn dòng) vào segment đang mở, đổi segment trước nếu tới lúc
+    void WriteOutLocked(int64_t firstTimeUs) {
+        if (file_ && activeBytes_ > 0 && ShouldRotateLocked(firstTimeUs, text_.size())) RotateLocked(firstTimeUs);
+        if (file_) {
+            std::fwrite(text_.data(), 1, text_.size(), file_);
+            std::fflush(file_);
+            if (activeBytes_ == 0) segmentStartUs_ = firstTimeUs;
+            activeBytes_ += text_.size();
+        }
+        if (consoleOutput_) {
+            std::fwrite(text_.data(), 1, text_.size(), stderr);
+        }
+    }
+
+    bool RotationEnabledLocked() const {
+        return rotation_.maxBytes > 0 || rotation_.maxAge.count() > 0 || rotation_.splitDaily;
+    }
+
+    bool ShouldRotateLocked(int64_t timeUs, size_t incoming) const {
+        if (timeUs < rotateRetryUs_) return false;
+        if (rotation_.maxBytes && activeBytes_ + incoming > rotation_.maxBytes) return true;
+        if (segmentStartUs_ == 0) return false;
+        int64_t ageUs = (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(rotation_.maxAge).count();
+        if (ageUs > 0 && timeUs - segmentStartUs_ >= ageUs) return true;
+        return rotation_.splitDaily && LocalDay(timeUs) != LocalDay(segmentStartUs_);
+    }
+
+    // Đóng segment đang ghi → đổi tên → giao cho archiver → mở file mới
+    void RotateLocked(int64_t nowUs) {
+        std::fclose(file_);
+        file_ = nullptr;
+        bool renamed = RenameActiveLocked(nowUs);
+        file_ = LogOpenFile(basePath_, "ab");
+        if (file_) std::setvbuf(file_, nullptr, _IOFBF, 64 * 1024);
+        if (!renamed) {
+            // file đang bị process khác giữ (Windows) → ghi tiếp file cũ, 1 phút sau thử lại
+            rotateRetryUs_ = nowUs + 60ll * 1000000;
+            return;
+        }
+        activeBytes_ = 0;
+        segmentStartUs_ = 0;
+    }
+
+    bool RenameActiveLocked(int64_t nowUs) {
+        std::filesystem::path segment = LogSegmentPath(basePath_, segmentStartUs_ ? segmentStartUs_ : nowUs);
+        std::error_code ec;
+        std::filesystem::rename(basePath_, segment, ec);
+        if (ec) return false;
+        rotations_.fetch_add(1, std::memory_order_relaxed);
+        archiver_.Enqueue(segment);
+        return true;
+    }
+
+    static int LocalDay(int64_t timeUs) {
+        std::time_t seconds = (std::time_t)(timeUs / 1000000);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+    }
+
+    static int64_t NowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Định dạng 1 bản ghi vào text_ (+ debugger); gọi khi giữ fileMtx_
+    void EmitLocked(int64_t timeUs, int level, const wchar_t* text, size_t chars) {
+        FormatLine(text_, timeUs, level, text, chars);
+        text_.push_back('\n');
+#ifdef _WIN32
+        if (debuggerOutput_) {
+            std::wstring line(text, chars);
+            line.push_back(L'\n');
+            OutputDebugStringW(line.c_str());
+        }
+#endif
+    }
+
+    // Writer chưa chạy / đã dừng: ghi ngay trên thread gọi
+    void WriteDirect(int64_t timeUs, int level, const wchar_t* text, size_t chars) {
+        std::lock_guard<std::mutex> lock(fileMtx_);
+        text_.clear();
+        EmitLocked(timeUs, level, text, chars);
+        WriteOutLocked(timeUs);
+    }
+
+    // cấu hình
+    size_t ringBytes_ = 32 * 1024;
+    std::atomic<int64_t> flushIntervalMs_{ 200 };
+    std::atomic<bool> consoleOutput_{ false };
+    std::atomic<bool> debuggerOutput_{ true };
+
+    // producer
+    std::atomic<uint64_t> nextSeq_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::mutex ringsMtx_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    // điều khiển writer
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable flushedCv_;
+    bool stop_ = false;
+    bool wake_ = false;
+    uint64_t flushRequested_ = 0;
+    uint64_t flushedTicket_ = 0;
+    std::atomic<bool> running_{ false };
+    std::thread writer_;
+
+    // file + bộ đệm định dạng + segment: writer / WriteDirect, dưới fileMtx_
+    std::mutex fileMtx_;
+    std::FILE* file_ = nullptr;
+    std::string text_;
+    std::filesystem::path basePath_;
+    LogRotationPolicy rotation_;
+    uint64_t activeBytes_ = 0;
+    int64_t segmentStartUs_ = 0;        // thời điểm dòng đầu của segment đang ghi
+    int64_t rotateRetryUs_ = 0;
+    std::atomic<uint64_t> rotations_{ 0 };
+    LogArchiver archiver_;
+    // chỉ writer
+    std::vector<Pending> batch_;
+    uint64_t reportedDropped_ = 0;
+};
@@ -0,0 +1,145 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+//
+// Nén khối cho segment log đã đóng: định dạng block LZ4 (token / literal / offset 16 bit / match),
+// tìm match tham lam bằng bảng băm 4 byte. Log dạng text lặp nhiều → thường nhỏ đi 4-8 lần,
+// giải nén chỉ là memcpy nên tool đọc lại nhanh.
+// Mỗi khối nén độc lập (không tham chiếu khối trước) → đọc được 1 khối bất kỳ theo index.
+//
+class LogCodec {
+public:
+    // Kích thước tối đa của dữ liệu nén cho n byte đầu vào
+    static size_t Bound(size_t n) { return n + n / 255 + 16; }
+
+    // Nén src vào dst (cần Bound(n) byte); trả về số byte đã ghi
+    static size_t Compress(const uint8_t* src, size_t n, uint8_t* dst, std::vector<uint32_t>& table) {
+        table.assign(size_t(1) << kHashBits, 0);
+        uint8_t* op = dst;
+        size_t anchor = 0;
+
+        if (n > kMatchFindLimit) {
+            const size_t limit = n - kMatchFindLimit;     // match phải bắt đầu trước đây
+            const size_t matchEnd = n - kLastLiterals;    // và kết thúc trước 5 byte cuối
+            size_t i = 1;
+            table[Hash(Read32(src))] = 0;
+            while (i < limit) {
+                uint32_t seq = Read32(src + i);
+                uint32_t& slot = table[Hash(seq)];
+                size_t cand = slot;
+                slot = (uint32_t)i;
+                if (cand >= i || i - cand > kMaxOffset || Read32(src + cand) != seq) {
+                    ++i;
+                    continue;
+                }
+
+                // nới match về phía trước (chưa vượt anchor) rồi về phía sau
+                while (i > anchor && cand > 0 && src[i - 1] == src[cand - 1]) {
+                    --i;
+                    --cand;
+                }
+                size_t len = kMinMatch;
+                while (i + len < matchEnd && src[cand + len] == src[i + len]) ++len;
+
+                op = EmitSequence(op, src + anchor, i - anchor, i - cand, len);
+                i += len;
+                anchor = i;
+                if (i >= limit) break;
+                table[Hash(Read32(src + i - 2))] = (uint32_t)(i - 2);
+            }
+        }
+
+        // literal cuối (sequence không có match)
+        size_t lit = n - anchor;
+        uint8_t* token = op++;
+        *token = (uint8_t)((lit < 15 ? lit : 15) << 4);
+        if (lit >= 15) op = EmitLength(op, lit - 15);
+        std::memcpy(op, src + anchor, lit);
+        return (size_t)(op + lit - dst);
+    }
+
+    // Giải nén đúng rawSize byte; false nếu dữ liệu hỏng (không bao giờ ghi / đọc ngoài buffer)
+    static bool Decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t rawSize) {
+        size_t ip = 0;
+        size_t op = 0;
+        while (ip < n) {
+            uint8_t token = src[ip++];
+
+            size_t lit = token >> 4;
+            if (lit == 15 && !ReadLength(src, n, ip, lit)) return false;
+            if (lit > n - ip || lit > rawSize - op) return false;
+            std::memcpy(dst + op, src + ip, lit);
+            ip += lit;
+            op += lit;
+            if (ip == n) break;     // sequence cuối chỉ có literal
+
+            if (n - ip < 2) return false;
+            size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) return false;
+
+            size_t len = token & 15;
+            if (len == 15 && !ReadLength(src, n, ip, len)) return false;
+            len += kMinMatch;
+            if (len > rawSize - op) return false;
+
+            const uint8_t* from = dst + op - offset;
+            if (offset >= len) std::memcpy(dst + op, from, len);
+            else for (size_t k = 0; k < len; ++k) dst[op + k] = from[k];   // chồng lấn: lặp mẫu ngắn
+            op += len;
+        }
+        return op == rawSize;
+    }
+
+private:
+    static constexpr size_t kMinMatch = 4;
+    static constexpr size_t kLastLiterals = 5;
+    static constexpr size_t kMatchFindLimit = 12;
+    static constexpr size_t kMaxOffset = 65535;
+    static constexpr int kHashBits = 14;
+
+    static uint32_t Read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint32_t Hash(uint32_t v) {
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    static uint8_t* EmitLength(uint8_t* op, size_t len) {
+        while (len >= 255) {
+            *op++ = 255;
+            len -= 255;
+        }
+        *op++ = (uint8_t)len;
+        return op;
+    }
+
+    static uint8_t* EmitSequence(uint8_t* op, const uint8_t* lit, size_t litLen, size_t offset, size_t matchLen) {
+        size_t m = matchLen - kMinMatch;
+        uint8_t* token = op++;
+        *token = (uint8_t)(((litLen < 15 ? litLen : 15) << 4) | (m < 15 ? m : 15));
+        if (litLen >= 15) op = EmitLength(op, litLen - 15);
+        std::memcpy(op, lit, litLen);
+        op += litLen;
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        if (m >= 15) op = EmitLength(op, m - 15);
+        return op;
+    }
+
+    static bool ReadLength(const uint8_t* src, size_t n, size_t& ip, size_t& len) {
+        uint8_t b;
+        do {
+            if (ip >= n) return false;
+            b = src[ip++];
+            len += b;
+        } while (b == 255);
+        return true;
+    }
+};
@@ -0,0 +1,378 @@
+﻿#pragma once
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include "Logger.h"
+
+//
+// Front end log có format: LogInfo(LogModule::App, L"Đã đặt số lượng in: {}", count)
+//
+// - Tham số giữ nguyên dạng thô (số, con trỏ chuỗi), chỉ format khi mức log được bật.
+// - Format vào buffer cố định của từng thread rồi chuyển thẳng cho Logger → không cấp phát heap.
+// - Mức dưới LINX_LOG_MIN_LEVEL bị bỏ lúc biên dịch; mỗi module có thêm ngưỡng lúc chạy (LogFilter).
+//
+// Placeholder: {} theo thứ tự tham số, {{ / }} cho dấu ngoặc. Thiếu tham số → bỏ placeholder,
+// thừa tham số → bỏ qua. Dòng dài hơn LogBuffer::kCapacity bị cắt và kết thúc bằng "…".
+//
+
+// Giá trị int giữ nguyên như Logger::Write (0 INFO, 1 WARNING, 2 ERROR, 3 DEBUG)
+enum class LogLevel : int {
+    Info = 0,
+    Warning = 1,
+    Error = 2,
+    Debug = 3,
+};
+
+// Độ nghiêm trọng để so ngưỡng: Debug < Info < Warning < Error
+constexpr int LogSeverity(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug:   return 0;
+    case LogLevel::Info:    return 1;
+    case LogLevel::Warning: return 2;
+    case LogLevel::Error:   return 3;
+    }
+    return 1;
+}
+
+// Ngưỡng lúc biên dịch (giá trị LogLevel). Đổi trong Preprocessor Definitions, vd. LINX_LOG_MIN_LEVEL=1
+#ifndef LINX_LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define LINX_LOG_MIN_LEVEL 3    // Debug: giữ mọi mức
+#else
+#define LINX_LOG_MIN_LEVEL 0    // Release: bỏ Debug
+#endif
+#endif
+
+constexpr LogLevel kLogMinLevel = (LogLevel)LINX_LOG_MIN_LEVEL;
+
+constexpr bool LogCompiledIn(LogLevel level) {
+    return LogSeverity(level) >= LogSeverity(kLogMinLevel);
+}
+
+enum class LogModule : uint8_t {
+    App,        // AppController, WorkerLoop
+    Rci,        // RciClient / transport
+    Resource,   // ResourceTracker
+    Ui,         // WindowManager / UIManager
+};
+constexpr size_t kLogModuleCount = 4;
+
+// Ngưỡng lúc chạy theo module (mặc định = ngưỡng biên dịch), đọc / ghi từ thread bất kỳ
+class LogFilter {
+public:
+    static void SetLevel(LogModule module, LogLevel level) {
+        Levels()[(size_t)module].store(LogSeverity(level), std::memory_order_relaxed);
+    }
+
+    static bool Enabled(LogModule module, LogLevel level) {
+        return LogSeverity(level) >= Levels()[(size_t)module].load(std::memory_order_relaxed);
+    }
+
+private:
+    static std::atomic<int>* Levels() {
+        static std::atomic<int> levels[kLogModuleCount] = {
+            LogSeverity(kLogMinLevel), LogSeverity(kLogMinLevel),
+            LogSeverity(kLogMinLevel), LogSeverity(kLogMinLevel) };
+        return levels;
+    }
+};
+
+// Buffer dòng log cố định, mỗi thread 1 cái (ThreadLocal)
+class LogBuffer {
+public:
+    static constexpr size_t kCapacity = 1024;
+
+    static LogBuffer& ThreadLocal() {
+        thread_local LogBuffer buffer;
+        return buffer;
+    }
+
+    void Clear() { size_ = 0; }
+
+    void Append(wchar_t c) {
+        if (size_ < kCapacity) data_[size_++] = c;
+        else data_[kCapacity - 1] = L'…';
+    }
+
+    void Append(std::wstring_view s) {
+        size_t n = s.size();
+        if (n > kCapacity - size_) {
+            n = kCapacity - size_;
+            if (n == 0) {
+                data_[kCapacity - 1] = L'…';
+                return;
+            }
+        }
+        s.copy(data_ + size_, n);
+        size_ += n;
+        if (n < s.size()) data_[kCapacity - 1] = L'…';
+    }
+
+    // Chuỗi ASCII (số đã format)
+    void AppendAscii(const char* s, size_t n) {
+        for (size_t i = 0; i < n; ++i) Append((wchar_t)(unsigned char)s[i]);
+    }
+
+    // std::string trong app là UTF-8 (e.what(), tên task); byte lỗi giữ nguyên như Latin-1
+    void AppendUtf8(std::string_view s) {
+        for (size_t i = 0; i < s.size(); ) {
+            uint32_t c = (unsigned char)s[i];
+            size_t len = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+            bool valid = len > 0 && i + len <= s.size();
+            for (size_t k = 1; valid && k < len; ++k)
+                valid = ((unsigned char)s[i + k] & 0xC0) == 0x80;
+            if (!valid) {
+                Append((wchar_t)c);
+                ++i;
+                continue;
+            }
+            if (len == 2) c &= 0x1F;
+            else if (len == 3) c &= 0x0F;
+            else if (len == 4) c &= 0x07;
+            for (size_t k = 1; k < len; ++k) c = (c << 6) | ((unsigned char)s[i + k] & 0x3F);
+            AppendCodePoint(c);
+            i += len;
+        }
+    }
+
+    std::wstring_view View() const { return std::wstring_view(data_, size_); }
+    size_t Size() const { return size_; }
+
+private:
+    void AppendCodePoint(uint32_t c) {
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (c >= 0x10000) {
+                c -= 0x10000;
+                Append((wchar_t)(0xD800 + (c >> 10)));
+                Append((wchar_t)(0xDC00 + (c & 0x3FF)));
+                return;
+            }
+        }
+        Append((wchar_t)c);
+    }
+
+    wchar_t data_[kCapacity];
+    size_t size_ = 0;
+};
+
+// Số hex có đệm 0: LogHex{ cmd, 2 } → "1d"
+struct LogHex {
+    uint64_t value;
+    int width = 0;
+};
+
+// Dump hex "02 06 1d ..." tối đa max byte đầu, dư thì thêm " …"
+struct LogBytes {
+    const uint8_t* data;
+    size_t size;
+    size_t max = 12;
+};
+
+//
+// 1 tham số log, giữ dạng thô tới lúc format. Chỉ giữ con trỏ / view → tham số phải sống
+// tới hết lời gọi log (tham số tạm trong biểu thức gọi là đủ).
+//
+class LogArg {
+public:
+    template<typename T>
+    LogArg(const T& value) {
+        using U = std::decay_t<T>;
+        if constexpr (std::is_pointer_v<T> && !std::is_void_v<std::remove_pointer_t<T>>) {
+            if (value == nullptr) {
+                SetWide(L"(null)");
+                return;
+            }
+        }
+
+        if constexpr (std::is_convertible_v<const T&, std::wstring_view>) {
+            SetWide(std::wstring_view(value));
+        }
+        else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            std::string_view s(value);
+            kind_ = Kind::Utf8;
+            narrow_ = Utf8Text{ s.data(), s.size() };
+        }
+        else if constexpr (std::is_same_v<U, bool>) {
+            SetWide(value ? L"true" : L"false");
+        }
+        else if constexpr (std::is_enum_v<U>) {
+            kind_ = Kind::Signed;
+            signed_ = (int64_t)value;
+        }
+        else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+            kind_ = Kind::Signed;
+            signed_ = (int64_t)value;
+        }
+        else if constexpr (std::is_integral_v<U>) {
+            kind_ = Kind::Unsigned;
+            unsigned_ = (uint64_t)value;
+        }
+        else if constexpr (std::is_floating_point_v<U>) {
+            kind_ = Kind::Double;
+            double_ = (double)value;
+        }
+        else if constexpr (std::is_same_v<U, LogHex>) {
+            kind_ = Kind::Hex;
+            hex_ = Hex{ value.value, value.width };
+        }
+        else if constexpr (std::is_same_v<U, LogBytes>) {
+            kind_ = Kind::Bytes;
+            bytes_ = Bytes{ value.data, value.size, value.max };
+        }
+        else if constexpr (std::is_pointer_v<U>) {
+            kind_ = Kind::Hex;
+            hex_ = Hex{ (uint64_t)(uintptr_t)value, (int)(sizeof(void*) * 2) };
+        }
+        else {
+            static_assert(sizeof(T) == 0, "LogArg: kiểu tham số chưa hỗ trợ");
+        }
+    }
+
+    void AppendTo(LogBuffer& out) const {
+        char num[32];
+        switch (kind_) {
+        case Kind::Wide:
+            out.Append(std::wstring_view(wide_.data, wide_.size));
+            break;
+        case Kind::Utf8:
+            out.AppendUtf8(std::string_view(narrow_.data, narrow_.size));
+            break;
+        case Kind::Signed: {
+            auto r = std::to_chars(num, num + sizeof(num), signed_);
+            out.AppendAscii(num, (size_t)(r.ptr - num));
+            break;
+        }
+        case Kind::Unsigned: {
+            auto r = std::to_chars(num, num + sizeof(num), unsigned_);
+            out.AppendAscii(num, (size_t)(r.ptr - num));
+            break;
+        }
+        case Kind::Double: {
+            auto r = std::to_chars(num, num + sizeof(num), double_, std::chars_format::general, 6);
+            out.AppendAscii(num, r.ec == std::errc() ? (size_t)(r.ptr - num) : 0);
+            break;
+        }
+        case Kind::Hex:
+            AppendHex(out, hex_.value, hex_.width);
+            break;
+        case Kind::Bytes: {
+            size_t n = bytes_.size < bytes_.max ? bytes_.size : bytes_.max;
+            for (size_t i = 0; i < n; ++i) {
+                if (i) out.Append(L' ');
+                AppendHex(out, bytes_.data[i], 2);
+            }
+            if (n < bytes_.size) out.Append(L" …");
+            break;
+        }
+        }
+    }
+
+private:
+    void SetWide(std::wstring_view s) {
+        kind_ = Kind::Wide;
+        wide_ = WideText{ s.data(), s.size() };
+    }
+
+    static void AppendHex(LogBuffer& out, uint64_t value, int width) {
+        char num[32];
+        auto r = std::to_chars(num, num + sizeof(num), value, 16);
+        for (int pad = width - (int)(r.ptr - num); pad > 0; --pad) out.Append(L'0');
+        out.AppendAscii(num, (size_t)(r.ptr - num));
+    }
+
+    enum class Kind : uint8_t { Wide, Utf8, Signed, Unsigned, Double, Hex, Bytes };
+
+    // Kiểu POD cho union (LogHex / LogBytes có giá trị mặc định → không đặt thẳng vào union)
+    struct WideText { const wchar_t* data; size_t size; };
+    struct Utf8Text { const char* data; size_t size; };
+    struct Hex { uint64_t value; int width; };
+    struct Bytes { const uint8_t* data; size_t size; size_t max; };
+
+    Kind kind_;
+    union {
+        WideText wide_;
+        Utf8Text narrow_;
+        int64_t signed_;
+        uint64_t unsigned_;
+        double double_;
+        Hex hex_;
+        Bytes bytes_;
+    };
+};
+
+inline void LogFormatArgs(LogBuffer& out, std::wstring_view fmt, const LogArg* args, size_t count) {
+    size_t next = 0;
+    size_t i = 0;
+    while (i < fmt.size()) {
+        size_t brace = fmt.find_first_of(L"{}", i);
+        if (brace == std::wstring_view::npos) {
+            out.Append(fmt.substr(i));
+            return;
+        }
+        out.Append(fmt.substr(i, brace - i));
+
+        wchar_t c = fmt[brace];
+        wchar_t after = brace + 1 < fmt.size() ? fmt[brace + 1] : L'\0';
+        if (c == L'{' && after == L'}') {
+            if (next < count) args[next++].AppendTo(out);
+            i = brace + 2;
+        }
+        else if (after == c) {      // {{ hoặc }}
+            out.Append(c);
+            i = brace + 2;
+        }
+        else {
+            out.Append(c);
+            i = brace + 1;
+        }
+    }
+}
+
+// Format vào buffer của thread gọi. View trả về chỉ dùng được tới lần LogFormat / LogWrite kế tiếp
+// trên cùng thread → không truyền kết quả LogFormat làm tham số của 1 lần format khác.
+template<typename... Args>
+std::wstring_view LogFormat(std::wstring_view fmt, const Args&... args) {
+    LogBuffer& buffer = LogBuffer::ThreadLocal();
+    buffer.Clear();
+    if constexpr (sizeof...(Args) == 0) {
+        LogFormatArgs(buffer, fmt, nullptr, 0);
+    }
+    else {
+        const LogArg list[] = { LogArg(args)... };
+        LogFormatArgs(buffer, fmt, list, sizeof...(Args));
+    }
+    return buffer.View();
+}
+
+// Ghi log ra Logger; mức tắt lúc biên dịch → hàm rỗng, mức tắt lúc chạy → không format
+template<LogLevel Level, typename... Args>
+void LogWrite(LogModule module, std::wstring_view fmt, const Args&... args) {
+    if constexpr (LogCompiledIn(Level)) {
+        if (!LogFilter::Enabled(module, Level)) return;
+        Logger::GetInstance().Write(LogFormat(fmt, args...), (int)Level);
+    }
+}
+
+template<typename... Args>
+void LogDebug(LogModule module, std::wstring_view fmt, const Args&... args) {
+    LogWrite<LogLevel::Debug>(module, fmt, args...);
+}
+
+template<typename... Args>
+void LogInfo(LogModule module, std::wstring_view fmt, const Args&... args) {
+    LogWrite<LogLevel::Info>(module, fmt, args...);
+}
+
+template<typename... Args>
+void LogWarning(LogModule module, std::wstring_view fmt, const Args&... args) {
+    LogWrite<LogLevel::Warning>(module, fmt, args...);
+}
+
+template<typename... Args>
+void LogError(LogModule module, std::wstring_view fmt, const Args&... args) {
+    LogWrite<LogLevel::Error>(module, fmt, args...);
+}
@@ -1,11 +1,20 @@
-#pragma once
+﻿#pragma once
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#endif
 #include <string>
-#include <fstream>
-#include <mutex>
-#include <memory>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+#include "LogBackend.h"
 
+//
+// Log của ứng dụng. Write chỉ chép bản ghi vào ring của thread gọi (xem AsyncLogBackend):
+// không khóa chung, không chờ file → gọi được từ worker thread đang giữ trạng thái máy in.
+// File log (UTF-8) được writer thread ghi theo lô mỗi flush interval, ngay khi có ERROR,
+// và khi Flush / Shutdown. File được chia segment, segment cũ nén + có index (LogArchive.h).
+//
 class Logger {
 public:
     static Logger& GetInstance() {
@@ -13,64 +22,59 @@ public:
         return instance;
     }
 
-    void Write(const std::wstring& message, int level = 0) {
-        std::lock_guard<std::mutex> lock(logMutex_);
+    void Write(std::wstring_view message, int level = 0) {
+        backend_.Append(level, message.data(), message.size());
+    }
 
-        std::wstring levelStr;
-        switch (level) {
-        case 1: levelStr = L"[WARNING] "; break;
-        case 2: levelStr = L"[ERROR] "; break;
-        case 3: levelStr = L"[DEBUG] "; break;
-        default: levelStr = L"[INFO] "; break;
-        }
+    void SetLogFile(const std::wstring& filename) {
+        backend_.OpenFile(filename);
+    }
 
-        std::wstring logEntry = GetCurrentTime() + L" " + levelStr + message;
+    void EnableConsoleOutput(bool enable) {
+        backend_.SetConsoleOutput(enable);
+    }
 
-        // Output to debugger
-        OutputDebugStringW((logEntry + L"\n").c_str());
+    // Chu kỳ writer gom log và ghi xuống file (mặc định 200 ms)
+    void SetFlushInterval(std::chrono::milliseconds interval) {
+        backend_.SetFlushInterval(interval);
+    }
 
-        // Write to file if enabled
-        if (logFile_.is_open()) {
-            logFile_ << logEntry << std::endl;
-        }
+    // Khi nào đổi sang segment mới (mặc định 8 MB / 24 giờ / qua nửa đêm)
+    void SetRotation(const LogRotationPolicy& policy) {
+        backend_.SetRotation(policy);
     }
 
-    void SetLogFile(const std::wstring& filename) {
-        std::lock_guard<std::mutex> lock(logMutex_);
-        if (logFile_.is_open()) {
-            logFile_.close();
-        }
-        logFile_.open(filename, std::ios::app);
+    // Giới hạn dung lượng các segment cũ đã nén (mặc định 256 MB / 400 segment)
+    void SetRetention(const LogRetentionPolicy& policy) {
+        backend_.SetRetention(policy);
     }
 
-    void EnableConsoleOutput(bool enable) {
-        consoleOutput_ = enable;
+    // Chờ mọi log đã Write xuống file
+    void Flush() {
+        backend_.Flush();
+    }
+
+    // Ghi nốt log rồi dừng writer thread; Write sau đó ghi thẳng xuống file
+    void Shutdown() {
+        backend_.Stop();
+    }
+
+    // Số bản ghi bị bỏ vì ring của thread đầy
+    uint64_t Dropped() const {
+        return backend_.Dropped();
     }
 
 private:
     Logger() {
         // Default log file
         SetLogFile(L"linx_controller.log");
+        backend_.Start();
         Write(L"Logger initialized");
     }
 
     ~Logger() {
-        if (logFile_.is_open()) {
-            logFile_.close();
-        }
-    }
-
-    std::wstring GetCurrentTime() {
-        SYSTEMTIME st;
-        GetLocalTime(&st);
-        wchar_t buffer[64];
-        swprintf_s(buffer, L"%02d:%02d:%02d.%03d",
-            st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
-        return std::wstring(buffer);
+        backend_.Stop();
     }
 
-    std::wstring logFilename_;
-    std::wofstream logFile_;
-    mutable std::mutex logMutex_;
-    bool consoleOutput_ = false;
-};
\ No newline at end of file
+    AsyncLogBackend backend_;
+};
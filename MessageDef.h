@@ -16,10 +16,13 @@ struct LogMessage {
 };
 
 //Truyền trạng thái máy in cho UI
+//Chỉ gửi khi có thay đổi; changed cho biết trường nào đổi so với lần gửi trước
+//(StateFieldStatusText cũng bật khi statusText của message đổi)
 struct PrinterStateMessage {
-	PrinterState state;     //Trạng thái máy in
+	PrinterState state;     //Trạng thái máy in (giá trị mới của mọi trường)
 	std::wstring statusText;    //Văn bản trạng thái bổ sung
 	std::wstring additionalInfo;    //Thông tin bổ sung (nếu có)
+	uint32_t changed = StateFieldAll;  //Mask PrinterStateField
 };
 
 //Truyền trạng thái kết nối mạng
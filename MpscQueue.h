@@ -0,0 +1,248 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <utility>
+
+//
+// Queue nhiều producer / 1 consumer không khóa (thuật toán MPSC của Vyukov, có node stub).
+//   - Push: 1 lần lấy node từ free list (CAS) + 1 exchange trên tail → không chờ consumer
+//   - TryPop: chỉ gọi từ 1 thread consumer; move giá trị ra rồi trả node về free list
+//   - node cấp theo slab (64, 128, 256... node) và được dùng lại → không cấp phát khi đã ổn định.
+//     Chỉ lúc free list cạn mới lấy mutex để thêm slab.
+// Free list là stack Treiber đánh số node 32 bit + tag 32 bit (tránh ABA khi node bị dùng lại).
+//
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() {
+        Grow();
+        Node* stub = Acquire();
+        stub->next.store(nullptr, std::memory_order_relaxed);
+        head_.store(stub, std::memory_order_relaxed);
+        tail_.store(stub, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue() {
+        Node* head = head_.load(std::memory_order_relaxed);
+        Node* next = head->next.load(std::memory_order_acquire);
+        while (next) {
+            next->Value()->~T();
+            next = next->next.load(std::memory_order_acquire);
+        }
+        for (auto& slab : slabs_) delete[] slab.load(std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // false khi hết node (đã dùng đủ kMaxSlabs slab)
+    bool Push(T&& value) { return Emplace(std::move(value)); }
+    bool Push(const T& value) { return Emplace(value); }
+
+    template<typename... Args>
+    bool Emplace(Args&&... args) {
+        Node* n = Acquire();
+        if (!n) return false;
+        new (n->storage) T(std::forward<Args>(args)...);
+        n->next.store(nullptr, std::memory_order_relaxed);
+
+        // seq_cst: cặp với MpscParker (producer đổi tail rồi đọc parked_, consumer ngược lại)
+        Node* prev = tail_.exchange(n, std::memory_order_seq_cst);
+        prev->next.store(n, std::memory_order_release);     // consumer thấy node từ đây
+        return true;
+    }
+
+    // Chỉ thread consumer. false khi rỗng (hoặc producer đã đặt chỗ nhưng chưa nối node xong)
+    bool TryPop(T& out) {
+        Node* head = head_.load(std::memory_order_relaxed);
+        Node* next = head->next.load(std::memory_order_acquire);
+        if (!next) return false;
+
+        T* value = next->Value();
+        out = std::move(*value);
+        value->~T();
+
+        head_.store(next, std::memory_order_release);       // next thành stub mới
+        Release(head);
+        return true;
+    }
+
+    // Gọi được từ mọi thread. false cả khi producer đang nối node dở → consumer sắp lấy được.
+    bool Empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFFu;
+    static constexpr uint32_t kFirstSlab = 64;      // slab s có kFirstSlab << s node
+    static constexpr size_t kMaxSlabs = 20;
+
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        std::atomic<uint32_t> freeNext{ kNil };
+        uint32_t index = 0;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* Value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    // index → slab: slab s chứa các index [64 * (2^s - 1), 64 * (2^(s+1) - 1))
+    Node* NodeAt(uint32_t index) const {
+        uint32_t k = index / kFirstSlab + 1;
+        unsigned s = (unsigned)std::bit_width(k) - 1;
+        uint32_t offset = index - kFirstSlab * ((1u << s) - 1);
+        return slabs_[s].load(std::memory_order_acquire) + offset;
+    }
+
+    static uint64_t Pack(uint64_t tag, uint32_t index) { return (tag << 32) | index; }
+
+    Node* Acquire() {
+        uint64_t head = free_.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = (uint32_t)head;
+            if (index == kNil) {
+                if (!Grow()) return nullptr;
+                head = free_.load(std::memory_order_acquire);
+                continue;
+            }
+            // node có thể vừa bị thread khác lấy → freeNext cũ, CAS sẽ hỏng nhờ tag
+            Node* n = NodeAt(index);
+            uint32_t next = n->freeNext.load(std::memory_order_relaxed);
+            if (free_.compare_exchange_weak(head, Pack((head >> 32) + 1, next),
+                std::memory_order_acquire, std::memory_order_acquire))
+                return n;
+        }
+    }
+
+    void Release(Node* n) { PushChain(n, n); }
+
+    // Đưa chuỗi first..last (đã nối bằng freeNext) về free list
+    void PushChain(Node* first, Node* last) {
+        uint64_t head = free_.load(std::memory_order_relaxed);
+        do {
+            last->freeNext.store((uint32_t)head, std::memory_order_relaxed);
+        } while (!free_.compare_exchange_weak(head, Pack((head >> 32) + 1, first->index),
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool Grow() {
+        std::lock_guard<std::mutex> lock(growMtx_);
+        if ((uint32_t)free_.load(std::memory_order_acquire) != kNil) return true;  // thread khác vừa thêm
+        if (slabCount_ == kMaxSlabs) return false;
+
+        uint32_t count = kFirstSlab << slabCount_;
+        uint32_t base = kFirstSlab * ((1u << slabCount_) - 1);
+        Node* slab = new Node[count];
+        for (uint32_t i = 0; i < count; ++i) {
+            slab[i].index = base + i;
+            slab[i].freeNext.store(i + 1 < count ? base + i + 1 : kNil, std::memory_order_relaxed);
+        }
+        slabs_[slabCount_++].store(slab, std::memory_order_release);
+        PushChain(&slab[0], &slab[count - 1]);
+        return true;
+    }
+
+    alignas(64) std::atomic<Node*> tail_{ nullptr };    // producer
+    alignas(64) std::atomic<Node*> head_{ nullptr };    // consumer (stub hiện tại)
+    alignas(64) std::atomic<uint64_t> free_{ kNil };    // tag << 32 | index
+    std::atomic<Node*> slabs_[kMaxSlabs] = {};
+    size_t slabCount_ = 0;
+    std::mutex growMtx_;
+};
+
+//
+// Cho consumer ngủ khi hết việc. Producer chỉ chạm mutex / condvar khi consumer thật sự đang
+// ngủ; lúc consumer đang chạy Notify() chỉ là 1 lần đọc atomic.
+// Không mất tín hiệu: producer ghi dữ liệu rồi đọc parked_, consumer ghi parked_ rồi đọc lại
+// dữ liệu (ready()), cả 4 thao tác đều seq_cst → ít nhất 1 bên thấy bên kia.
+//
+class MpscParker {
+public:
+    // Producer: gọi sau khi đã đẩy dữ liệu
+    void Notify() {
+        if (!parked_.load(std::memory_order_seq_cst)) return;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            parked_.store(false, std::memory_order_relaxed);
+        }
+        cv_.notify_one();
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Consumer: ngủ tới khi ready() == true, bị Notify(), hoặc tới deadline (max() = không giới hạn).
+    // false = hết hạn.
+    template<typename Ready>
+    bool ParkUntil(std::chrono::steady_clock::time_point deadline, Ready ready) {
+        parked_.store(true, std::memory_order_seq_cst);
+        if (ready()) {
+            parked_.store(false, std::memory_order_relaxed);
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto wake = [&] { return !parked_.load(std::memory_order_relaxed) || ready(); };
+        bool ok = true;
+        if (deadline == std::chrono::steady_clock::time_point::max())
+            cv_.wait(lock, wake);
+        else
+            ok = cv_.wait_until(lock, deadline, wake);
+        parked_.store(false, std::memory_order_relaxed);
+        return ok;
+    }
+
+    // Số lần producer phải đánh thức consumer (thống kê)
+    uint64_t Wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> parked_{ false };
+    std::atomic<uint64_t> wakeups_{ 0 };
+    std::mutex mtx_;
+    std::condition_variable cv_;
+};
+
+//
+// MpscQueue + MpscParker: Push / Pop / WaitPop khi chỉ có 1 thread lấy ra (Pop / WaitPop chỉ gọi
+// từ thread đó). ThreadSafeQueue<T, QueueConsumers::Single> dựng trên lớp này (thêm giới hạn / hạn dùng).
+//
+template<typename T>
+class BlockingMpscQueue {
+public:
+    bool Push(T&& value) {
+        if (!queue_.Push(std::move(value))) return false;
+        parker_.Notify();
+        return true;
+    }
+
+    bool Push(const T& value) {
+        if (!queue_.Push(value)) return false;
+        parker_.Notify();
+        return true;
+    }
+
+    bool Pop(T& value) { return queue_.TryPop(value); }
+
+    bool WaitPop(T& value, int timeoutMs = 100) {
+        return WaitPopUntil(value, std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+    }
+
+    bool WaitPopUntil(T& value, std::chrono::steady_clock::time_point deadline) {
+        while (!queue_.TryPop(value)) {
+            if (!parker_.ParkUntil(deadline, [this] { return !queue_.Empty(); }))
+                return queue_.TryPop(value);
+        }
+        return true;
+    }
+
+    bool Empty() const { return queue_.Empty(); }
+    uint64_t Wakeups() const { return parker_.Wakeups(); }
+
+private:
+    MpscQueue<T> queue_;
+    MpscParker parker_;
+};
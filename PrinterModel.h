@@ -2,9 +2,21 @@
 #include <string>
 #include "CommonTypes.h"
 #include <mutex>
-
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+//
+// Trạng thái máy in được công bố dạng snapshot bất biến (kiểu RCU):
+//   - writer (các hàm Set...) sửa currentState_ dưới mutex_, rồi tạo snapshot mới và đổi con trỏ
+//   - reader lấy shared_ptr tới snapshot hiện tại: không chờ mutex_, không copy chuỗi;
+//     snapshot cũ còn sống tới khi reader cuối cùng bỏ nó
+//   - mỗi lần trạng thái thật sự đổi, version tăng 1 → so version để bỏ qua khi không có gì mới
+//
 class PrinterModel {
 public:
+    using Snapshot = std::shared_ptr<const PrinterState>;
+
     PrinterModel() {
         // Khởi tạo currentState_ với giá trị mặc định
         currentState_.status = PrinterStateType::Disconnected;
@@ -13,25 +25,37 @@ public:
         currentState_.printing = false;
         currentState_.printedCount = 0;
         currentState_.targetCount = 0;
+        Publish();
     }
 
 	// Đặt trạng thái máy in
     void SetState(PrinterState state) {
         std::lock_guard<std::mutex> lock(mutex_);
-        currentState_ = state;
+        currentState_ = std::move(state);
+        Publish();
     }
 
-	// Lấy trạng thái máy in hiện tại
+	// Lấy bản copy trạng thái máy in hiện tại (để sửa rồi SetState)
     PrinterState GetState() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return currentState_;
+        return *GetSnapshot();
+    }
+
+    // Snapshot hiện tại, chỉ đọc. Không khóa mutex_ → không chặn worker đang ghi.
+    Snapshot GetSnapshot() const {
+        return snapshot_.load(std::memory_order_acquire);
+    }
+
+    // Version của snapshot mới nhất (tăng dần, bắt đầu từ 1)
+    uint64_t GetVersion() const {
+        return version_.load(std::memory_order_acquire);
     }
     
 	// Đặt văn bản trạng thái máy in
     void SetStatusText(const std::wstring& status) {
         std::lock_guard<std::mutex> lock(mutex_);
         statusText_ = status;
-        currentState_.statusText = status; 
+        currentState_.statusText = status;
+        Publish();
     }
 
 	// Lấy văn bản trạng thái máy in
@@ -49,6 +73,7 @@ public:
         currentState_.jobId = jobId;
         currentState_.targetCount = totalCount;
         currentState_.printedCount = 0;
+        Publish();
     }
 
 	// Cập nhật tiến trình công việc in
@@ -56,6 +81,7 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
         jobCurrent_ = currentCount;
         currentState_.printedCount = currentCount;
+        Publish();
     }
 
 	// Xóa công việc in hiện tại
@@ -67,6 +93,7 @@ public:
         currentState_.jobId.clear();
         currentState_.targetCount = 0;
         currentState_.printedCount = 0;
+        Publish();
     }
 
 	// Đặt lỗi cuối cùng
@@ -75,6 +102,7 @@ public:
         lastError_ = error;
         currentState_.errorMessage = error;
         currentState_.status = PrinterStateType::Error;
+        Publish();
     }
 
 	// Lấy lỗi cuối cùng
@@ -131,17 +159,35 @@ public:
         std::lock_guard<std::mutex> lock(mutex_);
         currentState_.printing = isPrinting;
         currentState_.status = isPrinting ? PrinterStateType::Printing : PrinterStateType::Idle;
+        Publish();
     }
 
     // Thêm method để cập nhật trạng thái jet
     void SetJetState(bool jetOn) {
         std::lock_guard<std::mutex> lock(mutex_);
         currentState_.jetOn = jetOn;
+        Publish();
     }
 
 private:
-    mutable std::mutex mutex_;
-    PrinterState currentState_;  // XÓA KHỞI TẠO TRỰC TIẾP
+    // Gọi khi đang giữ mutex_ sau khi sửa currentState_. Nội dung không đổi (vd. poll trả về
+    // đúng trạng thái cũ) → giữ snapshot và version cũ.
+    void Publish() {
+        Snapshot current = snapshot_.load(std::memory_order_relaxed);
+        if (current && current->SameAs(currentState_)) {
+            currentState_.version = current->version;
+            return;
+        }
+        uint64_t version = version_.load(std::memory_order_relaxed) + 1;
+        currentState_.version = version;
+        snapshot_.store(std::make_shared<const PrinterState>(currentState_), std::memory_order_release);
+        version_.store(version, std::memory_order_release);
+    }
+
+    mutable std::mutex mutex_;      // writer với nhau + các trường ngoài snapshot
+    PrinterState currentState_;     // bản của writer, chỉ sửa dưới mutex_
+    std::atomic<Snapshot> snapshot_;
+    std::atomic<uint64_t> version_{ 0 };
     std::wstring statusText_ = L"Chưa kết nối";
     std::wstring lastError_;
     std::wstring printContent_;
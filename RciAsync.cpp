@@ -0,0 +1,88 @@
+﻿#include "RciAsync.h"
+
+// =========================================================
+// CommandAwaiter
+// =========================================================
+void RciAsyncClient::CommandAwaiter::await_suspend(std::coroutine_handle<> h) {
+    auto st = std::make_shared<State>();
+    st->handle = h;
+    st->executor = &executor_;
+    st->payload = std::move(payload_);
+    st->cancel = cancel_;
+    state_ = st;
+
+    // Từ lúc đăng ký callback, coroutine có thể tiếp tục trên thread khác và hủy awaiter
+    // → chỉ dùng biến cục bộ / st bên dưới.
+    RciClient& client = client_;
+    uint8_t cmdid = cmdid_;
+    int timeoutMs = timeoutMs_;
+
+    uint64_t id = st->cancel.Register([st] {
+        RciResult r;
+        r.status = RciResult::Status::Cancelled;
+        Complete(st, r);
+        });
+    st->cancelId = id;
+    if (st->done) {
+        st->cancel.Unregister(id);   // đã hủy từ trước → không gửi lệnh
+        return;
+    }
+
+    client.SubmitCommand(cmdid, st->payload, timeoutMs, [st](const RciResult& r) {
+        Complete(st, r);
+        });
+}
+
+RciResult RciAsyncClient::CommandAwaiter::await_resume() {
+    return state_->result;
+}
+
+void RciAsyncClient::CommandAwaiter::Complete(const std::shared_ptr<State>& st, const RciResult& r) {
+    if (st->done.exchange(true)) return;    // reply tới sau khi hủy (hoặc ngược lại) → bỏ
+    st->result = r;
+    st->cancel.Unregister(st->cancelId);
+    // luôn tiếp tục trên executor, kể cả khi callback chạy ngay trong await_suspend
+    st->executor->Resume(st->handle);
+}
+
+// =========================================================
+// Lệnh
+// =========================================================
+RciAsyncClient::CommandAwaiter RciAsyncClient::Command(uint8_t cmdid, std::vector<uint8_t> payload,
+    int timeoutMs, RciCancelToken cancel) {
+    return CommandAwaiter(client_, executor_, cmdid, std::move(payload), timeoutMs, std::move(cancel));
+}
+
+RciAsyncClient::CommandAwaiter RciAsyncClient::StartJet(int timeoutMs, RciCancelToken cancel) {
+    return Command(RciCmd::StartJet, {}, timeoutMs, std::move(cancel));
+}
+
+RciAsyncClient::CommandAwaiter RciAsyncClient::StopJet(int timeoutMs, RciCancelToken cancel) {
+    return Command(RciCmd::StopJet, {}, timeoutMs, std::move(cancel));
+}
+
+RciAsyncClient::CommandAwaiter RciAsyncClient::StartPrint(int timeoutMs, RciCancelToken cancel) {
+    return Command(RciCmd::StartPrint, {}, timeoutMs, std::move(cancel));
+}
+
+RciAsyncClient::CommandAwaiter RciAsyncClient::StopPrint(int timeoutMs, RciCancelToken cancel) {
+    return Command(RciCmd::StopPrint, {}, timeoutMs, std::move(cancel));
+}
+
+RciAsyncClient::CommandAwaiter RciAsyncClient::LoadMessage(const std::string& name, uint16_t printCount,
+    int timeoutMs, RciCancelToken cancel) {
+    uint8_t payload[RciClient::kLoadMessagePayloadSize];
+    RciClient::MakeLoadMessagePayload(name, printCount, payload);
+    return Command(RciCmd::LoadMessage, std::vector<uint8_t>(payload, payload + sizeof(payload)),
+        timeoutMs, std::move(cancel));
+}
+
+RciTask<RciAwaitResult<PrinterStatus>> RciAsyncClient::Status(int timeoutMs, RciCancelToken cancel) {
+    RciResult r = co_await Command(RciCmd::Status, {}, timeoutMs, std::move(cancel));
+
+    RciAwaitResult<PrinterStatus> out;
+    out.status = r.status;
+    if (r.Ok() && !RciClient::ParseStatus(r.View(), out.value))
+        out.status = RciResult::Status::Invalid;
+    co_return out;
+}
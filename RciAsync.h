@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <coroutine>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RciClient.h"
+#include "RciExecutor.h"
+#include "RciTask.h"
+
+//
+// Lớp awaitable trên RciClient:
+//   RciResult r = co_await async.LoadMessage(name, n);
+//   auto st = co_await async.Status();
+// Lệnh gửi qua RciClient::SubmitCommand, coroutine tiếp tục trên RciExecutor khi có reply /
+// hết hạn (timeoutMs cho từng lần await) / bị hủy (RciCancelToken).
+// Để thread executor không bị chặn trong lúc chờ, RciClient cần bật pipeline (SetPipelineWindow > 1).
+//
+template<typename T>
+struct RciAwaitResult {
+    RciResult::Status status = RciResult::Status::Timeout;
+    T value{};
+
+    bool Ok() const { return status == RciResult::Status::Ok; }
+};
+
+class RciAsyncClient {
+public:
+    RciAsyncClient(RciClient& client, RciExecutor& executor) : client_(client), executor_(executor) {}
+
+    class CommandAwaiter {
+    public:
+        CommandAwaiter(RciClient& client, RciExecutor& executor, uint8_t cmdid,
+            std::vector<uint8_t> payload, int timeoutMs, RciCancelToken cancel)
+            : client_(client), executor_(executor), cmdid_(cmdid), payload_(std::move(payload)),
+            timeoutMs_(timeoutMs), cancel_(std::move(cancel)) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h);
+        RciResult await_resume();
+
+    private:
+        // Dùng chung giữa coroutine, callback reply và callback hủy: ai đến trước thắng
+        struct State {
+            std::atomic<bool> done{ false };
+            RciResult result;
+            std::coroutine_handle<> handle;
+            RciExecutor* executor = nullptr;
+            std::vector<uint8_t> payload;   // giữ payload tới khi SubmitCommand xong (frame coroutine có thể đã hủy)
+            RciCancelToken cancel;
+            std::atomic<uint64_t> cancelId{ 0 };
+        };
+        static void Complete(const std::shared_ptr<State>& st, const RciResult& r);
+
+        RciClient& client_;
+        RciExecutor& executor_;
+        uint8_t cmdid_;
+        std::vector<uint8_t> payload_;
+        int timeoutMs_;
+        RciCancelToken cancel_;
+        std::shared_ptr<State> state_;
+    };
+
+    CommandAwaiter Command(uint8_t cmdid, std::vector<uint8_t> payload = {},
+        int timeoutMs = 3000, RciCancelToken cancel = {});
+
+    CommandAwaiter StartJet(int timeoutMs = 3000, RciCancelToken cancel = {});
+    CommandAwaiter StopJet(int timeoutMs = 3000, RciCancelToken cancel = {});
+    CommandAwaiter StartPrint(int timeoutMs = 3000, RciCancelToken cancel = {});
+    CommandAwaiter StopPrint(int timeoutMs = 3000, RciCancelToken cancel = {});
+    CommandAwaiter LoadMessage(const std::string& name, uint16_t printCount = 1,
+        int timeoutMs = 3000, RciCancelToken cancel = {});
+
+    // STATUS 0x14 đã giải mã; reply sai định dạng → Status::Invalid
+    RciTask<RciAwaitResult<PrinterStatus>> Status(int timeoutMs = 3000, RciCancelToken cancel = {});
+
+    RciExecutor& Executor() { return executor_; }
+
+private:
+    RciClient& client_;
+    RciExecutor& executor_;
+};
@@ -0,0 +1,176 @@
+﻿#include "RciCapture.h"
+#include <cstring>
+
+namespace {
+    constexpr char kMagic[8] = { 'R', 'C', 'I', 'C', 'A', 'P', '\0', '\1' };
+}
+
+RciCapture::RciCapture(size_t ringBytes) {
+    // dung lượng ring: lũy thừa 2, tối thiểu 64 KB
+    capacity_ = 64 * 1024;
+    while (capacity_ < ringBytes) capacity_ <<= 1;
+    mask_ = capacity_ - 1;
+    ring_ = std::make_unique<uint64_t[]>(capacity_ / sizeof(uint64_t));   // khởi tạo = 0
+}
+
+RciCapture::~RciCapture() {
+    Close();
+}
+
+bool RciCapture::Open(const std::filesystem::path& path) {
+    if (open_) return false;
+
+    file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file_.is_open()) return false;
+
+    start_ = std::chrono::steady_clock::now();
+    FileHeader h{};
+    memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.headerSize = sizeof(FileHeader);
+    h.wallClockNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    file_.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    stopping_ = false;
+    open_ = true;
+    writer_ = std::thread(&RciCapture::WriterLoop, this);
+    return true;
+}
+
+void RciCapture::Close() {
+    if (!open_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+
+    Drain();    // phần còn lại sau lần ghi cuối của writer
+    file_.close();
+}
+
+// =========================================================
+// Producer: đặt chỗ bằng CAS trên head_, copy, rồi công bố bằng info (release)
+// =========================================================
+void RciCapture::Record(uint32_t connId, Direction dir, const uint8_t* data, size_t len) noexcept {
+    if (!open_.load(std::memory_order_relaxed)) return;
+
+    uint64_t timeNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+
+    while (len > 0) {
+        size_t part = len < kMaxRecord ? len : kMaxRecord;
+        size_t need = Align(sizeof(RecordHeader) + part);
+        if (need > capacity_ / 2) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        uint64_t total;
+        while (true) {
+            size_t contiguous = capacity_ - (size_t)(pos & mask_);
+            // không đủ chỗ liền ở cuối ring → bỏ phần đuôi, ghi từ đầu ring
+            total = need <= contiguous ? need : contiguous + need;
+            if (pos + total - tail_.load(std::memory_order_acquire) > capacity_) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (head_.compare_exchange_weak(pos, pos + total,
+                std::memory_order_acq_rel, std::memory_order_relaxed))
+                break;
+        }
+
+        uint64_t rec = pos;
+        if (total != need) {
+            InfoAt(pos).store(kPadInfo, std::memory_order_release);
+            rec = pos + (capacity_ - (size_t)(pos & mask_));
+        }
+
+        auto* h = reinterpret_cast<RecordHeader*>(At(rec));
+        h->timeNs = timeNs;
+        h->connId = connId;
+        memcpy(h + 1, data, part);
+        InfoAt(rec).store((uint32_t)part | ((uint32_t)dir << 24), std::memory_order_release);
+
+        data += part;
+        len -= part;
+    }
+}
+
+// =========================================================
+// Writer thread
+// =========================================================
+void RciCapture::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!stopping_) {
+        lock.unlock();
+        Drain();
+        lock.lock();
+        cv_.wait_for(lock, std::chrono::milliseconds(20), [this] { return stopping_; });
+    }
+}
+
+// Chuyển các bản ghi đã công bố ra file; dừng ở bản ghi đầu tiên chưa copy xong
+size_t RciCapture::Drain() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    size_t records = 0;
+    out_.clear();
+
+    while (tail < head) {
+        uint32_t info = InfoAt(tail).load(std::memory_order_acquire);
+        if (info == 0) break;
+
+        size_t step;
+        if (info == kPadInfo) {
+            step = capacity_ - (size_t)(tail & mask_);
+        }
+        else {
+            size_t len = info & 0xFFFFFF;
+            step = Align(sizeof(RecordHeader) + len);
+            const uint8_t* p = At(tail);
+            out_.insert(out_.end(), p, p + sizeof(RecordHeader) + len);
+            ++records;
+        }
+
+        // trả vùng về 0: header mới ghi vào đây sau này phải đọc được info == 0 trước khi công bố
+        memset(At(tail), 0, step);
+        tail += step;
+    }
+    tail_.store(tail, std::memory_order_release);
+
+    if (!out_.empty()) {
+        file_.write(reinterpret_cast<const char*>(out_.data()), (std::streamsize)out_.size());
+        file_.flush();
+        written_.fetch_add(records, std::memory_order_relaxed);
+    }
+    return records;
+}
+
+// =========================================================
+// RciCaptureReader
+// =========================================================
+bool RciCaptureReader::Open(const std::filesystem::path& path) {
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) return false;
+
+    if (!file_.read(reinterpret_cast<char*>(&header_), sizeof(header_))) return false;
+    if (memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0 || header_.version != RciCapture::kVersion)
+        return false;
+    file_.seekg(header_.headerSize, std::ios::beg);
+    return true;
+}
+
+bool RciCaptureReader::Next(Record& record) {
+    RciCapture::RecordHeader h;
+    if (!file_.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+
+    record.timeNs = h.timeNs;
+    record.connId = h.connId;
+    record.dir = (RciCapture::Direction)(h.info >> 24);
+    record.data.resize(h.info & 0xFFFFFF);
+    return (bool)file_.read(reinterpret_cast<char*>(record.data.data()), (std::streamsize)record.data.size());
+}
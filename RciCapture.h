@@ -0,0 +1,122 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <chrono>
+
+//
+// Ghi lại lưu lượng RCI (byte gửi / nhận) ra file nhị phân để phân tích và replay offline.
+//
+// Đường gửi/nhận chỉ làm 1 lần memcpy vào ring (MPSC, không khóa); thread riêng ghi ra file.
+// Ring đầy → bỏ bản ghi và tăng Dropped(), không bao giờ chặn RciClient.
+//
+// Định dạng file (little-endian):
+//   FileHeader
+//   lặp lại: RecordHeader + data[len] (không padding)
+//
+class RciCapture {
+public:
+    enum class Direction : uint8_t {
+        Tx = 0,     // RciClient → máy in
+        Rx = 1,     // máy in → RciClient (đúng từng đoạn byte đã recv)
+    };
+
+    struct FileHeader {
+        char magic[8];          // "RCICAP\0\1"
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t wallClockNs;   // system_clock lúc bắt đầu (đối chiếu với log)
+    };
+
+    struct RecordHeader {
+        uint64_t timeNs;        // steady_clock tính từ lúc Open()
+        uint32_t connId;
+        uint32_t info;          // bit 0..23 = len, bit 24..31 = Direction
+    };
+
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kMaxRecord = (1u << 24) - 1;
+
+    explicit RciCapture(size_t ringBytes = 4u << 20);
+    ~RciCapture();
+
+    RciCapture(const RciCapture&) = delete;
+    RciCapture& operator=(const RciCapture&) = delete;
+
+    // Mở file (ghi nối tiếp) và khởi động thread ghi
+    bool Open(const std::filesystem::path& path);
+    // Ghi nốt dữ liệu còn trong ring rồi đóng file
+    void Close();
+    bool IsOpen() const { return open_; }
+
+    // Mỗi kết nối RciClient lấy 1 id riêng
+    uint32_t NewConnectionId() { return nextConnId_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Gọi từ đường gửi/nhận: chỉ copy vào ring
+    void Record(uint32_t connId, Direction dir, const uint8_t* data, size_t len) noexcept;
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Written() const { return written_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kAlign = 16;
+    static constexpr uint32_t kPadInfo = 0xFFFFFFFFu;     // phần đuôi ring bị bỏ qua
+
+    static size_t Align(size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+    uint8_t* At(uint64_t pos) { return reinterpret_cast<uint8_t*>(ring_.get()) + (pos & mask_); }
+    std::atomic_ref<uint32_t> InfoAt(uint64_t pos) {
+        return std::atomic_ref<uint32_t>(reinterpret_cast<RecordHeader*>(At(pos))->info);
+    }
+
+    void WriterLoop();
+    size_t Drain();
+
+    std::unique_ptr<uint64_t[]> ring_;      // uint64_t để căn lề header
+    size_t capacity_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{ 0 };  // vị trí đã đặt chỗ (producer)
+    alignas(64) std::atomic<uint64_t> tail_{ 0 };  // vị trí đã ghi ra file (writer thread)
+
+    std::atomic<bool> open_{ false };
+    std::atomic<uint32_t> nextConnId_{ 1 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> written_{ 0 };
+    std::chrono::steady_clock::time_point start_;
+
+    std::ofstream file_;
+    std::vector<uint8_t> out_;              // gom bản ghi trước khi ghi file
+    std::thread writer_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+//
+// Đọc file capture tuần tự (replay / phân tích)
+//
+class RciCaptureReader {
+public:
+    struct Record {
+        uint64_t timeNs = 0;
+        uint32_t connId = 0;
+        RciCapture::Direction dir = RciCapture::Direction::Tx;
+        std::vector<uint8_t> data;
+    };
+
+    bool Open(const std::filesystem::path& path);
+    // false khi hết file hoặc bản ghi cuối bị cắt dở
+    bool Next(Record& record);
+
+    uint64_t WallClockNs() const { return header_.wallClockNs; }
+
+private:
+    std::ifstream file_;
+    RciCapture::FileHeader header_{};
+};
@@ -4,41 +4,25 @@
 #include <chrono>
 #include <sstream>
 #include <iomanip>
-#include "AppController.h"
+#include <cstring>
+#include <algorithm>
 
 #include <iostream> 
 #include <string>    
 
 using namespace std;
-#pragma comment(lib, "Ws2_32.lib")
 // =========================================================
 // Constructor / Destructor
 // =========================================================
-RciClient::RciClient() : sock_(INVALID_SOCKET), connected_(false), port_(0) {
-    WSADATA wsa;
-    WSAStartup(MAKEWORD(2, 2), &wsa);
+RciClient::RciClient() : RciClient(CreateDefaultRciTransport()) {}
+
+RciClient::RciClient(std::unique_ptr<IRciTransport> transport)
+    : transport_(std::move(transport)), connected_(false), port_(0) {
+    txBuffer_.reserve(RciFrame::MaxEncodedSize(256));
 }
 
 RciClient::~RciClient() {
     Disconnect();
-    WSACleanup();
-}
-static std::wstring WsaErrorToString(int err) {
-    wchar_t* msg = nullptr;
-    FormatMessageW(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-        NULL, err, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-        (LPWSTR)&msg, 0, NULL);
-    std::wstring out;
-    if (msg) {
-        out = msg;
-        LocalFree(msg);
-    }
-    else {
-        std::wstringstream ss; ss << L"WSA error " << err;
-        out = ss.str();
-    }
-    return out;
 }
 
 // =========================================================
@@ -47,104 +31,26 @@ static std::wstring WsaErrorToString(int err) {
 
 bool RciClient::Connect(const std::wstring& ip, unsigned short port, int timeoutMs) {
     // 1. Đảm bảo bất kỳ kết nối cũ nào cũng được đóng bên ngoài mutex
-    SOCKET oldSock = INVALID_SOCKET;
+    CloseConnection(true);
 
-    {
-        std::lock_guard<std::mutex> lock(mtx_);
+    // 2. Mở kết nối mới qua transport
+    Log<LogLevel::Warning>(L"🔌 [Connect] Bắt đầu kết nối đến {}:{}", ip, port);
 
-        if (connected_ || sock_ != INVALID_SOCKET) {
-            // đánh dấu disconnect
-            connected_ = false;
-            oldSock = sock_;
-            sock_ = INVALID_SOCKET;
-        }
-    }
-
-    if (oldSock != INVALID_SOCKET) {
-        ::shutdown(oldSock, SD_BOTH);
-        ::closesocket(oldSock);
-        Log(L"🔌 [Connect] Đã đóng kết nối cũ trước khi mở kết nối mới", 1);
-    }
-
-    // 2. Tạo socket mới
-    Log(L"🔌 [Connect] Bắt đầu kết nối đến " + ip + L":" + std::to_wstring(port), 1);
-
-    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s == INVALID_SOCKET) {
-        Log(L"❌ Không thể tạo socket", 2);
+    std::wstring error;
+    if (!transport_->Connect(ip, port, timeoutMs, error)) {
+        Log<LogLevel::Error>(L"{}", error);
         return false;
     }
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-
-    char ipUtf8[64] = {};
-    WideCharToMultiByte(CP_ACP, 0, ip.c_str(), -1, ipUtf8, sizeof(ipUtf8), NULL, NULL);
-
-    if (inet_pton(AF_INET, ipUtf8, &addr.sin_addr) <= 0) {
-        Log(L"❌ Địa chỉ IP không hợp lệ", 2);
-        closesocket(s);
-        return false;
-    }
-
-    // 3. Đặt non-blocking tạm thời để dùng select()
-    u_long mode = 1;
-    ioctlsocket(s, FIONBIO, &mode);
-
-    int res = connect(s, (sockaddr*)&addr, sizeof(addr));
-    if (res == SOCKET_ERROR) {
-        int err = WSAGetLastError();
-
-        // Cho phép WSAEWOULDBLOCK / WSAEINPROGRESS / WSAEALREADY
-        if (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS && err != WSAEALREADY) {
-            std::wstringstream ss;
-            ss << L"❌ connect() thất bại, WSAError=" << err << L" (" << WsaErrorToString(err) << L")";
-            Log(ss.str(), 2);
-            closesocket(s);
-            return false;
-        }
-    }
-
-    // 4. Chờ socket sẵn sàng ghi (kết nối thành công)
-    fd_set wset;
-    FD_ZERO(&wset);
-    FD_SET(s, &wset);
-
-    timeval tv;
-    tv.tv_sec = timeoutMs / 1000;
-    tv.tv_usec = (timeoutMs % 1000) * 1000;
-
-    res = select(0, NULL, &wset, NULL, &tv);
-    if (res <= 0 || !FD_ISSET(s, &wset)) {
-        Log(L"⏰ Timeout kết nối", 2);
-        closesocket(s);
-        return false;
-    }
-
-    // 5. Kiểm tra lỗi chậm bằng SO_ERROR
-    int so_err = 0;
-    int optlen = sizeof(so_err);
-    if (getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&so_err, &optlen) == 0) {
-        if (so_err != 0) {
-            std::wstringstream ss;
-            ss << L"❌ Kết nối thất bại (SO_ERROR=" << so_err << L")";
-            Log(ss.str(), 2);
-            closesocket(s);
-            return false;
-        }
-    }
-
-    // 6. Trả socket về blocking
-    mode = 0;
-    ioctlsocket(s, FIONBIO, &mode);
-
     {
         std::lock_guard<std::mutex> lock(mtx_);
-        sock_ = s;
         host_ = ip;
         port_ = port;
+        if (capture_) connId_ = capture_->NewConnectionId();
+        rxRing_.Clear();     // không dùng lại byte dư của kết nối cũ
+        decoder_.Reset();
         connected_ = true;
+        if (pipelined_) StartReaderLocked();
     }
 
     return true;
@@ -155,26 +61,37 @@ bool RciClient::Connect(const std::wstring& ip, unsigned short port, int timeout
 // ==========================
 
 bool RciClient::Disconnect() {
-    SOCKET localSock = INVALID_SOCKET;
+    CloseConnection(false);
+    return true;
+}
+
+// Đóng kết nối hiện tại: shutdown → dừng reader thread → close → báo lỗi các lệnh đang chờ
+void RciClient::CloseConnection(bool logOld) {
+    bool wasOpen = false;
 
     {
         std::lock_guard<std::mutex> lock(mtx_);
 
-        if (!connected_ && sock_ == INVALID_SOCKET) {
-            return true; // không có gì để ngắt
+        wasOpen = connected_;
+        if (!wasOpen && !ReaderActive()) {
+            return; // không có gì để ngắt
         }
 
         connected_ = false;
-        localSock = sock_;
-        sock_ = INVALID_SOCKET;
     }
 
-    if (localSock != INVALID_SOCKET) {
-        ::shutdown(localSock, SD_BOTH);
-        ::closesocket(localSock);
-    }
+    // shutdown đánh thức reader thread đang chờ nhận
+    transport_->Shutdown();
+    StopReader();
+    transport_->Close();
+    if (wasOpen && logOld) Log<LogLevel::Warning>(L"🔌 [Connect] Đã đóng kết nối cũ trước khi mở kết nối mới");
 
-    return true;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        rxRing_.Clear();
+        decoder_.Reset();
+    }
+    FailAllPending(RciResult::Status::Disconnected);
 }
 
 bool RciClient::IsConnected() const {
@@ -185,152 +102,588 @@ bool RciClient::IsConnected() const {
 // Send / Receive
 // =========================================================
 bool RciClient::SendFrame(const vector<uint8_t>& frame, vector<uint8_t>& reply, int timeoutMs) {
-    std::lock_guard<std::mutex> lock(mtx_);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!pipelined_) {
+            RciFrameView view;
+            if (!TransactLocked(frame.data(), frame.size(), -1, view, timeoutMs, cancelEpoch_.load()))
+                return false;
+            CopyReply(view, reply);
+            return true;
+        }
+    }
 
-    if (!connected_ || sock_ == INVALID_SOCKET)
-        return false;
+    // Pipeline: frame dựng sẵn không rõ cmdid → ghép với reply kế tiếp
+    std::promise<RciResult> done;
+    std::future<RciResult> fut = done.get_future();
+    SubmitFrame(frame.data(), frame.size(), -1, timeoutMs,
+        [&done](const RciResult& r) { done.set_value(r); });
+    RciResult r = fut.get();
+    if (!r.Ok()) return false;
+    CopyReply(r.View(), reply);
+    return true;
+}
+
+bool RciClient::SendCommand(uint8_t cmdid, const uint8_t* payload, size_t payloadLen,
+    vector<uint8_t>& reply, int timeoutMs) {
+    return Request(cmdid, nullptr, 0, payload, payloadLen, timeoutMs,
+        [&reply](const RciFrameView& view) { CopyReply(view, reply); });
+}
+
+// Gửi lệnh, bỏ qua nội dung reply (chỉ cần biết có phản hồi)
+bool RciClient::Exchange(uint8_t cmdid, const uint8_t* payload, size_t payloadLen, int timeoutMs) {
+    return Request(cmdid, nullptr, 0, payload, payloadLen, timeoutMs, nullptr);
+}
+
+// Đường chung cho mọi lệnh có reply.
+// Đồng bộ: giữ mtx_ suốt round trip, onReply nhận view zero-copy của decoder.
+// Pipeline: gửi rồi chờ future, onReply nhận view trên RciResult.
+bool RciClient::Request(uint8_t cmdid, const uint8_t* prefix, size_t prefixLen,
+    const uint8_t* payload, size_t payloadLen, int timeoutMs, const ReplyHandler& onReply) {
+    // epoch lấy trước khi hỏi preempt_: CancelWaits xảy ra sau điểm này đều bị phát hiện
+    uint64_t epoch = cancelEpoch_.load();
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!pipelined_) {
+            if (Preempted(epoch)) {
+                if (observer_) observer_(cmdid, std::chrono::steady_clock::duration::zero(), RciResult::Status::Cancelled);
+                return false;
+            }
+
+            const uint8_t* frame = nullptr;
+            size_t frameLen = 0;
+            if (!EncodeLocked(cmdid, prefix, prefixLen, payload, payloadLen, frame, frameLen))
+                return false;
+
+            RciFrameView view;
+            bool ok = TransactLocked(frame, frameLen, cmdid, view, timeoutMs, epoch);
+            if (observer_) {
+                auto status = ok ? RciResult::Status::Ok
+                    : !connected_ ? RciResult::Status::Disconnected
+                    : cancelEpoch_ != epoch ? RciResult::Status::Cancelled : RciResult::Status::Timeout;
+                observer_(cmdid, std::chrono::steady_clock::now() - start, status);
+            }
+            if (!ok)
+                return false;
+            if (onReply) onReply(view);
+            return true;
+        }
+    }
+
+    // Pipeline: đăng ký làm waiter để CancelWaits trả kết quả sớm
+    auto wait = std::make_shared<BlockingWait>();
+    std::future<RciResult> fut = wait->done.get_future();
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        if (cancelEpoch_ == epoch) waiters_.push_back(wait);
+    }
+    if (cancelEpoch_ != epoch || (preempt_ && preempt_())) {
+        RciResult cancelled;
+        cancelled.status = RciResult::Status::Cancelled;
+        wait->Complete(cancelled);
+    }
+    else {
+        SubmitEncoded(cmdid, prefix, prefixLen, payload, payloadLen, timeoutMs,
+            [wait](const RciResult& r) { wait->Complete(r); });
+    }
+
+    RciResult r = fut.get();
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        waiters_.erase(std::remove(waiters_.begin(), waiters_.end(), wait), waiters_.end());
+    }
+    if (!r.Ok()) return false;
+    if (onReply) onReply(r.View());
+    return true;
+}
+
+bool RciClient::Preempted(uint64_t epoch) const {
+    return cancelEpoch_ != epoch || (preempt_ && preempt_());
+}
+
+void RciClient::CancelWaits() {
+    std::vector<std::shared_ptr<BlockingWait>> waiters;
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        ++cancelEpoch_;
+        waiters.swap(waiters_);
+    }
+    transport_->Interrupt();    // lệnh đồng bộ đang chờ reply thôi chờ, thấy epoch mới
+
+    RciResult cancelled;
+    cancelled.status = RciResult::Status::Cancelled;
+    for (auto& w : waiters) w->Complete(cancelled);
+}
+
+// reply = [type, body...] đã unescape; dùng lại capacity của vector caller
+void RciClient::CopyReply(const RciFrameView& view, vector<uint8_t>& reply) {
+    reply.resize(view.size + 1);
+    reply[0] = view.type;
+    if (view.size) memcpy(reply.data() + 1, view.body, view.size);
+}
+
+// Gọi khi đã giữ mtx_: trả về frame cần gửi.
+// Lệnh không tham số có trong bảng RciFixed → frame dựng sẵn lúc compile,
+// còn lại encode thẳng vào txBuffer_.
+bool RciClient::EncodeLocked(uint8_t cmdid, const uint8_t* prefix, size_t prefixLen,
+    const uint8_t* payload, size_t payloadLen, const uint8_t*& frame, size_t& frameLen) {
+    if (prefixLen + payloadLen == 0 && RciFindFixedFrame(cmdid, frame, frameLen))
+        return true;
+
+    txBuffer_.resize(RciFrame::MaxEncodedSize(prefixLen + payloadLen));
+    RciFrame::Writer w(txBuffer_.data(), txBuffer_.size());
+    w.Put(cmdid);
+    w.Put(prefix, prefixLen);
+    w.Put(payload, payloadLen);
+    txBuffer_.resize(w.End());
+
+    frame = txBuffer_.data();
+    frameLen = txBuffer_.size();
+    return frameLen != 0;
+}
+
+// Gọi khi đã giữ mtx_ (chế độ đồng bộ).
+// expectCmd >= 0: bỏ qua reply trễ của lệnh khác (cmdid ở body[2])
+bool RciClient::TransactLocked(const uint8_t* frame, size_t len, int expectCmd,
+    RciFrameView& reply, int timeoutMs, uint64_t epoch) {
     //Kiểm tra kết nối trước khi gửi
     if (!IsConnected()) {
         return false;
     }
-    // 🟢 TĂNG hiệu suất gửi
-    u_long mode = 1; // non-blocking
-    ioctlsocket(sock_, FIONBIO, &mode);
 
-    if (!SendRaw(frame)) {
-        mode = 0; // blocking
-        ioctlsocket(sock_, FIONBIO, &mode);
+    if (!SendRaw(frame, len)) {
         return false;
     }
 
-    bool result = ReceiveRaw(reply, timeoutMs);
+    // Transport có Interrupt: chờ 1 lần tới deadline, CancelWaits đánh thức.
+    // Không có: chờ theo lát kCancelPollMs để CancelWaits / preempt_ ngắt được.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    bool interruptible = transport_->CanInterrupt();
+    bool result = false;
+    while (true) {
+        auto slice = interruptible ? deadline : std::min(deadline,
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(kCancelPollMs));
+        if (ReceiveFrame(reply, slice)) {
+            bool isAck = reply.type == RciFrame::ACK || reply.type == RciFrame::NAK;
+            if (expectCmd < 0 || !isAck || reply.size < 3 || reply[2] == (uint8_t)expectCmd) {
+                result = true;
+                break;
+            }
+            Log<LogLevel::Warning>(L"⚠ Bỏ qua reply trễ của lệnh {}", reply[2]);
+            continue;
+        }
+        if (!connected_ || std::chrono::steady_clock::now() >= deadline)
+            break;
+        if (Preempted(epoch)) {
+            Log<LogLevel::Warning>(L"Ngắt chờ reply lệnh {} (lệnh ưu tiên cao)", expectCmd);
+            break;
+        }
+    }
 
-    mode = 0; // blocking
-    ioctlsocket(sock_, FIONBIO, &mode);
+    if (!connected_) {
+        FailSocketLocked();   // recv lỗi / peer đóng
+    }
 
     return result;
 }
 
-bool RciClient::SendRaw(const vector<uint8_t>& buf) {
-    int sent = send(sock_, (const char*)buf.data(), (int)buf.size(), 0);
-    if (sent == SOCKET_ERROR) {
+bool RciClient::SendRaw(const uint8_t* buf, size_t len) {
+    if (capture_) capture_->Record(connId_, RciCapture::Direction::Tx, buf, len);
 
-        int err = WSAGetLastError();
-        Log(L"❌ Lỗi gửi dữ liệu (Fatal) - Socket sẽ bị đóng. Err=" + std::to_wstring(err), 2);
-
-        connected_ = false;
+    if (!transport_->Send(buf, len)) {
 
-        if (sock_ != INVALID_SOCKET) {
-            shutdown(sock_, SD_BOTH);
-            closesocket(sock_);
-            sock_ = INVALID_SOCKET;
-        }
+        int err = transport_->LastError();
+        Log<LogLevel::Error>(L"❌ Lỗi gửi dữ liệu (Fatal) - Socket sẽ bị đóng. Err={}", err);
 
+        FailSocketLocked();
         return false;   //báo lên AppController rằng kết nối đã chết
     }
     return true;
 }
 
-bool RciClient::ReceiveRaw(vector<uint8_t>& buf, int timeoutMs)
-{
-    buf.clear();
-
-    if (!connected_ || sock_ == INVALID_SOCKET)
-        return false;
+// Gọi khi đã giữ mtx_: đánh dấu kết nối chết.
+// Khi pipeline bật, reader thread vẫn dùng transport → chỉ shutdown, CloseConnection sẽ đóng hẳn.
+void RciClient::FailSocketLocked() {
+    connected_ = false;
 
-    auto start = std::chrono::steady_clock::now();
-    vector<uint8_t> acc;
+    transport_->Shutdown();
+    if (!ReaderActive()) {
+        transport_->Close();
+    }
+}
 
+// Decode dần từ rxRing_; chỉ recv khi ring đã hết byte. Byte dư sau frame được giữ lại.
+// Chỉ 1 luồng được gọi tại 1 thời điểm: caller giữ mtx_ (đồng bộ) hoặc reader thread (pipeline).
+bool RciClient::ReceiveFrame(RciFrameView& reply, std::chrono::steady_clock::time_point deadline)
+{
     while (true)
     {
-        // timeout
-        auto now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() > timeoutMs)
-            return false;
+        // 1) decode phần còn lại trong ring
+        while (!rxRing_.Empty()) {
+            size_t avail = 0, used = 0;
+            const uint8_t* p = rxRing_.ReadPtr(avail);
+            RciDecoder::Result r = decoder_.Feed(p, avail, used);
+            rxRing_.Consume(used);
+            if (r == RciDecoder::Result::Frame) {
+                reply = decoder_.Frame();
+                return true;
+            }
+        }
+        rxRing_.Clear(); // ring rỗng → đưa con trỏ về đầu để nhận được vùng liên tục lớn nhất
 
-        fd_set r;
-        FD_ZERO(&r);
-        FD_SET(sock_, &r);
-        timeval tv{ 0, 100000 }; // 100ms
+        if (!connected_)
+            return false;
 
-        int s = select(0, &r, NULL, NULL, &tv);
-        if (s == SOCKET_ERROR)
-        {
+        // 2) nhận thẳng vào ring, transport tự chờ tới deadline
+        size_t room = 0, n = 0;
+        uint8_t* dst = rxRing_.WritePtr(room);
+        switch (transport_->Receive(dst, room, n, deadline)) {
+        case IRciTransport::IoResult::Ok:
+            if (capture_) capture_->Record(connId_, RciCapture::Direction::Rx, dst, n);
+            rxRing_.CommitWrite(n);
+            break;
+        case IRciTransport::IoResult::Timeout:
+        case IRciTransport::IoResult::Interrupted:
+            return false;
+        default:
             connected_ = false;
             return false;
         }
-        if (s == 0) continue; // no data yet
+    }
+}
 
-        char tmp[1024];
-        int n = recv(sock_, tmp, sizeof(tmp), 0);
-        if (n <= 0) {
-            connected_ = false;
+// =========================================================
+// Pipeline
+// =========================================================
+void RciClient::SetPipelineWindow(size_t window) {
+    if (window < 1) window = 1;
+    bool enable = window > 1;
+
+    // giữ mtx_: không có lệnh đồng bộ nào đang dùng decoder khi đổi chế độ
+    std::lock_guard<std::mutex> lock(mtx_);
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        window_ = window;
+    }
+    pipeCv_.notify_all();
+
+    if (enable && !pipelined_) {
+        pipelined_ = true;
+        if (connected_) StartReaderLocked();
+    }
+    else if (!enable && pipelined_) {
+        pipelined_ = false;
+        StopReader();   // reader tự báo lỗi các lệnh còn chờ khi thoát
+    }
+}
+
+std::future<RciResult> RciClient::SubmitCommand(uint8_t cmdid, const std::vector<uint8_t>& payload, int timeoutMs) {
+    auto done = std::make_shared<std::promise<RciResult>>();
+    std::future<RciResult> fut = done->get_future();
+    SubmitCommand(cmdid, payload, timeoutMs, [done](const RciResult& r) { done->set_value(r); });
+    return fut;
+}
+
+void RciClient::SubmitCommand(uint8_t cmdid, const std::vector<uint8_t>& payload, int timeoutMs,
+    ReplyCallback onReply) {
+    SubmitEncoded(cmdid, nullptr, 0, payload.data(), payload.size(), timeoutMs, std::move(onReply));
+}
+
+void RciClient::SubmitRawFrame(const uint8_t* frame, size_t len, int expectCmd, int timeoutMs,
+    ReplyCallback onReply) {
+    if (!pipelined_) {
+        RciResult result;
+        result.status = RciResult::Status::SendFailed;
+        onReply(result);
+        return;
+    }
+    SubmitFrame(frame, len, expectCmd, timeoutMs, std::move(onReply));
+}
+
+// Chờ tới khi số lệnh đang bay < window (hoặc hết hạn / mất kết nối)
+bool RciClient::ReserveSlot(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lk(pipeMtx_);
+    bool ok = pipeCv_.wait_until(lk, deadline, [this] {
+        return !connected_ || inflight_.size() + reserving_ < window_;
+        });
+    if (!ok || !connected_) return false;
+    ++reserving_;
+    return true;
+}
+
+void RciClient::SubmitEncoded(uint8_t cmdid, const uint8_t* prefix, size_t prefixLen,
+    const uint8_t* payload, size_t payloadLen, int timeoutMs, ReplyCallback onReply) {
+    if (!pipelined_) {
+        // pipeline tắt → chạy đồng bộ, gọi callback ngay
+        RciResult result;
+        bool ok = Request(cmdid, prefix, prefixLen, payload, payloadLen, timeoutMs,
+            [&result](const RciFrameView& view) { result.Assign(view); });
+        if (!ok) result.status = connected_ ? RciResult::Status::Timeout : RciResult::Status::Disconnected;
+        onReply(result);
+        return;
+    }
 
-            if (sock_ != INVALID_SOCKET) {
-                shutdown(sock_, SD_BOTH);
-                closesocket(sock_);
-                sock_ = INVALID_SOCKET;
+    auto start = std::chrono::steady_clock::now();
+    if (observer_) {
+        // bọc callback chỉ khi có observer → đường thường không tốn thêm gì
+        onReply = [obs = observer_, cmdid, start, inner = std::move(onReply)](const RciResult& r) {
+            obs(cmdid, std::chrono::steady_clock::now() - start, r.status);
+            inner(r);
+        };
+    }
+
+    auto deadline = start + std::chrono::milliseconds(timeoutMs);
+    if (!ReserveSlot(deadline)) {
+        RciResult result;
+        result.status = connected_ ? RciResult::Status::Timeout : RciResult::Status::Disconnected;
+        onReply(result);
+        return;
+    }
+
+    bool queued = false;
+    {
+        // mtx_ giữ thứ tự đăng ký == thứ tự gửi lên dây
+        std::lock_guard<std::mutex> lock(mtx_);
+        const uint8_t* frame = nullptr;
+        size_t frameLen = 0;
+        bool encoded = connected_ &&
+            EncodeLocked(cmdid, prefix, prefixLen, payload, payloadLen, frame, frameLen);
+        {
+            std::lock_guard<std::mutex> plock(pipeMtx_);
+            --reserving_;
+            if (encoded && acceptingPending_) {
+                inflight_.push_back(PendingCommand{ cmdid, deadline, std::move(onReply) });
+                ArmPendingTimerLocked(deadline);
+                queued = true;
             }
+        }
+        // gửi lỗi → FailSocketLocked() shutdown transport, reader thoát và báo lỗi lệnh vừa đăng ký
+        if (queued) SendRaw(frame, frameLen);
+    }
 
-            return false;
+    if (!queued) {
+        pipeCv_.notify_all();
+        RciResult result;
+        result.status = RciResult::Status::SendFailed;
+        onReply(result);
+    }
+}
+
+void RciClient::SubmitFrame(const uint8_t* frame, size_t len, int expectCmd, int timeoutMs, ReplyCallback onReply) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    if (!ReserveSlot(deadline)) {
+        RciResult result;
+        result.status = connected_ ? RciResult::Status::Timeout : RciResult::Status::Disconnected;
+        onReply(result);
+        return;
+    }
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        {
+            std::lock_guard<std::mutex> plock(pipeMtx_);
+            --reserving_;
+            if (connected_ && acceptingPending_) {
+                inflight_.push_back(PendingCommand{ expectCmd, deadline, std::move(onReply) });
+                ArmPendingTimerLocked(deadline);
+                queued = true;
+            }
         }
+        if (queued) SendRaw(frame, len);
+    }
 
+    if (!queued) {
+        pipeCv_.notify_all();
+        RciResult result;
+        result.status = RciResult::Status::SendFailed;
+        onReply(result);
+    }
+}
 
-        acc.insert(acc.end(), tmp, tmp + n);
+// Gọi khi đã giữ mtx_ và đã kết nối
+void RciClient::StartReaderLocked() {
+    if (readerThread_.joinable()) readerThread_.join();   // reader cũ đã thoát
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        acceptingPending_ = true;
+        armedDeadline_ = std::chrono::steady_clock::time_point::max();
+    }
+    readerRunning_ = true;
+
+    // Transport có reactor → nhận và xử lý timeout trên reactor thread dùng chung
+    if (transport_->StartPush(
+        [this](const uint8_t* data, size_t len) { OnPushData(data, len); },
+        [this] { OnPushClosed(); },
+        [this] { OnPushTimer(); })) {
+        pushMode_ = true;
+        return;
+    }
+
+    readerThread_ = std::thread(&RciClient::ReaderLoop, this);
+}
+
+void RciClient::StopReader() {
+    readerRunning_ = false;
+    if (pushMode_) {
+        transport_->StopPush();     // không còn callback nào sau lệnh này
+        pushMode_ = false;
+        FailAllPending(connected_ ? RciResult::Status::Timeout : RciResult::Status::Disconnected);
+        return;
+    }
+    if (readerThread_.joinable() && readerThread_.get_id() != std::this_thread::get_id())
+        readerThread_.join();
+}
+
+// Reader thread: nhận mọi reply của kết nối, ghép với lệnh đang chờ, xử lý timeout từng lệnh.
+// Callback chạy trên thread này → không được gọi API đồng bộ của RciClient trong callback.
+void RciClient::ReaderLoop() {
+    while (readerRunning_ && connected_) {
+        auto now = std::chrono::steady_clock::now();
+        ExpirePending(now);
 
-        // Check for ESC ETX -> end of frame
-        for (size_t i = 0; i + 1 < acc.size(); ++i)
+        auto sliceEnd = now + std::chrono::milliseconds(100);
         {
-            if (acc[i] == 0x1B && acc[i + 1] == 0x03)
-            {
-                buf = acc;
-                return true;
+            std::lock_guard<std::mutex> plock(pipeMtx_);
+            for (const auto& p : inflight_)
+                if (p.deadline < sliceEnd) sliceEnd = p.deadline;
+        }
+
+        RciFrameView view;
+        if (!ReceiveFrame(view, sliceEnd))
+            continue;   // hết lát thời gian hoặc mất kết nối (vòng while kiểm tra lại)
+
+        DispatchReply(view);
+    }
+
+    FailAllPending(connected_ ? RciResult::Status::Timeout : RciResult::Status::Disconnected);
+}
+
+// Ghép reply với lệnh đang chờ đầu tiên cùng cmdid (reply không có cmdid → lệnh cũ nhất)
+void RciClient::DispatchReply(const RciFrameView& view) {
+    bool isAck = view.type == RciFrame::ACK || view.type == RciFrame::NAK;
+    int cmd = (isAck && view.size >= 3) ? view[2] : -1;
+
+    PendingCommand match;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        for (auto it = inflight_.begin(); it != inflight_.end(); ++it) {
+            if (it->expectCmd < 0 || cmd < 0 || it->expectCmd == cmd) {
+                match = std::move(*it);
+                inflight_.erase(it);
+                found = true;
+                break;
             }
         }
     }
+
+    if (!found) {
+        Log<LogLevel::Warning>(L"⚠ Reply không khớp lệnh nào đang chờ (cmd {})", cmd);
+        return;
+    }
+
+    pipeCv_.notify_all();
+    RciResult result;
+    result.Assign(view);
+    match.onReply(result);
 }
 
 // =========================================================
-// RCI Command Builders
+// Chế độ đẩy (reactor): các hàm dưới chạy trên reactor thread
 // =========================================================
-uint8_t RciClient::ComputeChecksum(const vector<uint8_t>& bytes) {
-    unsigned int sum = 0;
-    for (auto b : bytes) sum += b;
-    return (uint8_t)((0x100 - (sum & 0xFF)) & 0xFF);
+
+// Gọi khi đã giữ pipeMtx_: hẹn timer reactor nếu deadline mới sớm hơn lần hẹn hiện tại
+void RciClient::ArmPendingTimerLocked(std::chrono::steady_clock::time_point deadline) {
+    if (!pushMode_ || deadline >= armedDeadline_) return;
+    armedDeadline_ = deadline;
+    transport_->ArmTimer(deadline);
 }
 
-vector<uint8_t> RciClient::BuildFrame(uint8_t commandId, const vector<uint8_t>& payload, bool useSOH, bool includeChecksum) {
-    vector<uint8_t> frame;
-    const uint8_t ESC = 0x1B, STX = 0x02, SOH = 0x01, ETX = 0x03;
+void RciClient::OnPushData(const uint8_t* data, size_t len) {
+    if (capture_) capture_->Record(connId_, RciCapture::Direction::Rx, data, len);
+
+    // decode thẳng từ buffer của transport, không qua rxRing_
+    while (len > 0) {
+        size_t used = 0;
+        RciDecoder::Result r = decoder_.Feed(data, len, used);
+        data += used;
+        len -= used;
+        if (r == RciDecoder::Result::Frame)
+            DispatchReply(decoder_.Frame());
+    }
+}
 
-    frame.push_back(ESC);
-    frame.push_back(useSOH ? SOH : STX);
+void RciClient::OnPushClosed() {
+    connected_ = false;
+    Log<LogLevel::Error>(L"⚠ Mất kết nối máy in");
+    FailAllPending(RciResult::Status::Disconnected);
+}
 
-    vector<uint8_t> body;
-    body.push_back(commandId);
-    body.insert(body.end(), payload.begin(), payload.end());
+void RciClient::OnPushTimer() {
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        armedDeadline_ = std::chrono::steady_clock::time_point::max();
+    }
+    ExpirePending(std::chrono::steady_clock::now());
 
-    for (auto b : body) {
-        if (b == ESC || b == STX || b == SOH || b == ETX) {
-            frame.push_back(ESC);
-            frame.push_back(b);
-        }
-        else {
-            frame.push_back(b);
+    // hẹn lại theo lệnh còn chờ sớm nhất
+    std::lock_guard<std::mutex> plock(pipeMtx_);
+    for (const auto& p : inflight_)
+        ArmPendingTimerLocked(p.deadline);
+}
+
+// Hoàn tất lệnh quá hạn với Status::Timeout
+void RciClient::ExpirePending(std::chrono::steady_clock::time_point now) {
+    std::deque<PendingCommand> expired;
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        for (auto it = inflight_.begin(); it != inflight_.end();) {
+            if (it->deadline <= now) {
+                expired.push_back(std::move(*it));
+                it = inflight_.erase(it);
+            }
+            else {
+                ++it;
+            }
         }
     }
+    if (expired.empty()) return;
 
-    frame.push_back(ESC);
-    frame.push_back(ETX);
+    pipeCv_.notify_all();
+    RciResult result;
+    result.status = RciResult::Status::Timeout;
+    for (auto& p : expired) p.onReply(result);
+}
 
-    if (includeChecksum) {
-        vector<uint8_t> csData;
-        csData.push_back(useSOH ? SOH : STX);
-        csData.insert(csData.end(), body.begin(), body.end());
-        csData.push_back(ETX);
-        frame.push_back(ComputeChecksum(csData));
+// Báo lỗi mọi lệnh đang chờ và ngừng nhận lệnh mới tới khi reader chạy lại
+void RciClient::FailAllPending(RciResult::Status status) {
+    std::deque<PendingCommand> failed;
+    {
+        std::lock_guard<std::mutex> plock(pipeMtx_);
+        failed.swap(inflight_);
+        acceptingPending_ = false;
     }
+    pipeCv_.notify_all();
+
+    RciResult result;
+    result.status = status;
+    for (auto& p : failed) p.onReply(result);
+}
+
+// =========================================================
+// RCI Command Builders
+// =========================================================
+uint8_t RciClient::ComputeChecksum(const vector<uint8_t>& bytes) {
+    unsigned int sum = 0;
+    for (auto b : bytes) sum += b;
+    return (uint8_t)((0x100 - (sum & 0xFF)) & 0xFF);
+}
 
+vector<uint8_t> RciClient::BuildFrame(uint8_t commandId, const vector<uint8_t>& payload, bool useSOH, bool includeChecksum) {
+    vector<uint8_t> frame;
+    RciFrame::Encode(frame, commandId, payload.data(), payload.size(), useSOH, includeChecksum);
     return frame;
 }
 
@@ -338,60 +691,52 @@ vector<uint8_t> RciClient::BuildFrame(uint8_t commandId, const vector<uint8_t>&
 // High-level LINX Commands
 // =========================================================
 bool RciClient::RequestStatus() {
-    vector<uint8_t> reply;
-    auto frame = BuildFrame(0x14);
-    return SendFrame(frame, reply);
+    return Exchange(RciCmd::Status, nullptr, 0);
 }
 
 bool RciClient::StartPrint() {
-    vector<uint8_t> reply;
-    auto frame = BuildFrame(0x11);
-    return SendFrame(frame, reply);
+    return Exchange(RciCmd::StartPrint, nullptr, 0);
 }
 
 bool RciClient::StopPrint() {
-    vector<uint8_t> reply;
-    auto frame = BuildFrame(0x12);
-    return SendFrame(frame, reply);
+    return Exchange(RciCmd::StopPrint, nullptr, 0);
 }
 
 bool RciClient::StartJet() {
-    vector<uint8_t> reply;
-    auto frame = BuildFrame(0x0F);
-    return SendFrame(frame, reply);
+    return Exchange(RciCmd::StartJet, nullptr, 0);
 }
 bool RciClient::StopJet() {
-    vector<uint8_t> reply;
-    auto frame = BuildFrame(0x10);
-    return SendFrame(frame, reply);
+    return Exchange(RciCmd::StopJet, nullptr, 0);
+}
+
+void RciClient::MakeLoadMessagePayload(const string& name, uint16_t printCount,
+    uint8_t(&payload)[kLoadMessagePayloadSize]) {
+    // payload cố định: tên 8 byte (pad '\0') + count little-endian
+    memset(payload, 0, kLoadMessagePayloadSize);
+    for (size_t i = 0; i < 8 && i < name.size(); ++i)
+        payload[i] = (uint8_t)name[i];
+    payload[8] = printCount & 0xFF;
+    payload[9] = (printCount >> 8) & 0xFF;
 }
 
 bool RciClient::LoadMessage(const string& name, uint16_t printCount) {
-    vector<uint8_t> payload;
-    string fixed = name;
-    fixed.resize(8, '\0');
-    payload.insert(payload.end(), fixed.begin(), fixed.end());
-    payload.push_back(printCount & 0xFF);
-    payload.push_back((printCount >> 8) & 0xFF);
+    uint8_t payload[kLoadMessagePayloadSize];
+    MakeLoadMessagePayload(name, printCount, payload);
 
-    vector<uint8_t> reply;
-    return SendFrame(BuildFrame(0x1E, payload), reply);
+    return Exchange(RciCmd::LoadMessage, payload, sizeof(payload));
 }
 
 bool RciClient::DownloadRemoteField(const vector<uint8_t>& data) {
-    vector<uint8_t> payload;
-    uint16_t len = data.size();
-    payload.push_back(len & 0xFF);
-    payload.push_back((len >> 8) & 0xFF);
-    payload.insert(payload.end(), data.begin(), data.end());
+    uint16_t len = (uint16_t)data.size();
+    const uint8_t header[2] = { (uint8_t)(len & 0xFF), (uint8_t)((len >> 8) & 0xFF) };
 
-    vector<uint8_t> reply;
-    return SendFrame(BuildFrame(0x1D, payload), reply);
+    // header độ dài + data ghi thẳng vào buffer gửi, không nối payload tạm
+    return Request(RciCmd::DownloadRemoteField, header, sizeof(header),
+        data.data(), data.size(), 3000, nullptr);
 }
 
 bool RciClient::DownloadMessageData(const vector<uint8_t>& data) {
-    vector<uint8_t> reply;
-    return SendFrame(BuildFrame(0x19, data), reply);
+    return Exchange(RciCmd::DownloadMessage, data.data(), data.size());
 }
 
 // =========================================================
@@ -400,119 +745,66 @@ bool RciClient::DownloadMessageData(const vector<uint8_t>& data) {
 bool RciClient::SendAndWaitAck(uint8_t cmdid, const std::vector<uint8_t>& payload, int timeoutMs)
 {
     if (timeoutMs <= 0) {
-        if (cmdid == 0x0F || cmdid == 0x10) timeoutMs = 60000;
+        if (cmdid == RciCmd::StartJet || cmdid == RciCmd::StopJet) timeoutMs = 60000;
         else timeoutMs = 3000;
     }
 
-    std::vector<uint8_t> reply;
-    if (!SendFrame(BuildFrame(cmdid, payload), reply, timeoutMs))
-        return false;
-
-    Log(L"Recv: " + ReplyToString(reply), 1);
-
-    if (reply.size() < 5) return false;
-    const uint8_t ESC = 0x1B, ACK = 0x06, NAK = 0x15;
-
-    if (reply[0] != ESC) return false;
-
-    if (reply[1] == NAK) return false;
-    if (reply[1] != ACK) return false;
+    bool acked = false;
+    bool ok = Request(cmdid, nullptr, 0, payload.data(), payload.size(), timeoutMs,
+        [this, cmdid, &acked](const RciFrameView& reply) {
+            Log<LogLevel::Debug>(L"Recv: [{} bytes] {} | {}", reply.size, LogHex{ reply.type, 2 },
+                LogBytes{ reply.body, reply.size });
 
-    // --- parse frame body robustly: find delimiter (STX or SOH) at offset 1 already known? ---
-    // find first STX or SOH (reply[1] is ACK, so STX/SOH is not here) 
-    // We need to extract the body bytes between delimiter and ESC ETX.
-    // Find the first occurrence of ESC + ETX from the end.
-    size_t esc_etx_pos = std::string::npos;
-    for (size_t i = 0; i + 1 < reply.size(); ++i) {
-        if (reply[i] == 0x1B && reply[i + 1] == 0x03) { esc_etx_pos = i; break; }
-    }
-    if (esc_etx_pos == std::string::npos) {
-        // cannot find end marker, fallback to previous simple check
-        uint8_t recvCmd = reply.size() > 4 ? reply[4] : 0x00;
-        return recvCmd == cmdid;
-    }
+            RciAckView ack(reply);
+            if (ack.IsNak()) return;
+            if (!ack.IsAck()) return;
 
-    // body is bytes between reply[2] ... before esc_etx_pos
-    // But need to unescape bytes (ESC prefix)
-    std::vector<uint8_t> body;
-    // body starts at index 2 (p-status at [2])
-    for (size_t i = 2; i < esc_etx_pos; ++i) {
-        if (reply[i] == 0x1B) {
-            if (i + 1 < esc_etx_pos) {
-                body.push_back(reply[i + 1]);
-                ++i;
-            }
-            else {
-                // malformed escape, break
-                return false;
+            // checksum (ACK + body + ETX) đã được decoder kiểm tra trong lúc nhận
+            if (!ack.ChecksumOk()) {
+                Log<LogLevel::Warning>(L"⚠ Checksum mismatch on reply");
+                return;
             }
-        }
-        else {
-            body.push_back(reply[i]);
-        }
-    }
 
-    // body layout: [p_status, c_status, cmdid, ...]
-    if (body.size() < 3) return false;
-    uint8_t recvCmd = body[2];
+            acked = ack.IsAckFor(cmdid);
+        });
 
-    // verify checksum: compute over (ACK) + body + ETX
-    std::vector<uint8_t> csArea;
-    csArea.push_back(reply[1]); // ACK or NAK byte
-    // append raw body (unescaped) but the protocol checksum computed on unescaped body bytes
-    csArea.insert(csArea.end(), body.begin(), body.end());
-    csArea.push_back(0x03); // ETX
-    uint8_t expected = ComputeChecksum(csArea);
-
-    // determine received checksum (after ESC ETX)
-    // position after esc_etx_pos + 2
-    size_t after_etx = esc_etx_pos + 2;
-    if (after_etx >= reply.size()) return false;
-    uint8_t recvChk = 0;
-    if (reply[after_etx] == 0x1B) {
-        if (after_etx + 1 >= reply.size()) return false;
-        recvChk = reply[after_etx + 1];
-    }
-    else {
-        recvChk = reply[after_etx];
-    }
-    if (recvChk != expected) {
-        Log(L"⚠ Checksum mismatch on reply", 1);
-        return false;
-    }
-
-    return recvCmd == cmdid;
+    return ok && acked;
 }
 
 
 PrinterStatus RciClient::RequestStatusEx() {
-    std::vector<uint8_t> reply;
     PrinterStatus s;
+    RequestStatusEx(s);
+    return s;
+}
 
-    if (!IsConnected()) return s;
+bool RciClient::RequestStatusEx(PrinterStatus& out) {
+    out = PrinterStatus{};
+    if (!IsConnected()) return false;
 
-    if (!SendFrame(BuildFrame(0x14), reply, 100))
-        return s;
+    bool parsed = false;
+    bool ok = Request(RciCmd::Status, nullptr, 0, nullptr, 0, 100, [&](const RciFrameView& reply) {
+        parsed = ParseStatus(reply, out);
+        });
+    return ok && parsed;
+}
 
-    const uint8_t ESC = 0x1B, ACK = 0x06;
-    if (reply.size() >= 13 && reply[0] == ESC && reply[1] == ACK) {
-        s.jetState = reply[5];
-        s.printState = reply[6];
-        s.errorMask = (reply[7] << 24) | (reply[8] << 16) | (reply[9] << 8) | reply[10];
+bool RciClient::ParseStatus(const RciFrameView& reply, PrinterStatus& s) {
+    RciStatusView status(reply);
+    if (!status.Valid()) return false;
 
-        s.jetOn = (s.jetState != 0x03); // 03 = tắt jet
-        s.printing = (s.printState == 0x04); // 04 = đang in
-        s.paused = (s.printState == 0x02); // 02 = tạm dừng
-    }
-    return s;
+    s.jetState = status.JetStateRaw();
+    s.printState = status.PrintStateRaw();
+    s.errorMask = status.ErrorMask();
+
+    s.jetOn = status.JetOn();
+    s.printing = status.Printing();
+    s.paused = status.Paused();
+    return true;
 }
 // =========================================================
 // Utility
 // =========================================================
-void RciClient::Log(const std::wstring& msg, int type) {
-    if (callback_) callback_(msg, type);
-}
-
 std::wstring RciClient::ReplyToString(const vector<uint8_t>& reply) {
     wstringstream ws;
     ws << L"[" << reply.size() << L" bytes] ";
@@ -521,8 +813,22 @@ std::wstring RciClient::ReplyToString(const vector<uint8_t>& reply) {
     return ws.str();
 }
 
+std::wstring RciClient::ReplyToString(const RciFrameView& reply) {
+    wstringstream ws;
+    ws << L"[" << reply.size << L" bytes] " << hex << setw(2) << setfill(L'0') << (int)reply.type << L" | ";
+    for (size_t i = 0; i < min(reply.size, size_t(12)); ++i)
+        ws << hex << setw(2) << setfill(L'0') << (int)reply[i] << L" ";
+    return ws.str();
+}
+
 bool RciClient::SendCommandNoAck(uint8_t cmdid, const std::vector<uint8_t>& payload) {
     std::lock_guard<std::mutex> lock(mtx_);
-    std::vector<uint8_t> frame = BuildFrame(cmdid, payload);
-    return SendRaw(frame);
+    if (!connected_)
+        return false;
+
+    const uint8_t* frame = nullptr;
+    size_t frameLen = 0;
+    if (!EncodeLocked(cmdid, nullptr, 0, payload.data(), payload.size(), frame, frameLen))
+        return false;
+    return SendRaw(frame, frameLen);
 }
@@ -1,12 +1,23 @@
 ﻿
 #pragma once
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <string>
 #include <vector>
 #include <mutex>
 #include <thread>
 #include <functional>
+#include <chrono>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <condition_variable>
+#include <memory>
+#include "RciFrame.h"
+#include "RciDecoder.h"
+#include "RciCommands.h"
+#include "RciReply.h"
+#include "RciTransport.h"
+#include "RciCapture.h"
+#include "LogFormat.h"
 
 struct PrinterStatus {
     uint8_t jetState = 0;
@@ -19,18 +30,29 @@ struct PrinterStatus {
 
 class RciClient {
 public:
-    using MessageCallback = std::function<void(const std::wstring&, int)>;
+    // msg chỉ hợp lệ trong lời gọi callback (trỏ vào buffer LogFormat của thread gọi)
+    using MessageCallback = std::function<void(std::wstring_view, int)>;
+    using ReplyCallback = std::function<void(const RciResult&)>;
+    // cmdid, thời gian từ lúc gửi lệnh tới khi có kết quả, trạng thái
+    using CommandObserver = std::function<void(uint8_t, std::chrono::steady_clock::duration, RciResult::Status)>;
 
-    RciClient();
+    RciClient();                                                // transport TCP mặc định của nền tảng
+    explicit RciClient(std::unique_ptr<IRciTransport> transport);   // vd. RciLoopbackTransport
     ~RciClient();
 
     // Connection
     bool Connect(const std::wstring& ip, unsigned short port = 9100, int timeoutMs = 3000);
     bool Disconnect();
     bool IsConnected() const;
+    // Mã lỗi hệ thống của lần Connect / gửi nhận lỗi gần nhất (WSAGetLastError / errno)
+    int LastError() const { return transport_->LastError(); }
 
     // Command send/receive
+    // reply = [type, body...] đã unescape (ACK/NAK + p_status, c_status, cmdid, ...)
     bool SendFrame(const std::vector<uint8_t>& frame, std::vector<uint8_t>& reply, int timeoutMs = 3000);
+    // Encode thẳng vào buffer gửi của kết nối (không cấp phát) rồi gửi/nhận
+    bool SendCommand(uint8_t cmdid, const uint8_t* payload, size_t payloadLen,
+        std::vector<uint8_t>& reply, int timeoutMs = 3000);
 
     // High-level RCI commands
     bool RequestStatus();
@@ -46,32 +68,159 @@ public:
     // Extended high-level utilities for AppController
     bool SendAndWaitAck(uint8_t cmdid, const std::vector<uint8_t>& payload, int timeoutMs = 3000);
     PrinterStatus RequestStatusEx();
+    // false nếu timeout / NAK / reply STATUS không hợp lệ (out giữ giá trị mặc định)
+    bool RequestStatusEx(PrinterStatus& out);
 
-    // Frame builders (static)
+    // Frame builders (static) - wrapper mỏng quanh RciFrame::Encode
     static std::vector<uint8_t> BuildFrame(uint8_t commandId, const std::vector<uint8_t>& payload = {},
         bool useSOH = false, bool includeChecksum = true);
 
+    // Payload lệnh 0x1E: tên 8 byte (pad '\0') + count little-endian
+    static constexpr size_t kLoadMessagePayloadSize = 10;
+    static void MakeLoadMessagePayload(const std::string& name, uint16_t printCount,
+        uint8_t(&payload)[kLoadMessagePayloadSize]);
+    // Đọc reply STATUS 0x14; false nếu không phải ACK status hợp lệ
+    static bool ParseStatus(const RciFrameView& reply, PrinterStatus& out);
+
     // Utility
     static uint8_t ComputeChecksum(const std::vector<uint8_t>& bytes);
     static std::wstring ReplyToString(const std::vector<uint8_t>& reply);
+    static std::wstring ReplyToString(const RciFrameView& reply);
 
     void SetMessageCallback(MessageCallback cb) { callback_ = cb; }
 
+    // Đo round trip từng lệnh có reply (benchmark). Đặt trước Connect; observer được gọi trên
+    // thread hoàn tất lệnh (caller / reader / reactor) → phải nhanh và thread-safe.
+    void SetCommandObserver(CommandObserver observer) { observer_ = std::move(observer); }
+
+    // Ghi mọi byte gửi/nhận ra capture (nullptr = tắt). Đặt trước Connect; mỗi lần Connect
+    // thành công lấy 1 connection id mới.
+    void SetCapture(std::shared_ptr<RciCapture> capture) { capture_ = std::move(capture); }
+
+    // =====================================================
+    // Ngắt lệnh đang chờ reply (lệnh ưu tiên cao như dừng in cần đường truyền ngay)
+    // =====================================================
+    // preempt() == true → lệnh chờ reply (SendCommand, SendAndWaitAck, Start/Stop...) bị bỏ với
+    // Cancelled trước khi gửi. Đặt trước Connect; gọi trên thread gửi lệnh.
+    void SetPreemptCheck(std::function<bool()> preempt) { preempt_ = std::move(preempt); }
+    // Mọi lệnh đang chờ reply trả về ngay với Cancelled; gọi được từ mọi thread.
+    // Lệnh đã gửi vẫn tới máy in, reply trễ bị bỏ qua theo cmdid.
+    // SubmitCommand / RciAsync không bị ảnh hưởng (dùng RciCancelToken).
+    void CancelWaits();
+
+    // =====================================================
+    // Pipeline: cho phép tối đa window lệnh đang chờ reply cùng lúc.
+    // Reply được ghép với request theo cmdid (body[2]) và thứ tự gửi.
+    // window <= 1 → tắt, mỗi lệnh chiếm trọn 1 round trip như cũ.
+    // =====================================================
+    void SetPipelineWindow(size_t window);
+    size_t GetPipelineWindow() const { return window_; }
+    bool IsPipelined() const { return pipelined_; }
+
+    // Gửi lệnh không chặn; kết quả qua future hoặc callback (gọi trên reader thread).
+    // Khi pipeline tắt: chạy đồng bộ, callback được gọi ngay trong hàm.
+    std::future<RciResult> SubmitCommand(uint8_t cmdid, const std::vector<uint8_t>& payload = {},
+        int timeoutMs = 3000);
+    void SubmitCommand(uint8_t cmdid, const std::vector<uint8_t>& payload, int timeoutMs,
+        ReplyCallback onReply);
+    // Gửi nguyên văn frame đã encode sẵn (replay capture); reply ghép theo expectCmd (-1 = bất kỳ).
+    // Chỉ khi pipeline bật, nếu không callback nhận SendFailed.
+    void SubmitRawFrame(const uint8_t* frame, size_t len, int expectCmd, int timeoutMs,
+        ReplyCallback onReply);
+
     // =====================================================
     // Gửi lệnh thô (không chờ ACK)
     // =====================================================
     bool SendCommandNoAck(uint8_t cmdid, const std::vector<uint8_t>& payload = {});
 
 private:
-    SOCKET sock_;
+    // Caller đang chặn trong Request() chờ reply (pipeline); CancelWaits hoàn tất sớm
+    struct BlockingWait {
+        std::promise<RciResult> done;
+        std::atomic<bool> completed{ false };
+        void Complete(const RciResult& r) { if (!completed.exchange(true)) done.set_value(r); }
+    };
+
+    // Lệnh đang chờ reply trong pipeline
+    struct PendingCommand {
+        int expectCmd;                                  // -1: nhận reply bất kỳ
+        std::chrono::steady_clock::time_point deadline;
+        ReplyCallback onReply;
+    };
+
+    std::unique_ptr<IRciTransport> transport_;
     std::atomic<bool> connected_;
     std::wstring host_;
     unsigned short port_;
     std::mutex mtx_;
+    std::vector<uint8_t> txBuffer_;   // buffer encode dùng lại cho mỗi kết nối (bảo vệ bởi mtx_)
+    RciRingBuffer rxRing_;            // byte đã nhận chưa decode, giữ lại giữa các reply
+    RciDecoder decoder_;              // state machine decode reply
+
+    // Pipeline (pipeMtx_ bảo vệ inflight_ / reserving_)
+    std::atomic<bool> pipelined_{ false };
+    size_t window_ = 1;
+    std::mutex pipeMtx_;
+    std::condition_variable pipeCv_;
+    std::deque<PendingCommand> inflight_;
+    size_t reserving_ = 0;            // slot đã giữ nhưng chưa đăng ký vào inflight_
+    bool acceptingPending_ = false;   // false khi reader đã thoát → không nhận lệnh mới
+    std::thread readerThread_;
+    std::atomic<bool> readerRunning_{ false };
+    std::atomic<bool> pushMode_{ false };   // transport có reactor: nhận theo sự kiện, không có reader thread
+    std::chrono::steady_clock::time_point armedDeadline_ = std::chrono::steady_clock::time_point::max();
 
     MessageCallback callback_;
+    CommandObserver observer_;
+    std::shared_ptr<RciCapture> capture_;
+    std::atomic<uint32_t> connId_{ 0 };     // id kết nối trong capture
+
+    // Ngắt lệnh chờ reply
+    static constexpr int kCancelPollMs = 10;        // lát chờ của đường đồng bộ khi transport không có Interrupt
+    std::function<bool()> preempt_;
+    std::atomic<uint64_t> cancelEpoch_{ 0 };        // tăng mỗi lần CancelWaits
+    std::vector<std::shared_ptr<BlockingWait>> waiters_;   // bảo vệ bởi pipeMtx_
+
+    // Log ra callback theo format LogFormat.h; mức tắt (biên dịch / LogModule::Rci) → không format
+    template<LogLevel Level, typename... Args>
+    void Log(std::wstring_view fmt, const Args&... args) {
+        if constexpr (LogCompiledIn(Level)) {
+            if (!callback_ || !LogFilter::Enabled(LogModule::Rci, Level)) return;
+            callback_(LogFormat(fmt, args...), (int)Level);
+        }
+    }
+    using ReplyHandler = std::function<void(const RciFrameView&)>;
+
+    // Gửi lệnh + xử lý reply; tự chọn đường đồng bộ hoặc pipeline.
+    // prefix: phần đầu payload (vd. độ dài 0x1D) ghi thẳng vào frame, không nối tạm.
+    bool Request(uint8_t cmdid, const uint8_t* prefix, size_t prefixLen,
+        const uint8_t* payload, size_t payloadLen, int timeoutMs, const ReplyHandler& onReply);
+    bool Exchange(uint8_t cmdid, const uint8_t* payload, size_t payloadLen, int timeoutMs = 3000);
+    bool EncodeLocked(uint8_t cmdid, const uint8_t* prefix, size_t prefixLen,
+        const uint8_t* payload, size_t payloadLen, const uint8_t*& frame, size_t& frameLen);
+    bool TransactLocked(const uint8_t* frame, size_t len, int expectCmd,
+        RciFrameView& reply, int timeoutMs, uint64_t epoch);
+    bool Preempted(uint64_t epoch) const;
+    bool SendRaw(const uint8_t* buf, size_t len);
+    void FailSocketLocked();
+    bool ReceiveFrame(RciFrameView& reply, std::chrono::steady_clock::time_point deadline);
+    static void CopyReply(const RciFrameView& view, std::vector<uint8_t>& reply);
 
-    void Log(const std::wstring& msg, int type = 0);
-    bool SendRaw(const std::vector<uint8_t>& buf);
-    bool ReceiveRaw(std::vector<uint8_t>& buf, int timeoutMs);
+    // Pipeline
+    void SubmitFrame(const uint8_t* frame, size_t len, int expectCmd, int timeoutMs, ReplyCallback onReply);
+    void SubmitEncoded(uint8_t cmdid, const uint8_t* prefix, size_t prefixLen,
+        const uint8_t* payload, size_t payloadLen, int timeoutMs, ReplyCallback onReply);
+    bool ReserveSlot(std::chrono::steady_clock::time_point deadline);
+    void ReaderLoop();
+    void DispatchReply(const RciFrameView& view);
+    bool ReaderActive() const { return readerThread_.joinable() || pushMode_; }
+    void ArmPendingTimerLocked(std::chrono::steady_clock::time_point deadline);
+    void OnPushData(const uint8_t* data, size_t len);
+    void OnPushClosed();
+    void OnPushTimer();
+    void StartReaderLocked();
+    void StopReader();
+    void FailAllPending(RciResult::Status status);
+    void ExpirePending(std::chrono::steady_clock::time_point now);
+    void CloseConnection(bool logOld);
 };
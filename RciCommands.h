@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include "RciFrame.h"
+
+//
+// Mã lệnh RCI Linx dùng trong RciClient
+//
+namespace RciCmd {
+    constexpr uint8_t StartJet = 0x0F;
+    constexpr uint8_t StopJet = 0x10;
+    constexpr uint8_t StartPrint = 0x11;
+    constexpr uint8_t StopPrint = 0x12;
+    constexpr uint8_t Status = 0x14;
+    constexpr uint8_t DownloadMessage = 0x19;
+    constexpr uint8_t DownloadRemoteField = 0x1D;
+    constexpr uint8_t LoadMessage = 0x1E;
+}
+
+//
+// Frame của lệnh không tham số, dựng sẵn lúc compile:
+// ESC STX <cmd (escape nếu cần)> ESC ETX <checksum>
+//
+template<uint8_t Cmd>
+struct RciFixedFrame {
+    static constexpr size_t Size = 2 + (RciFrame::IsControlByte(Cmd) ? 2 : 1) + 2 + 1;
+
+    static constexpr std::array<uint8_t, Size> Make() {
+        std::array<uint8_t, Size> f{};
+        size_t i = 0;
+        f[i++] = RciFrame::ESC;
+        f[i++] = RciFrame::STX;
+        if (RciFrame::IsControlByte(Cmd)) f[i++] = RciFrame::ESC;
+        f[i++] = Cmd;
+        f[i++] = RciFrame::ESC;
+        f[i++] = RciFrame::ETX;
+        f[i++] = RciFrame::ChecksumFromSum(RciFrame::STX + Cmd + RciFrame::ETX);
+        return f;
+    }
+
+    static constexpr std::array<uint8_t, Size> Bytes = Make();
+};
+
+// Tổng STX + cmd + ETX + checksum phải chia hết cho 256
+template<size_t N>
+constexpr bool RciFixedChecksumValid(const std::array<uint8_t, N>& f) {
+    return ((RciFrame::STX + f[N - 4] + RciFrame::ETX + f[N - 1]) & 0xFF) == 0;
+}
+
+// =====================================================
+// Bảng lệnh cố định: thêm lệnh mới = thêm 1 dòng X(Tên, mã)
+// =====================================================
+#define RCI_FIXED_COMMANDS(X)               \
+    X(StartJet,   RciCmd::StartJet)         \
+    X(StopJet,    RciCmd::StopJet)          \
+    X(StartPrint, RciCmd::StartPrint)       \
+    X(StopPrint,  RciCmd::StopPrint)        \
+    X(Status,     RciCmd::Status)
+
+namespace RciFixed {
+#define RCI_DECLARE_FIXED(name, id) \
+    inline constexpr const auto& name = RciFixedFrame<id>::Bytes; \
+    static_assert(RciFixedChecksumValid(name), "checksum sai: " #name);
+    RCI_FIXED_COMMANDS(RCI_DECLARE_FIXED)
+#undef RCI_DECLARE_FIXED
+}
+
+// Giá trị checksum đối chiếu với frame BuildFrame() gửi trước đây
+static_assert(RciFixed::Status.back() == 0xE7, "checksum 0x14");
+static_assert(RciFixed::StartPrint.back() == 0xEA, "checksum 0x11");
+static_assert(RciFixed::StopPrint.back() == 0xE9, "checksum 0x12");
+static_assert(RciFixed::StartJet.back() == 0xEC, "checksum 0x0F");
+static_assert(RciFixed::StopJet.back() == 0xEB, "checksum 0x10");
+
+// Tra frame dựng sẵn theo cmdid (dùng cho SendAndWaitAck khi payload rỗng)
+inline bool RciFindFixedFrame(uint8_t cmdid, const uint8_t*& data, size_t& size) {
+    switch (cmdid) {
+#define RCI_FIND_FIXED(name, id) \
+    case id: data = RciFixed::name.data(); size = RciFixed::name.size(); return true;
+        RCI_FIXED_COMMANDS(RCI_FIND_FIXED)
+#undef RCI_FIND_FIXED
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,117 @@
+﻿#include "RciDecoder.h"
+
+RciDecoder::RciDecoder(size_t maxBodySize) : maxBodySize_(maxBodySize) {
+    body_.reserve(256);
+}
+
+void RciDecoder::Reset() {
+    state_ = State::WaitEsc;
+    body_.clear();
+    type_ = 0;
+    sum_ = 0;
+    frame_ = RciFrameView{};
+}
+
+void RciDecoder::Resync() {
+    ++resyncCount_;
+    state_ = State::WaitEsc;
+    body_.clear();
+}
+
+RciDecoder::Result RciDecoder::Feed(const uint8_t* data, size_t len, size_t& consumed) {
+    consumed = 0;
+    while (consumed < len) {
+        // Trong body: lấy nguyên đoạn tới ESC kế tiếp bằng kernel SIMD
+        if (state_ == State::Body && len - consumed >= RciSimd::kBulkThreshold) {
+            const uint8_t* p = data + consumed;
+            size_t run = RciSimd::FindEsc(p, len - consumed);
+            if (run && body_.size() + run <= maxBodySize_) {
+                body_.insert(body_.end(), p, p + run);
+                sum_ += RciSimd::Sum(p, run);
+                consumed += run;
+                continue;
+            }
+        }
+
+        uint8_t b = data[consumed++];
+        if (Step(b))
+            return Result::Frame;
+    }
+    return Result::NeedMore;
+}
+
+// Trả về true khi vừa hoàn tất 1 frame
+bool RciDecoder::Step(uint8_t b) {
+    const uint8_t ESC = RciFrame::ESC, ETX = RciFrame::ETX;
+
+    switch (state_) {
+    case State::WaitEsc:
+        // bỏ qua byte rác giữa các frame
+        if (b == ESC) state_ = State::WaitType;
+        return false;
+
+    case State::WaitType:
+        if (b == RciFrame::ACK || b == RciFrame::NAK ||
+            b == RciFrame::STX || b == RciFrame::SOH) {
+            type_ = b;
+            sum_ = b;
+            body_.clear();
+            state_ = State::Body;
+        }
+        else if (b != ESC) {
+            Resync();
+        }
+        return false;
+
+    case State::Body:
+        if (b == ESC) {
+            state_ = State::BodyEsc;
+            return false;
+        }
+        if (body_.size() >= maxBodySize_) {
+            Resync();
+            return false;
+        }
+        body_.push_back(b);
+        sum_ += b;
+        return false;
+
+    case State::BodyEsc:
+        if (b == ETX) {
+            sum_ += ETX;
+            state_ = State::Checksum;
+            return false;
+        }
+        if (body_.size() >= maxBodySize_) {
+            Resync();
+            return false;
+        }
+        // ESC ESC / ESC STX / ESC SOH ... → byte dữ liệu
+        body_.push_back(b);
+        sum_ += b;
+        state_ = State::Body;
+        return false;
+
+    case State::Checksum:
+        // ESC ở đây là tiền tố của checksum, trừ khi chính checksum là ESC: lệnh RciClient gửi
+        // checksum thô → nhận luôn. Nếu bên gửi có escape (ESC ESC), ESC thừa rơi vào WaitType
+        // và bị bỏ qua như ESC đứng trước frame kế tiếp.
+        if (b == ESC && RciFrame::ChecksumFromSum(sum_) != ESC) {
+            state_ = State::ChecksumEsc;
+            return false;
+        }
+        break;
+
+    case State::ChecksumEsc:
+        break;
+    }
+
+    // b là checksum → phát frame
+    frame_.type = type_;
+    frame_.body = body_.data();
+    frame_.size = body_.size();
+    frame_.checksum = b;
+    frame_.checksumOk = (RciFrame::ChecksumFromSum(sum_) == b);
+    state_ = State::WaitEsc;
+    return true;
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "RciFrame.h"
+
+//
+// View tới 1 frame reply đã unescape (zero-copy).
+// body trỏ vào buffer nội bộ của RciDecoder → chỉ hợp lệ tới lần Feed() kế tiếp.
+//
+struct RciFrameView {
+    uint8_t type = 0;               // ACK / NAK / STX / SOH
+    const uint8_t* body = nullptr;  // [p_status, c_status, cmdid, ...] với reply ACK/NAK
+    size_t size = 0;
+    uint8_t checksum = 0;           // checksum nhận được
+    bool checksumOk = false;
+
+    uint8_t operator[](size_t i) const { return body[i]; }
+};
+
+//
+// Ring buffer byte cố định cho mỗi kết nối: giữ các byte đã recv nhưng chưa decode
+// (phần dư sau 1 frame được giữ lại cho reply kế tiếp).
+//
+class RciRingBuffer {
+public:
+    explicit RciRingBuffer(size_t capacityPow2 = 4096)
+        : buf_(capacityPow2), mask_(capacityPow2 - 1) {}
+
+    size_t Size() const { return head_ - tail_; }
+    size_t Free() const { return buf_.size() - Size(); }
+    bool Empty() const { return head_ == tail_; }
+    void Clear() { head_ = tail_ = 0; }
+
+    // Vùng ghi liên tục (để recv thẳng vào)
+    uint8_t* WritePtr(size_t& contiguous) {
+        size_t pos = head_ & mask_;
+        contiguous = std::min(Free(), buf_.size() - pos);
+        return buf_.data() + pos;
+    }
+    void CommitWrite(size_t n) { head_ += n; }
+
+    // Vùng đọc liên tục
+    const uint8_t* ReadPtr(size_t& contiguous) const {
+        size_t pos = tail_ & mask_;
+        contiguous = std::min(Size(), buf_.size() - pos);
+        return buf_.data() + pos;
+    }
+    void Consume(size_t n) { tail_ += n; }
+
+private:
+    std::vector<uint8_t> buf_;
+    size_t mask_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+};
+
+//
+// Decoder reply RCI dạng state machine, nhận từng byte, có thể dừng/tiếp tục bất kỳ lúc nào.
+// Khung: ESC <type> <body escaped> ESC ETX <checksum>
+//   - ESC ESC / ESC STX / ESC SOH trong body = byte dữ liệu
+//   - ESC ETX = kết thúc body, byte sau đó là checksum (có thể có ESC đứng trước;
+//     checksum bằng ESC nhận cả dạng thô lẫn ESC ESC)
+// Checksum tính dần trong lúc decode: type + body + ETX.
+//
+class RciDecoder {
+public:
+    enum class Result {
+        NeedMore,   // chưa đủ frame
+        Frame,      // có frame hoàn chỉnh → gọi Frame()
+    };
+
+    explicit RciDecoder(size_t maxBodySize = 64 * 1024);
+
+    // Decode tối đa len byte; dừng ngay khi có 1 frame hoàn chỉnh.
+    // consumed = số byte đã dùng (phần còn lại giữ cho lần sau).
+    Result Feed(const uint8_t* data, size_t len, size_t& consumed);
+
+    // Frame vừa decode xong (hợp lệ tới lần Feed() kế tiếp)
+    const RciFrameView& Frame() const { return frame_; }
+
+    void Reset();
+
+    // Số lần phải bỏ dữ liệu rác / frame quá dài (debug)
+    size_t ResyncCount() const { return resyncCount_; }
+
+private:
+    enum class State {
+        WaitEsc,
+        WaitType,
+        Body,
+        BodyEsc,
+        Checksum,
+        ChecksumEsc,
+    };
+
+    bool Step(uint8_t b);
+    void Resync();
+
+    State state_ = State::WaitEsc;
+    std::vector<uint8_t> body_;
+    size_t maxBodySize_;
+    uint8_t type_ = 0;
+    unsigned int sum_ = 0;
+    RciFrameView frame_;
+    size_t resyncCount_ = 0;
+};
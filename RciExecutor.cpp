@@ -0,0 +1,86 @@
+﻿#include "RciExecutor.h"
+#include <memory>
+
+RciExecutor::RciExecutor(size_t threads) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i)
+        threads_.emplace_back(&RciExecutor::Run, this);
+}
+
+RciExecutor::~RciExecutor() {
+    Stop();
+}
+
+void RciExecutor::Post(std::function<void()> fn) {
+    PostAt(Clock::time_point::min(), std::move(fn));
+}
+
+void RciExecutor::PostAt(Clock::time_point when, std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stopping_) return;
+        queue_.push(Timed{ when, seq_++, std::move(fn) });
+    }
+    cv_.notify_one();
+}
+
+void RciExecutor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stopping_) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            if (t.get_id() == std::this_thread::get_id()) t.detach();
+            else t.join();
+        }
+    }
+
+    // bỏ việc còn lại ngoài lock (hàm có thể giữ tài nguyên cần hủy)
+    std::priority_queue<Timed, std::vector<Timed>, std::greater<Timed>> rest;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        rest.swap(queue_);
+    }
+}
+
+bool RciExecutor::InExecutorThread() const {
+    for (const auto& t : threads_)
+        if (t.get_id() == std::this_thread::get_id()) return true;
+    return false;
+}
+
+void RciExecutor::Run() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!stopping_) {
+        if (queue_.empty()) {
+            cv_.wait(lock);
+            continue;
+        }
+
+        auto when = queue_.top().when;
+        if (when > Clock::now()) {
+            cv_.wait_until(lock, when);
+            continue;
+        }
+
+        // priority_queue::top() là const → lấy hàm ra rồi pop
+        std::function<void()> fn = std::move(const_cast<Timed&>(queue_.top()).fn);
+        queue_.pop();
+
+        lock.unlock();
+        fn();
+        lock.lock();
+    }
+}
+
+void RciSpawn(RciExecutor& executor, RciTask<void> task, std::function<void(std::exception_ptr)> onDone) {
+    // std::function cần copy được → giữ task qua shared_ptr
+    auto holder = std::make_shared<RciTask<void>>(std::move(task));
+    executor.Post([holder, onDone = std::move(onDone)]() mutable {
+        RciTaskDetail::RunDetached(std::move(*holder), std::move(onDone));
+    });
+}
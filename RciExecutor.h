@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <coroutine>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include "RciTask.h"
+
+//
+// Executor nhỏ cho coroutine lệnh máy in: vài thread chạy công việc Post/PostAt.
+// Coroutine chờ máy in không giữ thread → 1 thread đủ cho nhiều chuỗi lệnh đồng thời.
+//
+class RciExecutor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RciExecutor(size_t threads = 1);
+    ~RciExecutor();
+
+    void Post(std::function<void()> fn);
+    void PostAt(Clock::time_point when, std::function<void()> fn);
+    void Resume(std::coroutine_handle<> h) { Post([h] { h.resume(); }); }
+
+    // Dừng nhận việc, chờ thread thoát (việc còn trong hàng đợi bị bỏ)
+    void Stop();
+    bool InExecutorThread() const;
+
+    // co_await executor.Schedule(): chuyển coroutine sang thread của executor
+    auto Schedule() {
+        struct Awaiter {
+            RciExecutor& ex;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { ex.Resume(h); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+
+    // co_await executor.Delay(ms): chờ không chiếm thread
+    auto Delay(std::chrono::milliseconds ms) {
+        struct Awaiter {
+            RciExecutor& ex;
+            Clock::time_point when;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { ex.PostAt(when, [h] { h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this, Clock::now() + ms };
+    }
+
+private:
+    struct Timed {
+        Clock::time_point when;
+        uint64_t seq;       // giữ thứ tự FIFO khi cùng thời điểm
+        std::function<void()> fn;
+        bool operator>(const Timed& o) const { return when != o.when ? when > o.when : seq > o.seq; }
+    };
+
+    void Run();
+
+    std::vector<std::thread> threads_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::priority_queue<Timed, std::vector<Timed>, std::greater<Timed>> queue_;
+    uint64_t seq_ = 0;
+    bool stopping_ = false;
+};
+
+// Chạy task trên executor, không chờ kết quả; onDone (tùy chọn) nhận lỗi nếu task ném exception
+void RciSpawn(RciExecutor& executor, RciTask<void> task,
+    std::function<void(std::exception_ptr)> onDone = nullptr);
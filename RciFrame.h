@@ -0,0 +1,123 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "RciSimd.h"
+
+//
+// Mã hóa frame RCI Linx: ESC STX|SOH <body escaped> ESC ETX <checksum>
+// Ghi thẳng vào buffer do caller cấp, tính checksum trong lúc escape (1 lần duyệt).
+// Không cấp phát heap: RciClient dùng lại 1 buffer gửi cho mỗi kết nối.
+//
+class RciFrame {
+public:
+    static constexpr uint8_t ESC = 0x1B;
+    static constexpr uint8_t STX = 0x02;
+    static constexpr uint8_t SOH = 0x01;
+    static constexpr uint8_t ETX = 0x03;
+    static constexpr uint8_t ACK = 0x06;
+    static constexpr uint8_t NAK = 0x15;
+
+    // Byte cần escape trong body
+    static constexpr bool IsControlByte(uint8_t b) {
+        return b == ESC || b == STX || b == SOH || b == ETX;
+    }
+
+    // Checksum Linx: bù 2 của tổng các byte (mod 256)
+    static constexpr uint8_t ChecksumFromSum(unsigned int sum) {
+        return (uint8_t)((0x100 - (sum & 0xFF)) & 0xFF);
+    }
+
+    // Kích thước tối đa của frame khi payload có payloadLen byte (mọi byte đều bị escape,
+    // checksum reply có ESC đứng trước)
+    static constexpr size_t MaxEncodedSize(size_t payloadLen) {
+        return 2 + 2 * (1 + payloadLen) + 2 + 2;
+    }
+
+    // =====================================================
+    // Writer: ghi frame từng phần (cmdid, payload nhiều đoạn...)
+    // Nếu hết chỗ → Ok() = false, End() trả về 0.
+    // =====================================================
+    class Writer {
+    public:
+        Writer(uint8_t* out, size_t capacity, bool useSOH = false)
+            : Writer(out, capacity, useSOH ? SOH : STX, true) {}
+
+        // Frame reply ESC ACK|NAK ... (máy in giả lập): phía máy in chỉ nhân đôi ESC,
+        // byte STX/SOH/ETX trong body gửi nguyên (decoder coi ESC ETX là hết body);
+        // checksum là byte điều khiển → thêm ESC đứng trước như máy in thật
+        static Writer Reply(uint8_t* out, size_t capacity, bool ack) {
+            return Writer(out, capacity, ack ? ACK : NAK, false);
+        }
+
+        void Put(uint8_t b) {
+            sum_ += b;
+            if (b == ESC || (escapeAll_ && IsControlByte(b))) PutRaw(ESC);
+            PutRaw(b);
+        }
+
+        void Put(const uint8_t* data, size_t len) {
+            // payload lớn (0x19 / 0x1D): kernel SIMD copy nguyên đoạn không cần escape
+            if (escapeAll_ && len >= RciSimd::kBulkThreshold && cap_ - pos_ >= 2 * len) {
+                pos_ += RciSimd::Escape(data, len, out_ + pos_, sum_);
+                return;
+            }
+            for (size_t i = 0; i < len; ++i) Put(data[i]);
+        }
+
+        // Đóng frame, trả về tổng số byte đã ghi (0 nếu tràn buffer)
+        size_t End(bool includeChecksum = true) {
+            PutRaw(ESC);
+            PutRaw(ETX);
+            if (includeChecksum) {
+                // lệnh giữ checksum thô (định dạng gửi máy in từ trước tới nay)
+                uint8_t checksum = ChecksumFromSum(sum_ + ETX);
+                if (!escapeAll_ && IsControlByte(checksum)) PutRaw(ESC);
+                PutRaw(checksum);
+            }
+            return ok_ ? pos_ : 0;
+        }
+
+        bool Ok() const { return ok_; }
+
+    private:
+        Writer(uint8_t* out, size_t capacity, uint8_t start, bool escapeAll)
+            : out_(out), cap_(capacity), pos_(0), sum_(0), ok_(true), escapeAll_(escapeAll) {
+            PutRaw(ESC);
+            PutRaw(start);
+            sum_ += start;
+        }
+
+        void PutRaw(uint8_t b) {
+            if (pos_ < cap_) out_[pos_++] = b;
+            else ok_ = false;
+        }
+
+        uint8_t* out_;
+        size_t cap_;
+        size_t pos_;
+        unsigned int sum_;
+        bool ok_;
+        bool escapeAll_;    // lệnh: escape mọi byte điều khiển; reply: chỉ ESC
+    };
+
+    // Encode 1 lệnh vào buffer thô; trả về số byte, 0 nếu buffer không đủ
+    static size_t Encode(uint8_t* out, size_t capacity, uint8_t commandId,
+        const uint8_t* payload, size_t payloadLen,
+        bool useSOH = false, bool includeChecksum = true) {
+        Writer w(out, capacity, useSOH);
+        w.Put(commandId);
+        w.Put(payload, payloadLen);
+        return w.End(includeChecksum);
+    }
+
+    // Encode vào vector dùng lại: chỉ cấp phát khi capacity chưa đủ (lần đầu / payload lớn hơn)
+    static size_t Encode(std::vector<uint8_t>& out, uint8_t commandId,
+        const uint8_t* payload, size_t payloadLen,
+        bool useSOH = false, bool includeChecksum = true) {
+        out.resize(MaxEncodedSize(payloadLen));
+        size_t n = Encode(out.data(), out.size(), commandId, payload, payloadLen, useSOH, includeChecksum);
+        out.resize(n);
+        return n;
+    }
+};
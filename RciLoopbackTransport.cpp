@@ -0,0 +1,84 @@
+﻿#include "RciLoopbackTransport.h"
+#include <algorithm>
+#include <cstring>
+
+RciLoopbackTransport::Pair RciLoopbackTransport::CreatePair() {
+    auto link = std::make_shared<Link>();
+    return Pair(std::unique_ptr<RciLoopbackTransport>(new RciLoopbackTransport(link, 0)),
+        std::unique_ptr<RciLoopbackTransport>(new RciLoopbackTransport(link, 1)));
+}
+
+bool RciLoopbackTransport::Connect(const std::wstring&, unsigned short, int, std::wstring&) {
+    std::lock_guard<std::mutex> lock(link_->mtx);
+    for (auto& p : link_->pipes) {
+        p.data.clear();
+        p.readPos = 0;
+    }
+    link_->open = true;
+    return true;
+}
+
+bool RciLoopbackTransport::Send(const uint8_t* data, size_t len) {
+    {
+        std::lock_guard<std::mutex> lock(link_->mtx);
+        if (!link_->open) return false;
+
+        Pipe& out = link_->pipes[1 - side_];
+        // dồn phần chưa đọc về đầu khi đã đọc quá nửa (giữ capacity, tránh cấp phát lại)
+        if (out.readPos > 0 && out.readPos * 2 >= out.data.size()) {
+            out.data.erase(out.data.begin(), out.data.begin() + out.readPos);
+            out.readPos = 0;
+        }
+        out.data.insert(out.data.end(), data, data + len);
+    }
+    link_->cv.notify_all();
+    return true;
+}
+
+IRciTransport::IoResult RciLoopbackTransport::Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) {
+    received = 0;
+    Pipe& in = link_->pipes[side_];
+
+    std::unique_lock<std::mutex> lock(link_->mtx);
+    bool& interrupted = link_->interrupted[side_];
+    bool ready = link_->cv.wait_until(lock, deadline, [&] {
+        return !link_->open || in.readPos < in.data.size() || interrupted;
+        });
+    if (!link_->open) return IoResult::Closed;
+    if (!ready) return IoResult::Timeout;
+    if (in.readPos == in.data.size()) {
+        interrupted = false;
+        return IoResult::Interrupted;
+    }
+
+    size_t n = std::min(cap, in.data.size() - in.readPos);
+    memcpy(buf, in.data.data() + in.readPos, n);
+    in.readPos += n;
+    if (in.readPos == in.data.size()) {
+        in.data.clear();
+        in.readPos = 0;
+    }
+    received = n;
+    return IoResult::Ok;
+}
+
+void RciLoopbackTransport::Interrupt() {
+    {
+        std::lock_guard<std::mutex> lock(link_->mtx);
+        link_->interrupted[side_] = true;
+    }
+    link_->cv.notify_all();
+}
+
+void RciLoopbackTransport::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(link_->mtx);
+        link_->open = false;
+    }
+    link_->cv.notify_all();
+}
+
+bool RciLoopbackTransport::IsOpen() const {
+    std::lock_guard<std::mutex> lock(link_->mtx);
+    return link_->open;
+}
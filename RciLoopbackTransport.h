@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <utility>
+#include "RciTransport.h"
+
+//
+// Cặp transport nối thẳng trong bộ nhớ (không socket).
+// Một đầu gắn vào RciClient, đầu kia cho máy in giả lập trong test / benchmark:
+// byte Send ở đầu này được Receive ở đầu kia.
+// Connect (host/port bị bỏ qua) mở lại kênh và xóa dữ liệu cũ; Shutdown/Close ở
+// bất kỳ đầu nào đóng kênh cho cả hai.
+//
+class RciLoopbackTransport : public IRciTransport {
+public:
+    using Pair = std::pair<std::unique_ptr<RciLoopbackTransport>, std::unique_ptr<RciLoopbackTransport>>;
+
+    // first: đầu client, second: đầu máy in
+    static Pair CreatePair();
+
+    bool Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) override;
+    bool Send(const uint8_t* data, size_t len) override;
+    IoResult Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) override;
+    void Shutdown() override;
+    void Close() override { Shutdown(); }
+    bool IsOpen() const override;
+    int LastError() const override { return 0; }
+    bool CanInterrupt() const override { return true; }
+    void Interrupt() override;
+
+private:
+    // Byte đang chờ đọc theo 1 chiều
+    struct Pipe {
+        std::vector<uint8_t> data;
+        size_t readPos = 0;
+    };
+
+    struct Link {
+        std::mutex mtx;
+        std::condition_variable cv;
+        Pipe pipes[2];      // pipes[i]: dữ liệu gửi tới đầu i
+        bool interrupted[2] = { false, false };     // Interrupt ở đầu i chưa được Receive nhận
+        bool open = true;
+    };
+
+    RciLoopbackTransport(std::shared_ptr<Link> link, int side) : link_(std::move(link)), side_(side) {}
+
+    std::shared_ptr<Link> link_;
+    int side_;
+};
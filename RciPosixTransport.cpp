@@ -0,0 +1,181 @@
+﻿#include "RciPosixTransport.h"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+RciPosixTransport::RciPosixTransport() {
+    if (::pipe(wakeFds_) == 0) {
+        for (int fd : wakeFds_) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+    else {
+        wakeFds_[0] = wakeFds_[1] = -1;     // không có pipe → RciClient chờ theo lát
+    }
+}
+
+RciPosixTransport::~RciPosixTransport() {
+    Close();
+    for (int fd : wakeFds_)
+        if (fd >= 0) ::close(fd);
+}
+
+bool RciPosixTransport::Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) {
+    Close();
+
+    int s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s < 0) {
+        error = L"❌ Không thể tạo socket";
+        lastError_ = errno;
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+
+    // địa chỉ IP chỉ gồm ký tự ASCII
+    char ip[64] = {};
+    for (size_t i = 0; i < host.size() && i + 1 < sizeof(ip); ++i)
+        ip[i] = (char)host[i];
+
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
+        error = L"❌ Địa chỉ IP không hợp lệ";
+        ::close(s);
+        return false;
+    }
+
+    // Non-blocking tạm thời để connect có timeout
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+
+    int res = ::connect(s, (sockaddr*)&addr, sizeof(addr));
+    if (res < 0 && errno != EINPROGRESS) {
+        int err = errno;
+        std::wstringstream ss;
+        ss << L"❌ connect() thất bại, errno=" << err << L" (" << strerror(err) << L")";
+        error = ss.str();
+        lastError_ = err;
+        ::close(s);
+        return false;
+    }
+
+    if (res < 0) {
+        pollfd pfd{ s, POLLOUT, 0 };
+        res = ::poll(&pfd, 1, timeoutMs);
+        if (res <= 0) {
+            error = L"⏰ Timeout kết nối";
+            lastError_ = res == 0 ? ETIMEDOUT : errno;
+            ::close(s);
+            return false;
+        }
+
+        int so_err = 0;
+        socklen_t optlen = sizeof(so_err);
+        if (getsockopt(s, SOL_SOCKET, SO_ERROR, &so_err, &optlen) == 0 && so_err != 0) {
+            std::wstringstream ss;
+            ss << L"❌ Kết nối thất bại (SO_ERROR=" << so_err << L")";
+            error = ss.str();
+            lastError_ = so_err;
+            ::close(s);
+            return false;
+        }
+    }
+
+    // Trả về blocking: Send chặn tới khi gửi hết, Receive chờ bằng poll
+    fcntl(s, F_SETFL, flags & ~O_NONBLOCK);
+
+    fd_ = s;
+    open_ = true;
+    return true;
+}
+
+bool RciPosixTransport::Send(const uint8_t* data, size_t len) {
+    if (!open_) return false;
+
+    while (len > 0) {
+        ssize_t sent = ::send(fd_, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            lastError_ = errno;
+            open_ = false;
+            return false;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+IRciTransport::IoResult RciPosixTransport::Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) {
+    received = 0;
+
+    while (true) {
+        if (!open_) return IoResult::Closed;
+
+        auto now = Clock::now();
+        if (now > deadline) return IoResult::Timeout;
+
+        // shutdown() đánh thức poll trên Linux → chờ thẳng tới deadline
+        auto remainMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+
+        pollfd pfd[2] = { { fd_, POLLIN, 0 }, { wakeFds_[0], POLLIN, 0 } };
+        int sel = ::poll(pfd, wakeFds_[0] >= 0 ? 2 : 1, (int)remainMs);
+        if (sel < 0) {
+            if (errno == EINTR) continue;
+            lastError_ = errno;
+            open_ = false;
+            return IoResult::Error;
+        }
+        if (sel == 0) continue; // no data yet
+
+        // có dữ liệu thì đọc trước, tín hiệu đánh thức giữ lại cho lần sau
+        if (!(pfd[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            uint8_t drain[16];
+            while (::read(wakeFds_[0], drain, sizeof(drain)) > 0) {}
+            return IoResult::Interrupted;
+        }
+
+        ssize_t n = ::recv(fd_, buf, cap, 0);
+        if (n == 0) {
+            open_ = false;
+            return IoResult::Closed;
+        }
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            lastError_ = errno;
+            open_ = false;
+            return IoResult::Error;
+        }
+        received = (size_t)n;
+        return IoResult::Ok;
+    }
+}
+
+void RciPosixTransport::Interrupt() {
+    if (wakeFds_[1] < 0) return;
+    uint8_t one = 1;
+    ssize_t r = ::write(wakeFds_[1], &one, 1);     // pipe đầy = đã có tín hiệu chờ đọc
+    (void)r;
+}
+
+void RciPosixTransport::Shutdown() {
+    open_ = false;
+    if (fd_ >= 0)
+        ::shutdown(fd_, SHUT_RDWR);
+}
+
+void RciPosixTransport::Close() {
+    open_ = false;
+    if (fd_ >= 0) {
+        ::shutdown(fd_, SHUT_RDWR);
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+#endif
@@ -0,0 +1,30 @@
+﻿#pragma once
+#ifndef _WIN32
+#include <atomic>
+#include "RciTransport.h"
+
+//
+// Transport TCP qua POSIX socket (Linux build agent / simulator)
+//
+class RciPosixTransport : public IRciTransport {
+public:
+    RciPosixTransport();
+    ~RciPosixTransport() override;
+
+    bool Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) override;
+    bool Send(const uint8_t* data, size_t len) override;
+    IoResult Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) override;
+    void Shutdown() override;
+    void Close() override;
+    bool IsOpen() const override { return open_; }
+    int LastError() const override { return lastError_; }
+    bool CanInterrupt() const override { return wakeFds_[1] >= 0; }
+    void Interrupt() override;
+
+private:
+    int fd_ = -1;
+    int wakeFds_[2] = { -1, -1 };   // self-pipe: Interrupt ghi 1 byte, Receive poll cùng socket
+    std::atomic<bool> open_{ false };
+    std::atomic<int> lastError_{ 0 };
+};
+#endif
@@ -0,0 +1,210 @@
+﻿#include "RciReactor.h"
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+
+RciReactor::RciReactor() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;    // id 0 = eventfd đánh thức
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+}
+
+RciReactor::~RciReactor() {
+    Stop();
+    // hủy ngay trong handler (chính reactor thread): không join được chính mình
+    if (thread_.joinable()) thread_.detach();
+    if (wakefd_ >= 0) close(wakefd_);
+    if (epfd_ >= 0) close(epfd_);
+}
+
+RciReactor& RciReactor::Default() {
+    static RciReactor reactor;
+    reactor.Start();
+    return reactor;
+}
+
+bool RciReactor::Start() {
+    if (epfd_ < 0 || wakefd_ < 0) return false;
+
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true))
+        return true;    // đang chạy
+
+    if (thread_.joinable()) {
+        // Stop rồi Start ngay trong handler: vòng Run hiện tại thấy running_ và chạy tiếp
+        if (InReactorThread()) return true;
+        thread_.join();     // lượt trước bị Stop từ handler, chưa ai join
+    }
+    thread_ = std::thread(&RciReactor::Run, this);
+    return true;
+}
+
+// Gọi từ handler: chỉ báo dừng, Run thoát sau vòng hiện tại; Stop / Start / hủy sau đó sẽ join
+void RciReactor::Stop() {
+    if (running_.exchange(false)) Wake();
+    if (thread_.joinable() && !InReactorThread())
+        thread_.join();
+}
+
+uint64_t RciReactor::Add(int fd, Handler* handler, uint32_t events) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        id = nextId_++;
+        entries_[id] = Entry{ fd, handler, Clock::time_point::max(), false };
+    }
+
+    epoll_event ev{};
+    ev.events = events | EPOLLET;
+    ev.data.u64 = id;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        entries_.erase(id);
+        return 0;
+    }
+    return id;
+}
+
+void RciReactor::Remove(uint64_t id) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return;
+
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    entries_.erase(it);
+
+    // handler đang chạy trên reactor thread → chờ xong (trừ khi chính nó gọi Remove)
+    if (!InReactorThread())
+        doneCv_.wait(lock, [&] { return current_ != id; });
+}
+
+void RciReactor::ArmTimer(uint64_t id, Clock::time_point when) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entries_.find(id);
+        if (it == entries_.end()) return;
+
+        it->second.timerAt = when;
+        it->second.timerArmed = true;
+        // timer sớm hơn lần chờ hiện tại → đánh thức để tính lại timeout epoll_wait
+        wake = timers_.empty() || when < timers_.top().when;
+        timers_.push(Timer{ when, id });
+    }
+    if (wake && !InReactorThread()) Wake();
+}
+
+void RciReactor::Post(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        posted_.push_back(std::move(fn));
+    }
+    if (!InReactorThread()) Wake();
+}
+
+size_t RciReactor::Count() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return entries_.size();
+}
+
+void RciReactor::Wake() {
+    uint64_t one = 1;
+    ssize_t r = write(wakefd_, &one, sizeof(one));
+    (void)r;
+}
+
+template<typename Fn>
+void RciReactor::Dispatch(uint64_t id, Fn&& fn) {
+    Handler* handler = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entries_.find(id);
+        if (it == entries_.end()) return;   // đã Remove trong cùng đợt sự kiện
+        handler = it->second.handler;
+        current_ = id;
+    }
+
+    fn(handler);
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        current_ = 0;
+    }
+    doneCv_.notify_all();
+}
+
+int RciReactor::NextTimeoutMs(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!posted_.empty()) return 0;
+    if (timers_.empty()) return -1;
+
+    auto when = timers_.top().when;
+    if (when <= now) return 0;
+    // làm tròn lên để không thức dậy sớm rồi quay vòng
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(when - now).count() + 1;
+    return ms > 60000 ? 60000 : (int)ms;
+}
+
+void RciReactor::RunTimers(Clock::time_point now) {
+    while (true) {
+        uint64_t id = 0;
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (timers_.empty() || timers_.top().when > now) return;
+
+            Timer t = timers_.top();
+            timers_.pop();
+
+            // bỏ mục cũ: đăng ký đã xóa hoặc timer đã được đặt lại
+            auto it = entries_.find(t.id);
+            if (it == entries_.end() || !it->second.timerArmed || it->second.timerAt != t.when)
+                continue;
+            it->second.timerArmed = false;
+            id = t.id;
+        }
+        Dispatch(id, [](Handler* h) { h->OnTimer(); });
+    }
+}
+
+void RciReactor::RunPosted() {
+    std::vector<std::function<void()>> work;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        work.swap(posted_);
+    }
+    for (auto& fn : work) fn();
+}
+
+void RciReactor::Run() {
+    threadId_ = std::this_thread::get_id();
+
+    epoll_event events[64];
+    while (running_) {
+        int timeout = NextTimeoutMs(Clock::now());
+        int n = epoll_wait(epfd_, events, 64, timeout);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < n; ++i) {
+            uint64_t id = events[i].data.u64;
+            uint32_t ev = events[i].events;
+            if (id == 0) {
+                uint64_t v;
+                while (read(wakefd_, &v, sizeof(v)) > 0) {}
+                continue;
+            }
+            Dispatch(id, [ev](Handler* h) { h->OnEvents(ev); });
+        }
+
+        RunTimers(Clock::now());
+        RunPosted();
+    }
+
+    threadId_ = std::thread::id();
+}
+#endif
@@ -0,0 +1,88 @@
+﻿#pragma once
+#ifdef __linux__
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <queue>
+#include <vector>
+
+//
+// Reactor I/O dùng epoll (Linux): 1 thread phục vụ nhiều kết nối máy in.
+//   - fd đăng ký ở chế độ edge-triggered, non-blocking
+//   - timer lưu trong reactor (min-heap), không cần thread chờ riêng
+//   - Post(): chạy hàm trên reactor thread
+// Handler được gọi trên reactor thread; sau khi Remove() trả về thì handler không còn được gọi.
+//
+class RciReactor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Handler {
+    public:
+        virtual ~Handler() = default;
+        virtual void OnEvents(uint32_t events) = 0;     // EPOLLIN / EPOLLOUT / EPOLLERR / EPOLLHUP / EPOLLRDHUP
+        virtual void OnTimer() = 0;
+    };
+
+    RciReactor();
+    ~RciReactor();
+
+    // Reactor dùng chung cho mọi kết nối (tự Start ở lần gọi đầu)
+    static RciReactor& Default();
+
+    bool Start();
+    void Stop();
+
+    // Trả về id đăng ký (0 nếu lỗi)
+    uint64_t Add(int fd, Handler* handler, uint32_t events);
+    void Remove(uint64_t id);
+
+    // Timer 1 lần cho mỗi đăng ký, gọi lại sẽ thay thời điểm cũ
+    void ArmTimer(uint64_t id, Clock::time_point when);
+
+    void Post(std::function<void()> fn);
+    bool InReactorThread() const { return std::this_thread::get_id() == threadId_.load(); }
+    size_t Count() const;
+
+private:
+    struct Entry {
+        int fd;
+        Handler* handler;
+        Clock::time_point timerAt;
+        bool timerArmed;
+    };
+
+    struct Timer {
+        Clock::time_point when;
+        uint64_t id;
+        bool operator>(const Timer& o) const { return when > o.when; }
+    };
+
+    void Run();
+    void Wake();
+    int NextTimeoutMs(Clock::time_point now);
+    void RunTimers(Clock::time_point now);
+    void RunPosted();
+    // Gọi handler id (nếu còn đăng ký) với cơ chế chặn Remove() trong lúc đang chạy
+    template<typename Fn> void Dispatch(uint64_t id, Fn&& fn);
+
+    int epfd_ = -1;
+    int wakefd_ = -1;
+    std::thread thread_;
+    std::atomic<std::thread::id> threadId_{};
+    std::atomic<bool> running_{ false };
+
+    mutable std::mutex mtx_;            // bảo vệ entries_ / timers_ / posted_ / current_
+    std::condition_variable doneCv_;    // báo handler current_ đã chạy xong
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::vector<std::function<void()>> posted_;
+    uint64_t nextId_ = 1;
+    uint64_t current_ = 0;              // id handler đang chạy
+};
+#endif
@@ -0,0 +1,248 @@
+﻿#include "RciReactorTransport.h"
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+RciReactorTransport::RciReactorTransport(RciReactor& reactor) : reactor_(reactor) {
+    wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+RciReactorTransport::~RciReactorTransport() {
+    Close();
+    if (wakefd_ >= 0) ::close(wakefd_);
+}
+
+bool RciReactorTransport::Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) {
+    Close();
+
+    int s = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (s < 0) {
+        error = L"❌ Không thể tạo socket";
+        lastError_ = errno;
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+
+    // địa chỉ IP chỉ gồm ký tự ASCII
+    char ip[64] = {};
+    for (size_t i = 0; i < host.size() && i + 1 < sizeof(ip); ++i)
+        ip[i] = (char)host[i];
+
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
+        error = L"❌ Địa chỉ IP không hợp lệ";
+        ::close(s);
+        return false;
+    }
+
+    int res = ::connect(s, (sockaddr*)&addr, sizeof(addr));
+    if (res < 0 && errno != EINPROGRESS) {
+        int err = errno;
+        std::wstringstream ss;
+        ss << L"❌ connect() thất bại, errno=" << err << L" (" << strerror(err) << L")";
+        error = ss.str();
+        lastError_ = err;
+        ::close(s);
+        return false;
+    }
+
+    if (res < 0) {
+        pollfd pfd{ s, POLLOUT, 0 };
+        res = ::poll(&pfd, 1, timeoutMs);
+        if (res <= 0) {
+            error = L"⏰ Timeout kết nối";
+            lastError_ = res == 0 ? ETIMEDOUT : errno;
+            ::close(s);
+            return false;
+        }
+
+        int so_err = 0;
+        socklen_t optlen = sizeof(so_err);
+        if (getsockopt(s, SOL_SOCKET, SO_ERROR, &so_err, &optlen) == 0 && so_err != 0) {
+            std::wstringstream ss;
+            ss << L"❌ Kết nối thất bại (SO_ERROR=" << so_err << L")";
+            error = ss.str();
+            lastError_ = so_err;
+            ::close(s);
+            return false;
+        }
+    }
+
+    // frame lệnh nhỏ, chờ reply → gửi ngay không gom gói
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // socket giữ non-blocking suốt vòng đời
+    fd_ = s;
+    closedNotified_ = false;
+    open_ = true;
+    return true;
+}
+
+bool RciReactorTransport::Send(const uint8_t* data, size_t len) {
+    if (!open_) return false;
+
+    while (len > 0) {
+        ssize_t sent = ::send(fd_, data, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // buffer gửi đầy (hiếm với frame RCI) → chờ ghi được
+                pollfd pfd{ fd_, POLLOUT, 0 };
+                if (::poll(&pfd, 1, 1000) > 0 && open_) continue;
+            }
+            lastError_ = errno;
+            open_ = false;
+            return false;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+IRciTransport::IoResult RciReactorTransport::Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) {
+    received = 0;
+
+    while (true) {
+        if (!open_) return IoResult::Closed;
+
+        auto now = Clock::now();
+        if (now > deadline) return IoResult::Timeout;
+
+        auto remainMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+
+        pollfd pfd[2] = { { fd_, POLLIN, 0 }, { wakefd_, POLLIN, 0 } };
+        int sel = ::poll(pfd, wakefd_ >= 0 ? 2 : 1, (int)remainMs);
+        if (sel < 0) {
+            if (errno == EINTR) continue;
+            lastError_ = errno;
+            open_ = false;
+            return IoResult::Error;
+        }
+        if (sel == 0) continue; // no data yet
+
+        // có dữ liệu thì đọc trước, tín hiệu đánh thức giữ lại cho lần sau
+        if (!(pfd[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            uint64_t v;
+            ssize_t r = ::read(wakefd_, &v, sizeof(v));
+            (void)r;
+            return IoResult::Interrupted;
+        }
+
+        ssize_t n = ::recv(fd_, buf, cap, 0);
+        if (n == 0) {
+            open_ = false;
+            return IoResult::Closed;
+        }
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            lastError_ = errno;
+            open_ = false;
+            return IoResult::Error;
+        }
+        received = (size_t)n;
+        return IoResult::Ok;
+    }
+}
+
+void RciReactorTransport::Interrupt() {
+    if (wakefd_ < 0) return;
+    uint64_t one = 1;
+    ssize_t r = ::write(wakefd_, &one, sizeof(one));
+    (void)r;
+}
+
+void RciReactorTransport::Shutdown() {
+    open_ = false;
+    if (fd_ >= 0)
+        ::shutdown(fd_, SHUT_RDWR);   // reactor nhận EPOLLHUP → báo onClosed
+}
+
+void RciReactorTransport::Close() {
+    open_ = false;
+    StopPush();
+    if (fd_ >= 0) {
+        ::shutdown(fd_, SHUT_RDWR);
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+// =========================================================
+// Chế độ đẩy
+// =========================================================
+bool RciReactorTransport::StartPush(DataHandler onData, EventHandler onClosed, EventHandler onTimer) {
+    if (fd_ < 0 || regId_ != 0) return false;
+
+    onData_ = std::move(onData);
+    onClosed_ = std::move(onClosed);
+    onTimer_ = std::move(onTimer);
+
+    // fd đang có sẵn dữ liệu → epoll báo ngay khi đăng ký, không mất byte
+    regId_ = reactor_.Add(fd_, this, EPOLLIN | EPOLLRDHUP);
+    return regId_ != 0;
+}
+
+void RciReactorTransport::StopPush() {
+    if (regId_ == 0) return;
+    reactor_.Remove(regId_);    // chờ callback đang chạy (nếu có) kết thúc
+    regId_ = 0;
+}
+
+void RciReactorTransport::ArmTimer(Clock::time_point when) {
+    if (regId_ != 0) reactor_.ArmTimer(regId_, when);
+}
+
+void RciReactorTransport::OnEvents(uint32_t events) {
+    if (events & EPOLLIN) {
+        // edge-triggered: đọc tới khi hết; recv trả về ít hơn buffer nghĩa là đã cạn
+        while (true) {
+            ssize_t n = ::recv(fd_, rxBuf_, sizeof(rxBuf_), 0);
+            if (n > 0) {
+                onData_(rxBuf_, (size_t)n);
+                if (regId_ == 0) return;    // callback đã StopPush
+                if ((size_t)n < sizeof(rxBuf_)) break;
+                continue;
+            }
+            if (n == 0) {
+                NotifyClosed();
+                return;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+            lastError_ = errno;
+            NotifyClosed();
+            return;
+        }
+    }
+
+    if (regId_ != 0 && (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))) {
+        NotifyClosed();
+    }
+}
+
+void RciReactorTransport::OnTimer() {
+    if (onTimer_) onTimer_();
+}
+
+void RciReactorTransport::NotifyClosed() {
+    open_ = false;
+    if (closedNotified_) return;
+    closedNotified_ = true;
+    if (onClosed_) onClosed_();
+}
+#endif
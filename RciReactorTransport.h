@@ -0,0 +1,52 @@
+﻿#pragma once
+#ifdef __linux__
+#include <atomic>
+#include "RciTransport.h"
+#include "RciReactor.h"
+
+//
+// Transport TCP non-blocking gắn với RciReactor (Linux).
+//   - Chế độ kéo (Receive): poll thẳng trên fd, không đi qua reactor
+//   - Chế độ đẩy (StartPush, khi RciClient bật pipeline): fd đăng ký edge-triggered vào
+//     reactor, dữ liệu và timeout được xử lý trên reactor thread → nhiều kết nối dùng chung
+//     1 thread thay vì mỗi kết nối 1 reader thread chờ chặn.
+//
+class RciReactorTransport : public IRciTransport, private RciReactor::Handler {
+public:
+    explicit RciReactorTransport(RciReactor& reactor = RciReactor::Default());
+    ~RciReactorTransport() override;
+
+    bool Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) override;
+    bool Send(const uint8_t* data, size_t len) override;
+    IoResult Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) override;
+    void Shutdown() override;
+    void Close() override;
+    bool IsOpen() const override { return open_; }
+    int LastError() const override { return lastError_; }
+    bool CanInterrupt() const override { return wakefd_ >= 0; }
+    void Interrupt() override;
+
+    bool StartPush(DataHandler onData, EventHandler onClosed, EventHandler onTimer) override;
+    void StopPush() override;
+    void ArmTimer(Clock::time_point when) override;
+
+private:
+    void OnEvents(uint32_t events) override;
+    void OnTimer() override;
+    void NotifyClosed();
+
+    RciReactor& reactor_;
+    int fd_ = -1;
+    int wakefd_ = -1;       // eventfd: Interrupt đánh thức Receive (chế độ kéo)
+    std::atomic<bool> open_{ false };
+    std::atomic<int> lastError_{ 0 };
+
+    // Chế độ đẩy (chỉ dùng trên reactor thread sau StartPush)
+    std::atomic<uint64_t> regId_{ 0 };
+    DataHandler onData_;
+    EventHandler onClosed_;
+    EventHandler onTimer_;
+    bool closedNotified_ = false;
+    uint8_t rxBuf_[4096];
+};
+#endif
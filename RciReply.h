@@ -0,0 +1,133 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "RciDecoder.h"
+#include "RciCommands.h"
+
+//
+// View có kiểu trên body reply đã unescape (không copy).
+// Cùng vòng đời với RciFrameView: hợp lệ tới lần decode kế tiếp.
+//
+
+// Trạng thái jet (byte 3 của reply status); giá trị khác giữ nguyên dạng raw
+enum class RciJetState : uint8_t {
+    Running = 0x00,     // 00 = jet đang chạy
+    Starting = 0x01,    // 01 = đang khởi động jet
+    Stopping = 0x02,    // 02 = đang tắt jet
+    Stopped = 0x03,     // 03 = tắt jet
+};
+
+// Trạng thái in (byte 4 của reply status)
+enum class RciPrintState : uint8_t {
+    Idle = 0x00,        // 00 = không in
+    Paused = 0x02,      // 02 = tạm dừng
+    Printing = 0x04,    // 04 = đang in
+};
+
+//
+// ACK/NAK chung: [p_status, c_status, cmdid, payload...]
+//
+class RciAckView {
+public:
+    explicit RciAckView(const RciFrameView& frame) : f_(frame) {}
+
+    bool IsAck() const { return f_.type == RciFrame::ACK; }
+    bool IsNak() const { return f_.type == RciFrame::NAK; }
+    bool ChecksumOk() const { return f_.checksumOk; }
+
+    // Frame ACK/NAK đủ header và đúng checksum
+    bool Valid() const { return (IsAck() || IsNak()) && f_.checksumOk && f_.size >= kHeaderSize; }
+
+    // ACK hợp lệ cho đúng lệnh cmdid
+    bool IsAckFor(uint8_t cmdid) const { return Valid() && IsAck() && CommandId() == cmdid; }
+
+    uint8_t PStatus() const { return f_.body[0]; }     // printer status
+    uint8_t CStatus() const { return f_.body[1]; }     // command status
+    uint8_t CommandId() const { return f_.body[2]; }
+
+    // Dữ liệu riêng của từng lệnh (sau header)
+    const uint8_t* Payload() const { return f_.body + kHeaderSize; }
+    size_t PayloadSize() const { return f_.size > kHeaderSize ? f_.size - kHeaderSize : 0; }
+
+    const RciFrameView& Frame() const { return f_; }
+
+    static constexpr size_t kHeaderSize = 3;
+
+protected:
+    // Đọc big-endian trong payload
+    uint8_t U8(size_t off) const { return Payload()[off]; }
+    uint32_t U32BE(size_t off) const {
+        const uint8_t* p = Payload() + off;
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    RciFrameView f_;    // POD nhỏ, copy theo giá trị (body vẫn trỏ vào buffer gốc)
+};
+
+//
+// Reply lệnh STATUS 0x14: payload = [jet, print, errorMask (4 byte BE)]
+//
+class RciStatusView : public RciAckView {
+public:
+    explicit RciStatusView(const RciFrameView& frame) : RciAckView(frame) {}
+
+    bool Valid() const { return IsAckFor(RciCmd::Status) && PayloadSize() >= kPayloadSize; }
+
+    uint8_t JetStateRaw() const { return U8(0); }
+    uint8_t PrintStateRaw() const { return U8(1); }
+    RciJetState JetState() const { return (RciJetState)JetStateRaw(); }
+    RciPrintState PrintState() const { return (RciPrintState)PrintStateRaw(); }
+    uint32_t ErrorMask() const { return U32BE(2); }
+
+    bool JetOn() const { return JetState() != RciJetState::Stopped; }
+    bool Printing() const { return PrintState() == RciPrintState::Printing; }
+    bool Paused() const { return PrintState() == RciPrintState::Paused; }
+    bool HasError() const { return ErrorMask() != 0; }
+
+    static constexpr size_t kPayloadSize = 6;
+};
+
+//
+// Reply có sở hữu dữ liệu (dùng cho lệnh pipeline: future / callback sống lâu hơn decoder).
+// Body lưu inline, không cấp phát; reply dài hơn kMaxBody bị cắt (truncated = true).
+//
+struct RciResult {
+    enum class Status {
+        Ok,             // đã nhận reply
+        Timeout,        // quá hạn chờ reply
+        Disconnected,   // mất kết nối trước khi có reply
+        SendFailed,     // không gửi được lệnh
+        Cancelled,      // bị hủy qua RciCancelToken
+        Invalid,        // có reply nhưng sai định dạng / không đúng lệnh
+    };
+
+    static constexpr size_t kMaxBody = 64;
+
+    Status status = Status::Timeout;
+    uint8_t type = 0;
+    bool checksumOk = false;
+    bool truncated = false;
+    size_t size = 0;
+    uint8_t body[kMaxBody] = {};
+
+    bool Ok() const { return status == Status::Ok; }
+
+    void Assign(const RciFrameView& f) {
+        status = Status::Ok;
+        type = f.type;
+        checksumOk = f.checksumOk;
+        truncated = f.size > kMaxBody;
+        size = truncated ? kMaxBody : f.size;
+        for (size_t i = 0; i < size; ++i) body[i] = f.body[i];
+    }
+
+    // View để dùng chung RciAckView / RciStatusView
+    RciFrameView View() const {
+        RciFrameView v;
+        v.type = type;
+        v.body = body;
+        v.size = size;
+        v.checksumOk = checksumOk;
+        return v;
+    }
+};
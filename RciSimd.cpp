@@ -0,0 +1,275 @@
+﻿#include "RciSimd.h"
+#include "RciFrame.h"
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RCI_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RCI_TARGET_AVX2
+#else
+#define RCI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+    std::atomic<int> g_level{ -1 };
+
+#if RCI_SIMD_X86
+    // Đoạn ngắn hơn: dùng bản SSE2 kể cả ở mức AVX2 (setup + vzeroupper không bù được ở vài chục byte)
+    constexpr size_t kAvx2MinBytes = 128;
+#endif
+
+    inline unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanForward(&idx, mask);
+        return (unsigned)idx;
+#else
+        return (unsigned)__builtin_ctz(mask);
+#endif
+    }
+
+#if RCI_SIMD_X86
+    // ---------------- SSE2 ----------------
+    // byte điều khiển: 0x01..0x03 (b-1 <= 2 unsigned) hoặc 0x1B
+    inline int ControlMask16(__m128i v) {
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i two = _mm_set1_epi8(2);
+        const __m128i esc = _mm_set1_epi8((char)RciFrame::ESC);
+        __m128i x = _mm_sub_epi8(v, one);
+        __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(x, two), x);
+        __m128i e = _mm_cmpeq_epi8(v, esc);
+        return _mm_movemask_epi8(_mm_or_si128(low, e));
+    }
+
+    size_t FindControlSSE2(const uint8_t* p, size_t n) {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            int m = ControlMask16(v);
+            if (m) return i + CountTrailingZeros((uint32_t)m);
+        }
+        return i + RciSimd::FindControlScalar(p + i, n - i);
+    }
+
+    size_t FindEscSSE2(const uint8_t* p, size_t n) {
+        const __m128i esc = _mm_set1_epi8((char)RciFrame::ESC);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            int m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, esc));
+            if (m) return i + CountTrailingZeros((uint32_t)m);
+        }
+        return i + RciSimd::FindEscScalar(p + i, n - i);
+    }
+
+    uint32_t SumSSE2(const uint8_t* p, size_t n) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+        }
+        uint32_t sum = (uint32_t)_mm_cvtsi128_si32(acc) +
+            (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+        return sum + RciSimd::SumScalar(p + i, n - i);
+    }
+
+    // ---------------- AVX2 ----------------
+    // Phần đuôi < 32 byte chạy bản SSE2 (mã không VEX): phải _mm256_zeroupper trước, nếu không
+    // nửa trên YMM còn "bẩn" → mỗi lệnh SSE bị phạt chuyển trạng thái (chậm hơn cả scalar).
+    // Compiler không tự chèn vzeroupper trước mọi lời gọi.
+    RCI_TARGET_AVX2 size_t FindControlAVX2(const uint8_t* p, size_t n) {
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i two = _mm256_set1_epi8(2);
+        const __m256i esc = _mm256_set1_epi8((char)RciFrame::ESC);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            __m256i x = _mm256_sub_epi8(v, one);
+            __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(x, two), x);
+            __m256i e = _mm256_cmpeq_epi8(v, esc);
+            uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(low, e));
+            if (m) {
+                _mm256_zeroupper();
+                return i + CountTrailingZeros(m);
+            }
+        }
+        _mm256_zeroupper();
+        return i + FindControlSSE2(p + i, n - i);
+    }
+
+    RCI_TARGET_AVX2 size_t FindEscAVX2(const uint8_t* p, size_t n) {
+        const __m256i esc = _mm256_set1_epi8((char)RciFrame::ESC);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, esc));
+            if (m) {
+                _mm256_zeroupper();
+                return i + CountTrailingZeros(m);
+            }
+        }
+        _mm256_zeroupper();
+        return i + FindEscSSE2(p + i, n - i);
+    }
+
+    RCI_TARGET_AVX2 uint32_t SumAVX2(const uint8_t* p, size_t n) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(v, zero));
+        }
+        __m128i lo = _mm256_castsi256_si128(acc);
+        __m128i hi = _mm256_extracti128_si256(acc, 1);
+        __m128i s = _mm_add_epi64(lo, hi);
+        uint32_t sum = (uint32_t)_mm_cvtsi128_si32(s) +
+            (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+        _mm256_zeroupper();
+        return sum + SumSSE2(p + i, n - i);
+    }
+
+    bool CpuHasAVX2() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) return false;
+        // OS phải lưu trạng thái thanh ghi YMM
+        if ((_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }
+#endif // RCI_SIMD_X86
+
+} // namespace
+
+RciSimd::Level RciSimd::DetectLevel() {
+#if RCI_SIMD_X86
+    return CpuHasAVX2() ? Level::AVX2 : Level::SSE2;
+#else
+    return Level::Scalar;
+#endif
+}
+
+RciSimd::Level RciSimd::GetLevel() {
+    int lv = g_level.load(std::memory_order_relaxed);
+    if (lv < 0) {
+        lv = (int)DetectLevel();
+        g_level.store(lv, std::memory_order_relaxed);
+    }
+    return (Level)lv;
+}
+
+void RciSimd::SetLevel(Level level) {
+    Level maxLevel = DetectLevel();
+    if ((int)level > (int)maxLevel) level = maxLevel;
+    g_level.store((int)level, std::memory_order_relaxed);
+}
+
+// ================== Scalar ==================
+size_t RciSimd::FindControlScalar(const uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (RciFrame::IsControlByte(p[i])) return i;
+    return n;
+}
+
+size_t RciSimd::FindEscScalar(const uint8_t* p, size_t n) {
+    const void* hit = memchr(p, RciFrame::ESC, n);
+    return hit ? (size_t)((const uint8_t*)hit - p) : n;
+}
+
+uint32_t RciSimd::SumScalar(const uint8_t* p, size_t n) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += p[i];
+    return sum;
+}
+
+size_t RciSimd::EscapeScalar(const uint8_t* in, size_t n, uint8_t* out, unsigned int& sum) {
+    size_t o = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t b = in[i];
+        sum += b;
+        if (RciFrame::IsControlByte(b)) out[o++] = RciFrame::ESC;
+        out[o++] = b;
+    }
+    return o;
+}
+
+// ================== Dispatch ==================
+size_t RciSimd::FindControl(const uint8_t* p, size_t n) {
+#if RCI_SIMD_X86
+    switch (GetLevel()) {
+    case Level::AVX2:
+        if (n >= kAvx2MinBytes) return FindControlAVX2(p, n);
+        [[fallthrough]];
+    case Level::SSE2: return FindControlSSE2(p, n);
+    default: break;
+    }
+#endif
+    return FindControlScalar(p, n);
+}
+
+size_t RciSimd::FindEsc(const uint8_t* p, size_t n) {
+#if RCI_SIMD_X86
+    switch (GetLevel()) {
+    case Level::AVX2:
+        if (n >= kAvx2MinBytes) return FindEscAVX2(p, n);
+        [[fallthrough]];
+    case Level::SSE2: return FindEscSSE2(p, n);
+    default: break;
+    }
+#endif
+    return FindEscScalar(p, n);
+}
+
+uint32_t RciSimd::Sum(const uint8_t* p, size_t n) {
+#if RCI_SIMD_X86
+    switch (GetLevel()) {
+    case Level::AVX2:
+        if (n >= kAvx2MinBytes) return SumAVX2(p, n);
+        [[fallthrough]];
+    case Level::SSE2: return SumSSE2(p, n);
+    default: break;
+    }
+#endif
+    return SumScalar(p, n);
+}
+
+// Tìm đoạn sạch → memcpy cả đoạn, chỉ xử lý riêng byte điều khiển
+size_t RciSimd::Escape(const uint8_t* in, size_t n, uint8_t* out, unsigned int& sum) {
+    if (GetLevel() == Level::Scalar || n < kBulkThreshold)
+        return EscapeScalar(in, n, out, sum);
+
+    // checksum tính trên byte gốc → cộng 1 lần cho cả payload
+    sum += Sum(in, n);
+
+    size_t o = 0;
+    size_t i = 0;
+    while (i < n) {
+        size_t run = FindControl(in + i, n - i);
+        if (run) {
+            memcpy(out + o, in + i, run);
+            o += run;
+            i += run;
+        }
+        if (i < n) {
+            out[o++] = RciFrame::ESC;
+            out[o++] = in[i++];
+        }
+    }
+    return o;
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+
+//
+// Kernel SIMD cho escape/unescape payload RCI lớn (0x19 message data, 0x1D remote field).
+// Tìm byte điều khiển 16 (SSE2) / 32 (AVX2) byte mỗi lần, copy nguyên đoạn sạch.
+// Chọn đường chạy lúc runtime theo CPU, luôn có bản scalar làm fallback.
+//
+class RciSimd {
+public:
+    enum class Level {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // Mức đang dùng (tự phát hiện ở lần gọi đầu)
+    static Level GetLevel();
+    // Ép mức (so sánh / benchmark); mức vượt quá CPU hỗ trợ sẽ bị hạ xuống
+    static void SetLevel(Level level);
+    static Level DetectLevel();
+
+    // Vị trí byte ESC/STX/SOH/ETX đầu tiên, n nếu không có
+    static size_t FindControl(const uint8_t* p, size_t n);
+    // Vị trí byte ESC đầu tiên, n nếu không có
+    static size_t FindEsc(const uint8_t* p, size_t n);
+    // Tổng các byte (dùng cho checksum)
+    static uint32_t Sum(const uint8_t* p, size_t n);
+
+    // Escape n byte vào out (cần tối thiểu 2*n byte), cộng dồn tổng byte gốc vào sum.
+    // Trả về số byte đã ghi.
+    static size_t Escape(const uint8_t* in, size_t n, uint8_t* out, unsigned int& sum);
+
+    // Bản scalar tham chiếu
+    static size_t FindControlScalar(const uint8_t* p, size_t n);
+    static size_t FindEscScalar(const uint8_t* p, size_t n);
+    static uint32_t SumScalar(const uint8_t* p, size_t n);
+    static size_t EscapeScalar(const uint8_t* in, size_t n, uint8_t* out, unsigned int& sum);
+
+    // Dưới ngưỡng này dùng thẳng vòng lặp scalar (tránh overhead dispatch)
+    static constexpr size_t kBulkThreshold = 32;
+};
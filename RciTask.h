@@ -0,0 +1,200 @@
+﻿#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <map>
+
+//
+// Coroutine task C++20 cho chuỗi lệnh máy in.
+// Khởi động lười: chỉ chạy khi được co_await (hoặc RciSpawn), kết thúc thì chuyển thẳng
+// về coroutine đang chờ (symmetric transfer, không chồng stack).
+//
+template<typename T> class RciTask;
+
+namespace RciTaskDetail {
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            template<typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+                auto next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        RciTask<T> get_return_object();
+        template<typename U>
+        void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+
+        T Take() {
+            if (error) std::rethrow_exception(error);
+            return std::move(*value);
+        }
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        RciTask<void> get_return_object();
+        void return_void() {}
+
+        void Take() {
+            if (error) std::rethrow_exception(error);
+        }
+    };
+
+} // namespace RciTaskDetail
+
+template<typename T = void>
+class RciTask {
+public:
+    using promise_type = RciTaskDetail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    RciTask() = default;
+    explicit RciTask(Handle h) : h_(h) {}
+    RciTask(RciTask&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    RciTask& operator=(RciTask&& o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    RciTask(const RciTask&) = delete;
+    RciTask& operator=(const RciTask&) = delete;
+    ~RciTask() { if (h_) h_.destroy(); }
+
+    bool Valid() const { return (bool)h_; }
+
+    // co_await task: chạy task, quay lại coroutine gọi khi task xong
+    bool await_ready() const noexcept { return !h_ || h_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        h_.promise().continuation = caller;
+        return h_;
+    }
+    T await_resume() { return h_.promise().Take(); }
+
+private:
+    Handle h_;
+};
+
+namespace RciTaskDetail {
+    template<typename T>
+    RciTask<T> Promise<T>::get_return_object() {
+        return RciTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+    }
+    inline RciTask<void> Promise<void>::get_return_object() {
+        return RciTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+    }
+
+    // Coroutine chạy độc lập (tự hủy khi xong) để giữ task gốc sống tới lúc kết thúc
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept {}
+        };
+    };
+
+    inline Detached RunDetached(RciTask<void> task, std::function<void(std::exception_ptr)> onDone) {
+        std::exception_ptr error;
+        try {
+            co_await task;
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        if (onDone) onDone(error);
+    }
+} // namespace RciTaskDetail
+
+// =====================================================
+// Hủy hợp tác: RciCancelSource giữ ở nơi quản lý (vd. AppController),
+// RciCancelToken truyền vào từng lệnh await; Cancel() hoàn tất ngay mọi lệnh đang chờ.
+// =====================================================
+class RciCancelToken {
+public:
+    RciCancelToken() = default;
+
+    bool IsCancelled() const {
+        if (!state_) return false;
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        return state_->cancelled;
+    }
+
+    // Đăng ký callback khi bị hủy; đã hủy sẵn → gọi ngay, trả về 0
+    uint64_t Register(std::function<void()> fn) const {
+        if (!state_) return 0;
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            if (!state_->cancelled) {
+                uint64_t id = state_->nextId++;
+                state_->callbacks.emplace(id, std::move(fn));
+                return id;
+            }
+        }
+        fn();
+        return 0;
+    }
+
+    void Unregister(uint64_t id) const {
+        if (!state_ || id == 0) return;
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        state_->callbacks.erase(id);
+    }
+
+private:
+    friend class RciCancelSource;
+
+    struct State {
+        std::mutex mtx;
+        bool cancelled = false;
+        uint64_t nextId = 1;
+        std::map<uint64_t, std::function<void()>> callbacks;
+    };
+
+    explicit RciCancelToken(std::shared_ptr<State> s) : state_(std::move(s)) {}
+    std::shared_ptr<State> state_;
+};
+
+class RciCancelSource {
+public:
+    RciCancelSource() : state_(std::make_shared<RciCancelToken::State>()) {}
+
+    RciCancelToken Token() const { return RciCancelToken(state_); }
+
+    void Cancel() {
+        std::map<uint64_t, std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(state_->mtx);
+            if (state_->cancelled) return;
+            state_->cancelled = true;
+            callbacks.swap(state_->callbacks);
+        }
+        for (auto& kv : callbacks) kv.second();
+    }
+
+private:
+    std::shared_ptr<RciCancelToken::State> state_;
+};
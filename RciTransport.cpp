@@ -0,0 +1,19 @@
+#include "RciTransport.h"
+
+#ifdef _WIN32
+#include "RciWin32Transport.h"
+#elif defined(__linux__)
+#include "RciReactorTransport.h"
+#else
+#include "RciPosixTransport.h"
+#endif
+
+std::unique_ptr<IRciTransport> CreateDefaultRciTransport() {
+#ifdef _WIN32
+    return std::make_unique<RciWin32Transport>();
+#elif defined(__linux__)
+    return std::make_unique<RciReactorTransport>();
+#else
+    return std::make_unique<RciPosixTransport>();
+#endif
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+
+//
+// Lớp truyền byte bên dưới RciClient: kết nối / gửi / nhận có hạn chờ / đóng.
+// RciClient chỉ làm việc với interface này → cùng logic giao thức chạy được trên
+// Winsock, POSIX TCP hoặc cặp loopback trong bộ nhớ (không cần socket).
+//
+// Quy ước luồng:
+//   - Send: 1 luồng tại 1 thời điểm (RciClient giữ mtx_)
+//   - Receive: 1 luồng tại 1 thời điểm (caller giữ mtx_ hoặc reader thread)
+//   - Shutdown / IsOpen / Interrupt: gọi được từ mọi luồng, Shutdown đánh thức Receive đang chờ
+//   - Close: chỉ gọi khi không còn luồng nào trong Send / Receive
+//
+class IRciTransport {
+public:
+    enum class IoResult {
+        Ok,         // có dữ liệu
+        Timeout,    // hết hạn chờ, kết nối vẫn còn
+        Interrupted,// Interrupt() trong lúc chờ, kết nối vẫn còn
+        Closed,     // peer đóng / đã Shutdown
+        Error,      // lỗi socket
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~IRciTransport() = default;
+
+    // error: mô tả lỗi để ghi log khi trả về false
+    virtual bool Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) = 0;
+
+    // Gửi hết len byte (chặn tới khi xong hoặc lỗi)
+    virtual bool Send(const uint8_t* data, size_t len) = 0;
+
+    // Nhận tối đa cap byte, chờ tối đa tới deadline
+    virtual IoResult Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) = 0;
+
+    // Ngắt kết nối nhưng chưa giải phóng (đánh thức Receive)
+    virtual void Shutdown() = 0;
+    virtual void Close() = 0;
+    virtual bool IsOpen() const = 0;
+
+    // Mã lỗi hệ thống gần nhất (WSAGetLastError / errno)
+    virtual int LastError() const = 0;
+
+    // Đánh thức Receive đang chờ → trả về Interrupted. Gọi lúc không có Receive nào chờ thì
+    // lần Receive kế tiếp trả về Interrupted ngay (không mất tín hiệu, có thể thừa 1 lần).
+    // CanInterrupt() = false: Interrupt không làm gì, caller phải tự chờ theo lát ngắn.
+    virtual bool CanInterrupt() const { return false; }
+    virtual void Interrupt() {}
+
+    // -------------------------------------------------
+    // Chế độ đẩy (transport có reactor): transport tự nhận và gọi onData trên luồng I/O
+    // của nó thay cho Receive. Mặc định không hỗ trợ → RciClient dùng reader thread.
+    // -------------------------------------------------
+    using DataHandler = std::function<void(const uint8_t* data, size_t len)>;
+    using EventHandler = std::function<void()>;
+
+    virtual bool StartPush(DataHandler /*onData*/, EventHandler /*onClosed*/, EventHandler /*onTimer*/) { return false; }
+    // Sau khi trả về, không còn callback nào được gọi
+    virtual void StopPush() {}
+    // Hẹn gọi onTimer tại thời điểm when (thay lần hẹn trước)
+    virtual void ArmTimer(Clock::time_point /*when*/) {}
+};
+
+// Transport TCP mặc định của nền tảng (Winsock trên Windows, epoll reactor trên Linux, POSIX socket nơi khác)
+std::unique_ptr<IRciTransport> CreateDefaultRciTransport();
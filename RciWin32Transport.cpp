@@ -0,0 +1,258 @@
+﻿#include "RciWin32Transport.h"
+#ifdef _WIN32
+#include <sstream>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+static std::wstring WsaErrorToString(int err) {
+    wchar_t* msg = nullptr;
+    FormatMessageW(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+        NULL, err, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+        (LPWSTR)&msg, 0, NULL);
+    std::wstring out;
+    if (msg) {
+        out = msg;
+        LocalFree(msg);
+    }
+    else {
+        std::wstringstream ss; ss << L"WSA error " << err;
+        out = ss.str();
+    }
+    return out;
+}
+
+RciWin32Transport::RciWin32Transport() {
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+    readEvent_ = WSACreateEvent();
+    wakeEvent_ = CreateEventW(NULL, FALSE, FALSE, NULL);
+}
+
+RciWin32Transport::~RciWin32Transport() {
+    Close();
+    if (readEvent_ != WSA_INVALID_EVENT) WSACloseEvent(readEvent_);
+    if (wakeEvent_ != NULL) CloseHandle(wakeEvent_);
+    WSACleanup();
+}
+
+bool RciWin32Transport::Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) {
+    Close();
+
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET) {
+        error = L"❌ Không thể tạo socket";
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+
+    char ipUtf8[64] = {};
+    WideCharToMultiByte(CP_ACP, 0, host.c_str(), -1, ipUtf8, sizeof(ipUtf8), NULL, NULL);
+
+    if (inet_pton(AF_INET, ipUtf8, &addr.sin_addr) <= 0) {
+        error = L"❌ Địa chỉ IP không hợp lệ";
+        closesocket(s);
+        return false;
+    }
+
+    // Đặt non-blocking tạm thời để dùng select()
+    u_long mode = 1;
+    ioctlsocket(s, FIONBIO, &mode);
+
+    int res = connect(s, (sockaddr*)&addr, sizeof(addr));
+    if (res == SOCKET_ERROR) {
+        int err = WSAGetLastError();
+
+        // Cho phép WSAEWOULDBLOCK / WSAEINPROGRESS / WSAEALREADY
+        if (err != WSAEWOULDBLOCK && err != WSAEINPROGRESS && err != WSAEALREADY) {
+            std::wstringstream ss;
+            ss << L"❌ connect() thất bại, WSAError=" << err << L" (" << WsaErrorToString(err) << L")";
+            error = ss.str();
+            lastError_ = err;
+            closesocket(s);
+            return false;
+        }
+    }
+
+    // Chờ socket sẵn sàng ghi (kết nối thành công)
+    fd_set wset;
+    FD_ZERO(&wset);
+    FD_SET(s, &wset);
+
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+    res = select(0, NULL, &wset, NULL, &tv);
+    if (res <= 0 || !FD_ISSET(s, &wset)) {
+        error = L"⏰ Timeout kết nối";
+        lastError_ = res == 0 ? WSAETIMEDOUT : WSAGetLastError();
+        closesocket(s);
+        return false;
+    }
+
+    // Kiểm tra lỗi chậm bằng SO_ERROR
+    int so_err = 0;
+    int optlen = sizeof(so_err);
+    if (getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&so_err, &optlen) == 0) {
+        if (so_err != 0) {
+            std::wstringstream ss;
+            ss << L"❌ Kết nối thất bại (SO_ERROR=" << so_err << L")";
+            error = ss.str();
+            lastError_ = so_err;
+            closesocket(s);
+            return false;
+        }
+    }
+
+    // Giữ non-blocking: Receive chờ socket + wakeEvent_ bằng WSAWaitForMultipleEvents,
+    // Send chờ ghi được khi buffer gửi đầy. Không tạo được event → trả về blocking + select.
+    bool events = readEvent_ != WSA_INVALID_EVENT && wakeEvent_ != NULL;
+    if (events) {
+        WSAResetEvent(readEvent_);
+        ResetEvent(wakeEvent_);     // bỏ Interrupt / Shutdown của kết nối trước
+        events = WSAEventSelect(s, readEvent_, FD_READ | FD_CLOSE) != SOCKET_ERROR;
+    }
+    if (!events) {
+        mode = 0;
+        ioctlsocket(s, FIONBIO, &mode);
+    }
+
+    eventMode_ = events;
+
+    sock_ = s;
+    open_ = true;
+    return true;
+}
+
+bool RciWin32Transport::Send(const uint8_t* data, size_t len) {
+    if (!open_) return false;
+
+    while (len > 0) {
+        int sent = send(sock_, (const char*)data, (int)len, 0);
+        if (sent == SOCKET_ERROR) {
+            int err = WSAGetLastError();
+            if (err == WSAEWOULDBLOCK) {
+                // buffer gửi đầy (hiếm với frame RCI) → chờ ghi được
+                fd_set w;
+                FD_ZERO(&w);
+                FD_SET(sock_, &w);
+                timeval tv{ 1, 0 };
+                if (select(0, NULL, &w, NULL, &tv) > 0 && open_) continue;
+            }
+            lastError_ = err;
+            open_ = false;
+            return false;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return true;
+}
+
+IRciTransport::IoResult RciWin32Transport::Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) {
+    received = 0;
+    if (eventMode_) return ReceiveEvent(buf, cap, received, deadline);
+
+    while (true) {
+        if (!open_) return IoResult::Closed;
+
+        auto now = Clock::now();
+        if (now > deadline) return IoResult::Timeout;
+
+        // tối đa 100ms mỗi lần select: shutdown() không chắc đánh thức select trên Winsock
+        auto remainUs = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+        if (remainUs > 100000) remainUs = 100000;
+
+        fd_set r;
+        FD_ZERO(&r);
+        FD_SET(sock_, &r);
+        timeval tv{ 0, (long)remainUs };
+
+        int sel = select(0, &r, NULL, NULL, &tv);
+        if (sel == SOCKET_ERROR) {
+            lastError_ = WSAGetLastError();
+            open_ = false;
+            return IoResult::Error;
+        }
+        if (sel == 0) continue; // no data yet
+
+        int n = recv(sock_, (char*)buf, (int)cap, 0);
+        if (n == 0) {
+            open_ = false;
+            return IoResult::Closed;
+        }
+        if (n < 0) {
+            lastError_ = WSAGetLastError();
+            open_ = false;
+            return IoResult::Error;
+        }
+        received = (size_t)n;
+        return IoResult::Ok;
+    }
+}
+
+// recv thử trước (socket non-blocking); chưa có dữ liệu thì chờ FD_READ / FD_CLOSE hoặc wakeEvent_.
+// recv trả WSAEWOULDBLOCK bật lại FD_READ nên dữ liệu tới giữa recv và lúc chờ vẫn đánh thức.
+IRciTransport::IoResult RciWin32Transport::ReceiveEvent(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) {
+    while (true) {
+        if (!open_) return IoResult::Closed;
+
+        int n = recv(sock_, (char*)buf, (int)cap, 0);
+        if (n > 0) {
+            received = (size_t)n;
+            return IoResult::Ok;
+        }
+        if (n == 0) {
+            open_ = false;
+            return IoResult::Closed;
+        }
+        int err = WSAGetLastError();
+        if (err != WSAEWOULDBLOCK) {
+            lastError_ = err;
+            open_ = false;
+            return IoResult::Error;
+        }
+
+        auto now = Clock::now();
+        if (now > deadline) return IoResult::Timeout;
+        auto remainMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+        if (remainMs > 60000) remainMs = 60000;
+
+        WSAEVENT events[2] = { readEvent_, wakeEvent_ };
+        DWORD w = WSAWaitForMultipleEvents(2, events, FALSE, (DWORD)remainMs, FALSE);
+        if (w == WSA_WAIT_FAILED) {
+            lastError_ = WSAGetLastError();
+            open_ = false;
+            return IoResult::Error;
+        }
+        if (w == WSA_WAIT_EVENT_0 + 1)
+            return open_ ? IoResult::Interrupted : IoResult::Closed;
+        if (w == WSA_WAIT_EVENT_0)
+            WSAResetEvent(readEvent_);
+    }
+}
+
+void RciWin32Transport::Interrupt() {
+    if (wakeEvent_ != NULL) SetEvent(wakeEvent_);
+}
+
+void RciWin32Transport::Shutdown() {
+    open_ = false;
+    if (sock_ != INVALID_SOCKET)
+        shutdown(sock_, SD_BOTH);
+    Interrupt();    // shutdown() không chắc đánh thức lần chờ trên Winsock
+}
+
+void RciWin32Transport::Close() {
+    open_ = false;
+    if (sock_ != INVALID_SOCKET) {
+        shutdown(sock_, SD_BOTH);
+        closesocket(sock_);
+        sock_ = INVALID_SOCKET;
+    }
+}
+#endif
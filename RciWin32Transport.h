@@ -0,0 +1,37 @@
+﻿#pragma once
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <atomic>
+#include "RciTransport.h"
+
+//
+// Transport TCP qua Winsock (kết nối tới máy in Linx thật, cổng 9100)
+//
+class RciWin32Transport : public IRciTransport {
+public:
+    RciWin32Transport();
+    ~RciWin32Transport() override;
+
+    bool Connect(const std::wstring& host, unsigned short port, int timeoutMs, std::wstring& error) override;
+    bool Send(const uint8_t* data, size_t len) override;
+    IoResult Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline) override;
+    void Shutdown() override;
+    void Close() override;
+    bool IsOpen() const override { return open_; }
+    int LastError() const override { return lastError_; }
+    bool CanInterrupt() const override { return eventMode_; }
+    void Interrupt() override;
+
+private:
+    IoResult ReceiveEvent(uint8_t* buf, size_t cap, size_t& received, Clock::time_point deadline);
+
+    SOCKET sock_ = INVALID_SOCKET;
+    // Receive chờ cùng lúc socket (WSAEventSelect FD_READ | FD_CLOSE) và wakeEvent_ (Interrupt / Shutdown)
+    WSAEVENT readEvent_ = WSA_INVALID_EVENT;
+    HANDLE wakeEvent_ = NULL;       // auto-reset: 1 lần Set đánh thức đúng 1 lần chờ
+    std::atomic<bool> eventMode_{ false };  // socket đã gắn readEvent_ (non-blocking)
+    std::atomic<bool> open_{ false };
+    std::atomic<int> lastError_{ 0 };
+};
+#endif
@@ -1,44 +1,325 @@
-#pragma once
+﻿#pragma once
 #include "CommonTypes.h"
-#include <queue>
-#include <mutex>
-#include <condition_variable>
+#include "MpscQueue.h"
+#include "ThreadSafeQueue.h"
+#include <atomic>
+#include <chrono>
+#include <vector>
 
+//
+// Queue request từ UI, chia theo RequestPriority: Pop luôn lấy lớp ưu tiên cao nhất còn request,
+// trong cùng 1 lớp giữ thứ tự FIFO. Thời gian chờ trong queue được thống kê theo từng lớp.
+//
+// Mỗi lớp là 1 MpscQueue không khóa: Push (UI / mọi thread) không chờ worker, request được move
+// vào node dùng lại. Pop / PopUntil / DrainAll chỉ gọi từ 1 thread (worker).
+//
+// Mỗi lớp có giới hạn và tuổi tối đa (LanePolicy) để lúc mất kết nối lâu, click của UI và
+// request reconnect không dồn lại rồi chạy một loạt khi có kết nối:
+//   - Reject: lớp đầy → Push trả false
+//   - DropOldest: lớp đầy → request cũ nhất bị bỏ (worker bỏ ở lần Pop kế tiếp, nên trong lúc
+//     worker bận có thể vượt capacity một ít)
+//   - Block coi như Reject: Push gọi từ UI thread, không được chờ
+//   - request quá hạn (expiresAt, mặc định enqueuedAt + maxAge) bị bỏ, không tới HandleRequest
+//
+// Gộp request trùng (coalescing): request chưa chạy bị request cùng loại, cùng đích đến sau thay
+// thế (CoalesceKey): bấm Print 2 lần cùng message = 1 lần, Connect lại cùng IP / cổng chỉ 1 lần
+// chờ, SetCount cuối cùng thắng. Connect tới IP khác / in message khác là request khác.
+// Request nội bộ (RequestPrintJetStarting / RequestPrintStarted) báo từng bước của 1 chuỗi lệnh
+// nên không bao giờ bị gộp.
+//
+// Lệnh dừng hủy lệnh bắt đầu đã Push trước nó ở mọi lớp (luôn bật, kể cả khi tắt coalescing):
+// lớp Emergency được lấy trước nên nếu không hủy, StartPrint bấm trước StopJet sẽ chạy sau nó.
+//   - StopPrint hủy StartPrint; StopJet hủy StartJet và StartPrint (in cần jet)
+//   - Disconnect hủy Connect
+// Lệnh Stop vẫn được gửi vì máy in có thể đã đang in / bật jet từ trước.
+//
+// Push gán cho request 1 số thứ tự chung của cả queue (queueSeq). Mỗi loại có bảng nhỏ số mới
+// nhất theo đích (latest_, slot = hash đích) và mốc hủy (cancelBefore_): TryPop bỏ request không
+// mang số mới nhất của đích đó hoặc có số nhỏ hơn mốc hủy. 2 đích trùng slot thì slot giữ đích
+// đến sau, đích kia không còn được gộp (chỉ gộp ít đi, không bỏ nhầm).
+// Không cần khóa, không phải sửa node đã nằm trong queue.
+//
 class RequestQueue {
 public:
-    void Push(const Request& request) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        queue_.push(request);
-        condition_.notify_one();
+    struct LanePolicy {
+        size_t capacity = 0;                        // 0 = không giới hạn
+        QueueOverflow overflow = QueueOverflow::DropOldest;
+        std::chrono::milliseconds maxAge{ 0 };      // 0 = không hết hạn
+    };
+
+    struct LaneStats {
+        uint64_t popped = 0;        // số request đã lấy ra
+        uint64_t totalWaitUs = 0;   // tổng thời gian chờ trong queue
+        uint64_t maxWaitUs = 0;
+        size_t depth = 0;           // số request đang chờ
+        uint64_t dropped = 0;       // bị bỏ do DropOldest
+        uint64_t rejected = 0;      // bị từ chối do đầy
+        uint64_t expired = 0;       // quá hạn trước khi tới lượt
+        uint64_t coalesced = 0;     // bị request đến sau thay thế / hủy
+
+        double AvgWaitMs() const { return popped ? (double)totalWaitUs / (double)popped / 1000.0 : 0.0; }
+    };
+
+    RequestQueue() {
+        using namespace std::chrono_literals;
+        // dừng in / dừng jet: không hết hạn, lệnh trùng thì giữ lệnh mới nhất
+        SetLanePolicy(RequestPriority::Emergency, { 16, QueueOverflow::DropOldest, 0ms });
+        SetLanePolicy(RequestPriority::Control, { 32, QueueOverflow::DropOldest, 10s });
+        SetLanePolicy(RequestPriority::Status, { 8, QueueOverflow::DropOldest, 2s });
     }
 
-    bool Pop(Request& request, int timeoutMs = 100) {
-        std::unique_lock<std::mutex> lock(mutex_);
+    // Gọi trước khi có thread nào Push / Pop
+    void SetLanePolicy(RequestPriority priority, const LanePolicy& policy) {
+        lanes_[(size_t)priority].policy = policy;
+    }
+
+    // Gọi trước khi có thread nào Push / Pop (mặc định bật)
+    void SetCoalescing(bool enabled) { coalescing_ = enabled; }
+
+    // false khi lớp đầy (Reject) hoặc hết node
+    bool Push(Request request) {
+        Lane& lane = lanes_[(size_t)PriorityOf(request.type)];
+        const LanePolicy& policy = lane.policy;
 
-        if (queue_.empty()) {
-            condition_.wait_for(lock, std::chrono::milliseconds(timeoutMs));
-            if (queue_.empty()) {
+        request.queueSeq = pushSeq_.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint64_t key;
+        if (coalescing_ && CoalesceKey(request, key))
+            StoreLatest(latest_[(size_t)request.type][key % kCoalesceSlots], key, request.queueSeq);
+        CancelPending(request.type, request.queueSeq);
+
+        request.enqueuedAt = std::chrono::steady_clock::now();
+        if (request.expiresAt == std::chrono::steady_clock::time_point::max() && policy.maxAge.count() > 0)
+            request.expiresAt = request.enqueuedAt + policy.maxAge;
+
+        // đếm trước Push: HasPending thấy ngay
+        int64_t depth = lane.depth.fetch_add(1, std::memory_order_relaxed);
+        if (policy.capacity > 0 && depth >= (int64_t)policy.capacity) {
+            if (policy.overflow != QueueOverflow::DropOldest) {
+                lane.depth.fetch_sub(1, std::memory_order_relaxed);
+                lane.rejected.fetch_add(1, std::memory_order_relaxed);
                 return false;
             }
+            lane.trim.fetch_add(1, std::memory_order_relaxed);    // worker bỏ 1 request cũ nhất
+        }
+
+        if (!lane.queue.Push(std::move(request))) {
+            lane.depth.fetch_sub(1, std::memory_order_relaxed);
+            lane.rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        parker_.Notify();
+        return true;
+    }
+
+    bool Pop(Request& request, int timeoutMs = 100) {
+        return PopUntil(request, std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs));
+    }
 
-        request = queue_.front();
-        queue_.pop();
+    // Chờ tới khi có request, tới deadline hoặc bị Wake() (time_point::max() = không giới hạn).
+    // false = không lấy được request nào.
+    bool PopUntil(Request& request, std::chrono::steady_clock::time_point deadline) {
+        while (!TryPop(request)) {
+            if (woken_.exchange(false, std::memory_order_acquire))
+                return false;
+            bool ready = parker_.ParkUntil(deadline, [this] {
+                return woken_.load(std::memory_order_seq_cst) || !EmptyLanes();
+                });
+            if (!ready) {
+                woken_.store(false, std::memory_order_relaxed);
+                return TryPop(request);
+            }
+        }
         return true;
     }
 
+    // Lấy mọi request còn hạn theo thứ tự ưu tiên (nối vào out); trả về số request lấy được
+    size_t DrainAll(std::vector<Request>& out) {
+        size_t n = 0;
+        Request request;
+        while (TryPop(request)) {
+            out.push_back(std::move(request));
+            ++n;
+        }
+        return n;
+    }
+
+    // Đánh thức PopUntil đang chờ khi điều kiện ngoài queue thay đổi (dừng worker, bật reconnect...)
+    void Wake() {
+        woken_.store(true, std::memory_order_seq_cst);
+        parker_.Notify();
+    }
+
+    // Còn request của lớp priority đang chờ không
+    bool HasPending(RequestPriority priority) const {
+        return lanes_[(size_t)priority].depth.load(std::memory_order_relaxed) > 0;
+    }
+
+    LaneStats GetStats(RequestPriority priority) const {
+        const Lane& lane = lanes_[(size_t)priority];
+        LaneStats s;
+        s.popped = lane.popped.load(std::memory_order_relaxed);
+        s.totalWaitUs = lane.totalWaitUs.load(std::memory_order_relaxed);
+        s.maxWaitUs = lane.maxWaitUs.load(std::memory_order_relaxed);
+        s.dropped = lane.dropped.load(std::memory_order_relaxed);
+        s.rejected = lane.rejected.load(std::memory_order_relaxed);
+        s.expired = lane.expired.load(std::memory_order_relaxed);
+        s.coalesced = lane.coalesced.load(std::memory_order_relaxed);
+        int64_t depth = lane.depth.load(std::memory_order_relaxed);
+        s.depth = depth > 0 ? (size_t)depth : 0;
+        return s;
+    }
+
     bool Empty() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return queue_.empty();
+        return EmptyLanes();
     }
 
     size_t Size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return queue_.size();
+        size_t n = 0;
+        for (size_t i = 0; i < kRequestPriorityCount; ++i)
+            n += GetStats((RequestPriority)i).depth;
+        return n;
     }
 
+    // Số lần Push phải đánh thức worker đang ngủ
+    uint64_t Wakeups() const { return parker_.Wakeups(); }
+
 private:
-    mutable std::mutex mutex_;
-    std::queue<Request> queue_;
-    std::condition_variable condition_;
-};
\ No newline at end of file
+    struct Lane {
+        MpscQueue<Request> queue;
+        LanePolicy policy;
+        std::atomic<int64_t> depth{ 0 };
+        std::atomic<int64_t> trim{ 0 };         // số request cũ worker phải bỏ (DropOldest)
+        std::atomic<uint64_t> rejected{ 0 };
+        // chỉ worker ghi
+        std::atomic<uint64_t> popped{ 0 };
+        std::atomic<uint64_t> totalWaitUs{ 0 };
+        std::atomic<uint64_t> maxWaitUs{ 0 };
+        std::atomic<uint64_t> dropped{ 0 };
+        std::atomic<uint64_t> expired{ 0 };
+        std::atomic<uint64_t> coalesced{ 0 };
+    };
+
+    static constexpr size_t kRequestTypeCount = (size_t)RequestType::RequestPrintStarted + 1;
+
+    // Slot gộp request: [tag 24 bit = bit cao của key][queueSeq 40 bit]
+    static constexpr size_t kCoalesceSlots = 8;
+    static constexpr int kSeqBits = 40;
+    static constexpr uint64_t kSeqMask = (1ull << kSeqBits) - 1;
+
+    // Đích của request (FNV-1a): 2 request cùng loại chỉ thay thế nhau khi cùng key.
+    // false = không gộp (request nội bộ báo kết quả từng bước, cái nào cũng phải tới worker)
+    static bool CoalesceKey(const Request& request, uint64_t& key) {
+        uint64_t h = 1469598103934665603ull;
+        auto mix = [&h](uint64_t v) { h = (h ^ v) * 1099511628211ull; };
+        switch (request.type) {
+        case RequestType::RequestPrintJetStarting:
+        case RequestType::RequestPrintStarted:
+            return false;
+        case RequestType::RequestConnect:       // IP nằm ở data (ipAddress giữ cho tương thích)
+            for (wchar_t c : request.data) mix((uint64_t)c);
+            for (wchar_t c : request.ipAddress) mix((uint64_t)c);
+            mix((uint64_t)request.port);
+            break;
+        case RequestType::RequestStartPrint:
+            for (wchar_t c : request.data) mix((uint64_t)c);
+            mix((uint64_t)request.count);
+            break;
+        default:                                // 1 máy in, không có đích riêng: bản cuối cùng thắng
+            break;
+        }
+        key = h;
+        return true;
+    }
+
+    // Chỉ ghi đè khi seq mới hơn (Push 2 thread cùng lúc có thể tới không theo thứ tự số)
+    static void StoreLatest(std::atomic<uint64_t>& slot, uint64_t key, uint64_t seq) {
+        uint64_t packed = (key >> kSeqBits << kSeqBits) | (seq & kSeqMask);
+        uint64_t cur = slot.load(std::memory_order_relaxed);
+        while ((cur & kSeqMask) < (seq & kSeqMask) &&
+            !slot.compare_exchange_weak(cur, packed, std::memory_order_relaxed)) {}
+    }
+
+    // Push 2 thread cùng lúc có thể ghi không theo thứ tự số → chỉ tăng, không lùi
+    static void StoreMax(std::atomic<uint64_t>& slot, uint64_t seq) {
+        uint64_t cur = slot.load(std::memory_order_relaxed);
+        while (cur < seq && !slot.compare_exchange_weak(cur, seq, std::memory_order_relaxed)) {}
+    }
+
+    // Lệnh dừng số seq: mọi lệnh bắt đầu tương ứng Push trước nó trở thành vô nghĩa
+    void CancelPending(RequestType type, uint64_t seq) {
+        switch (type) {
+        case RequestType::RequestStopJet:
+            StoreMax(cancelBefore_[(size_t)RequestType::RequestStartJet], seq);
+            [[fallthrough]];
+        case RequestType::RequestStopPrint:
+            StoreMax(cancelBefore_[(size_t)RequestType::RequestStartPrint], seq);
+            break;
+        case RequestType::RequestDisconnect:
+            StoreMax(cancelBefore_[(size_t)RequestType::RequestConnect], seq);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Đã có request cùng loại, cùng đích đến sau, hoặc lệnh dừng Push sau nó → bỏ
+    bool Superseded(const Request& request) const {
+        size_t type = (size_t)request.type;
+        if (request.queueSeq < cancelBefore_[type].load(std::memory_order_relaxed)) return true;
+
+        uint64_t key;
+        if (!coalescing_ || !CoalesceKey(request, key)) return false;
+        uint64_t cur = latest_[type][key % kCoalesceSlots].load(std::memory_order_relaxed);
+        // slot đang giữ đích khác → không biết đích này có bản mới hơn không, giữ lại
+        return (cur >> kSeqBits) == (key >> kSeqBits) && (cur & kSeqMask) != (request.queueSeq & kSeqMask);
+    }
+
+    bool EmptyLanes() const {
+        for (const auto& lane : lanes_)
+            if (!lane.queue.Empty()) return false;
+        return true;
+    }
+
+    // Lấy request còn hạn đầu tiên của lớp cao nhất; bỏ dần request cũ (DropOldest), quá hạn và đã bị thay thế
+    bool TryPop(Request& request) {
+        auto now = std::chrono::steady_clock::now();
+        for (auto& lane : lanes_) {
+            while (lane.trim.load(std::memory_order_relaxed) > 0 && lane.queue.TryPop(request)) {
+                lane.trim.fetch_sub(1, std::memory_order_relaxed);
+                lane.depth.fetch_sub(1, std::memory_order_relaxed);
+                lane.dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            bool found = false;
+            while (lane.queue.TryPop(request)) {
+                lane.depth.fetch_sub(1, std::memory_order_relaxed);
+                if (request.expiresAt <= now)
+                    lane.expired.fetch_add(1, std::memory_order_relaxed);
+                else if (Superseded(request))
+                    lane.coalesced.fetch_add(1, std::memory_order_relaxed);
+                else {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) continue;
+
+            auto waitUs = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - request.enqueuedAt).count();
+            lane.popped.fetch_add(1, std::memory_order_relaxed);
+            lane.totalWaitUs.fetch_add(waitUs, std::memory_order_relaxed);
+            if (waitUs > lane.maxWaitUs.load(std::memory_order_relaxed))
+                lane.maxWaitUs.store(waitUs, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    Lane lanes_[kRequestPriorityCount];
+    MpscParker parker_;
+    std::atomic<bool> woken_{ false };
+    bool coalescing_ = true;
+    std::atomic<uint64_t> pushSeq_{ 0 };                        // queueSeq cuối cùng đã gán
+    std::atomic<uint64_t> latest_[kRequestTypeCount][kCoalesceSlots] = {};    // [tag | queueSeq] mới nhất theo (loại, đích)
+    std::atomic<uint64_t> cancelBefore_[kRequestTypeCount] = {};   // queueSeq < mốc này đã bị hủy
+};
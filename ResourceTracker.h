@@ -4,7 +4,7 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include "Logger.h"
+#include "LogFormat.h"
 
 class ResourceTracker {
 private:
@@ -18,44 +18,31 @@ public:
     template<typename T>
     void addCleanup(const std::string& taskName, T&& task) {
         cleanupTasks.emplace_back(taskName, std::forward<T>(task));
-        Logger::GetInstance().Write(L"[" + std::wstring(name_.begin(), name_.end()) +
-            L"] Added cleanup task: " +
-            std::wstring(taskName.begin(), taskName.end()));
+        LogDebug(LogModule::Resource, L"[{}] Added cleanup task: {}", name_, taskName);
     }
 
     // Cleanup tất cả resources
     void cleanupAll() {
-        Logger::GetInstance().Write(L"[" + std::wstring(name_.begin(), name_.end()) +
-            L"] Starting cleanup of " +
-            std::to_wstring(cleanupTasks.size()) + L" resources");
+        LogInfo(LogModule::Resource, L"[{}] Starting cleanup of {} resources", name_, cleanupTasks.size());
 
         for (auto it = cleanupTasks.rbegin(); it != cleanupTasks.rend(); ++it) {
             const auto& taskName = it->first;
             const auto& task = it->second;
 
             try {
-                Logger::GetInstance().Write(L"Cleaning up: " +
-                    std::wstring(taskName.begin(), taskName.end()));
+                LogInfo(LogModule::Resource, L"Cleaning up: {}", taskName);
                 task();
-                Logger::GetInstance().Write(L"✓ Success: " +
-                    std::wstring(taskName.begin(), taskName.end()));
+                LogInfo(LogModule::Resource, L"✓ Success: {}", taskName);
             }
             catch (const std::exception& e) {
-                std::string error = e.what();
-                Logger::GetInstance().Write(L"✗ Failed cleanup [" +
-                    std::wstring(taskName.begin(), taskName.end()) +
-                    L"]: " +
-                    std::wstring(error.begin(), error.end()), 2);
+                LogError(LogModule::Resource, L"✗ Failed cleanup [{}]: {}", taskName, e.what());
             }
             catch (...) {
-                Logger::GetInstance().Write(L"✗ Unknown error in cleanup [" +
-                    std::wstring(taskName.begin(), taskName.end()) +
-                    L"]", 2);
+                LogError(LogModule::Resource, L"✗ Unknown error in cleanup [{}]", taskName);
             }
         }
         cleanupTasks.clear();
-        Logger::GetInstance().Write(L"[" + std::wstring(name_.begin(), name_.end()) +
-            L"] Cleanup completed");
+        LogInfo(LogModule::Resource, L"[{}] Cleanup completed", name_);
     }
 
     // Manual cleanup của một task cụ thể
@@ -65,13 +52,11 @@ public:
                 try {
                     it->second();
                     cleanupTasks.erase(it);
-                    Logger::GetInstance().Write(L"✓ Manually cleaned: " +
-                        std::wstring(taskName.begin(), taskName.end()));
+                    LogInfo(LogModule::Resource, L"✓ Manually cleaned: {}", taskName);
                     return true;
                 }
                 catch (...) {
-                    Logger::GetInstance().Write(L"✗ Manual cleanup failed: " +
-                        std::wstring(taskName.begin(), taskName.end()), 2);
+                    LogError(LogModule::Resource, L"✗ Manual cleanup failed: {}", taskName);
                     return false;
                 }
             }
@@ -81,8 +66,7 @@ public:
 
     ~ResourceTracker() {
         if (!cleanupTasks.empty()) {
-            Logger::GetInstance().Write(L"[" + std::wstring(name_.begin(), name_.end()) +
-                L"] Auto-cleaning in destructor");
+            LogInfo(LogModule::Resource, L"[{}] Auto-cleaning in destructor", name_);
             cleanupAll();
         }
     }
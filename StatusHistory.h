@@ -0,0 +1,654 @@
+﻿#pragma once
+#include <cctype>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <system_error>
+#include "LogArchive.h"
+#include "ThreadSafeQueue.h"
+
+//
+// Lịch sử trạng thái máy in: mỗi lần poll STATUS (500 ms) ghi 1 mẫu, dùng để tra lỗi chập chờn
+// ("mask lỗi đổi những lúc nào trong 8 giờ qua", "hôm nay jet bật bao lâu").
+//
+// Khối đang ghi giữ mẫu thô; đủ blockSamples mẫu thì niêm phong, mã hóa theo từng cột:
+//   thời gian    delta-of-delta (ms) zigzag varint → poll đều đặn ~1 byte / mẫu
+//   các cột còn lại (jetState, printState, flags, errorMask, delta bộ đếm): run-length (giá trị, độ dài)
+// → 1 tuần mẫu 500 ms ≈ 1.2 MB. Khối niêm phong được giữ trong RAM tới hết memoryBytes; cũ hơn thì
+// chỉ còn header trong RAM, dữ liệu đọc lại từ file khi truy vấn.
+// Record chạy trên worker thread (sau mỗi lần poll) nên không đụng đĩa: khối niêm phong được đưa
+// cho writer thread riêng (như LogArchiver) ghi file, xóa file quá hạn; khối chưa ghi xong luôn
+// còn payload trong RAM nên truy vấn không phải chờ.
+//
+// File: <dir>/<máy in>.YYYYMMDD.sts (ngày địa phương của mẫu đầu khối)
+//   "LXTS" + version, rồi các khối [StatusBlockHeader][payload]
+// Header khối có tóm tắt (số lần mask đổi, thời gian jet bật) → truy vấn bỏ qua / cộng thẳng các
+// khối không cần giải mã. Thời gian = system_clock (ms từ epoch UTC).
+// Mẫu trong khối đang ghi (tối đa blockSamples) và khối chưa ghi xong mất nếu app crash;
+// Close() ghi nốt rồi mới trả về.
+//
+
+struct StatusSample {
+    int64_t timeMs = 0;
+    uint32_t errorMask = 0;
+    int32_t count = 0;              // bộ đếm in (PrinterModel)
+    uint8_t jetState = 0;
+    uint8_t printState = 0;
+    uint8_t flags = 0;              // StatusFlag*
+};
+
+enum StatusFlag : uint8_t {
+    StatusFlagJetOn = 1,
+    StatusFlagPrinting = 2,
+    StatusFlagPaused = 4,
+};
+
+struct StatusTransition {
+    int64_t timeMs;
+    uint32_t oldMask;
+    uint32_t newMask;
+};
+
+struct StatusHistoryOptions {
+    std::filesystem::path dir = "status_history";
+    int keepDays = 30;                      // xóa file cũ hơn
+    size_t memoryBytes = 2 * 1024 * 1024;   // payload khối niêm phong giữ trong RAM
+    uint32_t blockSamples = 3600;           // 30 phút ở 500 ms
+    int64_t maxGapMs = 2000;                // 2 mẫu cách hơn → coi như không có dữ liệu (mất kết nối)
+};
+
+#pragma pack(push, 1)
+struct StatusBlockHeader {
+    char magic[4];              // "LXTB"
+    uint32_t payloadBytes;
+    uint32_t count;
+    uint32_t maskChanges;       // số lần errorMask đổi trong khối
+    int64_t firstTimeMs;
+    int64_t lastTimeMs;
+    int64_t jetOnMs;            // tổng khoảng giữa 2 mẫu liên tiếp trong khối mà mẫu trước có jet bật
+    uint32_t firstMask;
+    uint32_t lastMask;
+    uint8_t lastFlags;
+    uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+class StatusHistory {
+public:
+    StatusHistory() = default;
+    StatusHistory(const StatusHistory&) = delete;
+    StatusHistory& operator=(const StatusHistory&) = delete;
+    ~StatusHistory() { Close(); }
+
+    static int64_t NowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // 0 giờ (giờ địa phương) của ngày chứa timeMs
+    static int64_t LocalDayStartMs(int64_t timeMs) {
+        std::tm local = LocalTime(timeMs);
+        local.tm_hour = local.tm_min = local.tm_sec = 0;
+        local.tm_isdst = -1;
+        return (int64_t)std::mktime(&local) * 1000;
+    }
+
+    // Mở lịch sử của 1 máy in (vd. IP): nạp index các khối trên đĩa, xóa file quá hạn
+    bool Open(const std::wstring& printer, const StatusHistoryOptions& options = {}) {
+        Close();
+        std::lock_guard<std::mutex> lock(mtx_);
+        options_ = options;
+        if (options_.blockSamples == 0) options_.blockSamples = 1;
+        prefix_.clear();
+        for (wchar_t c : printer)
+            prefix_ += (c < 128 && std::isalnum((int)c)) ? (char)c : '_';
+        if (prefix_.empty()) prefix_ = "printer";
+
+        std::error_code ec;
+        std::filesystem::create_directories(options_.dir, ec);
+        RemoveExpiredFiles(NowMs());
+        LoadIndexLocked();
+        active_.reserve(options_.blockSamples);
+        open_ = true;
+        stop_.store(false, std::memory_order_relaxed);
+        writer_ = std::thread([this] { Run(); });
+        return !ec;
+    }
+
+    // Ghi khối đang dở + các khối writer chưa ghi xuống đĩa rồi đóng file
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            if (!open_) return;
+            SealLocked();
+            open_ = false;
+        }
+        // writer cần mtx_ để cập nhật index khối → join ngoài khóa; job rỗng để writer dậy ngay
+        stop_.store(true, std::memory_order_relaxed);
+        writes_.Push(WriteJob{});
+        if (writer_.joinable()) writer_.join();
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        blocks_.clear();
+        files_.clear();
+        active_.clear();
+        memoryUsed_ = 0;
+    }
+
+    bool IsOpen() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return open_;
+    }
+
+    // Thêm 1 mẫu (worker thread, sau mỗi lần poll); thời gian phải không giảm
+    void Record(const StatusSample& sample) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!open_) return;
+        StatusSample s = sample;
+        if (!active_.empty() && s.timeMs < active_.back().timeMs) s.timeMs = active_.back().timeMs;
+        else if (active_.empty() && !blocks_.empty() && s.timeMs < blocks_.back().header.lastTimeMs)
+            s.timeMs = blocks_.back().header.lastTimeMs;
+        active_.push_back(s);
+        if (active_.size() >= options_.blockSamples) SealLocked();
+    }
+
+    // Mẫu trong [fromMs, toMs], theo thời gian
+    std::vector<StatusSample> Samples(int64_t fromMs, int64_t toMs) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<StatusSample> out;
+        Reader reader;
+        std::vector<StatusSample> decoded;
+        auto take = [&](const std::vector<StatusSample>& samples) {
+            for (const auto& s : samples)
+                if (s.timeMs >= fromMs && s.timeMs <= toMs) out.push_back(s);
+        };
+        for (size_t i = FirstBlockLocked(fromMs); i < blocks_.size() && blocks_[i].header.firstTimeMs <= toMs; ++i) {
+            if (LoadLocked(i, reader, decoded)) take(decoded);
+        }
+        take(active_);
+        return out;
+    }
+
+    // Các lần errorMask đổi trong (fromMs, toMs]; khối không đổi mask chỉ cần header
+    std::vector<StatusTransition> ErrorTransitions(int64_t fromMs, int64_t toMs) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::vector<StatusTransition> out;
+        bool havePrev = false;
+        uint32_t prev = 0;
+        auto step = [&](const StatusSample& s) {
+            if (s.timeMs > toMs) return;
+            if (havePrev && s.errorMask != prev && s.timeMs > fromMs) out.push_back({ s.timeMs, prev, s.errorMask });
+            prev = s.errorMask;
+            havePrev = true;
+        };
+
+        Reader reader;
+        std::vector<StatusSample> decoded;
+        size_t first = FirstBlockLocked(fromMs);
+        if (first > 0) {
+            prev = blocks_[first - 1].header.lastMask;
+            havePrev = true;
+        }
+        for (size_t i = first; i < blocks_.size() && blocks_[i].header.firstTimeMs <= toMs; ++i) {
+            const auto& h = blocks_[i].header;
+            if (h.maskChanges == 0) {
+                step(StatusSample{ h.firstTimeMs, h.firstMask });
+                prev = h.lastMask;
+                continue;
+            }
+            if (LoadLocked(i, reader, decoded))
+                for (const auto& s : decoded) step(s);
+        }
+        for (const auto& s : active_) step(s);
+        return out;
+    }
+
+    // Thời gian jet bật trong [fromMs, toMs] (khoảng giữa 2 mẫu > maxGapMs không tính)
+    int64_t JetOnMs(int64_t fromMs, int64_t toMs) const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        int64_t total = 0;
+        bool havePrev = false;
+        StatusSample prev;
+        auto interval = [&](const StatusSample& a, int64_t bTime) {
+            if (!(a.flags & StatusFlagJetOn) || bTime - a.timeMs > options_.maxGapMs) return;
+            int64_t lo = std::max(a.timeMs, fromMs);
+            int64_t hi = std::min(bTime, toMs);
+            if (hi > lo) total += hi - lo;
+        };
+        auto step = [&](const StatusSample& s) {
+            if (havePrev) interval(prev, s.timeMs);
+            prev = s;
+            havePrev = true;
+        };
+
+        Reader reader;
+        std::vector<StatusSample> decoded;
+        size_t first = FirstBlockLocked(fromMs);
+        if (first > 0) {
+            const auto& h = blocks_[first - 1].header;
+            prev.timeMs = h.lastTimeMs;
+            prev.flags = h.lastFlags;
+            havePrev = true;
+        }
+        for (size_t i = first; i < blocks_.size() && blocks_[i].header.firstTimeMs <= toMs; ++i) {
+            const auto& h = blocks_[i].header;
+            if (h.firstTimeMs >= fromMs && h.lastTimeMs <= toMs) {
+                // khối nằm trọn trong khoảng: cộng tóm tắt, chỉ tính riêng khoảng nối với khối trước
+                if (havePrev) interval(prev, h.firstTimeMs);
+                total += h.jetOnMs;
+                prev.timeMs = h.lastTimeMs;
+                prev.flags = h.lastFlags;
+                havePrev = true;
+                continue;
+            }
+            if (LoadLocked(i, reader, decoded))
+                for (const auto& s : decoded) step(s);
+        }
+        for (const auto& s : active_) step(s);
+        return total;
+    }
+
+    struct Stats {
+        uint64_t samples = 0;
+        size_t blocks = 0;
+        size_t blocksInMemory = 0;
+        size_t memoryBytes = 0;         // payload khối niêm phong + khối đang ghi
+        uint64_t diskBytes = 0;
+        uint64_t writeErrors = 0;
+    };
+
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        Stats st;
+        st.blocks = blocks_.size();
+        for (const auto& b : blocks_) {
+            st.samples += b.header.count;
+            if (!b.payload.empty()) ++st.blocksInMemory;
+            st.diskBytes += sizeof(StatusBlockHeader) + b.header.payloadBytes;
+        }
+        st.samples += active_.size();
+        st.memoryBytes = memoryUsed_ + active_.capacity() * sizeof(StatusSample);
+        st.writeErrors = writeErrors_;
+        return st;
+    }
+
+    // Mã hóa / giải mã 1 khối (dùng chung cho tool đọc file .sts)
+    static StatusBlockHeader Encode(const std::vector<StatusSample>& samples, int64_t maxGapMs, std::vector<uint8_t>& payload) {
+        StatusBlockHeader h{};
+        std::memcpy(h.magic, "LXTB", 4);
+        payload.clear();
+        h.count = (uint32_t)samples.size();
+        if (samples.empty()) return h;
+        h.firstTimeMs = samples.front().timeMs;
+        h.lastTimeMs = samples.back().timeMs;
+        h.firstMask = samples.front().errorMask;
+        h.lastMask = samples.back().errorMask;
+        h.lastFlags = samples.back().flags;
+        for (size_t i = 1; i < samples.size(); ++i) {
+            const auto& a = samples[i - 1];
+            if (samples[i].errorMask != a.errorMask) ++h.maskChanges;
+            if ((a.flags & StatusFlagJetOn) && samples[i].timeMs - a.timeMs <= maxGapMs) h.jetOnMs += samples[i].timeMs - a.timeMs;
+        }
+
+        int64_t prevDelta = 0;
+        for (size_t i = 1; i < samples.size(); ++i) {
+            int64_t delta = samples[i].timeMs - samples[i - 1].timeMs;
+            PutVarint(payload, Zigzag(delta - prevDelta));
+            prevDelta = delta;
+        }
+        PutRuns(payload, samples, [](const StatusSample& s, const StatusSample*) { return (uint64_t)s.jetState; });
+        PutRuns(payload, samples, [](const StatusSample& s, const StatusSample*) { return (uint64_t)s.printState; });
+        PutRuns(payload, samples, [](const StatusSample& s, const StatusSample*) { return (uint64_t)s.flags; });
+        PutRuns(payload, samples, [](const StatusSample& s, const StatusSample*) { return (uint64_t)s.errorMask; });
+        PutRuns(payload, samples, [](const StatusSample& s, const StatusSample* prev) {
+            return Zigzag((int64_t)s.count - (prev ? prev->count : 0));
+            });
+        h.payloadBytes = (uint32_t)payload.size();
+        return h;
+    }
+
+    static bool Decode(const StatusBlockHeader& h, const uint8_t* p, size_t n, std::vector<StatusSample>& out) {
+        out.assign(h.count, StatusSample{});
+        if (h.count == 0) return true;
+        size_t at = 0;
+        int64_t time = h.firstTimeMs;
+        int64_t delta = 0;
+        out[0].timeMs = time;
+        for (uint32_t i = 1; i < h.count; ++i) {
+            uint64_t v;
+            if (!GetVarint(p, n, at, v)) return false;
+            delta += Unzigzag(v);
+            time += delta;
+            out[i].timeMs = time;
+        }
+        int64_t count = 0;
+        return GetRuns(p, n, at, out, [](StatusSample& s, uint64_t v) { s.jetState = (uint8_t)v; }) &&
+            GetRuns(p, n, at, out, [](StatusSample& s, uint64_t v) { s.printState = (uint8_t)v; }) &&
+            GetRuns(p, n, at, out, [](StatusSample& s, uint64_t v) { s.flags = (uint8_t)v; }) &&
+            GetRuns(p, n, at, out, [](StatusSample& s, uint64_t v) { s.errorMask = (uint32_t)v; }) &&
+            GetRuns(p, n, at, out, [&count](StatusSample& s, uint64_t v) {
+                count += Unzigzag(v);
+                s.count = (int32_t)count;
+                }) &&
+            at == n;
+    }
+
+private:
+    // Block::file: chỉ số trong files_, hoặc
+    static constexpr size_t kNoFile = SIZE_MAX;             // ghi lỗi: khối chỉ còn trong RAM
+    static constexpr size_t kPendingFile = SIZE_MAX - 1;    // writer chưa ghi xong
+
+    struct Block {
+        StatusBlockHeader header;
+        size_t file;                    // chỉ số trong files_ / kNoFile / kPendingFile
+        uint64_t offset;                // vị trí payload trong file
+        std::vector<uint8_t> payload;   // rỗng: đã bỏ khỏi RAM, đọc lại từ file
+        uint64_t id = 0;                // số thứ tự niêm phong, writer tìm lại khối bằng số này
+    };
+
+    // Khối niêm phong chờ writer ghi (bản sao payload: khối trong blocks_ vẫn phục vụ truy vấn)
+    struct WriteJob {
+        uint64_t id = 0;                // 0: chỉ đánh thức writer (Close)
+        StatusBlockHeader header{};
+        std::vector<uint8_t> payload;
+    };
+
+    // file đang mở để đọc trong 1 lần truy vấn
+    struct Reader {
+        size_t file = SIZE_MAX;
+        std::FILE* f = nullptr;
+        std::vector<uint8_t> buffer;
+        ~Reader() { if (f) std::fclose(f); }
+    };
+
+    static constexpr char kFileMagic[4] = { 'L', 'X', 'T', 'S' };
+    static constexpr uint32_t kFileVersion = 1;
+
+    static std::tm LocalTime(int64_t timeMs) {
+        std::time_t seconds = (std::time_t)(timeMs / 1000);
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+        return local;
+    }
+
+    static uint64_t Zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+    static int64_t Unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+    static void PutVarint(std::vector<uint8_t>& out, uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((uint8_t)v);
+    }
+
+    static bool GetVarint(const uint8_t* p, size_t n, size_t& at, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (at >= n) return false;
+            uint8_t b = p[at++];
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // (giá trị, độ dài) cho mỗi đoạn giá trị lặp
+    template <typename Value>
+    static void PutRuns(std::vector<uint8_t>& out, const std::vector<StatusSample>& samples, Value value) {
+        uint64_t current = value(samples[0], nullptr);
+        uint64_t run = 1;
+        for (size_t i = 1; i < samples.size(); ++i) {
+            uint64_t v = value(samples[i], &samples[i - 1]);
+            if (v == current) {
+                ++run;
+                continue;
+            }
+            PutVarint(out, current);
+            PutVarint(out, run);
+            current = v;
+            run = 1;
+        }
+        PutVarint(out, current);
+        PutVarint(out, run);
+    }
+
+    template <typename Assign>
+    static bool GetRuns(const uint8_t* p, size_t n, size_t& at, std::vector<StatusSample>& out, Assign assign) {
+        size_t i = 0;
+        while (i < out.size()) {
+            uint64_t v, run;
+            if (!GetVarint(p, n, at, v) || !GetVarint(p, n, at, run)) return false;
+            if (run == 0 || run > out.size() - i) return false;
+            for (uint64_t k = 0; k < run; ++k) assign(out[i++], v);
+        }
+        return true;
+    }
+
+    std::filesystem::path DayFile(int64_t timeMs) const {
+        std::tm local = LocalTime(timeMs);
+        char day[16];
+        std::snprintf(day, sizeof(day), ".%04d%02d%02d.sts", local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+        return options_.dir / (prefix_ + day);
+    }
+
+    // File của máy in này, cũ → mới (tên chứa ngày)
+    std::vector<std::filesystem::path> ListFilesLocked() const {
+        namespace fs = std::filesystem;
+        std::vector<fs::path> files;
+        std::error_code ec;
+        std::string start = prefix_ + ".";
+        for (fs::directory_iterator it(options_.dir, ec), end; !ec && it != end; it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (name.size() == start.size() + 12 && name.compare(0, start.size(), start) == 0 &&
+                it->path().extension() == ".sts")
+                files.push_back(it->path());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    // Xóa file quá hạn, trả về các file đã xóa. Không cần mtx_: options_ / prefix_ chỉ đổi
+    // trong Open, lúc writer chưa chạy.
+    std::vector<std::filesystem::path> RemoveExpiredFiles(int64_t nowMs) const {
+        std::vector<std::filesystem::path> removed;
+        if (options_.keepDays <= 0) return removed;
+        std::string oldest = DayFile(LocalDayStartMs(nowMs) - (int64_t)options_.keepDays * 24 * 3600 * 1000).filename().string();
+        std::error_code ec;
+        for (const auto& file : ListFilesLocked()) {
+            if (file.filename().string() >= oldest) break;
+            if (std::filesystem::remove(file, ec)) removed.push_back(file);
+        }
+        return removed;
+    }
+
+    // Bỏ index của file đã xóa (khối luôn theo thứ tự file)
+    void DropRemovedLocked(const std::vector<std::filesystem::path>& removed) {
+        size_t keep = 0;
+        while (keep < blocks_.size() && blocks_[keep].file < kPendingFile &&
+            std::find(removed.begin(), removed.end(), files_[blocks_[keep].file]) != removed.end()) ++keep;
+        for (size_t i = 0; i < keep; ++i) memoryUsed_ -= blocks_[i].payload.size();
+        blocks_.erase(blocks_.begin(), blocks_.begin() + keep);
+    }
+
+    // Đọc header các khối; phần cuối hỏng (app tắt giữa lúc ghi) bị cắt bỏ để ghi tiếp được
+    void LoadIndexLocked() {
+        blocks_.clear();
+        files_.clear();
+        memoryUsed_ = 0;
+        for (const auto& path : ListFilesLocked()) {
+            std::FILE* f = LogOpenFile(path, "rb");
+            if (!f) continue;
+            size_t file = files_.size();
+            files_.push_back(path);
+            char magic[4];
+            uint32_t version = 0;
+            uint64_t valid = 0;
+            if (std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, kFileMagic, 4) == 0 &&
+                std::fread(&version, sizeof(version), 1, f) == 1 && version == kFileVersion) {
+                valid = 8;
+                StatusBlockHeader h;
+                while (std::fread(&h, sizeof(h), 1, f) == 1 && std::memcmp(h.magic, "LXTB", 4) == 0) {
+                    uint64_t offset = valid + sizeof(h);
+                    if (LogSeek(f, (int64_t)(offset + h.payloadBytes)) != 0) break;
+                    // fseek qua cuối file không lỗi → kiểm tra bằng kích thước
+                    std::error_code ec;
+                    if (offset + h.payloadBytes > std::filesystem::file_size(path, ec)) break;
+                    blocks_.push_back(Block{ h, file, offset, {} });
+                    valid = offset + h.payloadBytes;
+                }
+            }
+            std::fclose(f);
+            std::error_code ec;
+            if (valid == 0) std::filesystem::remove(path, ec);
+            else if (valid < std::filesystem::file_size(path, ec)) std::filesystem::resize_file(path, valid, ec);
+        }
+    }
+
+    // Mã hóa khối đang ghi, giữ trong RAM và đưa writer ghi xuống đĩa (worker thread: không I/O)
+    void SealLocked() {
+        if (active_.empty()) return;
+        WriteJob job;
+        job.id = ++sealed_;
+        job.header = Encode(active_, options_.maxGapMs, job.payload);
+        active_.clear();
+
+        Block block{ job.header, kPendingFile, 0, job.payload, job.id };
+        memoryUsed_ += block.payload.size();
+        blocks_.push_back(std::move(block));
+        writes_.Push(std::move(job));
+    }
+
+    // Writer thread: ghi khối theo thứ tự niêm phong; khi dừng thì ghi nốt khối còn trong queue
+    void Run() {
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
+        WriteJob job;
+        std::filesystem::path outPath;
+        while (!stop_.load(std::memory_order_relaxed)) {
+            if (writes_.WaitPop(job, 200)) Write(job, outPath);
+        }
+        while (writes_.Pop(job)) Write(job, outPath);
+        if (out_) std::fclose(out_);
+        out_ = nullptr;
+    }
+
+    void Write(const WriteJob& job, std::filesystem::path& outPath) {
+        if (job.id == 0) return;
+        namespace fs = std::filesystem;
+        const StatusBlockHeader& h = job.header;
+        fs::path path = DayFile(h.firstTimeMs);
+        std::vector<fs::path> removed;
+        if (path != outPath || !out_) {
+            if (out_) std::fclose(out_);
+            std::error_code ec;
+            bool fresh = !fs::exists(path, ec) || fs::file_size(path, ec) == 0;
+            out_ = LogOpenFile(path, "ab");
+            if (out_ && fresh) {
+                std::fwrite(kFileMagic, 1, 4, out_);
+                std::fwrite(&kFileVersion, sizeof(kFileVersion), 1, out_);
+            }
+            if (path != outPath) removed = RemoveExpiredFiles(h.firstTimeMs);
+            outPath = path;
+        }
+
+        uint64_t offset = 0;
+        bool ok = out_ != nullptr;
+        if (ok) {
+            std::fseek(out_, 0, SEEK_END);
+            offset = (uint64_t)std::ftell(out_) + sizeof(h);
+            ok = std::fwrite(&h, sizeof(h), 1, out_) == 1 &&
+                std::fwrite(job.payload.data(), 1, job.payload.size(), out_) == job.payload.size() &&
+                std::fflush(out_) == 0;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (files_.empty() || files_.back() != path) files_.push_back(path);
+        DropRemovedLocked(removed);
+        auto it = std::lower_bound(blocks_.begin(), blocks_.end(), job.id,
+            [](const Block& b, uint64_t id) { return b.id < id; });
+        if (it != blocks_.end() && it->id == job.id) {
+            if (ok) {
+                it->file = files_.size() - 1;
+                it->offset = offset;
+            }
+            else {
+                // không ghi được: khối chỉ còn trong RAM
+                ++writeErrors_;
+                it->file = kNoFile;
+            }
+        }
+        TrimMemoryLocked();
+    }
+
+    // Vượt ngân sách RAM → bỏ payload khối cũ nhất (vẫn còn trên đĩa; khối ghi lỗi thì mất hẳn,
+    // khối writer chưa ghi thì giữ)
+    void TrimMemoryLocked() {
+        for (size_t i = 0; i < blocks_.size() && memoryUsed_ > options_.memoryBytes; ) {
+            Block& b = blocks_[i];
+            if (b.file == kPendingFile || b.payload.empty()) {
+                ++i;
+                continue;
+            }
+            memoryUsed_ -= b.payload.size();
+            if (b.file == kNoFile) {
+                blocks_.erase(blocks_.begin() + (ptrdiff_t)i);
+                continue;
+            }
+            std::vector<uint8_t>().swap(b.payload);
+            ++i;
+        }
+    }
+
+    // Khối đầu tiên có thể chứa mẫu >= fromMs
+    size_t FirstBlockLocked(int64_t fromMs) const {
+        return (size_t)(std::lower_bound(blocks_.begin(), blocks_.end(), fromMs,
+            [](const Block& b, int64_t t) { return b.header.lastTimeMs < t; }) - blocks_.begin());
+    }
+
+    bool LoadLocked(size_t index, Reader& reader, std::vector<StatusSample>& out) const {
+        const Block& b = blocks_[index];
+        if (!b.payload.empty() || b.header.payloadBytes == 0)
+            return Decode(b.header, b.payload.data(), b.payload.size(), out);
+        if (b.file >= kPendingFile) return false;
+        if (reader.file != b.file) {
+            if (reader.f) std::fclose(reader.f);
+            reader.f = LogOpenFile(files_[b.file], "rb");
+            reader.file = b.file;
+        }
+        if (!reader.f || LogSeek(reader.f, (int64_t)b.offset) != 0) return false;
+        reader.buffer.resize(b.header.payloadBytes);
+        if (std::fread(reader.buffer.data(), 1, reader.buffer.size(), reader.f) != reader.buffer.size()) return false;
+        return Decode(b.header, reader.buffer.data(), reader.buffer.size(), out);
+    }
+
+    mutable std::mutex mtx_;
+    StatusHistoryOptions options_;
+    std::string prefix_;
+    bool open_ = false;
+    std::vector<StatusSample> active_;
+    std::vector<Block> blocks_;                     // theo thời gian
+    std::vector<std::filesystem::path> files_;
+    size_t memoryUsed_ = 0;
+    uint64_t writeErrors_ = 0;
+    uint64_t sealed_ = 0;
+    ThreadSafeQueue<WriteJob, QueueConsumers::Single> writes_;    // chỉ writer_ lấy ra
+    std::thread writer_;
+    std::atomic<bool> stop_{ false };
+    std::FILE* out_ = nullptr;                      // chỉ writer_ dùng
+};
@@ -1,38 +1,94 @@
-#pragma once
-#include <queue>
+﻿#pragma once
+#include <deque>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <algorithm>
-template<typename T>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include "MpscQueue.h"
+
+// Xử lý khi queue có giới hạn đã đầy
+enum class QueueOverflow {
+    Block,          // Push chờ tới khi có chỗ (TryPush trả false ngay)
+    Reject,         // bỏ phần tử mới, Push trả false
+    DropOldest,     // bỏ phần tử cũ nhất để nhận phần tử mới
+};
+
+// Số thread lấy ra khỏi ThreadSafeQueue
+enum class QueueConsumers {
+    Multi,          // mutex + condvar
+    Single,         // MpscQueue không khóa: Pop / WaitPop / DrainAll chỉ gọi từ 1 thread
+};
+
+// Queue nhiều producer; mặc định nhiều consumer (có khóa).
+// ThreadSafeQueue<T, QueueConsumers::Single>: cùng giao diện, Push không khóa, không chờ consumer.
+//
+// capacity > 0: giới hạn số phần tử theo overflow. Mỗi phần tử có thể kèm hạn dùng (expiresAt);
+// phần tử quá hạn bị bỏ khi lấy ra hoặc khi queue đầy, không bao giờ trả về cho consumer.
+template<typename T, QueueConsumers Consumers = QueueConsumers::Multi>
 class ThreadSafeQueue {
 public:
-    void Push(const T& value) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        queue_.push(value);
-        condition_.notify_one();
+    using Clock = std::chrono::steady_clock;
+
+    explicit ThreadSafeQueue(size_t capacity = 0, QueueOverflow overflow = QueueOverflow::Block)
+        : capacity_(capacity), overflow_(overflow) {}
+
+    bool Push(const T& value, Clock::time_point expiresAt = Clock::time_point::max()) {
+        return Insert(T(value), expiresAt, true);
+    }
+
+    bool Push(T&& value, Clock::time_point expiresAt = Clock::time_point::max()) {
+        return Insert(std::move(value), expiresAt, true);
+    }
+
+    // Như Push nhưng không bao giờ chờ (QueueOverflow::Block + đầy → false)
+    bool TryPush(T&& value, Clock::time_point expiresAt = Clock::time_point::max()) {
+        return Insert(std::move(value), expiresAt, false);
     }
 
     bool Pop(T& value) {
         std::unique_lock<std::mutex> lock(mutex_);
-        if (queue_.empty()) {
-            return false;
-        }
-        value = queue_.front();
-        queue_.pop();
-        return true;
+        return PopLocked(value, Clock::now());
     }
 
     bool WaitPop(T& value, int timeoutMs = 100) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
         std::unique_lock<std::mutex> lock(mutex_);
-        if (queue_.empty()) {
-            condition_.wait_for(lock, std::chrono::milliseconds(timeoutMs));
-            if (queue_.empty()) {
-                return false;
+        while (true) {
+            if (PopLocked(value, Clock::now())) return true;
+            if (condition_.wait_until(lock, deadline) == std::cv_status::timeout)
+                return PopLocked(value, Clock::now());
+        }
+    }
+
+    // Lấy toàn bộ phần tử còn hạn (nối vào out) trong 1 lần khóa; trả về số phần tử lấy được
+    size_t DrainAll(std::vector<T>& out) {
+        std::deque<Item> items;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            items.swap(queue_);
+        }
+        notFull_.notify_all();
+
+        auto now = Clock::now();
+        size_t taken = 0;
+        uint64_t expired = 0;
+        for (auto& item : items) {
+            if (item.expiresAt <= now) {
+                ++expired;
+                continue;
             }
+            out.push_back(std::move(item.value));
+            ++taken;
         }
-        value = queue_.front();
-        queue_.pop();
-        return true;
+        if (expired) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expired_ += expired;
+        }
+        return taken;
     }
 
     bool Empty() const {
@@ -40,13 +96,208 @@ public:
         return queue_.empty();
     }
 
+    // Gồm cả phần tử quá hạn chưa bị dọn
     size_t Size() const {
         std::lock_guard<std::mutex> lock(mutex_);
         return queue_.size();
     }
 
+    size_t Capacity() const { return capacity_; }
+
+    // Thống kê: bị bỏ do DropOldest / bị từ chối do đầy / quá hạn
+    uint64_t Dropped() const { std::lock_guard<std::mutex> lock(mutex_); return dropped_; }
+    uint64_t Rejected() const { std::lock_guard<std::mutex> lock(mutex_); return rejected_; }
+    uint64_t Expired() const { std::lock_guard<std::mutex> lock(mutex_); return expired_; }
+
 private:
+    struct Item {
+        T value;
+        Clock::time_point expiresAt;
+    };
+
+    bool Full() const { return capacity_ > 0 && queue_.size() >= capacity_; }
+
+    bool Insert(T&& value, Clock::time_point expiresAt, bool mayBlock) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if (Full()) PurgeExpiredLocked(Clock::now());
+        if (Full()) {
+            switch (overflow_) {
+            case QueueOverflow::Block:
+                if (!mayBlock) {
+                    ++rejected_;
+                    return false;
+                }
+                notFull_.wait(lock, [this] { return !Full(); });
+                break;
+            case QueueOverflow::Reject:
+                ++rejected_;
+                return false;
+            case QueueOverflow::DropOldest:
+                queue_.pop_front();
+                ++dropped_;
+                break;
+            }
+        }
+
+        queue_.push_back(Item{ std::move(value), expiresAt });
+        condition_.notify_one();
+        return true;
+    }
+
+    // Bỏ các phần tử quá hạn ở đầu queue rồi lấy phần tử đầu tiên còn hạn
+    bool PopLocked(T& value, Clock::time_point now) {
+        while (!queue_.empty()) {
+            Item& front = queue_.front();
+            if (front.expiresAt <= now) {
+                queue_.pop_front();
+                ++expired_;
+                continue;
+            }
+            value = std::move(front.value);
+            queue_.pop_front();
+            if (capacity_ > 0) notFull_.notify_one();
+            return true;
+        }
+        return false;
+    }
+
+    void PurgeExpiredLocked(Clock::time_point now) {
+        auto it = std::remove_if(queue_.begin(), queue_.end(),
+            [now](const Item& item) { return item.expiresAt <= now; });
+        expired_ += (uint64_t)std::distance(it, queue_.end());
+        queue_.erase(it, queue_.end());
+    }
+
     mutable std::mutex mutex_;
-    std::queue<T> queue_;
-    std::condition_variable condition_;
-};
\ No newline at end of file
+    std::deque<Item> queue_;
+    std::condition_variable condition_;     // có phần tử mới
+    std::condition_variable notFull_;       // có chỗ trống (QueueOverflow::Block)
+    size_t capacity_;
+    QueueOverflow overflow_;
+    uint64_t dropped_ = 0;
+    uint64_t rejected_ = 0;
+    uint64_t expired_ = 0;
+};
+
+//
+// 1 consumer: BlockingMpscQueue bên dưới, producer không bao giờ lấy mutex (trừ khi phải đánh thức
+// consumer đang ngủ). Giới hạn giống RequestQueue:
+//   - DropOldest: producer chỉ đếm, consumer bỏ phần tử cũ nhất ở lần lấy kế tiếp (trong lúc
+//     consumer bận có thể vượt capacity một ít)
+//   - Block coi như Reject: producer không có gì để chờ nếu không khóa
+//   - phần tử quá hạn chỉ bị bỏ khi consumer lấy ra
+//
+template<typename T>
+class ThreadSafeQueue<T, QueueConsumers::Single> {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit ThreadSafeQueue(size_t capacity = 0, QueueOverflow overflow = QueueOverflow::Block)
+        : capacity_(capacity), overflow_(overflow) {}
+
+    bool Push(const T& value, Clock::time_point expiresAt = Clock::time_point::max()) {
+        return Insert(T(value), expiresAt);
+    }
+
+    bool Push(T&& value, Clock::time_point expiresAt = Clock::time_point::max()) {
+        return Insert(std::move(value), expiresAt);
+    }
+
+    bool TryPush(T&& value, Clock::time_point expiresAt = Clock::time_point::max()) {
+        return Insert(std::move(value), expiresAt);
+    }
+
+    bool Pop(T& value) {
+        Item item;
+        while (queue_.Pop(item))
+            if (Take(item, value)) return true;
+        return false;
+    }
+
+    bool WaitPop(T& value, int timeoutMs = 100) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        Item item;
+        while (queue_.WaitPopUntil(item, deadline))
+            if (Take(item, value)) return true;
+        return false;
+    }
+
+    size_t DrainAll(std::vector<T>& out) {
+        size_t taken = 0;
+        T value;
+        while (Pop(value)) {
+            out.push_back(std::move(value));
+            ++taken;
+        }
+        return taken;
+    }
+
+    bool Empty() const { return queue_.Empty(); }
+
+    // Gồm cả phần tử quá hạn / chờ bỏ (DropOldest) chưa bị dọn
+    size_t Size() const {
+        int64_t depth = depth_.load(std::memory_order_relaxed);
+        return depth > 0 ? (size_t)depth : 0;
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t Expired() const { return expired_.load(std::memory_order_relaxed); }
+
+    // Số lần Push phải đánh thức consumer đang ngủ
+    uint64_t Wakeups() const { return queue_.Wakeups(); }
+
+private:
+    struct Item {
+        T value;
+        Clock::time_point expiresAt;
+    };
+
+    bool Insert(T&& value, Clock::time_point expiresAt) {
+        // đếm trước Push: Size thấy ngay
+        int64_t depth = depth_.fetch_add(1, std::memory_order_relaxed);
+        if (capacity_ > 0 && depth >= (int64_t)capacity_) {
+            if (overflow_ != QueueOverflow::DropOldest) {
+                depth_.fetch_sub(1, std::memory_order_relaxed);
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            trim_.fetch_add(1, std::memory_order_relaxed);     // consumer bỏ 1 phần tử cũ nhất
+        }
+
+        if (!queue_.Push(Item{ std::move(value), expiresAt })) {
+            depth_.fetch_sub(1, std::memory_order_relaxed);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // Consumer: item vừa lấy ra → bỏ nếu đang phải trim / đã quá hạn, ngược lại trả cho caller
+    bool Take(Item& item, T& value) {
+        depth_.fetch_sub(1, std::memory_order_relaxed);
+        if (trim_.load(std::memory_order_relaxed) > 0) {
+            trim_.fetch_sub(1, std::memory_order_relaxed);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (item.expiresAt <= Clock::now()) {
+            expired_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        value = std::move(item.value);
+        return true;
+    }
+
+    BlockingMpscQueue<Item> queue_;
+    size_t capacity_;
+    QueueOverflow overflow_;
+    std::atomic<int64_t> depth_{ 0 };
+    std::atomic<int64_t> trim_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> rejected_{ 0 };
+    std::atomic<uint64_t> expired_{ 0 };
+};
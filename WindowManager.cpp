@@ -83,6 +83,7 @@ LRESULT CALLBACK WindowManager::StaticWndProc(HWND hwnd, UINT msg, WPARAM wParam
 
 		// Tạo AppController với HWND của cửa sổ chính
         pThis->appController_ = std::make_unique<AppController>(hwnd);
+        pThis->SubscribeControllerEvents();
     }
     else {
 		pThis = reinterpret_cast<WindowManager*>(GetWindowLongPtr(hwnd, GWLP_USERDATA)); // Lấy con trỏ this từ dữ liệu cửa sổ
@@ -110,27 +111,9 @@ LRESULT WindowManager::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
         return TRUE;
 
 
-    case WM_APP_LOG: {  //nhận log message từ AppController thread, update UI.
-        LogMessage* logMsg = reinterpret_cast<LogMessage*>(wParam);
-        HandleAppLog(logMsg);
-        delete logMsg;
+    case WM_APP_EVENTS:     //AppController có sự kiện (log, trạng thái, kết nối) → giao cho các handler
+        if (appController_) appController_->Events().Dispatch();
         return 0;
-    }
-
-    case WM_APP_PRINTER_UPDATE: {   //cập nhật trạng thái máy in trên UI
-        PrinterStateMessage* stateMsg = reinterpret_cast<PrinterStateMessage*>(wParam);
-        HandlePrinterUpdate(stateMsg);
-
-        delete stateMsg;
-        return 0;
-    }
-
-    case WM_APP_CONNECTION_UPDATE: {    //nhận thông tin connected/disconnected
-        ConnectionMessage* connMsg = reinterpret_cast<ConnectionMessage*>(wParam);
-        HandleConnectionUpdate(connMsg);
-        delete connMsg;
-        return 0;
-    }
 
     case WM_APP_BUTTON_STATE: {     //cập nhật trạng thái button (active, disabled, running…)
         ButtonStateMessage* btnMsg = reinterpret_cast<ButtonStateMessage*>(wParam);
@@ -196,32 +179,44 @@ void WindowManager::HandleDrawItem(LPDRAWITEMSTRUCT dis) {
     }
 }
 
-//Vị trí gọi: WM_APP_* messages. Nhận log message từ AppController thread và cập nhật UI log.
-void WindowManager::HandleAppLog(LogMessage* msg) {
-	if (uiManager_ && msg) {    // kiểm tra UIManager và LogMessage không null
-		uiManager_->AddMessage(msg->text);  // thêm message vào log UI
-    }
+//Vị trí gọi: ngay sau khi tạo AppController (WM_NCCREATE). Đăng ký nhận sự kiện của AppController;
+//handler chạy trên thread UI khi WM_APP_EVENTS gọi Dispatch.
+void WindowManager::SubscribeControllerEvents() {
+    EventBus& events = appController_->Events();
+    events.Subscribe<LogMessage>([this](const LogMessage& m) { HandleAppLog(m); });
+    events.Subscribe<PrinterStateMessage>([this](const PrinterStateMessage& m) { HandlePrinterUpdate(m); });
+    events.Subscribe<ConnectionMessage>([this](const ConnectionMessage& m) { HandleConnectionUpdate(m); });
 }
 
-//Vị trí gọi: WM_APP_PRINTER_UPDATE. Cập nhật trạng thái máy in trên UI.
-void WindowManager::HandlePrinterUpdate(PrinterStateMessage* msg) {
-    if (uiManager_ && msg) {
-		uiManager_->UpdatePrinterStatus(msg->statusText);   // Cập nhật text trạng thái máy in
-		uiManager_->UpdatePrinterUIState(msg->state);       // Cập nhật trạng thái UI dựa trên trạng thái máy in
-        uiManager_->UpdateButtonStates(msg->state);
-        Logger::GetInstance().Write(L"HandlePrinterUpdate: status=" + std::to_wstring((int)msg->state.status));
+//Vị trí gọi: EventBus (LogMessage). Nhận log message từ AppController thread và cập nhật UI log.
+void WindowManager::HandleAppLog(const LogMessage& msg) {
+	if (uiManager_) {    // kiểm tra UIManager không null
+		uiManager_->AddMessage(msg.text);  // thêm message vào log UI
+    }
+}
 
+//Vị trí gọi: EventBus (PrinterStateMessage). Cập nhật trạng thái máy in trên UI.
+//Chỉ làm lại phần UI ứng với trường đã đổi (msg.changed)
+void WindowManager::HandlePrinterUpdate(const PrinterStateMessage& msg) {
+    if (uiManager_) {
+        if (msg.changed & StateFieldStatusText)
+            uiManager_->UpdatePrinterStatus(msg.statusText);    // Cập nhật text trạng thái máy in
+        if (msg.changed & StateFieldStatus) {
+            uiManager_->UpdatePrinterUIState(msg.state);        // Cập nhật trạng thái UI dựa trên trạng thái máy in
+            uiManager_->UpdateButtonStates(msg.state);          // nút chỉ phụ thuộc status
+            Logger::GetInstance().Write(L"HandlePrinterUpdate: status=" + std::to_wstring((int)msg.state.status));
+        }
     }
 }
 
-//Vị trí gọi: WM_APP_CONNECTION_UPDATE. Nhận thông tin connected/disconnected.
-void WindowManager::HandleConnectionUpdate(ConnectionMessage* msg) {
-    if (uiManager_ && msg) {
-        uiManager_->SetToggleState(msg->connected);     // Cập nhật trạng thái toggle
+//Vị trí gọi: EventBus (ConnectionMessage). Nhận thông tin connected/disconnected.
+void WindowManager::HandleConnectionUpdate(const ConnectionMessage& msg) {
+    if (uiManager_) {
+        uiManager_->SetToggleState(msg.connected);     // Cập nhật trạng thái toggle
         
         // Thêm message kết nối/ngắt kết nối vào log UI
-        if (msg->connected) { 
-            uiManager_->AddMessage(L"✅ Đã kết nối đến " + msg->ipAddress);
+        if (msg.connected) { 
+            uiManager_->AddMessage(L"✅ Đã kết nối đến " + msg.ipAddress);
         }
         else {
             uiManager_->AddMessage(L"🔌 Đã ngắt kết nối");
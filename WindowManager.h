@@ -33,9 +33,10 @@ private:
 	void HandleCreate();                                        //Khởi tạo UIManager, AppController, Tạo các button, listbox, v.v.
 	void HandleCommand(int id);                                 // Xử lý các lệnh từ button, menu, v.v.
     void HandleDrawItem(LPDRAWITEMSTRUCT dis);                  //Vẽ nút custom (Owner-Draw button)
-    void HandleAppLog(LogMessage* msg);                         //Nhận message từ AppController thread và cập nhật UI log.
-	void HandlePrinterUpdate(PrinterStateMessage* msg);         //Cập nhật trạng thái máy in trên UI.                  
-    void HandleConnectionUpdate(ConnectionMessage* msg);        //Nhận thông tin connected/disconnected.
+    void SubscribeControllerEvents();                           //Đăng ký handler sự kiện của AppController (EventBus).
+    void HandleAppLog(const LogMessage& msg);                   //Nhận message từ AppController thread và cập nhật UI log.
+	void HandlePrinterUpdate(const PrinterStateMessage& msg);   //Cập nhật trạng thái máy in trên UI.                  
+    void HandleConnectionUpdate(const ConnectionMessage& msg);  //Nhận thông tin connected/disconnected.
     void HandleButtonState(ButtonStateMessage* msg);            //Setter trạng thái button (active, disabled, running…)
 	void HandleDestroy();                                       //Xử lý dọn dẹp khi cửa sổ bị đóng.
     // UI interaction handlers //Các handler dành cho UI//giao tiếp giữa WindowManager → AppController.
@@ -39,5 +39,6 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
 
     //thoát ứng dụng
     Logger::GetInstance().Write(L"Application shutting down");
+    Logger::GetInstance().Shutdown();   // ghi nốt log trước khi thoát
     return (int)msg.wParam;
 }
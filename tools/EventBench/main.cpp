@@ -0,0 +1,230 @@
+﻿//
+// EventBench: so sánh đường gửi sự kiện AppController → UI cũ (new payload, PostMessage 1 message
+// mỗi sự kiện, UI delete) với EventBus (payload lấy từ pool, 1 lần đánh thức cho cả loạt sự kiện).
+// Hàng đợi message Win32 được mô phỏng bằng mutex + condvar để chạy được trên Linux.
+// In ra: thông lượng, độ trễ từng lần Publish (p50 / p99 / max), số lần cấp phát heap mỗi sự kiện,
+// số lần phải đánh thức thread UI, tỉ lệ pool cạn (UI tụt lại quá kích thước pool).
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp -o eventbench
+//   cl /std:c++20 /O2 /EHsc /I..\.. main.cpp
+//
+// Ví dụ: eventbench --events 200000 --producers 1,2,4
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include "EventBus.h"
+#include "../FleetBench/LatencyHistogram.h"
+
+// Đếm số lần cấp phát trong lúc đo
+static std::atomic<uint64_t> g_allocs{ 0 };
+
+void* operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // Cùng hình dạng với LogMessage / ConnectionMessage (MessageDef.h cần windows.h)
+    struct LogEvent {
+        std::wstring text;
+        int level = 0;
+    };
+
+    struct ConnectionEvent {
+        bool connected = false;
+        std::wstring ipAddress;
+        int port = 0;
+    };
+
+    // Hàng đợi message của 1 cửa sổ: PostMessage(type, pointer) / GetMessage
+    class FakeMessageQueue {
+    public:
+        void Post(int type, void* payload) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            queue_.push_back({ type, payload });
+            cv_.notify_one();
+            ++posts_;
+        }
+
+        bool Get(int& type, void*& payload, int timeoutMs) {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (!cv_.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return !queue_.empty(); }))
+                return false;
+            type = queue_.front().type;
+            payload = queue_.front().payload;
+            queue_.pop_front();
+            return true;
+        }
+
+        uint64_t Posts() const { std::lock_guard<std::mutex> lock(mtx_); return posts_; }
+
+    private:
+        struct Msg { int type; void* payload; };
+        mutable std::mutex mtx_;
+        std::condition_variable cv_;
+        std::deque<Msg> queue_;
+        uint64_t posts_ = 0;
+    };
+
+    struct Result {
+        double seconds = 0;
+        uint64_t allocs = 0;
+        uint64_t wakeups = 0;
+        uint64_t poolMisses = 0;
+        uint64_t p50 = 0, p99 = 0, max = 0;     // ns mỗi lần Publish
+        bool ok = true;
+    };
+
+    // ip ngắn (nằm gọn trong SSO) → phần cấp phát còn lại chỉ là vỏ payload
+    const wchar_t* kIp = L"10.0.0.7";
+
+    // Cách cũ: new payload → PostMessage → UI xử lý rồi delete
+    struct LegacyPath {
+        FakeMessageQueue window;
+        std::atomic<uint64_t> handled{ 0 };
+
+        void Publish(size_t i) {
+            if (i % 4 == 0) window.Post(1, new ConnectionEvent{ true, kIp, 9100 });
+            else window.Post(0, new LogEvent{ L"", (int)(i % 3) });
+        }
+
+        bool Consume() {
+            int type; void* p;
+            if (!window.Get(type, p, 100)) return false;
+            if (type == 1) delete static_cast<ConnectionEvent*>(p);
+            else delete static_cast<LogEvent*>(p);
+            handled.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        uint64_t Wakeups() const { return window.Posts(); }
+        uint64_t PoolMisses() const { return 0; }
+    };
+
+    // EventBus: wakeup = PostMessage 1 message không kèm dữ liệu, UI gọi Dispatch
+    struct BusPath {
+        EventBus bus{ 1024 };
+        FakeMessageQueue window;
+        std::atomic<uint64_t> handled{ 0 };
+
+        BusPath() {
+            bus.Subscribe<LogEvent>([this](const LogEvent&) { handled.fetch_add(1, std::memory_order_relaxed); });
+            bus.Subscribe<ConnectionEvent>([this](const ConnectionEvent&) { handled.fetch_add(1, std::memory_order_relaxed); });
+            bus.SetWakeup([this] { window.Post(0, nullptr); return true; });
+        }
+
+        void Publish(size_t i) {
+            if (i % 4 == 0) bus.Publish<ConnectionEvent>(ConnectionEvent{ true, kIp, 9100 });
+            else bus.Publish<LogEvent>(LogEvent{ L"", (int)(i % 3) });
+        }
+
+        bool Consume() {
+            int type; void* p;
+            if (!window.Get(type, p, 100)) return false;
+            bus.Dispatch();
+            return true;
+        }
+
+        uint64_t Wakeups() const { return window.Posts(); }
+        // UI chậm hơn producer quá kích thước pool → cấp phát heap
+        uint64_t PoolMisses() const { return bus.PoolOverflows<LogEvent>() + bus.PoolOverflows<ConnectionEvent>(); }
+    };
+
+    template<typename Path>
+    Result Run(size_t producers, size_t eventsPerProducer) {
+        Path path;
+        LatencyHistogram publishNs;
+        std::atomic<bool> go{ false };
+        const uint64_t total = producers * eventsPerProducer;
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&] {
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (size_t i = 0; i < eventsPerProducer; ++i) {
+                    auto t0 = Clock::now();
+                    path.Publish(i);
+                    publishNs.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+                }
+                });
+        }
+
+        Result res;
+        uint64_t allocs0 = g_allocs.load();
+        auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+
+        while (path.handled.load(std::memory_order_relaxed) < total) {
+            if (!path.Consume() && Clock::now() - start > std::chrono::seconds(60)) { res.ok = false; break; }
+        }
+        res.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (auto& t : threads) t.join();
+
+        res.allocs = g_allocs.load() - allocs0;
+        res.wakeups = path.Wakeups();
+        res.poolMisses = path.PoolMisses();
+        res.p50 = publishNs.Percentile(0.50);
+        res.p99 = publishNs.Percentile(0.99);
+        res.max = publishNs.Max();
+        return res;
+    }
+
+    void Print(const char* name, size_t producers, size_t events, const Result& r) {
+        double total = (double)(producers * events);
+        std::printf("%-18s %3zu  %8.2f  %8.0f  %8.0f  %10llu  %9.2f  %9.4f  %9.4f%s\n",
+            name, producers, total / r.seconds / 1e6,
+            (double)r.p50, (double)r.p99, (unsigned long long)r.max,
+            (double)r.allocs / total, (double)r.wakeups / total, (double)r.poolMisses / total,
+            r.ok ? "" : "  (TIMEOUT)");
+    }
+
+    std::vector<size_t> ParseList(const char* s) {
+        std::vector<size_t> out;
+        while (*s) {
+            out.push_back((size_t)std::strtoul(s, const_cast<char**>(&s), 10));
+            if (*s == ',') ++s;
+            else if (*s) break;
+        }
+        return out;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t events = 200000;
+    std::vector<size_t> producerCounts = { 1, 2, 4 };
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--events") && i + 1 < argc) events = (size_t)std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--producers") && i + 1 < argc) producerCounts = ParseList(argv[++i]);
+        else {
+            std::printf("eventbench [--events N] [--producers 1,2,4]\n");
+            return 1;
+        }
+    }
+
+    std::printf("%zu event / producer, 1 UI thread\n", events);
+    std::printf("%-18s %3s  %8s  %8s  %8s  %10s  %9s  %9s  %9s\n",
+        "path", "P", "Mev/s", "pub p50", "pub p99", "pub max", "alloc/ev", "wake/ev", "poolmiss");
+    for (size_t p : producerCounts) {
+        Print("new + PostMessage", p, events, Run<LegacyPath>(p, events));
+        Print("EventBus pooled", p, events, Run<BusPath>(p, events));
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <bit>
+
+//
+// Histogram độ trễ log-tuyến tính (kiểu HdrHistogram rút gọn), sai số tương đối ~3%.
+//   - giá trị < 64: mỗi giá trị 1 ô
+//   - từ 64 trở lên: mỗi khoảng [2^k, 2^(k+1)) chia 32 ô đều nhau
+// Record() chỉ dùng atomic relaxed → gọi được đồng thời từ nhiều thread, không khóa.
+//
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 32;
+    static constexpr size_t kBuckets = 64 + 58 * kSubBuckets;
+
+    void Record(uint64_t value) noexcept {
+        counts_[IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t m = max_.load(std::memory_order_relaxed);
+        while (value > m && !max_.compare_exchange_weak(m, value, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+    double Mean() const {
+        uint64_t n = Count();
+        return n ? (double)sum_.load(std::memory_order_relaxed) / (double)n : 0.0;
+    }
+
+    // Giá trị tại phân vị p (0..1), trả về điểm giữa của ô chứa phân vị
+    uint64_t Percentile(double p) const {
+        uint64_t n = Count();
+        if (n == 0) return 0;
+        uint64_t rank = (uint64_t)(p * (double)n);
+        if (rank >= n) rank = n - 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen > rank) {
+                uint64_t mid = LowerBound(i) + Width(i) / 2;
+                return mid < Max() ? mid : Max();
+            }
+        }
+        return Max();
+    }
+
+    void Reset() {
+        for (auto& c : counts_) c.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static size_t IndexOf(uint64_t v) {
+        if (v < 64) return (size_t)v;
+        unsigned shift = (unsigned)std::bit_width(v) - 6;   // v >> shift nằm trong [32, 63]
+        return 64 + (shift - 1) * kSubBuckets + (size_t)((v >> shift) - 32);
+    }
+
+    static uint64_t LowerBound(size_t i) {
+        if (i < 64) return i;
+        size_t k = i - 64;
+        unsigned shift = (unsigned)(k / kSubBuckets) + 1;
+        return (uint64_t)(k % kSubBuckets + 32) << shift;
+    }
+
+    static uint64_t Width(size_t i) {
+        if (i < 64) return 1;
+        return (uint64_t)1 << ((i - 64) / kSubBuckets + 1);
+    }
+
+    std::atomic<uint64_t> counts_[kBuckets] = {};
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> sum_{ 0 };
+    std::atomic<uint64_t> max_{ 0 };
+};
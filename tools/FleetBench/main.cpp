@@ -0,0 +1,378 @@
+﻿//
+// FleetBench: chạy N phiên AppController thật (WorkerLoop poll 500 ms + chuỗi lệnh in)
+// tới N máy in giả lập LinxSim (tools/LinxSim), đo:
+//   - số lệnh / giây, độ trễ p50/p99/p999 theo từng mã lệnh
+//   - chu kỳ poll STATUS thực tế (lệch bao nhiêu so với 500 ms)
+//   - thời gian kết nối / kết nối lại
+//   - CPU và bộ nhớ trên mỗi máy in
+// Kết quả ghi ra JSON để so sánh giữa các lần chạy.
+//
+// Chạy (Windows; LinxSim chạy trên máy Linux / WSL cùng mạng):
+//   linxsim --port 20000 --count 1000 --threads 4 --drop-every 5
+//   FleetBench --host 127.0.0.1 --port 20000 --sessions 1000 --duration 60 --out fleet.json
+//
+// Build: console app, cùng nguồn với project chính trừ main.cpp / UI
+//   cl /std:c++20 /EHsc /O2 /utf-8 /I..\.. main.cpp ..\..\AppController.cpp ..\..\RciClient.cpp
+//      ..\..\RciDecoder.cpp ..\..\RciSimd.cpp ..\..\RciTransport.cpp ..\..\RciWin32Transport.cpp
+//      ..\..\RciExecutor.cpp ..\..\RciAsync.cpp ws2_32.lib user32.lib gdi32.lib psapi.lib
+//
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <windows.h>
+#include <psapi.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "AppController.h"
+#include "CommonDefs.h"
+#include "MessageDef.h"
+#include "LatencyHistogram.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::wstring host = L"127.0.0.1";
+        int basePort = 20000;
+        int sessions = 10;
+        int warmupSec = 10;
+        int durationSec = 60;
+        int rampMs = 2;             // giãn cách tạo phiên (tránh dồn connect)
+        int jobEverySec = 20;       // mỗi phiên: StartPrinting / StopPrinting luân phiên
+        int jobCount = 50;
+        std::wstring out;           // rỗng → stdout
+    };
+
+    int64_t NowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // =====================================================
+    // Số liệu chung cho mọi phiên (ghi từ nhiều thread, không khóa)
+    // =====================================================
+    struct Metrics {
+        std::atomic<bool> measuring{ false };
+        std::unique_ptr<LatencyHistogram> perCmd[256];
+        std::atomic<uint64_t> results[6] = {};      // theo RciResult::Status
+        LatencyHistogram pollInterval;
+        LatencyHistogram connect;
+        LatencyHistogram reconnect;
+    };
+
+    struct Session {
+        int index = 0;
+        int port = 0;
+        HWND window = nullptr;
+        std::unique_ptr<AppController> controller;
+
+        std::atomic<int64_t> connectStartNs{ 0 };   // lúc gọi Connect() lần đầu
+        std::atomic<bool> everConnected{ false };
+        std::atomic<bool> connected{ false };
+        std::atomic<int64_t> lostAtNs{ 0 };         // lần đầu thấy mất kết nối
+        std::atomic<int64_t> lastStatusNs{ 0 };     // STATUS gần nhất hoàn tất
+        bool printing = false;
+    };
+
+    Metrics g_metrics;
+
+    void MarkLost(Session& s) {
+        if (!s.connected.exchange(false)) return;
+        int64_t zero = 0;
+        s.lostAtNs.compare_exchange_strong(zero, NowNs());
+        s.lastStatusNs = 0;     // khoảng mất kết nối không tính vào chu kỳ poll
+    }
+
+    void OnCommand(Session& s, uint8_t cmdid, Clock::duration rtt, RciResult::Status status) {
+        bool measuring = g_metrics.measuring.load(std::memory_order_relaxed);
+        if (measuring) g_metrics.results[(int)status].fetch_add(1, std::memory_order_relaxed);
+
+        if (status == RciResult::Status::Disconnected || status == RciResult::Status::SendFailed) {
+            MarkLost(s);
+            return;
+        }
+        if (status != RciResult::Status::Ok) return;
+
+        if (measuring) g_metrics.perCmd[cmdid]->Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(rtt).count());
+
+        if (cmdid == RciCmd::Status) {
+            int64_t now = NowNs();
+            int64_t prev = s.lastStatusNs.exchange(now);
+            if (measuring && prev) g_metrics.pollInterval.Record((uint64_t)(now - prev));
+        }
+    }
+
+    // =====================================================
+    // Sự kiện của AppController (giao trên thread chính khi cửa sổ message-only nhận WM_APP_EVENTS)
+    // =====================================================
+    void SubscribeSession(Session& s) {
+        EventBus& events = s.controller->Events();
+        events.Subscribe<PrinterStateMessage>([&s](const PrinterStateMessage& m) {
+            // AppController tự phát hiện mất kết nối → chuyển Connecting/Reconnecting
+            if (m.state.status == PrinterStateType::Connecting ||
+                m.state.status == PrinterStateType::Reconnecting)
+                MarkLost(s);
+            });
+        events.Subscribe<ConnectionMessage>([&s](const ConnectionMessage& m) {
+            if (!m.connected) return;
+            int64_t now = NowNs();
+            s.connected = true;
+            if (!s.everConnected.exchange(true)) {
+                g_metrics.connect.Record((uint64_t)(now - s.connectStartNs));
+            }
+            else {
+                int64_t lost = s.lostAtNs.exchange(0);
+                if (lost && g_metrics.measuring) g_metrics.reconnect.Record((uint64_t)(now - lost));
+            }
+            });
+        // LogMessage: không ai nghe → AppController không dựng message log
+    }
+
+    LRESULT CALLBACK BenchWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+        auto* s = reinterpret_cast<Session*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+        if (msg == WM_APP_EVENTS) {
+            if (s && s->controller) s->controller->Events().Dispatch();
+            return 0;
+        }
+        return DefWindowProcW(hwnd, msg, wParam, lParam);
+    }
+
+    void PumpFor(std::chrono::milliseconds ms) {
+        auto end = Clock::now() + ms;
+        while (true) {
+            MSG msg;
+            while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE)) DispatchMessageW(&msg);
+
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(end - Clock::now()).count();
+            if (left <= 0) return;
+            MsgWaitForMultipleObjects(0, nullptr, FALSE, (DWORD)std::min<long long>(left, 50), QS_ALLINPUT);
+        }
+    }
+
+    // =====================================================
+    // CPU / bộ nhớ của process
+    // =====================================================
+    uint64_t ProcessCpuNs() {
+        FILETIME c, e, k, u;
+        GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u);
+        auto v = [](const FILETIME& f) { return ((uint64_t)f.dwHighDateTime << 32) | f.dwLowDateTime; };
+        return (v(k) + v(u)) * 100;     // đơn vị 100 ns
+    }
+
+    uint64_t PrivateBytes() {
+        PROCESS_MEMORY_COUNTERS_EX pmc{};
+        GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
+        return pmc.PrivateUsage;
+    }
+
+    // =====================================================
+    // JSON
+    // =====================================================
+    void WriteHistogram(FILE* f, const char* name, const LatencyHistogram& h, double scale, bool comma) {
+        std::fprintf(f, "    \"%s\": { \"count\": %llu, \"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, "
+            "\"p999\": %.3f, \"max\": %.3f }%s\n",
+            name, (unsigned long long)h.Count(), h.Mean() / scale,
+            h.Percentile(0.50) / scale, h.Percentile(0.99) / scale, h.Percentile(0.999) / scale,
+            h.Max() / scale, comma ? "," : "");
+    }
+
+    const char* CommandName(int id) {
+        switch (id) {
+        case RciCmd::StartJet: return "start_jet";
+        case RciCmd::StopJet: return "stop_jet";
+        case RciCmd::StartPrint: return "start_print";
+        case RciCmd::StopPrint: return "stop_print";
+        case RciCmd::Status: return "status";
+        case RciCmd::DownloadMessage: return "download_message";
+        case RciCmd::DownloadRemoteField: return "remote_field";
+        case RciCmd::LoadMessage: return "load_message";
+        default: return nullptr;
+        }
+    }
+
+    void WriteJson(FILE* f, const Options& o, double seconds, uint64_t cpuNs, int64_t memBytes) {
+        static const char* statusNames[] = { "ok", "timeout", "disconnected", "send_failed", "cancelled", "invalid" };
+
+        uint64_t total = 0;
+        for (auto& r : g_metrics.results) total += r;
+
+        std::fprintf(f, "{\n");
+        std::fprintf(f, "  \"sessions\": %d,\n  \"duration_s\": %.3f,\n  \"base_port\": %d,\n",
+            o.sessions, seconds, o.basePort);
+        std::fprintf(f, "  \"commands\": %llu,\n  \"commands_per_sec\": %.1f,\n",
+            (unsigned long long)total, total / seconds);
+
+        std::fprintf(f, "  \"results\": {");
+        for (int i = 0; i < 6; ++i)
+            std::fprintf(f, "%s \"%s\": %llu", i ? "," : "", statusNames[i], (unsigned long long)g_metrics.results[i].load());
+        std::fprintf(f, " },\n");
+
+        std::fprintf(f, "  \"latency_ms\": {\n");
+        std::vector<int> ids;
+        for (int i = 0; i < 256; ++i)
+            if (g_metrics.perCmd[i]->Count()) ids.push_back(i);
+        for (size_t k = 0; k < ids.size(); ++k) {
+            char name[32];
+            const char* known = CommandName(ids[k]);
+            if (known) std::snprintf(name, sizeof(name), "%s", known);
+            else std::snprintf(name, sizeof(name), "0x%02x", ids[k]);
+            WriteHistogram(f, name, *g_metrics.perCmd[ids[k]], 1e6, k + 1 < ids.size());
+        }
+        std::fprintf(f, "  },\n");
+
+        std::fprintf(f, "  \"poll_interval_ms\": {\n");
+        WriteHistogram(f, "status", g_metrics.pollInterval, 1e6, false);
+        std::fprintf(f, "  },\n");
+        std::fprintf(f, "  \"poll_slip_p99_ms\": %.3f,\n", g_metrics.pollInterval.Percentile(0.99) / 1e6 - 500.0);
+
+        std::fprintf(f, "  \"connection_ms\": {\n");
+        WriteHistogram(f, "connect", g_metrics.connect, 1e6, true);
+        WriteHistogram(f, "reconnect", g_metrics.reconnect, 1e6, false);
+        std::fprintf(f, "  },\n");
+
+        double cores = cpuNs / 1e9 / seconds;
+        std::fprintf(f, "  \"cpu\": { \"process_cores\": %.4f, \"per_printer_pct\": %.5f },\n",
+            cores, cores * 100.0 / o.sessions);
+        std::fprintf(f, "  \"memory\": { \"private_bytes_delta\": %lld, \"per_printer_bytes\": %lld }\n",
+            (long long)memBytes, (long long)(memBytes / o.sessions));
+        std::fprintf(f, "}\n");
+    }
+
+    bool ParseArgs(int argc, wchar_t** argv, Options& o) {
+        for (int i = 1; i < argc; ++i) {
+            std::wstring a = argv[i];
+            if (i + 1 >= argc) return false;
+            const wchar_t* v = argv[++i];
+            if (a == L"--host") o.host = v;
+            else if (a == L"--port") o.basePort = _wtoi(v);
+            else if (a == L"--sessions") o.sessions = _wtoi(v);
+            else if (a == L"--warmup") o.warmupSec = _wtoi(v);
+            else if (a == L"--duration") o.durationSec = _wtoi(v);
+            else if (a == L"--ramp-ms") o.rampMs = _wtoi(v);
+            else if (a == L"--job-every") o.jobEverySec = _wtoi(v);
+            else if (a == L"--job-count") o.jobCount = _wtoi(v);
+            else if (a == L"--out") o.out = v;
+            else return false;
+        }
+        return o.sessions > 0 && o.durationSec > 0 && o.basePort > 0 && o.basePort + o.sessions - 1 <= 65535;
+    }
+
+    // Dừng nhiều phiên song song: mỗi ~AppController chờ worker thread (tới 500 ms)
+    void DestroySessions(std::vector<std::unique_ptr<Session>>& sessions) {
+        size_t workers = std::min<size_t>(64, sessions.size());
+        std::atomic<size_t> next{ 0 };
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < workers; ++t) {
+            threads.emplace_back([&] {
+                for (size_t i; (i = next++) < sessions.size();) {
+                    auto& c = sessions[i]->controller;
+                    c->DisableAutoReconnect();
+                    c.reset();
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+
+        PumpFor(std::chrono::milliseconds(100));    // bỏ WM_APP_EVENTS còn trong hàng đợi (sự kiện đã về pool khi bus hủy)
+        for (auto& s : sessions) DestroyWindow(s->window);
+    }
+
+} // namespace
+
+int wmain(int argc, wchar_t** argv) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        std::fwprintf(stderr, L"FleetBench --host IP --port BASE --sessions N [--warmup S] [--duration S]\n"
+            L"           [--ramp-ms MS] [--job-every S] [--job-count N] [--out file.json]\n");
+        return 2;
+    }
+
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+
+    for (auto& h : g_metrics.perCmd) h = std::make_unique<LatencyHistogram>();
+
+    WNDCLASSW wc{};
+    wc.lpfnWndProc = BenchWndProc;
+    wc.hInstance = GetModuleHandleW(nullptr);
+    wc.lpszClassName = L"FleetBenchSession";
+    RegisterClassW(&wc);
+
+    // Mốc bộ nhớ trước khi tạo phiên
+    uint64_t memBase = PrivateBytes();
+
+    std::vector<std::unique_ptr<Session>> sessions;
+    sessions.reserve(o.sessions);
+    for (int i = 0; i < o.sessions; ++i) {
+        auto s = std::make_unique<Session>();
+        s->index = i;
+        s->port = o.basePort + i;
+        s->window = CreateWindowW(wc.lpszClassName, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr, wc.hInstance, nullptr);
+        SetWindowLongPtrW(s->window, GWLP_USERDATA, (LONG_PTR)s.get());
+
+        Session* sp = s.get();
+        s->controller = std::make_unique<AppController>(s->window);
+        SubscribeSession(*s);
+        s->controller->SetCommandObserver([sp](uint8_t cmd, Clock::duration rtt, RciResult::Status st) {
+            OnCommand(*sp, cmd, rtt, st);
+        });
+        s->controller->StartWorkerThread();
+        s->connectStartNs = NowNs();
+        s->controller->Connect(o.host, s->port);
+        sessions.push_back(std::move(s));
+
+        PumpFor(std::chrono::milliseconds(o.rampMs));
+    }
+
+    std::fwprintf(stderr, L"FleetBench: %d sessions started, warmup %ds\n", o.sessions, o.warmupSec);
+    PumpFor(std::chrono::seconds(o.warmupSec));
+
+    // ===== Đo =====
+    g_metrics.measuring = true;
+    uint64_t cpu0 = ProcessCpuNs();
+    auto t0 = Clock::now();
+    auto end = t0 + std::chrono::seconds(o.durationSec);
+
+    // Lệnh in rải đều: phiên i tới lượt tại t0 + (i / sessions) * jobEvery
+    std::vector<Clock::time_point> nextJob(sessions.size());
+    for (size_t i = 0; i < sessions.size(); ++i)
+        nextJob[i] = t0 + std::chrono::milliseconds((int64_t)o.jobEverySec * 1000 * (int64_t)i / o.sessions);
+
+    while (Clock::now() < end) {
+        auto now = Clock::now();
+        if (o.jobEverySec > 0) {
+            for (size_t i = 0; i < sessions.size(); ++i) {
+                if (now < nextJob[i]) continue;
+                Session& s = *sessions[i];
+                if (s.printing) s.controller->StopPrinting();
+                else s.controller->StartPrinting(L"BENCH", o.jobCount);
+                s.printing = !s.printing;
+                nextJob[i] += std::chrono::seconds(o.jobEverySec);
+            }
+        }
+        PumpFor(std::chrono::milliseconds(20));
+    }
+
+    g_metrics.measuring = false;
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    uint64_t cpuNs = ProcessCpuNs() - cpu0;
+    int64_t memDelta = (int64_t)PrivateBytes() - (int64_t)memBase;
+
+    FILE* f = stdout;
+    if (!o.out.empty() && _wfopen_s(&f, o.out.c_str(), L"w") != 0) {
+        std::fwprintf(stderr, L"Không mở được %ls\n", o.out.c_str());
+        f = stdout;
+    }
+    WriteJson(f, o, seconds, cpuNs, memDelta);
+    if (f != stdout) std::fclose(f);
+
+    DestroySessions(sessions);
+    WSACleanup();
+    return 0;
+}
@@ -0,0 +1,254 @@
+﻿//
+// FrameBench: kiểm tra đường encode lệnh RCI không cấp phát heap ở trạng thái ổn định.
+// Hook operator new đếm số lần cấp phát (như QueueBench); sau vòng warm-up, lặp các lệnh
+// hot path (STATUS, START/STOP PRINT, LOAD MESSAGE, 0x1D, 0x19) qua:
+//   1. RciFrame::Writer / RciFrame::Encode vào buffer thô và vector dùng lại
+//   2. RciClient::SendCommand + lệnh high-level, qua transport giả trả ACK từ buffer cố định
+// In ra số lần cấp phát / thời gian mỗi frame; trả về 1 nếu còn cấp phát sau warm-up.
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp ../../RciClient.cpp ../../RciDecoder.cpp ../../RciSimd.cpp
+//       ../../RciCapture.cpp ../../RciTransport.cpp ../../RciReactor.cpp ../../RciReactorTransport.cpp
+//       ../../RciPosixTransport.cpp -o framebench
+//   cl /std:c++20 /O2 /EHsc /I..\.. main.cpp ..\..\RciClient.cpp ..\..\RciDecoder.cpp ..\..\RciSimd.cpp
+//       ..\..\RciCapture.cpp ..\..\RciTransport.cpp ..\..\RciWin32Transport.cpp ws2_32.lib
+//
+// Ví dụ: framebench --iterations 200000
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include "RciFrame.h"
+#include "RciCommands.h"
+#include "RciClient.h"
+#include "RciTransport.h"
+
+// =========================================================
+// Đếm cấp phát heap (mọi thread)
+// =========================================================
+static std::atomic<uint64_t> g_allocs{ 0 };
+
+void* operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using Clock = std::chrono::steady_clock;
+
+static volatile size_t g_sink = 0;
+
+// =========================================================
+// Transport giả: mỗi lệnh gửi đi → 1 reply ACK dựng sẵn trong buffer cố định
+// (STATUS kèm 6 byte trạng thái để RequestStatusEx parse được)
+// =========================================================
+class AckTransport : public IRciTransport {
+public:
+    bool Connect(const std::wstring&, unsigned short, int, std::wstring&) override {
+        open_ = true;
+        return true;
+    }
+
+    bool Send(const uint8_t* data, size_t len) override {
+        if (!open_ || len < 3) return false;
+        // ESC STX [ESC] cmdid ...
+        uint8_t cmd = data[2] == RciFrame::ESC ? data[3] : data[2];
+
+        // ESC ACK p_status c_status cmdid [status] ESC ETX [ESC] checksum (body không có ESC)
+        size_t n = 0;
+        unsigned int sum = RciFrame::ACK + cmd;
+        reply_[n++] = RciFrame::ESC;
+        reply_[n++] = RciFrame::ACK;
+        reply_[n++] = 0x00;
+        reply_[n++] = 0x00;
+        if (cmd == RciFrame::ESC) reply_[n++] = RciFrame::ESC;
+        reply_[n++] = cmd;
+        if (cmd == RciCmd::Status) {
+            for (size_t i = 0; i < RciStatusView::kPayloadSize; ++i) reply_[n++] = 0x00;
+        }
+        reply_[n++] = RciFrame::ESC;
+        reply_[n++] = RciFrame::ETX;
+        uint8_t checksum = RciFrame::ChecksumFromSum(sum + RciFrame::ETX);
+        if (RciFrame::IsControlByte(checksum)) reply_[n++] = RciFrame::ESC;
+        reply_[n++] = checksum;
+
+        pending_ = n;
+        pos_ = 0;
+        return true;
+    }
+
+    IoResult Receive(uint8_t* buf, size_t cap, size_t& received, Clock::time_point) override {
+        received = 0;
+        if (!open_) return IoResult::Closed;
+        if (pos_ >= pending_) return IoResult::Timeout;
+        received = std::min(cap, pending_ - pos_);
+        std::memcpy(buf, reply_ + pos_, received);
+        pos_ += received;
+        return IoResult::Ok;
+    }
+
+    void Shutdown() override { open_ = false; }
+    void Close() override { open_ = false; }
+    bool IsOpen() const override { return open_; }
+    int LastError() const override { return 0; }
+
+private:
+    bool open_ = false;
+    uint8_t reply_[32] = {};
+    size_t pending_ = 0;
+    size_t pos_ = 0;
+};
+
+// =========================================================
+// Lệnh hot path
+// =========================================================
+struct HotPath {
+    uint8_t loadPayload[10];            // 0x1E: tên 8 byte (pad '\0') + count little-endian
+    std::vector<uint8_t> remoteField;   // 0x1D: vài chục byte (mã lô / số đếm)
+    std::vector<uint8_t> messageData;   // 0x19: message 1 KB (có byte điều khiển)
+
+    HotPath() : loadPayload{ 'M', 'S', 'G', '0', '1', 0, 0, 0, 1, 0 }, remoteField(48), messageData(1024) {
+        for (size_t i = 0; i < remoteField.size(); ++i) remoteField[i] = (uint8_t)('0' + i % 10);
+        for (size_t i = 0; i < messageData.size(); ++i) messageData[i] = (uint8_t)(i * 7);
+    }
+};
+
+struct Result {
+    const char* name;
+    uint64_t frames;
+    uint64_t allocs;
+    double nsPerFrame;
+};
+
+static void Print(const Result& r) {
+    std::printf("  %-30s %10llu frame  %8.1f ns/frame  %llu cấp phát\n", r.name,
+        (unsigned long long)r.frames, r.nsPerFrame, (unsigned long long)r.allocs);
+}
+
+// Chạy body warmup lần rồi iterations lần, đếm cấp phát chỉ trong lượt đo
+template<typename Body>
+static Result Measure(const char* name, size_t warmup, size_t iterations, size_t framesPerIter, Body body) {
+    for (size_t i = 0; i < warmup; ++i) body();
+
+    uint64_t before = g_allocs.load(std::memory_order_relaxed);
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) body();
+    auto t1 = Clock::now();
+    uint64_t allocs = g_allocs.load(std::memory_order_relaxed) - before;
+
+    uint64_t frames = (uint64_t)iterations * framesPerIter;
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    return Result{ name, frames, allocs, frames ? ns / frames : 0.0 };
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = 100000;
+    size_t warmup = 100;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--warmup") && i + 1 < argc) warmup = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::printf("usage: framebench [--iterations N] [--warmup N]\n");
+            return 2;
+        }
+    }
+
+    HotPath hot;
+    std::vector<Result> results;
+
+    // ---------------------------------------------------------
+    // 1. RciFrame: buffer thô (Writer) và vector dùng lại (Encode)
+    // ---------------------------------------------------------
+    uint8_t raw[RciFrame::MaxEncodedSize(1024)];
+    results.push_back(Measure("RciFrame::Writer -> uint8_t[]", warmup, iterations, 6, [&] {
+        size_t n = 0;
+        n += RciFrame::Encode(raw, sizeof(raw), RciCmd::Status, nullptr, 0);
+        n += RciFrame::Encode(raw, sizeof(raw), RciCmd::StartPrint, nullptr, 0);
+        n += RciFrame::Encode(raw, sizeof(raw), RciCmd::StopPrint, nullptr, 0);
+        n += RciFrame::Encode(raw, sizeof(raw), RciCmd::LoadMessage, hot.loadPayload, sizeof(hot.loadPayload));
+
+        // 0x1D: header độ dài + data ghi từng phần như RciClient
+        const uint8_t header[2] = { (uint8_t)hot.remoteField.size(), 0 };
+        RciFrame::Writer w(raw, sizeof(raw));
+        w.Put(RciCmd::DownloadRemoteField);
+        w.Put(header, sizeof(header));
+        w.Put(hot.remoteField.data(), hot.remoteField.size());
+        n += w.End();
+
+        n += RciFrame::Encode(raw, sizeof(raw), RciCmd::DownloadMessage,
+            hot.messageData.data(), hot.messageData.size());
+        g_sink = n;
+    }));
+
+    std::vector<uint8_t> frame;
+    results.push_back(Measure("RciFrame::Encode -> vector", warmup, iterations, 6, [&] {
+        size_t n = 0;
+        n += RciFrame::Encode(frame, RciCmd::Status, nullptr, 0);
+        n += RciFrame::Encode(frame, RciCmd::StartPrint, nullptr, 0);
+        n += RciFrame::Encode(frame, RciCmd::StopPrint, nullptr, 0);
+        n += RciFrame::Encode(frame, RciCmd::LoadMessage, hot.loadPayload, sizeof(hot.loadPayload));
+        n += RciFrame::Encode(frame, RciCmd::DownloadRemoteField, hot.remoteField.data(), hot.remoteField.size());
+        n += RciFrame::Encode(frame, RciCmd::DownloadMessage, hot.messageData.data(), hot.messageData.size());
+        g_sink = n;
+    }));
+
+    // ---------------------------------------------------------
+    // 2. RciClient: encode vào txBuffer_ + gửi + decode reply qua transport giả
+    // ---------------------------------------------------------
+    RciClient client(std::make_unique<AckTransport>());
+    if (!client.Connect(L"framebench", 9100, 1000)) {
+        std::printf("Connect transport giả thất bại\n");
+        return 1;
+    }
+
+    uint64_t failures = 0;
+    std::vector<uint8_t> reply;
+    results.push_back(Measure("RciClient::SendCommand", warmup, iterations, 6, [&] {
+        failures += !client.SendCommand(RciCmd::Status, nullptr, 0, reply);
+        failures += !client.SendCommand(RciCmd::StartPrint, nullptr, 0, reply);
+        failures += !client.SendCommand(RciCmd::StopPrint, nullptr, 0, reply);
+        failures += !client.SendCommand(RciCmd::LoadMessage, hot.loadPayload, sizeof(hot.loadPayload), reply);
+        failures += !client.SendCommand(RciCmd::DownloadRemoteField,
+            hot.remoteField.data(), hot.remoteField.size(), reply);
+        failures += !client.SendCommand(RciCmd::DownloadMessage,
+            hot.messageData.data(), hot.messageData.size(), reply);
+    }));
+
+    const std::string messageName = "MSG01";
+    results.push_back(Measure("RciClient high-level", warmup, iterations, 6, [&] {
+        failures += !client.RequestStatus();
+        failures += !client.StartPrint();
+        failures += !client.StopPrint();
+        failures += !client.LoadMessage(messageName, 1);
+        failures += !client.DownloadRemoteField(hot.remoteField);
+        failures += !client.DownloadMessageData(hot.messageData);
+    }));
+
+    client.Disconnect();
+
+    std::printf("FrameBench: %zu vòng đo (warm-up %zu vòng)\n", iterations, warmup);
+    uint64_t totalAllocs = 0;
+    for (const auto& r : results) {
+        Print(r);
+        totalAllocs += r.allocs;
+    }
+
+    if (failures) {
+        std::printf("LỖI: %llu lệnh không nhận được ACK\n", (unsigned long long)failures);
+        return 1;
+    }
+    if (totalAllocs) {
+        std::printf("LỖI: còn %llu lần cấp phát heap sau warm-up\n", (unsigned long long)totalAllocs);
+        return 1;
+    }
+    std::printf("OK: 0 cấp phát heap mỗi frame sau warm-up\n");
+    return 0;
+}
@@ -0,0 +1,185 @@
+﻿#include "SimPrinter.h"
+#include <cmath>
+
+SimPrinter::SimPrinter(const SimPrinterConfig& config)
+    : config_(config), rng_(config.seed ? config.seed : 1) {}
+
+// =========================================================
+// Trạng thái theo thời gian
+// =========================================================
+void SimPrinter::Advance(Clock::time_point now) {
+    if (jet_ == RciJetState::Starting && now >= jetDoneAt_) jet_ = RciJetState::Running;
+    if (jet_ == RciJetState::Stopping && now >= jetDoneAt_) jet_ = RciJetState::Stopped;
+
+    if (print_ != RciPrintState::Printing) return;
+
+    // lỗi ngẫu nhiên: chỉ tính bản in tới thời điểm lỗi
+    bool fault = now >= faultAt_;
+    Clock::time_point end = fault ? faultAt_ : now;
+
+    double secs = std::chrono::duration<double>(end - printStart_).count();
+    uint64_t total = secs > 0 ? (uint64_t)(secs * config_.printsPerSec) : 0;
+    bool finished = targetCount_ > 0 && total >= targetCount_;
+    if (finished) total = targetCount_;
+
+    counters_.prints += total - printedInRun_;
+    printedInRun_ = total;
+
+    if (finished) {
+        StopPrinting();
+    }
+    else if (fault) {
+        faultMask_ |= config_.faultBits;
+        counters_.faults++;
+        StopPrinting();
+    }
+}
+
+void SimPrinter::StopPrinting() {
+    print_ = RciPrintState::Idle;
+    faultAt_ = Clock::time_point::max();
+}
+
+void SimPrinter::ScheduleFault(Clock::time_point now) {
+    if (config_.faultsPerHour <= 0) {
+        faultAt_ = Clock::time_point::max();
+        return;
+    }
+    // khoảng cách giữa 2 lỗi theo phân phối mũ
+    double u = (NextRandom() + 1.0) / 4294967296.0;
+    double secs = -std::log(u) * 3600.0 / config_.faultsPerHour;
+    faultAt_ = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(secs));
+}
+
+uint32_t SimPrinter::NextRandom() {
+    // xorshift32
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+}
+
+// =========================================================
+// Xử lý lệnh
+// =========================================================
+size_t SimPrinter::Handle(const RciFrameView& request, Clock::time_point now,
+    uint8_t* out, size_t capacity, Clock::time_point& readyAt) {
+    Advance(now);
+    readyAt = now;
+    counters_.commands++;
+
+    bool isCommand = request.type == RciFrame::STX || request.type == RciFrame::SOH;
+    uint8_t cmd = request.size > 0 ? request.body[0] : 0;
+    const uint8_t* p = request.size > 1 ? request.body + 1 : nullptr;
+    size_t n = request.size > 1 ? request.size - 1 : 0;
+
+    uint8_t c = SimCStatus::Ok;
+    if (!isCommand || !request.checksumOk || request.size == 0) {
+        c = SimCStatus::BadLength;
+    }
+    else {
+        switch (cmd) {
+        case RciCmd::Status:              break;
+        case RciCmd::StartJet:            c = OnStartJet(now, readyAt); break;
+        case RciCmd::StopJet:             c = OnStopJet(now, readyAt); break;
+        case RciCmd::StartPrint:          c = OnStartPrint(now); break;
+        case RciCmd::StopPrint:           c = OnStopPrint(); break;
+        case RciCmd::LoadMessage:         c = OnLoadMessage(p, n); break;
+        case RciCmd::DownloadMessage:
+            if (n == 0) c = SimCStatus::BadLength;
+            else counters_.downloadBytes += n;
+            break;
+        case RciCmd::DownloadRemoteField: c = OnRemoteField(p, n); break;
+        default:                          c = SimCStatus::UnknownCommand; break;
+        }
+    }
+
+    // lệnh bị từ chối → NAK kèm c_status
+    bool ack = c == SimCStatus::Ok;
+    if (!ack) counters_.naks++;
+
+    uint32_t mask = ErrorMask();
+    auto w = RciFrame::Writer::Reply(out, capacity, ack);
+    w.Put(mask ? SimPStatus::Error : SimPStatus::Ok);
+    w.Put(c);
+    w.Put(cmd);
+    if (ack && cmd == RciCmd::Status) {
+        w.Put((uint8_t)jet_);
+        w.Put((uint8_t)print_);
+        w.Put((uint8_t)(mask >> 24));
+        w.Put((uint8_t)(mask >> 16));
+        w.Put((uint8_t)(mask >> 8));
+        w.Put((uint8_t)mask);
+    }
+    return w.End();
+}
+
+uint8_t SimPrinter::OnStartJet(Clock::time_point now, Clock::time_point& readyAt) {
+    // khởi động lại jet = reset lỗi ngẫu nhiên
+    faultMask_ = 0;
+
+    switch (jet_) {
+    case RciJetState::Stopping:
+        return SimCStatus::Busy;
+    case RciJetState::Stopped:
+        jet_ = RciJetState::Starting;
+        jetDoneAt_ = now + std::chrono::milliseconds(config_.jetUpMs);
+        if (jetDoneAt_ <= now) jet_ = RciJetState::Running;
+        break;
+    default:
+        break;
+    }
+    if (config_.ackJetWhenReady && jet_ == RciJetState::Starting) readyAt = jetDoneAt_;
+    return SimCStatus::Ok;
+}
+
+uint8_t SimPrinter::OnStopJet(Clock::time_point now, Clock::time_point& readyAt) {
+    if (print_ == RciPrintState::Printing) StopPrinting();
+
+    if (jet_ == RciJetState::Running || jet_ == RciJetState::Starting) {
+        jet_ = RciJetState::Stopping;
+        jetDoneAt_ = now + std::chrono::milliseconds(config_.jetDownMs);
+        if (jetDoneAt_ <= now) jet_ = RciJetState::Stopped;
+    }
+    if (config_.ackJetWhenReady && jet_ == RciJetState::Stopping) readyAt = jetDoneAt_;
+    return SimCStatus::Ok;
+}
+
+uint8_t SimPrinter::OnStartPrint(Clock::time_point now) {
+    if (faultMask_) return SimCStatus::Fault;
+    if (jet_ == RciJetState::Starting || jet_ == RciJetState::Stopping) return SimCStatus::Busy;
+    if (jet_ != RciJetState::Running) return SimCStatus::JetNotRunning;
+    if (message_.empty()) return SimCStatus::NoMessage;
+    if (print_ == RciPrintState::Printing) return SimCStatus::Ok;
+
+    print_ = RciPrintState::Printing;
+    printStart_ = now;
+    printedInRun_ = 0;
+    ScheduleFault(now);
+    return SimCStatus::Ok;
+}
+
+uint8_t SimPrinter::OnStopPrint() {
+    if (print_ == RciPrintState::Printing) StopPrinting();
+    return SimCStatus::Ok;
+}
+
+uint8_t SimPrinter::OnLoadMessage(const uint8_t* p, size_t n) {
+    // cùng định dạng RciClient::MakeLoadMessagePayload: tên 8 byte + count LE
+    if (n != 10 || p[0] == 0) return SimCStatus::BadLength;
+    if (print_ == RciPrintState::Printing) return SimCStatus::Busy;
+
+    message_.clear();
+    for (size_t i = 0; i < 8 && p[i]; ++i) message_.push_back((char)p[i]);
+    targetCount_ = (uint16_t)(p[8] | (p[9] << 8));
+    return SimCStatus::Ok;
+}
+
+uint8_t SimPrinter::OnRemoteField(const uint8_t* p, size_t n) {
+    // [len LE 2 byte][data]
+    if (n < 2) return SimCStatus::BadLength;
+    size_t len = (size_t)(p[0] | (p[1] << 8));
+    if (n - 2 != len) return SimCStatus::BadLength;
+    counters_.downloadBytes += len;
+    return SimCStatus::Ok;
+}
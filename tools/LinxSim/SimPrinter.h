@@ -0,0 +1,104 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <string>
+#include "RciDecoder.h"
+#include "RciReply.h"
+
+//
+// Cấu hình 1 máy in giả lập
+//
+struct SimPrinterConfig {
+    int jetUpMs = 4000;             // thời gian khởi động jet (Starting → Running)
+    int jetDownMs = 2000;           // thời gian tắt jet (Stopping → Stopped)
+    double printsPerSec = 5.0;      // tốc độ in khi đang in
+    uint32_t errorMask = 0;         // lỗi cố định trả về trong STATUS
+    double faultsPerHour = 0.0;     // lỗi ngẫu nhiên trong lúc in (0 = tắt)
+    uint32_t faultBits = 0x00000100;// bit được bật khi có lỗi ngẫu nhiên
+    bool ackJetWhenReady = false;   // true: ACK StartJet/StopJet chỉ gửi khi chuỗi jet xong
+    uint32_t seed = 1;              // seed cho lỗi ngẫu nhiên (mỗi máy in khác nhau)
+};
+
+// Mã c_status máy in giả lập trả về
+namespace SimCStatus {
+    constexpr uint8_t Ok = 0x00;
+    constexpr uint8_t JetNotRunning = 0x01;     // StartPrint khi jet chưa chạy
+    constexpr uint8_t NoMessage = 0x02;         // StartPrint khi chưa load message
+    constexpr uint8_t BadLength = 0x03;         // payload sai độ dài
+    constexpr uint8_t Busy = 0x04;              // jet đang khởi động / đang tắt
+    constexpr uint8_t Fault = 0x05;             // đang có lỗi, cần khởi động lại jet
+    constexpr uint8_t UnknownCommand = 0x06;
+}
+
+// Bit p_status
+namespace SimPStatus {
+    constexpr uint8_t Ok = 0x00;
+    constexpr uint8_t Error = 0x01;             // errorMask != 0
+}
+
+//
+// Mô hình máy in Linx 8900 phía máy in (không I/O).
+// Xử lý 1 frame lệnh, ghi frame reply vào buffer của caller.
+// Trạng thái tính theo thời gian lúc xử lý (jet-up, số bản in) → không cần timer riêng.
+// Không thread-safe: mỗi máy in chỉ được dùng trên 1 thread.
+//
+class SimPrinter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Counters {
+        uint64_t commands = 0;
+        uint64_t naks = 0;
+        uint64_t prints = 0;            // tổng bản in
+        uint64_t faults = 0;
+        uint64_t downloadBytes = 0;     // 0x19 + 0x1D
+    };
+
+    explicit SimPrinter(const SimPrinterConfig& config = {});
+
+    // Xử lý 1 frame lệnh; trả về số byte reply (0 nếu buffer không đủ).
+    // readyAt = thời điểm sớm nhất được gửi reply (ackJetWhenReady), mặc định = now.
+    size_t Handle(const RciFrameView& request, Clock::time_point now,
+        uint8_t* out, size_t capacity, Clock::time_point& readyAt);
+
+    // Cập nhật trạng thái tới thời điểm now (gọi trước khi đọc trạng thái từ ngoài)
+    void Advance(Clock::time_point now);
+
+    void SetErrorMask(uint32_t mask) { config_.errorMask = mask; }
+    void ClearFaults() { faultMask_ = 0; }
+
+    uint32_t ErrorMask() const { return config_.errorMask | faultMask_; }
+    RciJetState JetState() const { return jet_; }
+    RciPrintState PrintState() const { return print_; }
+    const std::string& MessageName() const { return message_; }
+    const Counters& Stats() const { return counters_; }
+
+    // Dung lượng tối đa 1 reply (STATUS là reply dài nhất)
+    static constexpr size_t kMaxReplySize = RciFrame::MaxEncodedSize(3 + RciStatusView::kPayloadSize);
+
+private:
+    uint8_t OnStartJet(Clock::time_point now, Clock::time_point& readyAt);
+    uint8_t OnStopJet(Clock::time_point now, Clock::time_point& readyAt);
+    uint8_t OnStartPrint(Clock::time_point now);
+    uint8_t OnStopPrint();
+    uint8_t OnLoadMessage(const uint8_t* p, size_t n);
+    uint8_t OnRemoteField(const uint8_t* p, size_t n);
+
+    void StopPrinting();
+    void ScheduleFault(Clock::time_point now);
+    uint32_t NextRandom();
+
+    SimPrinterConfig config_;
+    RciJetState jet_ = RciJetState::Stopped;
+    RciPrintState print_ = RciPrintState::Idle;
+    Clock::time_point jetDoneAt_;       // hết Starting / Stopping
+    Clock::time_point printStart_;      // mốc tính số bản in
+    Clock::time_point faultAt_ = Clock::time_point::max();
+    uint64_t printedInRun_ = 0;         // bản in đã cộng vào counters_ trong lần in hiện tại
+    std::string message_;
+    uint16_t targetCount_ = 0;          // 0 = in liên tục
+    uint32_t faultMask_ = 0;
+    uint32_t rng_;
+    Counters counters_;
+};
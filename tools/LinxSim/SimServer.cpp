@@ -0,0 +1,382 @@
+﻿#include "SimServer.h"
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <unordered_set>
+
+using Clock = SimPrinter::Clock;
+
+// =========================================================
+// Shard: 1 reactor + các máy in / kết nối thuộc về nó
+// =========================================================
+struct SimServer::Shard {
+    RciReactor reactor;
+    std::vector<std::unique_ptr<Listener>> listeners;
+    std::unordered_set<Connection*> connections;    // chỉ dùng trên reactor thread
+    std::vector<Connection*> dead;                  // đã đóng, chờ xóa sau đợt sự kiện hiện tại
+
+    std::atomic<uint64_t> accepted{ 0 };
+    std::atomic<uint64_t> active{ 0 };
+    std::atomic<uint64_t> bytesIn{ 0 };
+    std::atomic<uint64_t> bytesOut{ 0 };
+
+    void CollectDead();
+};
+
+// =========================================================
+// Connection: 1 kết nối TCP tới 1 máy in giả lập
+// =========================================================
+class SimServer::Connection : public RciReactor::Handler {
+public:
+    Connection(Shard& shard, SimPrinter& printer, int fd, int delayUs)
+        : shard_(shard), printer_(printer), fd_(fd), delay_(std::chrono::microseconds(delayUs)) {}
+
+    ~Connection() override {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    uint64_t id = 0;
+
+    SimPrinter& Printer() { return printer_; }
+
+    void OnEvents(uint32_t events) override {
+        if (events & EPOLLIN) ReadAll();
+        if (closed_) return;
+        if (events & EPOLLOUT) Flush();
+        if (closed_) return;
+        if (events & (EPOLLERR | EPOLLHUP)) Close();
+    }
+
+    void OnTimer() override {
+        MoveDue(Clock::now());
+        Flush();
+        ArmNext();
+    }
+
+    void Close() {
+        if (closed_) return;
+        closed_ = true;
+        shard_.reactor.Remove(id);
+        shutdown(fd_, SHUT_RDWR);
+        shard_.connections.erase(this);
+        shard_.active--;
+
+        // handler vẫn đang chạy → xóa sau khi đợt sự kiện hiện tại kết thúc
+        bool first = shard_.dead.empty();
+        shard_.dead.push_back(this);
+        if (first) {
+            Shard* shard = &shard_;
+            shard_.reactor.Post([shard] { shard->CollectDead(); });
+        }
+    }
+
+private:
+    // Reply chờ tới hạn gửi (độ trễ xử lý / ACK jet khi chuỗi jet xong)
+    struct Delayed {
+        Clock::time_point when;
+        size_t size;
+        uint8_t bytes[SimPrinter::kMaxReplySize];
+    };
+
+    void ReadAll() {
+        uint8_t buf[4096];
+        while (!closed_) {
+            ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+            if (n > 0) {
+                shard_.bytesIn += (uint64_t)n;
+                Process(buf, (size_t)n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0 && errno == EINTR) continue;
+            Close();    // n == 0: client đóng kết nối
+            return;
+        }
+        Flush();
+        ArmNext();
+    }
+
+    void Process(const uint8_t* data, size_t len) {
+        Clock::time_point now = Clock::now();
+        size_t off = 0;
+        while (off < len) {
+            size_t used = 0;
+            if (decoder_.Feed(data + off, len - off, used) == RciDecoder::Result::Frame) {
+                uint8_t reply[SimPrinter::kMaxReplySize];
+                Clock::time_point readyAt;
+                size_t n = printer_.Handle(decoder_.Frame(), now, reply, sizeof(reply), readyAt);
+                if (n) Queue(reply, n, std::max(readyAt, now + delay_), now);
+            }
+            off += used;
+        }
+    }
+
+    // Giữ thứ tự reply theo thứ tự lệnh: reply sau không gửi trước reply đang chờ
+    void Queue(const uint8_t* reply, size_t n, Clock::time_point when, Clock::time_point now) {
+        if (delayed_.empty() && when <= now) {
+            tx_.insert(tx_.end(), reply, reply + n);
+            return;
+        }
+        if (!delayed_.empty() && when < delayed_.back().when) when = delayed_.back().when;
+        delayed_.emplace_back();
+        Delayed& d = delayed_.back();
+        d.when = when;
+        d.size = n;
+        memcpy(d.bytes, reply, n);
+    }
+
+    void MoveDue(Clock::time_point now) {
+        while (!delayed_.empty() && delayed_.front().when <= now) {
+            const Delayed& d = delayed_.front();
+            tx_.insert(tx_.end(), d.bytes, d.bytes + d.size);
+            delayed_.pop_front();
+        }
+    }
+
+    void ArmNext() {
+        if (!closed_ && !delayed_.empty()) shard_.reactor.ArmTimer(id, delayed_.front().when);
+    }
+
+    void Flush() {
+        while (!closed_ && txOff_ < tx_.size()) {
+            ssize_t n = send(fd_, tx_.data() + txOff_, tx_.size() - txOff_, MSG_NOSIGNAL);
+            if (n > 0) {
+                txOff_ += (size_t)n;
+                shard_.bytesOut += (uint64_t)n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;    // chờ EPOLLOUT
+            if (n < 0 && errno == EINTR) continue;
+            Close();
+            return;
+        }
+        tx_.clear();
+        txOff_ = 0;
+    }
+
+    Shard& shard_;
+    SimPrinter& printer_;
+    int fd_;
+    std::chrono::microseconds delay_;
+    RciDecoder decoder_;
+    std::vector<uint8_t> tx_;
+    size_t txOff_ = 0;
+    std::deque<Delayed> delayed_;
+    bool closed_ = false;
+};
+
+void SimServer::Shard::CollectDead() {
+    for (Connection* c : dead) delete c;
+    dead.clear();
+}
+
+// =========================================================
+// Listener: socket lắng nghe của 1 máy in
+// =========================================================
+class SimServer::Listener : public RciReactor::Handler {
+public:
+    Listener(Shard& shard, SimPrinter& printer, int fd, int delayUs)
+        : shard_(shard), printer_(printer), fd_(fd), delayUs_(delayUs) {}
+
+    ~Listener() override {
+        if (fd_ >= 0) close(fd_);
+    }
+
+    uint64_t id = 0;
+
+    void OnEvents(uint32_t) override {
+        while (true) {
+            int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;     // EAGAIN / hết fd: chờ lần sự kiện sau
+            }
+
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            auto* c = new Connection(shard_, printer_, fd, delayUs_);
+            c->id = shard_.reactor.Add(fd, c, EPOLLIN | EPOLLOUT | EPOLLRDHUP);
+            if (c->id == 0) {
+                delete c;
+                continue;
+            }
+            shard_.connections.insert(c);
+            shard_.accepted++;
+            shard_.active++;
+        }
+    }
+
+    void OnTimer() override {}
+
+private:
+    Shard& shard_;
+    SimPrinter& printer_;
+    int fd_;
+    int delayUs_;
+};
+
+// =========================================================
+// SimServer
+// =========================================================
+SimServer::SimServer() {}
+
+SimServer::~SimServer() {
+    Stop();
+}
+
+bool SimServer::Start(const Options& options, std::string& error) {
+    if (running_) return true;
+    if (options.count == 0 || options.basePort + options.count - 1 > 65535) {
+        error = "port range out of bounds";
+        return false;
+    }
+
+    options_ = options;
+    size_t threads = options.threads ? std::min(options.threads, options.count) : 1;
+
+    in_addr addr{};
+    if (inet_pton(AF_INET, options.bind.c_str(), &addr) != 1) {
+        error = "invalid bind address: " + options.bind;
+        return false;
+    }
+
+    for (size_t t = 0; t < threads; ++t)
+        shards_.push_back(std::make_unique<Shard>());
+
+    for (size_t i = 0; i < options.count; ++i) {
+        SimPrinterConfig cfg = options.printer;
+        cfg.seed = options.printer.seed + (uint32_t)i * 2654435761u;
+        if (options.errorEvery && i % options.errorEvery == 0) cfg.errorMask |= options.errorMask;
+        printers_.push_back(std::make_unique<SimPrinter>(cfg));
+
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            error = "socket() failed: " + std::string(strerror(errno));
+            Stop();
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in sa{};
+        sa.sin_family = AF_INET;
+        sa.sin_addr = addr;
+        sa.sin_port = htons(PortOf(i));
+        if (bind(fd, (sockaddr*)&sa, sizeof(sa)) != 0 || listen(fd, 64) != 0) {
+            error = "bind/listen port " + std::to_string(PortOf(i)) + " failed: " + strerror(errno);
+            close(fd);
+            Stop();
+            return false;
+        }
+
+        Shard& shard = ShardOf(i);
+        shard.listeners.push_back(std::make_unique<Listener>(shard, *printers_[i], fd, options.replyDelayUs));
+        Listener& l = *shard.listeners.back();
+        l.id = shard.reactor.Add(fd, &l, EPOLLIN);
+        if (l.id == 0) {
+            error = "epoll registration failed";
+            Stop();
+            return false;
+        }
+    }
+
+    for (auto& s : shards_) {
+        if (!s->reactor.Start()) {
+            error = "reactor start failed";
+            Stop();
+            return false;
+        }
+    }
+    running_ = true;
+    return true;
+}
+
+void SimServer::Stop() {
+    for (auto& s : shards_) s->reactor.Stop();
+
+    // reactor đã dừng → dọn trên thread hiện tại
+    for (auto& s : shards_) {
+        for (Connection* c : s->connections) delete c;
+        s->connections.clear();
+        s->CollectDead();
+        s->listeners.clear();
+    }
+    shards_.clear();
+    printers_.clear();
+    running_ = false;
+}
+
+void SimServer::WithPrinter(size_t index, const std::function<void(SimPrinter&)>& fn) {
+    if (!running_ || index >= printers_.size()) return;
+
+    std::promise<void> done;
+    SimPrinter* printer = printers_[index].get();
+    ShardOf(index).reactor.Post([&] {
+        fn(*printer);
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+void SimServer::DropConnections(size_t index) {
+    if (!running_ || index >= printers_.size()) return;
+
+    std::promise<void> done;
+    SimPrinter* printer = printers_[index].get();
+    Shard& shard = ShardOf(index);
+    shard.reactor.Post([&] {
+        std::vector<Connection*> victims;
+        for (Connection* c : shard.connections)
+            if (&c->Printer() == printer) victims.push_back(c);
+        for (Connection* c : victims) c->Close();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+SimServer::Totals SimServer::Snapshot() {
+    Totals t;
+    if (!running_) return t;
+    t.printers = printers_.size();
+
+    Clock::time_point now = Clock::now();
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        Shard& shard = *shards_[s];
+        t.accepted += shard.accepted;
+        t.active += shard.active;
+        t.bytesIn += shard.bytesIn;
+        t.bytesOut += shard.bytesOut;
+
+        // đọc máy in trên đúng reactor thread của shard
+        std::promise<void> done;
+        shard.reactor.Post([&] {
+            for (size_t i = s; i < printers_.size(); i += shards_.size()) {
+                SimPrinter& p = *printers_[i];
+                p.Advance(now);
+                const auto& c = p.Stats();
+                t.printer.commands += c.commands;
+                t.printer.naks += c.naks;
+                t.printer.prints += c.prints;
+                t.printer.faults += c.faults;
+                t.printer.downloadBytes += c.downloadBytes;
+                if (p.JetState() == RciJetState::Running) t.jetRunning++;
+                if (p.PrintState() == RciPrintState::Printing) t.printing++;
+                if (p.ErrorMask()) t.withError++;
+            }
+            done.set_value();
+        });
+        done.get_future().wait();
+    }
+    return t;
+}
+#endif
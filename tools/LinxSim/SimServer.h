@@ -0,0 +1,70 @@
+﻿#pragma once
+#ifdef __linux__
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "RciReactor.h"
+#include "SimPrinter.h"
+
+//
+// Server giả lập nhiều máy in Linx 8900 trong 1 process:
+// máy in i lắng nghe TCP tại basePort + i, các máy in chia đều cho vài RciReactor (epoll).
+// Mọi thao tác trên SimPrinter chạy trên reactor thread sở hữu máy in đó.
+//
+class SimServer {
+public:
+    struct Options {
+        std::string bind = "127.0.0.1";
+        uint16_t basePort = 9100;
+        size_t count = 1;               // số máy in
+        size_t threads = 1;             // số reactor thread
+        int replyDelayUs = 0;           // độ trễ xử lý mỗi lệnh
+        SimPrinterConfig printer;
+        uint32_t errorMask = 0;         // lỗi cố định cho 1 phần máy in
+        size_t errorEvery = 0;          // máy in i có errorMask nếu i % errorEvery == 0 (0 = không máy nào)
+    };
+
+    struct Totals {
+        size_t printers = 0;
+        uint64_t accepted = 0;          // số kết nối đã nhận
+        uint64_t active = 0;            // kết nối đang mở
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        SimPrinter::Counters printer;   // cộng dồn mọi máy in
+        size_t jetRunning = 0;
+        size_t printing = 0;
+        size_t withError = 0;
+    };
+
+    SimServer();
+    ~SimServer();
+
+    bool Start(const Options& options, std::string& error);
+    void Stop();
+
+    size_t PrinterCount() const { return printers_.size(); }
+    uint16_t PortOf(size_t index) const { return (uint16_t)(options_.basePort + index); }
+
+    // Chạy fn trên reactor thread của máy in index và chờ xong
+    void WithPrinter(size_t index, const std::function<void(SimPrinter&)>& fn);
+
+    // Đóng mọi kết nối tới máy in index (giả lập rớt mạng để đo reconnect)
+    void DropConnections(size_t index);
+
+    Totals Snapshot();
+
+private:
+    struct Shard;
+    class Listener;
+    class Connection;
+
+    Shard& ShardOf(size_t index) { return *shards_[index % shards_.size()]; }
+
+    Options options_;
+    std::vector<std::unique_ptr<SimPrinter>> printers_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    bool running_ = false;
+};
+#endif
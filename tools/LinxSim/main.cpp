@@ -0,0 +1,240 @@
+﻿//
+// LinxSim: máy in Linx 8900 giả lập (giao thức RCI qua TCP) để thử AppController / RciClient
+// mà không cần máy in thật. Chạy trên Linux (epoll).
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp SimServer.cpp SimPrinter.cpp
+//       ../../RciDecoder.cpp ../../RciSimd.cpp ../../RciReactor.cpp -o linxsim
+//
+// Ví dụ: 2000 máy in ở cổng 20000..21999, 4 thread, jet-up 4s, 10 bản/s, máy thứ 50 báo lỗi 0x10
+//   ./linxsim --port 20000 --count 2000 --threads 4 --jet-up 4000 --rate 10 --error-mask 0x10 --error-every 50
+//
+// Lệnh gõ khi đang chạy: stats | show <i> | err <i|all> <mask> | clear <i|all> | drop <i|all> | quit
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <csignal>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "SimServer.h"
+
+namespace {
+
+    std::atomic<bool> g_quit{ false };
+
+    void OnSignal(int) { g_quit = true; }
+
+    void Usage() {
+        std::puts(
+            "linxsim [options]\n"
+            "  --bind ADDR         dia chi lang nghe (127.0.0.1)\n"
+            "  --port N            cong cua may in dau tien (9100)\n"
+            "  --count N           so may in (1), may in i nghe cong port+i\n"
+            "  --threads N         so reactor thread (1)\n"
+            "  --jet-up MS         thoi gian khoi dong jet (4000)\n"
+            "  --jet-down MS       thoi gian tat jet (2000)\n"
+            "  --rate N            ban in / giay khi dang in (5)\n"
+            "  --error-mask HEX    errorMask co dinh\n"
+            "  --error-every K     chi may in i % K == 0 co error-mask (mac dinh: tat ca)\n"
+            "  --fault-rate N      loi ngau nhien / gio khi dang in (0)\n"
+            "  --fault-bits HEX    bit loi ngau nhien (0x100)\n"
+            "  --ack-jet-ready     ACK StartJet/StopJet khi chuoi jet ket thuc\n"
+            "  --delay-us N        do tre xu ly moi lenh (0)\n"
+            "  --drop-every SEC    dong ket noi cua 1 may in (lan luot) moi SEC giay (0 = tat)\n"
+            "  --stats SEC         in thong ke dinh ky (0 = tat)");
+    }
+
+    bool ParseArgs(int argc, char** argv, SimServer::Options& o, int& statsSec, int& dropSec) {
+        bool maskSet = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto next = [&](unsigned long long& v, int base) {
+                if (i + 1 >= argc) return false;
+                char* end = nullptr;
+                v = std::strtoull(argv[++i], &end, base);
+                return end && *end == 0;
+            };
+            unsigned long long v = 0;
+            bool ok = true;
+
+            if (a == "--bind" && i + 1 < argc) o.bind = argv[++i];
+            else if (a == "--port") { ok = next(v, 10); o.basePort = (uint16_t)v; }
+            else if (a == "--count") { ok = next(v, 10); o.count = (size_t)v; }
+            else if (a == "--threads") { ok = next(v, 10); o.threads = (size_t)v; }
+            else if (a == "--jet-up") { ok = next(v, 10); o.printer.jetUpMs = (int)v; }
+            else if (a == "--jet-down") { ok = next(v, 10); o.printer.jetDownMs = (int)v; }
+            else if (a == "--rate" && i + 1 < argc) o.printer.printsPerSec = std::atof(argv[++i]);
+            else if (a == "--error-mask") { ok = next(v, 16); o.errorMask = (uint32_t)v; maskSet = true; }
+            else if (a == "--error-every") { ok = next(v, 10); o.errorEvery = (size_t)v; }
+            else if (a == "--fault-rate" && i + 1 < argc) o.printer.faultsPerHour = std::atof(argv[++i]);
+            else if (a == "--fault-bits") { ok = next(v, 16); o.printer.faultBits = (uint32_t)v; }
+            else if (a == "--ack-jet-ready") o.printer.ackJetWhenReady = true;
+            else if (a == "--delay-us") { ok = next(v, 10); o.replyDelayUs = (int)v; }
+            else if (a == "--stats") { ok = next(v, 10); statsSec = (int)v; }
+            else if (a == "--drop-every") { ok = next(v, 10); dropSec = (int)v; }
+            else ok = false;
+
+            if (!ok) {
+                std::fprintf(stderr, "tham so khong hop le: %s\n", a.c_str());
+                return false;
+            }
+        }
+        if (maskSet && o.errorEvery == 0) o.errorEvery = 1;
+        return true;
+    }
+
+    // Mỗi máy in cần 1 fd lắng nghe + fd kết nối → nâng giới hạn fd mềm lên mức cứng
+    void RaiseFdLimit() {
+        rlimit rl{};
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+            rl.rlim_cur = rl.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+    }
+
+    void PrintStats(SimServer& server) {
+        SimServer::Totals t = server.Snapshot();
+        std::printf("printers=%zu conn=%llu/%llu cmds=%llu naks=%llu prints=%llu faults=%llu "
+            "jet=%zu printing=%zu error=%zu in=%lluB out=%lluB\n",
+            t.printers, (unsigned long long)t.active, (unsigned long long)t.accepted,
+            (unsigned long long)t.printer.commands, (unsigned long long)t.printer.naks,
+            (unsigned long long)t.printer.prints, (unsigned long long)t.printer.faults,
+            t.jetRunning, t.printing, t.withError,
+            (unsigned long long)t.bytesIn, (unsigned long long)t.bytesOut);
+        std::fflush(stdout);
+    }
+
+    // Áp dụng fn cho máy in "i" hoặc "all"
+    void ForPrinters(SimServer& server, const std::string& which, const std::function<void(SimPrinter&)>& fn) {
+        if (which == "all") {
+            for (size_t i = 0; i < server.PrinterCount(); ++i) server.WithPrinter(i, fn);
+            return;
+        }
+        size_t i = (size_t)std::strtoull(which.c_str(), nullptr, 10);
+        if (i < server.PrinterCount()) server.WithPrinter(i, fn);
+        else std::printf("khong co may in %s\n", which.c_str());
+    }
+
+    void RunCommand(SimServer& server, const std::string& line) {
+        std::istringstream in(line);
+        std::string cmd, which, arg;
+        in >> cmd >> which >> arg;
+
+        if (cmd.empty()) return;
+        if (cmd == "quit" || cmd == "exit") {
+            g_quit = true;
+        }
+        else if (cmd == "stats") {
+            PrintStats(server);
+        }
+        else if (cmd == "err" && !which.empty() && !arg.empty()) {
+            uint32_t mask = (uint32_t)std::strtoul(arg.c_str(), nullptr, 16);
+            ForPrinters(server, which, [mask](SimPrinter& p) { p.SetErrorMask(mask); });
+        }
+        else if (cmd == "clear" && !which.empty()) {
+            ForPrinters(server, which, [](SimPrinter& p) { p.SetErrorMask(0); p.ClearFaults(); });
+        }
+        else if (cmd == "drop" && !which.empty()) {
+            if (which == "all") {
+                for (size_t i = 0; i < server.PrinterCount(); ++i) server.DropConnections(i);
+            }
+            else {
+                server.DropConnections((size_t)std::strtoull(which.c_str(), nullptr, 10));
+            }
+        }
+        else if (cmd == "show" && !which.empty()) {
+            size_t i = (size_t)std::strtoull(which.c_str(), nullptr, 10);
+            server.WithPrinter(i, [&](SimPrinter& p) {
+                p.Advance(SimPrinter::Clock::now());
+                const auto& c = p.Stats();
+                std::printf("#%zu port=%u jet=%02x print=%02x err=%08x msg='%s' cmds=%llu prints=%llu faults=%llu\n",
+                    i, server.PortOf(i), (unsigned)p.JetState(), (unsigned)p.PrintState(), p.ErrorMask(),
+                    p.MessageName().c_str(), (unsigned long long)c.commands,
+                    (unsigned long long)c.prints, (unsigned long long)c.faults);
+            });
+        }
+        else {
+            std::puts("lenh: stats | show <i> | err <i|all> <mask> | clear <i|all> | drop <i|all> | quit");
+        }
+        std::fflush(stdout);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SimServer::Options options;
+    int statsSec = 0;
+    int dropSec = 0;
+    if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)) {
+        Usage();
+        return 0;
+    }
+    if (!ParseArgs(argc, argv, options, statsSec, dropSec)) {
+        Usage();
+        return 2;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+    RaiseFdLimit();
+
+    SimServer server;
+    std::string error;
+    if (!server.Start(options, error)) {
+        std::fprintf(stderr, "linxsim: %s\n", error.c_str());
+        return 1;
+    }
+    std::printf("linxsim: %zu printer(s) on %s:%u-%u\n", server.PrinterCount(), options.bind.c_str(),
+        server.PortOf(0), server.PortOf(server.PrinterCount() - 1));
+    std::fflush(stdout);
+
+    // stdin đóng (chạy nền) → chỉ chờ tín hiệu dừng
+    bool stdinOpen = true;
+    auto nextStats = std::chrono::steady_clock::now() + std::chrono::seconds(statsSec);
+    auto nextDrop = std::chrono::steady_clock::now() + std::chrono::seconds(dropSec);
+    size_t dropIndex = 0;
+    std::string pending;
+
+    while (!g_quit) {
+        pollfd pfd{ STDIN_FILENO, POLLIN, 0 };
+        int r = poll(&pfd, stdinOpen ? 1 : 0, 200);
+        if (r > 0 && (pfd.revents & (POLLIN | POLLHUP))) {
+            char buf[256];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n <= 0) {
+                stdinOpen = false;
+            }
+            else {
+                pending.append(buf, (size_t)n);
+                size_t pos;
+                while ((pos = pending.find('\n')) != std::string::npos) {
+                    RunCommand(server, pending.substr(0, pos));
+                    pending.erase(0, pos + 1);
+                }
+            }
+        }
+
+        if (statsSec > 0 && std::chrono::steady_clock::now() >= nextStats) {
+            PrintStats(server);
+            nextStats += std::chrono::seconds(statsSec);
+        }
+
+        if (dropSec > 0 && std::chrono::steady_clock::now() >= nextDrop) {
+            server.DropConnections(dropIndex);
+            dropIndex = (dropIndex + 1) % server.PrinterCount();
+            nextDrop += std::chrono::seconds(dropSec);
+        }
+    }
+
+    server.Stop();
+    return 0;
+}
@@ -0,0 +1,720 @@
+﻿//
+// LogAnalyzer: thống kê file log của app (Logger / AsyncLogBackend) mà không phải đọc tay:
+//   - mỗi phiên chạy (từ "Logger initialized"): thời lượng, uptime kết nối, số lần kết nối lại,
+//     thời gian trung bình để kết nối lại (MTTR), số lần kết nối lỗi, số dòng ERROR
+//   - histogram mã lỗi ("error: 10061", "Err=", "WSAError=", "SO_ERROR=")
+//   - những phút có nhiều dòng log nhất
+//
+// File .log được map vào bộ nhớ (mmap / MapViewOfFile), chia thành từng đoạn ~16 MB cắt ở cuối dòng,
+// các thread parse song song trên chính vùng đã map (string_view, không chép dòng).
+// Segment nén .log.lz (LogArchive.h) cũng được map; mỗi khối giải nén vào buffer của thread rồi
+// parse như trên, khối lưu nguyên được parse thẳng trên vùng map. Có --from / --to thì dùng .idx
+// để bỏ qua các khối nằm ngoài khoảng thời gian.
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp -o loganalyzer
+//   cl /std:c++20 /O2 /EHsc /I..\.. main.cpp
+//
+// Ví dụ:
+//   loganalyzer linx_controller.log
+//   loganalyzer --history linx_controller.log --from "2026-10-01" --to "2026-10-08 12:00"
+//   loganalyzer --threads 8 --top 20 --sessions all old1.log old2.log
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "LogArchive.h"
+
+namespace {
+
+    namespace fs = std::filesystem;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int64_t kMinuteUs = 60ll * 1000000;
+    constexpr int64_t kDayUs = 24ll * 60 * kMinuteUs;
+
+    // File chỉ đọc map vào bộ nhớ; Windows: cho app tiếp tục ghi file đang map
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+#ifdef _WIN32
+            if (data_) UnmapViewOfFile(data_);
+            if (mapping_) CloseHandle(mapping_);
+            if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+            if (data_) munmap((void*)data_, size_);
+#endif
+        }
+
+        bool Open(const fs::path& path) {
+#ifdef _WIN32
+            file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_, &size)) return false;
+            size_ = (size_t)size.QuadPart;
+            if (size_ == 0) return true;
+            mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping_) return false;
+            data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+            return data_ != nullptr;
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                ::close(fd);
+                return false;
+            }
+            size_ = (size_t)st.st_size;
+            if (size_ > 0) {
+                void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    data_ = (const char*)p;
+                    madvise(p, size_, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+            return size_ == 0 || data_ != nullptr;
+#endif
+        }
+
+        const char* Data() const { return data_; }
+        size_t Size() const { return size_; }
+
+    private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        HANDLE mapping_ = nullptr;
+#endif
+    };
+
+    enum class EventKind : uint8_t {
+        SessionStart,       // "Logger initialized"
+        SessionEnd,         // "Application shutting down"
+        Connected,          // "Connected to printer ..."
+        ConnectFailed,      // "Connection failed to ..., error: N"
+        Lost,               // "Disconnected from printer (connection lost ...)" / dòng cũ không rõ lý do
+        UserDisconnect,     // "Disconnected from printer (user request)"
+        ErrorLine,          // dòng [ERROR] bất kỳ
+    };
+
+    struct Event {
+        int64_t timeUs;         // dated: LogCivilMicros, không thì giờ trong ngày
+        int64_t prevTimeUs;     // dòng ngay trước (SessionStart: mốc kết thúc phiên trước), -1 = đầu đoạn
+        EventKind kind;
+        bool dated;
+    };
+
+    // Kết quả parse 1 đoạn (ghép theo đúng thứ tự đoạn)
+    struct UnitResult {
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+        uint64_t undated = 0;               // dòng chỉ có giờ (log cũ)
+        uint64_t levels[4] = {};            // INFO / WARNING / ERROR / DEBUG
+        int64_t lastTimeUs = -1;
+        bool lastDated = false;
+        std::vector<Event> events;
+        std::unordered_map<int, uint64_t> codes;
+        std::unordered_map<int64_t, uint32_t> perMinute;   // < 0: phút trong ngày của dòng không có ngày
+        bool ok = true;
+    };
+
+    struct Source {
+        fs::path path;
+        std::unique_ptr<MappedFile> map;
+        bool packed = false;
+    };
+
+    // 1 đơn vị việc: đoạn text trong file map hoặc 1 khối nén
+    struct WorkUnit {
+        const Source* source;
+        uint64_t offset;
+        uint32_t rawSize;
+        uint32_t packedSize;    // 0: text thường
+    };
+
+    struct Options {
+        std::vector<fs::path> inputs;
+        bool history = false;
+        int64_t from = INT64_MIN;
+        int64_t to = INT64_MAX;
+        size_t threads = 0;
+        size_t top = 10;
+        size_t sessions = 20;           // SIZE_MAX = tất cả
+        size_t chunkBytes = 16u << 20;
+    };
+
+    bool StartsWith(std::string_view s, std::string_view prefix) {
+        return s.size() >= prefix.size() && std::memcmp(s.data(), prefix.data(), prefix.size()) == 0;
+    }
+
+    // Số nguyên ngay sau key đầu tiên tìm thấy trong s
+    bool FindCode(std::string_view s, std::string_view key, int& code) {
+        size_t at = s.find(key);
+        if (at == std::string_view::npos) return false;
+        at += key.size();
+        bool neg = at < s.size() && s[at] == '-';
+        if (neg) ++at;
+        if (at >= s.size() || s[at] < '0' || s[at] > '9') return false;
+        int v = 0;
+        while (at < s.size() && s[at] >= '0' && s[at] <= '9') v = v * 10 + (s[at++] - '0');
+        code = neg ? -v : v;
+        return true;
+    }
+
+    // "HH:MM:SS.mmm" (log trước khi có ngày)
+    bool ParseTimeOfDay(const char* p, size_t n, int64_t& timeUs) {
+        static const char kPattern[] = "dd:dd:dd.ddd";
+        if (n < sizeof(kPattern) - 1) return false;
+        for (size_t i = 0; i < sizeof(kPattern) - 1; ++i) {
+            if (kPattern[i] == 'd' ? (p[i] < '0' || p[i] > '9') : p[i] != kPattern[i]) return false;
+        }
+        auto num = [p](size_t at, size_t len) {
+            int v = 0;
+            for (size_t i = 0; i < len; ++i) v = v * 10 + (p[at + i] - '0');
+            return (int64_t)v;
+        };
+        timeUs = ((num(0, 2) * 60 + num(3, 2)) * 60 + num(6, 2)) * 1000000 + num(9, 3) * 1000;
+        return true;
+    }
+
+    void ParseText(const char* data, size_t size, const Options& opt, UnitResult& r) {
+        r.bytes += size;
+        const char* p = data;
+        const char* end = data + size;
+        int64_t minuteKey = INT64_MIN;
+        uint32_t minuteCount = 0;
+        int64_t prevTime = -1;
+
+        while (p < end) {
+            const char* nl = (const char*)std::memchr(p, '\n', (size_t)(end - p));
+            const char* lineEnd = nl ? nl : end;
+            std::string_view line(p, (size_t)(lineEnd - p));
+            p = nl ? nl + 1 : end;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty()) continue;
+
+            int64_t t;
+            bool dated;
+            size_t at;
+            if (LogParseLineTime(line.data(), line.size(), t)) {
+                dated = true;
+                at = 24;
+            }
+            else if (ParseTimeOfDay(line.data(), line.size(), t)) {
+                dated = false;
+                at = 13;
+            }
+            else continue;      // dòng tiếp của 1 message nhiều dòng
+            if (dated ? (t < opt.from || t > opt.to) : (opt.from != INT64_MIN || opt.to != INT64_MAX)) continue;
+            if (at > line.size()) continue;
+            std::string_view rest = line.substr(at);
+
+            int level = 0;
+            size_t tag = 0;
+            if (StartsWith(rest, "[INFO] ")) { level = 0; tag = 7; }
+            else if (StartsWith(rest, "[WARNING] ")) { level = 1; tag = 10; }
+            else if (StartsWith(rest, "[ERROR] ")) { level = 2; tag = 8; }
+            else if (StartsWith(rest, "[DEBUG] ")) { level = 3; tag = 8; }
+            std::string_view msg = rest.substr(tag);
+
+            ++r.lines;
+            ++r.levels[level];
+            if (!dated) ++r.undated;
+
+            int64_t key = dated ? t / kMinuteUs : -1 - t / kMinuteUs;
+            if (key != minuteKey) {
+                if (minuteCount) r.perMinute[minuteKey] += minuteCount;
+                minuteKey = key;
+                minuteCount = 0;
+            }
+            ++minuteCount;
+
+            auto push = [&](EventKind kind) { r.events.push_back(Event{ t, prevTime, kind, dated }); };
+            switch (msg.empty() ? 0 : msg[0]) {
+            case 'L':
+                if (StartsWith(msg, "Logger initialized")) push(EventKind::SessionStart);
+                break;
+            case 'A':
+                if (StartsWith(msg, "Application shutting down")) push(EventKind::SessionEnd);
+                break;
+            case 'C':
+                if (StartsWith(msg, "Connected to printer")) push(EventKind::Connected);
+                else if (StartsWith(msg, "Connection failed to")) push(EventKind::ConnectFailed);
+                break;
+            case 'D':
+                if (StartsWith(msg, "Disconnected from printer"))
+                    push(msg.find("user request") != std::string_view::npos ? EventKind::UserDisconnect : EventKind::Lost);
+                break;
+            }
+            if (level == 2) push(EventKind::ErrorLine);
+
+            if (level == 1 || level == 2) {
+                int code;
+                if (FindCode(msg, "error: ", code) || FindCode(msg, "WSAError=", code) ||
+                    FindCode(msg, "SO_ERROR=", code) || FindCode(msg, "Err=", code)) {
+                    if (code != 0) ++r.codes[code];
+                }
+            }
+            prevTime = t;
+            r.lastTimeUs = t;
+            r.lastDated = dated;
+        }
+        if (minuteCount) r.perMinute[minuteKey] += minuteCount;
+    }
+
+    void RunUnit(const WorkUnit& unit, const Options& opt, UnitResult& r, std::vector<char>& scratch) {
+        const char* base = unit.source->map->Data() + unit.offset;
+        if (unit.packedSize == 0 || unit.packedSize == unit.rawSize) {
+            ParseText(base, unit.rawSize, opt, r);
+            return;
+        }
+        scratch.resize(unit.rawSize);
+        if (!LogCodec::Decompress((const uint8_t*)base, unit.packedSize, (uint8_t*)scratch.data(), unit.rawSize)) {
+            r.ok = false;
+            return;
+        }
+        ParseText(scratch.data(), scratch.size(), opt, r);
+    }
+
+    // Cắt file text thành các đoạn ~chunkBytes ở cuối dòng
+    void SplitText(const Source& src, size_t chunkBytes, std::vector<WorkUnit>& units) {
+        const char* data = src.map->Data();
+        size_t size = src.map->Size();
+        size_t off = 0;
+        while (off < size) {
+            size_t end = std::min(size, off + chunkBytes);
+            if (end < size) {
+                const char* nl = (const char*)std::memchr(data + end, '\n', size - end);
+                end = nl ? (size_t)(nl - data) + 1 : size;
+            }
+            // 1 đoạn tối đa 4 GB (rawSize 32 bit)
+            end = std::min(end, off + (size_t)UINT32_MAX);
+            units.push_back(WorkUnit{ &src, off, (uint32_t)(end - off), 0 });
+            off = end;
+        }
+    }
+
+    // Khối của .log.lz: theo .idx (bỏ khối ngoài khoảng thời gian), không có .idx thì đi theo header khối
+    bool SplitPacked(const Source& src, const Options& opt, std::vector<WorkUnit>& units, uint64_t& skipped) {
+        const char* data = src.map->Data();
+        size_t size = src.map->Size();
+        if (size < 8 || std::memcmp(data, "LXLZ", 4) != 0) return false;
+
+        fs::path indexPath = src.path;
+        indexPath.replace_extension();      // X.log.lz → X.log
+        indexPath.replace_extension(".idx");
+        LogIndexHeader header;
+        std::vector<LogIndexEntry> entries;
+        if (LogReadIndex(indexPath, header, entries)) {
+            for (size_t i = 0; i < entries.size(); ++i) {
+                const auto& e = entries[i];
+                if (e.fileOffset + e.packedSize > size) return false;
+                int64_t next = i + 1 < entries.size() ? entries[i + 1].timeUs : header.lastTimeUs;
+                bool known = e.timeUs != 0;
+                if (known && (e.timeUs > opt.to || (next != 0 && next < opt.from))) {
+                    ++skipped;
+                    continue;
+                }
+                units.push_back(WorkUnit{ &src, e.fileOffset, e.rawSize, e.packedSize });
+            }
+            return true;
+        }
+
+        size_t off = 8;
+        while (off + 8 <= size) {
+            uint32_t sizes[2];
+            std::memcpy(sizes, data + off, sizeof(sizes));
+            off += 8;
+            if (off + sizes[1] > size) return false;
+            units.push_back(WorkUnit{ &src, off, sizes[0], sizes[1] });
+            off += sizes[1];
+        }
+        return true;
+    }
+
+    struct Session {
+        int64_t start = 0;
+        int64_t end = 0;
+        bool dated = false;
+        uint64_t connects = 0;
+        uint64_t reconnects = 0;
+        uint64_t failures = 0;
+        uint64_t lost = 0;
+        uint64_t errors = 0;
+        int64_t uptimeUs = 0;
+        int64_t reconnectUs = 0;        // tổng thời gian từ lúc mất kết nối tới khi kết nối lại
+    };
+
+    // Ghép sự kiện theo thứ tự → phiên. Dòng không có ngày: qua nửa đêm khi giờ lùi > 1 giờ.
+    class SessionBuilder {
+    public:
+        void Add(const Event& e) {
+            int64_t t = Resolve(e.timeUs, e.dated);
+            if (e.kind == EventKind::SessionStart) {
+                if (open_) Close(e.prevTimeUs >= 0 ? Resolve(e.prevTimeUs, e.dated, false) : last_);
+                sessions_.push_back(Session{});
+                sessions_.back().start = t;
+                sessions_.back().dated = e.dated;
+                open_ = true;
+            }
+            else if (!open_) {
+                // log bắt đầu giữa phiên (segment đầu đã bị xóa)
+                sessions_.push_back(Session{});
+                sessions_.back().start = t;
+                sessions_.back().dated = e.dated;
+                open_ = true;
+            }
+            Session& s = sessions_.back();
+            switch (e.kind) {
+            case EventKind::SessionEnd:
+                Close(t);
+                break;
+            case EventKind::Connected:
+                ++s.connects;
+                if (lostAt_ >= 0) {
+                    ++s.reconnects;
+                    s.reconnectUs += t - lostAt_;
+                    lostAt_ = -1;
+                }
+                if (connectedSince_ < 0) connectedSince_ = t;
+                break;
+            case EventKind::ConnectFailed:
+                ++s.failures;
+                break;
+            case EventKind::Lost:
+                ++s.lost;
+                if (connectedSince_ >= 0) s.uptimeUs += t - connectedSince_;
+                connectedSince_ = -1;
+                if (lostAt_ < 0) lostAt_ = t;
+                break;
+            case EventKind::UserDisconnect:
+                if (connectedSince_ >= 0) s.uptimeUs += t - connectedSince_;
+                connectedSince_ = -1;
+                lostAt_ = -1;
+                break;
+            case EventKind::ErrorLine:
+                ++s.errors;
+                break;
+            default:
+                break;
+            }
+            last_ = t;
+        }
+
+        // Dòng cuối của 1 đoạn (mốc kết thúc phiên nếu phiên không có dòng shutdown)
+        void Touch(int64_t timeUs, bool dated) {
+            if (timeUs >= 0) last_ = Resolve(timeUs, dated);
+        }
+
+        std::vector<Session> Finish() {
+            if (open_) Close(last_);
+            return std::move(sessions_);
+        }
+
+    private:
+        int64_t Resolve(int64_t t, bool dated, bool advance = true) {
+            if (dated) return t;
+            if (lastTod_ >= 0 && t + 3600ll * 1000000 < lastTod_) {
+                if (!advance) return t + (dayBase_ + kDayUs);
+                dayBase_ += kDayUs;
+            }
+            if (advance) lastTod_ = t;
+            return t + dayBase_;
+        }
+
+        void Close(int64_t t) {
+            if (!open_) return;
+            Session& s = sessions_.back();
+            s.end = std::max(t, s.start);
+            if (connectedSince_ >= 0) s.uptimeUs += s.end - connectedSince_;
+            connectedSince_ = -1;
+            lostAt_ = -1;
+            open_ = false;
+        }
+
+        std::vector<Session> sessions_;
+        bool open_ = false;
+        int64_t last_ = 0;
+        int64_t connectedSince_ = -1;
+        int64_t lostAt_ = -1;
+        int64_t dayBase_ = 0;
+        int64_t lastTod_ = -1;
+    };
+
+    std::string FormatTime(int64_t us, bool dated) {
+        int64_t minutes = us / kMinuteUs;
+        int64_t secs = us / 1000000 % 60;
+        char buf[64];
+        if (!dated) {
+            int64_t tod = minutes % (24 * 60);
+            std::snprintf(buf, sizeof(buf), "day+%lld %02lld:%02lld:%02lld", (long long)(minutes / (24 * 60)),
+                (long long)(tod / 60), (long long)(tod % 60), (long long)secs);
+            return buf;
+        }
+        // ngược lại LogCivilMicros (civil-from-days)
+        int64_t z = us / kDayUs + 719468;
+        int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+        int64_t doe = z - era * 146097;
+        int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        int64_t mp = (5 * doy + 2) / 153;
+        int64_t d = doy - (153 * mp + 2) / 5 + 1;
+        int64_t m = mp < 10 ? mp + 3 : mp - 9;
+        int64_t y = yoe + era * 400 + (m <= 2);
+        int64_t tod = minutes % (24 * 60);
+        std::snprintf(buf, sizeof(buf), "%04lld-%02lld-%02lld %02lld:%02lld:%02lld", (long long)y, (long long)m, (long long)d,
+            (long long)(tod / 60), (long long)(tod % 60), (long long)secs);
+        return buf;
+    }
+
+    std::string FormatDuration(int64_t us) {
+        int64_t s = us / 1000000;
+        char buf[32];
+        if (s >= 3600) std::snprintf(buf, sizeof(buf), "%lldh%02lldm", (long long)(s / 3600), (long long)(s / 60 % 60));
+        else if (s >= 60) std::snprintf(buf, sizeof(buf), "%lldm%02llds", (long long)(s / 60), (long long)(s % 60));
+        else std::snprintf(buf, sizeof(buf), "%.1fs", us / 1e6);
+        return buf;
+    }
+
+    const char* CodeName(int code) {
+        switch (code) {
+        case 10060: case 110: return "timed out";
+        case 10061: case 111: return "connection refused";
+        case 10065: case 113: return "host unreachable";
+        case 10051: case 101: return "network unreachable";
+        case 10054: case 104: return "connection reset";
+        case 10053: case 103: return "connection aborted";
+        case 10050: case 100: return "network down";
+        default: return "";
+        }
+    }
+
+    // "YYYY-MM-DD[ HH:MM[:SS]]" → micro giây (cùng hệ với index)
+    bool ParseArgTime(const char* s, bool endOfRange, int64_t& out) {
+        int y, mo, d, h = 0, mi = 0, sec = 0;
+        int n = std::sscanf(s, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &sec);
+        if (n < 3) return false;
+        out = LogCivilMicros(y, mo, d, h, mi, sec, 0);
+        if (endOfRange) {
+            // --to "2026-10-08" = hết ngày; "... 12:00" = hết phút đó
+            if (n == 3) out += kDayUs - 1;
+            else if (n == 5) out += kMinuteUs - 1;
+            else if (n == 6) out += 1000000 - 1;
+        }
+        return true;
+    }
+
+    bool ParseArgs(int argc, char** argv, Options& opt) {
+        for (int i = 1; i < argc; ++i) {
+            const char* a = argv[i];
+            bool more = i + 1 < argc;
+            if (!std::strcmp(a, "--history")) opt.history = true;
+            else if (!std::strcmp(a, "--from") && more) { if (!ParseArgTime(argv[++i], false, opt.from)) return false; }
+            else if (!std::strcmp(a, "--to") && more) { if (!ParseArgTime(argv[++i], true, opt.to)) return false; }
+            else if (!std::strcmp(a, "--threads") && more) opt.threads = (size_t)std::atol(argv[++i]);
+            else if (!std::strcmp(a, "--top") && more) opt.top = (size_t)std::atol(argv[++i]);
+            else if (!std::strcmp(a, "--sessions") && more) {
+                const char* v = argv[++i];
+                opt.sessions = !std::strcmp(v, "all") ? SIZE_MAX : (size_t)std::atol(v);
+            }
+            else if (!std::strcmp(a, "--chunk-mb") && more) opt.chunkBytes = (size_t)std::atol(argv[++i]) << 20;
+            else if (a[0] == '-') return false;
+            else opt.inputs.push_back(fs::path(a));
+        }
+        if (opt.chunkBytes == 0) opt.chunkBytes = 16u << 20;
+        return !opt.inputs.empty();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        std::printf(
+            "loganalyzer [--history] [--from T] [--to T] [--threads N] [--top N] [--sessions N|all] file...\n"
+            "  file        .log (text) hoặc .log.lz (segment nén)\n"
+            "  --history   file là log đang ghi (vd. linx_controller.log): đọc thêm mọi segment đã đóng\n"
+            "  T           \"YYYY-MM-DD\", \"YYYY-MM-DD HH:MM\" hoặc \"YYYY-MM-DD HH:MM:SS\"\n");
+        return 1;
+    }
+
+    // danh sách file theo thứ tự thời gian
+    std::vector<fs::path> files;
+    for (const auto& input : opt.inputs) {
+        if (opt.history) {
+            for (const auto& seg : LogListSegments(input)) {
+                if (!seg.packed.empty()) files.push_back(seg.packed);
+                else if (!seg.plain.empty()) files.push_back(seg.plain);
+            }
+        }
+        files.push_back(input);
+    }
+
+    auto t0 = Clock::now();
+    std::vector<std::unique_ptr<Source>> sources;
+    std::vector<WorkUnit> units;
+    uint64_t skippedBlocks = 0;
+    uint64_t mappedBytes = 0;
+    for (const auto& path : files) {
+        auto src = std::make_unique<Source>();
+        src->path = path;
+        src->map = std::make_unique<MappedFile>();
+        if (!src->map->Open(path)) {
+            std::fprintf(stderr, "Không mở được %s\n", path.string().c_str());
+            continue;
+        }
+        mappedBytes += src->map->Size();
+        src->packed = path.extension() == ".lz";
+        if (src->packed) {
+            if (!SplitPacked(*src, opt, units, skippedBlocks))
+                std::fprintf(stderr, "Segment nén hỏng: %s\n", path.string().c_str());
+        }
+        else {
+            SplitText(*src, opt.chunkBytes, units);
+        }
+        sources.push_back(std::move(src));
+    }
+
+    size_t threadCount = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, std::max<size_t>(units.size(), 1));
+    std::vector<UnitResult> results(units.size());
+    std::atomic<size_t> next{ 0 };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&] {
+            std::vector<char> scratch;
+            for (size_t u; (u = next.fetch_add(1, std::memory_order_relaxed)) < units.size(); )
+                RunUnit(units[u], opt, results[u], scratch);
+            });
+    }
+    for (auto& t : threads) t.join();
+    double parseSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    // ghép theo thứ tự đoạn
+    UnitResult total;
+    std::unordered_map<int64_t, uint64_t> perMinute;
+    SessionBuilder builder;
+    uint64_t badUnits = 0;
+    for (auto& r : results) {
+        if (!r.ok) ++badUnits;
+        total.lines += r.lines;
+        total.bytes += r.bytes;
+        total.undated += r.undated;
+        for (int l = 0; l < 4; ++l) total.levels[l] += r.levels[l];
+        for (const auto& [code, n] : r.codes) total.codes[code] += n;
+        for (const auto& [minute, n] : r.perMinute) perMinute[minute] += n;
+        for (const auto& e : r.events) builder.Add(e);
+        builder.Touch(r.lastTimeUs, r.lastDated);
+    }
+    std::vector<Session> sessions = builder.Finish();
+    double totalSeconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::printf("%zu file, %.1f MB trên đĩa, %.1f MB text, %llu dòng (%llu dòng không có ngày)\n",
+        sources.size(), mappedBytes / 1e6, total.bytes / 1e6,
+        (unsigned long long)total.lines, (unsigned long long)total.undated);
+    std::printf("parse %.3f s (%.2f GB/s, %zu thread, %zu đoạn, %llu khối bỏ qua theo index), tổng %.3f s\n",
+        parseSeconds, total.bytes / 1e9 / std::max(parseSeconds, 1e-9), threadCount, units.size(),
+        (unsigned long long)skippedBlocks, totalSeconds);
+    if (badUnits) std::printf("CẢNH BÁO: %llu khối nén giải nén lỗi\n", (unsigned long long)badUnits);
+    std::printf("INFO %llu  WARNING %llu  ERROR %llu  DEBUG %llu\n\n",
+        (unsigned long long)total.levels[0], (unsigned long long)total.levels[1],
+        (unsigned long long)total.levels[2], (unsigned long long)total.levels[3]);
+
+    // phiên
+    Session sum;
+    uint64_t reconnectSamples = 0;
+    int64_t wallUs = 0;
+    for (const auto& s : sessions) {
+        sum.connects += s.connects;
+        sum.reconnects += s.reconnects;
+        sum.failures += s.failures;
+        sum.lost += s.lost;
+        sum.errors += s.errors;
+        sum.uptimeUs += s.uptimeUs;
+        sum.reconnectUs += s.reconnectUs;
+        reconnectSamples += s.reconnects;
+        wallUs += s.end - s.start;
+    }
+    size_t first = sessions.size() > opt.sessions ? sessions.size() - opt.sessions : 0;
+    std::printf("%zu phiên%s\n", sessions.size(), first ? " (chỉ in các phiên cuối, --sessions all để in hết)" : "");
+    std::printf("%-22s %10s %7s %8s %8s %8s %6s %10s %7s\n",
+        "bắt đầu", "thời lượng", "uptime", "kết nối", "mất kết", "kết lại", "lỗi kn", "MTTR", "ERROR");
+    for (size_t i = first; i < sessions.size(); ++i) {
+        const auto& s = sessions[i];
+        int64_t len = s.end - s.start;
+        std::printf("%-22s %10s %6.1f%% %8llu %8llu %8llu %6llu %10s %7llu\n",
+            FormatTime(s.start, s.dated).c_str(), FormatDuration(len).c_str(),
+            len > 0 ? 100.0 * (double)s.uptimeUs / (double)len : 0.0,
+            (unsigned long long)s.connects, (unsigned long long)s.lost, (unsigned long long)s.reconnects,
+            (unsigned long long)s.failures,
+            s.reconnects ? FormatDuration(s.reconnectUs / (int64_t)s.reconnects).c_str() : "-",
+            (unsigned long long)s.errors);
+    }
+    std::printf("tổng: thời gian chạy %s, uptime %.1f%%, %llu kết nối, %llu lần mất kết nối, %llu lần kết nối lại, "
+        "%llu lần kết nối lỗi, MTTR %s\n\n",
+        FormatDuration(wallUs).c_str(), wallUs > 0 ? 100.0 * (double)sum.uptimeUs / (double)wallUs : 0.0,
+        (unsigned long long)sum.connects, (unsigned long long)sum.lost, (unsigned long long)sum.reconnects,
+        (unsigned long long)sum.failures,
+        reconnectSamples ? FormatDuration(sum.reconnectUs / (int64_t)reconnectSamples).c_str() : "-");
+
+    // mã lỗi
+    std::vector<std::pair<int, uint64_t>> codes(total.codes.begin(), total.codes.end());
+    std::sort(codes.begin(), codes.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::printf("mã lỗi (%zu loại)\n", codes.size());
+    uint64_t maxCode = codes.empty() ? 1 : codes.front().second;
+    for (const auto& [code, n] : codes) {
+        int bar = (int)(40 * n / maxCode);
+        std::printf("%8d %-20s %8llu %.*s\n", code, CodeName(code), (unsigned long long)n, bar,
+            "########################################");
+    }
+
+    // phút bận nhất
+    std::vector<std::pair<int64_t, uint64_t>> minutes(perMinute.begin(), perMinute.end());
+    size_t top = std::min(opt.top, minutes.size());
+    std::partial_sort(minutes.begin(), minutes.begin() + top, minutes.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+    std::printf("\n%zu phút nhiều log nhất\n", top);
+    for (size_t i = 0; i < top; ++i) {
+        int64_t key = minutes[i].first;
+        std::string label;
+        if (key >= 0) label = FormatTime(key * kMinuteUs, true).substr(0, 16);
+        else {
+            // log cũ: chỉ biết giờ trong ngày
+            char buf[24];
+            int64_t tod = (-1 - key) % (24 * 60);
+            std::snprintf(buf, sizeof(buf), "(không ngày) %02d:%02d", (int)(tod / 60), (int)(tod % 60));
+            label = buf;
+        }
+        std::printf("  %s  %8llu dòng\n", label.c_str(), (unsigned long long)minutes[i].second);
+    }
+    return 0;
+}
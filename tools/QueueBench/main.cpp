@@ -0,0 +1,230 @@
+﻿//
+// QueueBench: so sánh queue request cũ (mutex + condvar, copy vào / copy ra) với MpscQueue
+// (không khóa, move, node dùng lại) khi nhiều thread cùng Push và 1 worker lấy ra.
+// In ra: thông lượng, độ trễ từng lần Push (p50 / p99 / max), số lần cấp phát heap trong lúc đo,
+// số lần phải đánh thức consumer.
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp -o queuebench
+//   cl /std:c++20 /O2 /EHsc /I..\.. main.cpp
+//
+// Ví dụ: queuebench --items 200000 --producers 1,2,4,8
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include "CommonTypes.h"
+#include "RequestQueue.h"
+#include "ThreadSafeQueue.h"
+#include "MpscQueue.h"
+#include "../FleetBench/LatencyHistogram.h"
+
+// Đếm số lần cấp phát trong lúc đo
+static std::atomic<uint64_t> g_allocs{ 0 };
+
+void* operator new(std::size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // RequestQueue trước khi chuyển sang MpscQueue (giữ nguyên để làm mốc so sánh)
+    class LegacyRequestQueue {
+    public:
+        void Push(const Request& request) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push(request);
+            condition_.notify_one();
+        }
+
+        bool Pop(Request& request, int timeoutMs = 100) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (queue_.empty()) {
+                condition_.wait_for(lock, std::chrono::milliseconds(timeoutMs));
+                if (queue_.empty()) {
+                    return false;
+                }
+            }
+            request = queue_.front();
+            queue_.pop();
+            return true;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::queue<Request> queue_;
+        std::condition_variable condition_;
+    };
+
+    // Cùng 1 giao diện cho vòng đo: Push(Request&&) / Pop(Request&, timeoutMs)
+    struct LegacyAdapter {
+        LegacyRequestQueue q;
+        void Push(Request&& r) { q.Push(r); }     // bản cũ chỉ có Push(const&) → copy
+        bool Pop(Request& r) { return q.Pop(r, 100); }
+        uint64_t Wakeups() const { return 0; }
+    };
+
+    struct MutexAdapter {
+        ThreadSafeQueue<Request> q;
+        void Push(Request&& r) { q.Push(std::move(r)); }
+        bool Pop(Request& r) { return q.WaitPop(r, 100); }
+        uint64_t Wakeups() const { return 0; }
+    };
+
+    struct MpscAdapter {
+        BlockingMpscQueue<Request> q;
+        void Push(Request&& r) { q.Push(std::move(r)); }
+        bool Pop(Request& r) { return q.WaitPop(r, 100); }
+        uint64_t Wakeups() const { return q.Wakeups(); }
+    };
+
+    struct SingleConsumerAdapter {
+        ThreadSafeQueue<Request, QueueConsumers::Single> q;
+        void Push(Request&& r) { q.Push(std::move(r)); }
+        bool Pop(Request& r) { return q.WaitPop(r, 100); }
+        uint64_t Wakeups() const { return q.Wakeups(); }
+    };
+
+    struct RequestQueueAdapter {
+        RequestQueue q;
+        RequestQueueAdapter() {
+            // đo queue, không đo giới hạn / gộp request: bỏ capacity / maxAge mặc định
+            for (size_t i = 0; i < kRequestPriorityCount; ++i)
+                q.SetLanePolicy((RequestPriority)i, {});
+            q.SetCoalescing(false);
+        }
+        void Push(Request&& r) { q.Push(std::move(r)); }
+        bool Pop(Request& r) { return q.Pop(r, 100); }
+        uint64_t Wakeups() const { return q.Wakeups(); }
+    };
+
+    struct Result {
+        double seconds = 0;
+        uint64_t allocs = 0;
+        uint64_t wakeups = 0;
+        uint64_t p50 = 0, p99 = 0, max = 0;     // ns mỗi lần Push
+        bool ok = true;
+    };
+
+    Request MakeRequest(size_t i) {
+        Request r;
+        r.type = (i % 8 == 0) ? RequestType::RequestStatus : RequestType::RequestStartPrint;
+        r.data = L"BENCH-MESSAGE-0123456789";  // đủ dài để wstring nằm trên heap
+        r.count = (int)i;
+        r.payload.assign(16, (uint8_t)i);
+        return r;
+    }
+
+    template<typename Adapter>
+    Result Run(size_t producers, size_t itemsPerProducer) {
+        Adapter adapter;
+        LatencyHistogram pushNs;
+        std::atomic<bool> go{ false };
+        const size_t total = producers * itemsPerProducer;
+
+        // làm nóng: cho queue cấp đủ node trước khi đo
+        for (size_t i = 0; i < 1024; ++i) adapter.Push(MakeRequest(i));
+        Request sink;
+        for (size_t i = 0; i < 1024; ++i) adapter.Pop(sink);
+
+        // dựng sẵn request cho từng producer (không tính vào phần đo)
+        std::vector<std::vector<Request>> work(producers);
+        for (size_t p = 0; p < producers; ++p) {
+            work[p].reserve(itemsPerProducer);
+            for (size_t i = 0; i < itemsPerProducer; ++i) work[p].push_back(MakeRequest(i));
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                for (auto& r : work[p]) {
+                    auto t0 = Clock::now();
+                    adapter.Push(std::move(r));
+                    pushNs.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count());
+                }
+                });
+        }
+
+        Result res;
+        uint64_t allocs0 = g_allocs.load();
+        uint64_t wake0 = adapter.Wakeups();
+        auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+
+        size_t got = 0;
+        Request r;
+        while (got < total) {
+            if (adapter.Pop(r)) ++got;
+            else if (Clock::now() - start > std::chrono::seconds(60)) { res.ok = false; break; }
+        }
+        res.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (auto& t : threads) t.join();
+
+        res.allocs = g_allocs.load() - allocs0;
+        res.wakeups = adapter.Wakeups() - wake0;
+        res.p50 = pushNs.Percentile(0.50);
+        res.p99 = pushNs.Percentile(0.99);
+        res.max = pushNs.Max();
+        return res;
+    }
+
+    void Print(const char* name, size_t producers, size_t items, const Result& r) {
+        double total = (double)(producers * items);
+        std::printf("%-22s %3zu  %8.2f  %8.0f  %8.0f  %10llu  %9.2f  %8llu%s\n",
+            name, producers, total / r.seconds / 1e6,
+            (double)r.p50, (double)r.p99, (unsigned long long)r.max,
+            (double)r.allocs / total, (unsigned long long)r.wakeups, r.ok ? "" : "  (TIMEOUT)");
+    }
+
+    std::vector<size_t> ParseList(const char* s) {
+        std::vector<size_t> out;
+        while (*s) {
+            out.push_back((size_t)std::strtoul(s, const_cast<char**>(&s), 10));
+            if (*s == ',') ++s;
+            else if (*s) break;
+        }
+        return out;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t items = 200000;
+    std::vector<size_t> producerCounts = { 1, 2, 4, 8 };
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--items") && i + 1 < argc) items = (size_t)std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--producers") && i + 1 < argc) producerCounts = ParseList(argv[++i]);
+        else {
+            std::printf("queuebench [--items N] [--producers 1,2,4,8]\n");
+            return 1;
+        }
+    }
+
+    std::printf("%zu request / producer, 1 consumer\n", items);
+    std::printf("%-22s %3s  %8s  %8s  %8s  %10s  %9s  %8s\n",
+        "queue", "P", "Mops/s", "push p50", "push p99", "push max", "alloc/op", "wakeups");
+    for (size_t p : producerCounts) {
+        Print("mutex+condvar copy", p, items, Run<LegacyAdapter>(p, items));
+        Print("ThreadSafeQueue move", p, items, Run<MutexAdapter>(p, items));
+        Print("BlockingMpscQueue", p, items, Run<MpscAdapter>(p, items));
+        Print("ThreadSafeQueue Single", p, items, Run<SingleConsumerAdapter>(p, items));
+        Print("RequestQueue", p, items, Run<RequestQueueAdapter>(p, items));
+    }
+    return 0;
+}
@@ -0,0 +1,272 @@
+﻿//
+// RciReplay: phát lại file capture RCI (RciCapture, bật bằng LINX_RCI_CAPTURE=<file>) qua
+// RciClient + RciDecoder thật, không cần máy in:
+//   - mỗi connection id trong capture → 1 RciClient nối với 1 RciLoopbackTransport
+//   - frame Tx được gửi nguyên văn qua RciClient (pipeline), byte Rx được đẩy vào đầu máy in
+//     đúng từng đoạn như lúc recv → decoder gặp lại đúng cách cắt gói của TCP
+//   - so byte RciClient thực sự gửi với byte trong capture
+//
+// Build (từ thư mục này, Linux):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp ../../RciCapture.cpp ../../RciClient.cpp
+//       ../../RciDecoder.cpp ../../RciSimd.cpp ../../RciTransport.cpp ../../RciLoopbackTransport.cpp
+//       ../../RciReactor.cpp ../../RciReactorTransport.cpp ../../RciPosixTransport.cpp -o rcireplay
+// Windows: cl /std:c++20 /O2 /EHsc /I..\.. main.cpp + các file trên (thay 3 file Reactor/Posix bằng
+//   ..\..\RciWin32Transport.cpp)
+//
+// Ví dụ:
+//   rcireplay capture.rcicap                      phát lại đúng tốc độ đã ghi
+//   rcireplay capture.rcicap --speed max          nhanh nhất có thể
+//   rcireplay capture.rcicap --speed 10           nhanh gấp 10 lần
+//   rcireplay capture.rcicap --decode-only 50     chỉ đo RciDecoder trên byte Rx (50 vòng)
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "RciCapture.h"
+#include "RciClient.h"
+#include "RciDecoder.h"
+#include "RciLoopbackTransport.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string path;
+        double speed = 1.0;         // 0 = nhanh nhất có thể
+        size_t window = 64;
+        int timeoutMs = 3000;
+        int decodeOnly = 0;         // > 0: số vòng benchmark decoder
+        bool verbose = false;
+    };
+
+    void Usage() {
+        std::printf(
+            "rcireplay <file> [options]\n"
+            "  --speed realtime|max|<x>   tốc độ phát lại (mặc định realtime)\n"
+            "  --window <n>               cửa sổ pipeline của RciClient (mặc định 64)\n"
+            "  --timeout-ms <ms>          hạn chờ reply mỗi lệnh (mặc định 3000)\n"
+            "  --decode-only <n>          chỉ chạy RciDecoder trên byte Rx, lặp n vòng\n"
+            "  --verbose                  in log của RciClient\n");
+    }
+
+    bool ParseArgs(int argc, char** argv, Options& o) {
+        for (int i = 1; i < argc; ++i) {
+            std::string a = argv[i];
+            auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+            if (a == "--speed") {
+                const char* v = next();
+                if (!v) return false;
+                if (!strcmp(v, "realtime")) o.speed = 1.0;
+                else if (!strcmp(v, "max")) o.speed = 0.0;
+                else o.speed = std::atof(v);
+                if (o.speed < 0) return false;
+            }
+            else if (a == "--window") { const char* v = next(); if (!v) return false; o.window = (size_t)std::atoi(v); }
+            else if (a == "--timeout-ms") { const char* v = next(); if (!v) return false; o.timeoutMs = std::atoi(v); }
+            else if (a == "--decode-only") { const char* v = next(); if (!v) return false; o.decodeOnly = std::atoi(v); }
+            else if (a == "--verbose") o.verbose = true;
+            else if (a == "-h" || a == "--help") return false;
+            else if (o.path.empty() && a[0] != '-') o.path = a;
+            else return false;
+        }
+        return !o.path.empty();
+    }
+
+    // cmdid của frame request đã encode: ESC STX|SOH <cmdid> (cmdid có thể bị escape)
+    int RequestCmd(const std::vector<uint8_t>& frame) {
+        if (frame.size() < 3 || frame[0] != RciFrame::ESC) return -1;
+        if (frame[2] != RciFrame::ESC) return frame[2];
+        return frame.size() > 3 ? frame[3] : -1;
+    }
+
+    // =====================================================
+    // --decode-only: thông lượng RciDecoder trên đúng các đoạn byte đã recv
+    // =====================================================
+    int RunDecodeOnly(const std::vector<RciCaptureReader::Record>& records, int rounds) {
+        std::map<uint32_t, std::vector<const std::vector<uint8_t>*>> rx;
+        size_t bytes = 0;
+        for (const auto& r : records) {
+            if (r.dir != RciCapture::Direction::Rx) continue;
+            rx[r.connId].push_back(&r.data);
+            bytes += r.data.size();
+        }
+        if (bytes == 0) {
+            std::printf("capture không có byte Rx\n");
+            return 1;
+        }
+
+        uint64_t frames = 0, badChecksum = 0, resync = 0;
+        auto t0 = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (const auto& [connId, chunks] : rx) {
+                RciDecoder decoder;     // mỗi kết nối 1 decoder như RciClient
+                for (const auto* chunk : chunks) {
+                    const uint8_t* p = chunk->data();
+                    size_t left = chunk->size();
+                    while (left > 0) {
+                        size_t used = 0;
+                        if (decoder.Feed(p, left, used) == RciDecoder::Result::Frame) {
+                            ++frames;
+                            if (!decoder.Frame().checksumOk) ++badChecksum;
+                        }
+                        p += used;
+                        left -= used;
+                    }
+                }
+                resync += decoder.ResyncCount();
+            }
+        }
+        double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+        double totalBytes = (double)bytes * rounds;
+        std::printf("decode-only: %d vòng, %zu kết nối, %zu byte Rx/vòng\n", rounds, rx.size(), bytes);
+        std::printf("  frames        %llu (%llu sai checksum, %llu resync)\n",
+            (unsigned long long)frames, (unsigned long long)badChecksum, (unsigned long long)resync);
+        std::printf("  thời gian     %.3f s\n", sec);
+        std::printf("  thông lượng   %.1f MB/s, %.0f frame/s\n",
+            sec > 0 ? totalBytes / sec / 1e6 : 0.0, sec > 0 ? (double)frames / sec : 0.0);
+        return 0;
+    }
+
+    // =====================================================
+    // Phát lại qua RciClient
+    // =====================================================
+    struct Counters {
+        std::atomic<uint64_t> submitted{ 0 };
+        std::atomic<uint64_t> completed{ 0 };
+        std::atomic<uint64_t> status[6] = {};   // theo RciResult::Status
+        std::atomic<uint64_t> naks{ 0 };
+        std::atomic<uint64_t> badChecksum{ 0 };
+    };
+
+    struct Connection {
+        std::unique_ptr<RciClient> client;
+        std::unique_ptr<RciLoopbackTransport> printer;     // đầu máy in của cặp loopback
+        std::vector<uint8_t> sent;                          // byte RciClient vừa gửi
+        bool ok = false;
+    };
+
+    const char* StatusName(size_t i) {
+        static const char* names[] = { "ok", "timeout", "disconnected", "send_failed", "cancelled", "invalid" };
+        return i < 6 ? names[i] : "?";
+    }
+
+    int RunReplay(const std::vector<RciCaptureReader::Record>& records, const Options& o) {
+        std::map<uint32_t, Connection> conns;
+        Counters counters;
+        uint64_t txFrames = 0, rxChunks = 0, txMismatch = 0, failedConnect = 0;
+        uint64_t maxLateNs = 0;
+
+        auto open = [&](uint32_t connId) -> Connection& {
+            auto it = conns.find(connId);
+            if (it != conns.end()) return it->second;
+
+            Connection& c = conns[connId];
+            auto pair = RciLoopbackTransport::CreatePair();
+            c.client = std::make_unique<RciClient>(std::move(pair.first));
+            c.printer = std::move(pair.second);
+            if (o.verbose) {
+                c.client->SetMessageCallback([connId](std::wstring_view msg, int) {
+                    std::fwprintf(stderr, L"[%u] %.*ls\n", connId, (int)msg.size(), msg.data());
+                    });
+            }
+            c.client->SetPipelineWindow(o.window < 2 ? 2 : o.window);
+            c.ok = c.client->Connect(L"replay", 0, 1000);
+            if (!c.ok) ++failedConnect;
+            return c;
+        };
+
+        auto start = Clock::now();
+        for (const auto& r : records) {
+            if (o.speed > 0) {
+                auto due = start + std::chrono::nanoseconds((uint64_t)((double)r.timeNs / o.speed));
+                auto now = Clock::now();
+                if (due > now) std::this_thread::sleep_until(due);
+                else maxLateNs = std::max<uint64_t>(maxLateNs, (uint64_t)(now - due).count());
+            }
+
+            Connection& c = open(r.connId);
+            if (!c.ok) continue;
+
+            if (r.dir == RciCapture::Direction::Tx) {
+                ++txFrames;
+                counters.submitted.fetch_add(1, std::memory_order_relaxed);
+                c.client->SubmitRawFrame(r.data.data(), r.data.size(), RequestCmd(r.data), o.timeoutMs,
+                    [&counters](const RciResult& res) {
+                        counters.status[(size_t)res.status].fetch_add(1, std::memory_order_relaxed);
+                        if (res.Ok() && res.type == RciFrame::NAK) counters.naks.fetch_add(1, std::memory_order_relaxed);
+                        if (res.Ok() && !res.checksumOk) counters.badChecksum.fetch_add(1, std::memory_order_relaxed);
+                        counters.completed.fetch_add(1, std::memory_order_release);
+                    });
+
+                // byte thực sự đi ra phải trùng capture
+                c.sent.clear();
+                uint8_t buf[4096];
+                size_t n = 0;
+                while (c.sent.size() < r.data.size() &&
+                    c.printer->Receive(buf, sizeof(buf), n, Clock::now()) == IRciTransport::IoResult::Ok)
+                    c.sent.insert(c.sent.end(), buf, buf + n);
+                if (c.sent != r.data) ++txMismatch;
+            }
+            else {
+                ++rxChunks;
+                c.printer->Send(r.data.data(), r.data.size());
+            }
+        }
+
+        // chờ các lệnh còn đang bay (reply cuối cùng có thể không có trong capture)
+        auto waitUntil = Clock::now() + std::chrono::milliseconds(o.timeoutMs + 1000);
+        while (counters.completed.load(std::memory_order_acquire) < counters.submitted.load() &&
+            Clock::now() < waitUntil)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        double sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (auto& [id, c] : conns)
+            if (c.ok) c.client->Disconnect();
+
+        double captureSec = records.empty() ? 0.0 : (double)records.back().timeNs / 1e9;
+        std::printf("replay: %zu bản ghi, %zu kết nối (%llu lỗi kết nối)\n",
+            records.size(), conns.size(), (unsigned long long)failedConnect);
+        std::printf("  tx frames     %llu (%llu khác capture)\n",
+            (unsigned long long)txFrames, (unsigned long long)txMismatch);
+        std::printf("  rx chunks     %llu\n", (unsigned long long)rxChunks);
+        std::printf("  kết quả      ");
+        for (size_t i = 0; i < 6; ++i)
+            std::printf(" %s=%llu", StatusName(i), (unsigned long long)counters.status[i].load());
+        std::printf("\n  nak           %llu, sai checksum %llu\n",
+            (unsigned long long)counters.naks.load(), (unsigned long long)counters.badChecksum.load());
+        std::printf("  thời gian     %.3f s (capture %.3f s, x%.1f)\n",
+            sec, captureSec, sec > 0 ? captureSec / sec : 0.0);
+        if (o.speed > 0)
+            std::printf("  trễ lịch tối đa %.3f ms\n", (double)maxLateNs / 1e6);
+        return txMismatch == 0 && counters.status[0].load() == counters.submitted.load() ? 0 : 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!ParseArgs(argc, argv, o)) {
+        Usage();
+        return 1;
+    }
+
+    RciCaptureReader reader;
+    if (!reader.Open(o.path)) {
+        std::fprintf(stderr, "không đọc được capture: %s\n", o.path.c_str());
+        return 1;
+    }
+
+    std::vector<RciCaptureReader::Record> records;
+    RciCaptureReader::Record r;
+    while (reader.Next(r)) records.push_back(std::move(r));
+
+    return o.decodeOnly > 0 ? RunDecodeOnly(records, o.decodeOnly) : RunReplay(records, o);
+}
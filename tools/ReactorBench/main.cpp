@@ -0,0 +1,165 @@
+﻿//
+// ReactorBench: so sánh 2 transport Linux của RciClient khi N kết nối cùng gửi lệnh tới LinxSim:
+//   - posix:   RciPosixTransport, chế độ pipeline có 1 reader thread chặn cho mỗi kết nối
+//   - reactor: RciReactorTransport, mọi kết nối dùng chung 1 thread epoll (RciReactor::Default)
+// In ra: lệnh / giây, độ trễ p50 / p99 / max (SetCommandObserver), CPU user + sys, số context
+// switch (getrusage) và số thread I/O mà transport tạo thêm.
+//
+// Chạy (Linux):
+//   linxsim --port 20000 --count 200 --threads 2
+//   reactorbench --port 20000 --clients 200 --commands 2000 --window 8
+//   reactorbench --port 20000 --clients 200 --commands 500 --window 1     (đồng bộ: send + poll + recv)
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -pthread -I../.. main.cpp ../../RciClient.cpp ../../RciDecoder.cpp ../../RciSimd.cpp
+//       ../../RciCapture.cpp ../../RciTransport.cpp ../../RciReactor.cpp ../../RciReactorTransport.cpp
+//       ../../RciPosixTransport.cpp -o reactorbench
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sys/resource.h>
+#include "RciClient.h"
+#include "RciCommands.h"
+#include "RciPosixTransport.h"
+#include "RciReactorTransport.h"
+#include "../FleetBench/LatencyHistogram.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::wstring host = L"127.0.0.1";
+        int port = 20000;
+        size_t clients = 100;
+        size_t commands = 1000;     // mỗi client
+        size_t window = 8;          // 1 = đồng bộ
+        std::string transport = "both";
+    };
+
+    struct Usage {
+        double cpuSec = 0;
+        long contextSwitches = 0;
+    };
+
+    Usage ReadUsage() {
+        rusage ru{};
+        getrusage(RUSAGE_SELF, &ru);
+        Usage u;
+        u.cpuSec = (double)ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+            (double)ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+        u.contextSwitches = ru.ru_nvcsw + ru.ru_nivcsw;
+        return u;
+    }
+
+    int ThreadCount() {
+        std::ifstream in("/proc/self/status");
+        std::string line;
+        while (std::getline(in, line))
+            if (line.rfind("Threads:", 0) == 0) return std::atoi(line.c_str() + 8);
+        return 0;
+    }
+
+    bool Run(const Options& opt, bool reactor) {
+        const char* name = reactor ? "reactor" : "posix";
+        LatencyHistogram latencyUs;
+        std::atomic<uint64_t> completed{ 0 }, failed{ 0 };
+
+        int threadsBefore = ThreadCount();
+        std::vector<std::unique_ptr<RciClient>> clients;
+        for (size_t i = 0; i < opt.clients; ++i) {
+            std::unique_ptr<IRciTransport> transport;
+            if (reactor) transport = std::make_unique<RciReactorTransport>();
+            else transport = std::make_unique<RciPosixTransport>();
+
+            auto client = std::make_unique<RciClient>(std::move(transport));
+            client->SetCommandObserver([&](uint8_t, Clock::duration rtt, RciResult::Status) {
+                latencyUs.Record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(rtt).count());
+            });
+            client->SetPipelineWindow(opt.window);
+            if (!client->Connect(opt.host, (unsigned short)(opt.port + i), 3000)) {
+                std::printf("%s: không kết nối được cổng %d (linxsim --port %d --count %zu?)\n",
+                    name, opt.port + (int)i, opt.port, opt.clients);
+                return false;
+            }
+            clients.push_back(std::move(client));
+        }
+        int ioThreads = ThreadCount() - threadsBefore;
+
+        // mỗi client 1 thread gửi (giống nhau ở 2 transport); pipeline: chặn khi đủ window lệnh chờ
+        const uint64_t total = (uint64_t)opt.clients * opt.commands;
+        Usage u0 = ReadUsage();
+        auto t0 = Clock::now();
+        std::vector<std::thread> drivers;
+        for (auto& c : clients) {
+            RciClient* client = c.get();
+            drivers.emplace_back([&, client] {
+                std::vector<uint8_t> reply;
+                for (size_t k = 0; k < opt.commands; ++k) {
+                    if (opt.window > 1) {
+                        client->SubmitCommand(RciCmd::Status, {}, 3000, [&](const RciResult& r) {
+                            if (!r.Ok()) failed.fetch_add(1, std::memory_order_relaxed);
+                            completed.fetch_add(1, std::memory_order_relaxed);
+                        });
+                    }
+                    else {
+                        if (!client->SendCommand(RciCmd::Status, nullptr, 0, reply))
+                            failed.fetch_add(1, std::memory_order_relaxed);
+                        completed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (auto& t : drivers) t.join();
+        while (completed.load() < total && Clock::now() - t0 < std::chrono::seconds(60))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+        Usage u1 = ReadUsage();
+
+        for (auto& c : clients) c->Disconnect();
+
+        std::printf("%-9s %7zu %9.0f %8llu %8llu %8llu %9.2f %10.1f %8d %6llu\n", name, opt.clients,
+            (double)completed.load() / sec,
+            (unsigned long long)latencyUs.Percentile(0.50), (unsigned long long)latencyUs.Percentile(0.99),
+            (unsigned long long)latencyUs.Max(), u1.cpuSec - u0.cpuSec,
+            (double)(u1.contextSwitches - u0.contextSwitches) / (double)(completed.load() ? completed.load() : 1),
+            ioThreads, (unsigned long long)failed.load());
+        return failed.load() == 0 && completed.load() == total;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : ""; };
+        if (!std::strcmp(argv[i], "--host")) { std::string h = next(); opt.host.assign(h.begin(), h.end()); }
+        else if (!std::strcmp(argv[i], "--port")) opt.port = std::atoi(next());
+        else if (!std::strcmp(argv[i], "--clients")) opt.clients = std::strtoull(next(), nullptr, 10);
+        else if (!std::strcmp(argv[i], "--commands")) opt.commands = std::strtoull(next(), nullptr, 10);
+        else if (!std::strcmp(argv[i], "--window")) opt.window = std::strtoull(next(), nullptr, 10);
+        else if (!std::strcmp(argv[i], "--transport")) opt.transport = next();
+        else {
+            std::printf("usage: reactorbench [--host H] [--port N] [--clients N] [--commands N] "
+                "[--window N] [--transport posix|reactor|both]\n");
+            return 2;
+        }
+    }
+
+    std::printf("%zu client x %zu lệnh STATUS, window %zu%s\n", opt.clients, opt.commands, opt.window,
+        opt.window > 1 ? "" : " (đồng bộ)");
+    std::printf("%-9s %7s %9s %8s %8s %8s %9s %10s %8s %6s\n", "transport", "clients", "cmd/s",
+        "p50 us", "p99 us", "max us", "CPU s", "ctxsw/cmd", "threads", "errors");
+
+    bool ok = true;
+    if (opt.transport != "reactor") ok = Run(opt, false) && ok;
+    if (opt.transport != "posix") ok = Run(opt, true) && ok;
+    return ok ? 0 : 1;
+}
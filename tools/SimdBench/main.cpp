@@ -0,0 +1,303 @@
+﻿//
+// SimdBench: kiểm tra kernel RciSimd (SSE2 / AVX2) cho ra đúng từng byte như bản scalar, rồi đo tốc độ
+// encode (RciFrame → RciSimd::Escape) và decode (RciDecoder → FindEsc / Sum) theo từng mức dispatch.
+//   - so sánh: payload ngẫu nhiên đủ độ dài quanh ngưỡng 16 / 32 byte, lệch căn lề 0..31, mật độ byte
+//     điều khiển từ 0 tới 100%; FindControl / FindEsc / Sum / Escape so với *Scalar, RciDecoder giải mã
+//     frame lệnh và frame reply cắt thành các đoạn ngẫu nhiên (như TCP) phải ra đúng payload gốc
+//   - đo: payload cỡ thật của 0x1D (remote field, vài chục byte) tới 0x19 (message data, vài KB),
+//     dạng text (không có byte điều khiển) và nhị phân ngẫu nhiên
+// Thoát với mã 1 nếu có sai khác.
+//
+// Build (từ thư mục này):
+//   g++ -std=c++20 -O2 -I../.. main.cpp ../../RciSimd.cpp ../../RciDecoder.cpp -o simdbench
+//   cl /std:c++20 /O2 /EHsc /I..\.. main.cpp ..\..\RciSimd.cpp ..\..\RciDecoder.cpp
+//
+// Ví dụ: simdbench --rounds 20000 --mb 64
+//        simdbench --check-only
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "RciSimd.h"
+#include "RciFrame.h"
+#include "RciDecoder.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    const char* LevelName(RciSimd::Level level) {
+        switch (level) {
+        case RciSimd::Level::SSE2: return "SSE2";
+        case RciSimd::Level::AVX2: return "AVX2";
+        default: return "Scalar";
+        }
+    }
+
+    // Các mức CPU này chạy được (Scalar luôn có)
+    std::vector<RciSimd::Level> AvailableLevels() {
+        std::vector<RciSimd::Level> levels;
+        for (int lv = 0; lv <= (int)RciSimd::DetectLevel(); ++lv) levels.push_back((RciSimd::Level)lv);
+        return levels;
+    }
+
+    const uint8_t kControls[] = { RciFrame::ESC, RciFrame::STX, RciFrame::SOH, RciFrame::ETX };
+
+    // density: xác suất 1 byte là byte điều khiển (< 0: byte ngẫu nhiên đều)
+    void FillPayload(std::mt19937& rng, uint8_t* p, size_t n, double density) {
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        for (size_t i = 0; i < n; ++i) {
+            if (density < 0) p[i] = (uint8_t)rng();
+            else if (coin(rng) < density) p[i] = kControls[rng() % 4];
+            else p[i] = (uint8_t)(0x20 + rng() % 0x5F);
+        }
+    }
+
+    // Frame reply như máy in gửi: ESC ACK <body, chỉ nhân đôi ESC> ESC ETX [ESC] checksum
+    // (decoder coi ESC ETX là hết body; checksum là byte điều khiển → có ESC đứng trước)
+    size_t EncodeReply(uint8_t* out, const uint8_t* p, size_t n) {
+        size_t len = 0;
+        unsigned int sum = RciFrame::ACK;
+        out[len++] = RciFrame::ESC;
+        out[len++] = RciFrame::ACK;
+        for (size_t i = 0; i < n; ++i) {
+            sum += p[i];
+            if (p[i] == RciFrame::ESC) out[len++] = RciFrame::ESC;
+            out[len++] = p[i];
+        }
+        out[len++] = RciFrame::ESC;
+        out[len++] = RciFrame::ETX;
+        uint8_t checksum = RciFrame::ChecksumFromSum(sum + RciFrame::ETX);
+        if (RciFrame::IsControlByte(checksum)) out[len++] = RciFrame::ESC;
+        out[len++] = checksum;
+        return len;
+    }
+
+    struct Checker {
+        uint64_t cases = 0;
+        uint64_t failures = 0;
+
+        void Fail(const char* what, RciSimd::Level level, size_t n, size_t offset, double density) {
+            if (failures < 20)
+                std::printf("  SAI %-12s level=%s n=%zu lệch=%zu mật độ=%.3f\n", what, LevelName(level), n, offset, density);
+            ++failures;
+        }
+
+        // Kernel so với bản scalar trên cùng dữ liệu
+        void Kernels(RciSimd::Level level, const uint8_t* p, size_t n, size_t offset, double density,
+            std::vector<uint8_t>& outSimd, std::vector<uint8_t>& outScalar) {
+            ++cases;
+            if (RciSimd::FindControl(p, n) != RciSimd::FindControlScalar(p, n)) Fail("FindControl", level, n, offset, density);
+            if (RciSimd::FindEsc(p, n) != RciSimd::FindEscScalar(p, n)) Fail("FindEsc", level, n, offset, density);
+            if (RciSimd::Sum(p, n) != RciSimd::SumScalar(p, n)) Fail("Sum", level, n, offset, density);
+
+            // sum khởi đầu khác 0: Escape cộng dồn vào giá trị có sẵn
+            outSimd.assign(2 * n + 64, 0xCC);
+            outScalar.assign(2 * n + 64, 0xCC);
+            unsigned int sumSimd = 0x1234, sumScalar = 0x1234;
+            size_t a = RciSimd::Escape(p, n, outSimd.data(), sumSimd);
+            size_t b = RciSimd::EscapeScalar(p, n, outScalar.data(), sumScalar);
+            // so cả phần sau byte cuối: kernel không được ghi quá số byte trả về
+            if (a != b || sumSimd != sumScalar || outSimd != outScalar) Fail("Escape", level, n, offset, density);
+        }
+
+        // Frame encode → cắt đoạn ngẫu nhiên → decode phải ra đúng payload, checksum đúng.
+        // reply: ESC ACK, chỉ nhân đôi ESC, checksum điều khiển có ESC đứng trước. Không phải reply:
+        // ESC STX, escape cả STX/SOH (ESC ETX là hết body nên payload loại này không chứa ETX),
+        // checksum thô như RciClient gửi.
+        void Decoder(std::mt19937& rng, RciSimd::Level level, const uint8_t* src, size_t n, double density, bool reply) {
+            ++cases;
+            std::vector<uint8_t> payload(src, src + n);
+            if (!reply) std::replace(payload.begin(), payload.end(), RciFrame::ETX, (uint8_t)0x7E);
+            const uint8_t* p = payload.data();
+
+            std::vector<uint8_t> frame(RciFrame::MaxEncodedSize(n) + 1);
+            size_t len;
+            if (reply) {
+                len = EncodeReply(frame.data(), p, n);
+            }
+            else {
+                RciFrame::Writer w(frame.data(), frame.size());
+                w.Put(p, n);
+                len = w.End();
+            }
+            // rác trước frame: decoder phải bỏ qua tới ESC <type>
+            std::vector<uint8_t> wire = { 0x55, 0x00 };
+            wire.insert(wire.end(), frame.begin(), frame.begin() + (ptrdiff_t)len);
+
+            RciDecoder decoder(64 * 1024);
+            size_t at = 0;
+            bool got = false;
+            while (at < wire.size() && !got) {
+                size_t chunk = std::min(wire.size() - at, (size_t)(1 + rng() % 200));
+                size_t consumed = 0;
+                got = decoder.Feed(wire.data() + at, chunk, consumed) == RciDecoder::Result::Frame;
+                at += consumed;
+            }
+            const RciFrameView& f = decoder.Frame();
+            bool ok = got && f.type == (reply ? RciFrame::ACK : RciFrame::STX) &&
+                f.size == n && f.checksumOk && (n == 0 || std::memcmp(f.body, p, n) == 0);
+            // checksum ESC dạng ESC ESC: frame ra ở ESC đầu, ESC thừa không được sinh frame nào
+            if (ok && at < wire.size()) {
+                size_t consumed = 0;
+                ok = wire.size() - at == 1 && wire[at] == RciFrame::ESC &&
+                    decoder.Feed(wire.data() + at, 1, consumed) == RciDecoder::Result::NeedMore;
+            }
+            if (!ok) Fail(reply ? "Decoder(ACK)" : "Decoder(STX)", level, n, 0, density);
+        }
+
+        // Checksum đúng bằng ESC (~1/256 frame): reply của LinxSim (ESC ESC) và lệnh RciClient (ESC thô),
+        // mỗi loại nối 1 frame STATUS phía sau trong cùng luồng, đưa vào decoder từng byte và cả khối
+        void EscChecksum() {
+            uint8_t stream[2 * RciFrame::MaxEncodedSize(16)];
+            for (bool reply : { true, false }) {
+                ++cases;
+                // reply: body 00 00 14 C8 → checksum 0x1B; lệnh: cmdid 0x12 + payload 0xCE → 0x1B
+                const uint8_t replyBody[] = { 0x00, 0x00, 0x14, 0xC8 };
+                const uint8_t cmdPayload[] = { 0xCE };
+                size_t len;
+                if (reply) {
+                    auto w = RciFrame::Writer::Reply(stream, sizeof(stream), true);
+                    w.Put(replyBody, sizeof(replyBody));
+                    len = w.End();
+                }
+                else {
+                    len = RciFrame::Encode(stream, sizeof(stream), 0x12, cmdPayload, sizeof(cmdPayload));
+                }
+                bool ok = len >= 2 && stream[len - 1] == RciFrame::ESC &&
+                    (stream[len - 2] == RciFrame::ESC) == reply;
+                len += RciFrame::Encode(stream + len, sizeof(stream) - len, 0x14, nullptr, 0);
+
+                for (size_t chunk : { (size_t)1, len }) {
+                    RciDecoder decoder(64 * 1024);
+                    size_t at = 0, frames = 0;
+                    while (at < len) {
+                        size_t consumed = 0;
+                        if (decoder.Feed(stream + at, std::min(chunk, len - at), consumed) == RciDecoder::Result::Frame) {
+                            const RciFrameView& f = decoder.Frame();
+                            ok = ok && f.checksumOk && (frames > 0 || f.checksum == RciFrame::ESC) &&
+                                f.size == (frames > 0 ? 1 : reply ? sizeof(replyBody) : 1 + sizeof(cmdPayload));
+                            ++frames;
+                        }
+                        at += consumed;
+                    }
+                    ok = ok && frames == 2 && decoder.ResyncCount() == 0;
+                }
+                if (!ok) Fail(reply ? "EscChecksum(ACK)" : "EscChecksum(STX)", RciSimd::GetLevel(), len, 0, 0.0);
+            }
+        }
+    };
+
+    bool RunChecks(uint64_t rounds) {
+        std::printf("== So sánh với scalar (%llu vòng mỗi mức) ==\n", (unsigned long long)rounds);
+        const double densities[] = { 0.0, 0.001, 0.02, 0.1, 0.5, 1.0, -1.0 };
+        Checker checker;
+        std::vector<uint8_t> buffer(4096 + 64), outSimd, outScalar;
+
+        for (RciSimd::Level level : AvailableLevels()) {
+            RciSimd::SetLevel(level);
+            if (RciSimd::GetLevel() != level) continue;
+            uint64_t before = checker.failures;
+            std::mt19937 rng(12345);    // cùng dữ liệu cho mọi mức
+
+            // độ dài biên: quanh 16 / 32 / 64 byte và ngưỡng kBulkThreshold
+            for (size_t n = 0; n <= 200; ++n) {
+                for (size_t offset = 0; offset < 32; ++offset) {
+                    double density = densities[(n + offset) % 7];
+                    FillPayload(rng, buffer.data() + offset, n, density);
+                    checker.Kernels(level, buffer.data() + offset, n, offset, density, outSimd, outScalar);
+                }
+            }
+            // ngẫu nhiên tới 4 KB, byte điều khiển đúng ở cuối / đầu khối vector
+            for (uint64_t r = 0; r < rounds; ++r) {
+                size_t n = rng() % 4097;
+                size_t offset = rng() % 32;
+                double density = densities[rng() % 7];
+                uint8_t* p = buffer.data() + offset;
+                FillPayload(rng, p, n, density);
+                if (n && r % 3 == 0) p[rng() % n] = kControls[rng() % 4];
+                if (n && r % 5 == 0) p[n - 1] = kControls[rng() % 4];
+                checker.Kernels(level, p, n, offset, density, outSimd, outScalar);
+                if (r % 4 == 0) checker.Decoder(rng, level, p, n, density, (r / 4) % 2 == 1);
+            }
+            checker.EscChecksum();
+            std::printf("  %-6s %s\n", LevelName(level), checker.failures == before ? "khớp" : "CÓ SAI KHÁC");
+        }
+        std::printf("  %llu trường hợp, %llu sai\n\n", (unsigned long long)checker.cases, (unsigned long long)checker.failures);
+        return checker.failures == 0;
+    }
+
+    volatile size_t g_sink;
+
+    void RunBench(size_t megabytes) {
+        std::printf("== Tốc độ (payload MB/s, ns mỗi frame) ==\n");
+        std::printf("%-8s %-6s %7s %12s %10s %12s %10s\n", "dữ liệu", "mức", "byte", "encode MB/s", "ns/frame", "decode MB/s", "ns/frame");
+        // 0x1D remote field: vài chục byte; 0x19 message data: vài trăm byte tới vài KB
+        const size_t sizes[] = { 24, 64, 256, 1024, 4096, 16384 };
+        std::mt19937 rng(777);
+
+        for (int profile = 0; profile < 2; ++profile) {
+            const char* name = profile == 0 ? "text" : "nhị phân";
+            for (size_t n : sizes) {
+                std::vector<uint8_t> payload(n);
+                FillPayload(rng, payload.data(), n, profile == 0 ? 0.0 : -1.0);
+                std::vector<uint8_t> frame(RciFrame::MaxEncodedSize(n) + 1);
+
+                for (RciSimd::Level level : AvailableLevels()) {
+                    RciSimd::SetLevel(level);
+                    if (RciSimd::GetLevel() != level) continue;
+                    size_t iterations = std::max<size_t>(1, (megabytes << 20) / n);
+
+                    size_t len = 0;
+                    auto t0 = Clock::now();
+                    for (size_t i = 0; i < iterations; ++i)
+                        len = RciFrame::Encode(frame.data(), frame.size(), 0x19, payload.data(), n);
+                    double encodeSec = std::chrono::duration<double>(Clock::now() - t0).count();
+                    g_sink = len;
+
+                    // reply cùng payload
+                    len = EncodeReply(frame.data(), payload.data(), n);
+                    RciDecoder decoder(64 * 1024);
+                    t0 = Clock::now();
+                    for (size_t i = 0; i < iterations; ++i) {
+                        size_t consumed;
+                        decoder.Feed(frame.data(), len, consumed);
+                        g_sink = decoder.Frame().size;
+                    }
+                    double decodeSec = std::chrono::duration<double>(Clock::now() - t0).count();
+
+                    double mb = (double)n * iterations / 1e6;
+                    std::printf("%-8s %-6s %7zu %12.0f %10.1f %12.0f %10.1f\n", name, LevelName(level), n,
+                        mb / encodeSec, encodeSec * 1e9 / iterations, mb / decodeSec, decodeSec * 1e9 / iterations);
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t rounds = 20000;
+    size_t megabytes = 64;
+    bool checkOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--mb") && i + 1 < argc) megabytes = (size_t)std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--check-only")) checkOnly = true;
+        else {
+            std::printf("simdbench [--rounds N] [--mb N] [--check-only]\n");
+            return 2;
+        }
+    }
+
+    std::printf("CPU: %s\n\n", LevelName(RciSimd::DetectLevel()));
+    bool ok = RunChecks(rounds);
+    if (!checkOnly) RunBench(std::max<size_t>(1, megabytes));
+    RciSimd::SetLevel(RciSimd::DetectLevel());
+    return ok ? 0 : 1;
+}